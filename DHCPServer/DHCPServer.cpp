@@ -34,6 +34,7 @@ namespace Plugin {
     DHCPServer::DHCPServer()
         : _skipURL(0)
         , _servers()
+        , _stores()
     {
         RegisterAll();
     }
@@ -78,8 +79,17 @@ namespace Plugin {
                         dns,
                         std::bind(&DHCPServer::OnNewIPRequest, this, std::placeholders::_1, std::placeholders::_2)));
 
-                if (server.second == true) {
-                    LoadLeases(server.first->first, server.first->second);
+                if ((server.second == true) && (_persistentPath.empty() == false)) {
+                    auto store = _stores.emplace(std::piecewise_construct,
+                        std::make_tuple(server.first->first),
+                        std::forward_as_tuple(_persistentPath + server.first->first + _T(".leases"), server.first->second));
+
+                    if (store.first->second.Restore() == false) {
+                        LoadLeases(server.first->first, server.first->second);
+                    }
+                    if (store.first->second.Open() != Core::ERROR_NONE) {
+                        SYSLOG(Logging::Notification, (_T("Leases of %s are not kept over a restart"), server.first->first.c_str()));
+                    }
                 }
             }
         }
@@ -97,6 +107,8 @@ namespace Plugin {
             index++;
         }
 
+        // The stores refer to the servers.
+        _stores.clear();
         _servers.clear();
     }
 
@@ -186,32 +198,6 @@ namespace Plugin {
         return result;
     }
 
-    void DHCPServer::SaveLeases(const string& interface, const DHCPServerImplementation& dhcpServer) const
-    {
-
-        if (_persistentPath.empty() == false) {
-            Core::JSON::ArrayType<Data::Server::Lease> leasesList;
-
-            // Saving to file might take a while, and lifetime of DHCPServerImplementation::Iterator
-            // object must be deterministic and short (<10ms), so we scope it 
-            {
-                DHCPServerImplementation::Iterator leases = dhcpServer.Leases();
-                while(leases.Next() && (leases.IsValid() == true)) {
-                    leasesList.Add().Set(leases.Current());
-                }        
-            }
-
-            Core::File leasesFile(_persistentPath + interface + ".json");
-
-            if (leasesFile.Create() == true) {
-                leasesList.IElement::ToFile(leasesFile);
-                leasesFile.Close();
-            } else {
-                TRACE_L1("Could not save leases in pemranent storage area.\n");
-            }
-        }
-    }
-
     void DHCPServer::LoadLeases(const string& interface, DHCPServerImplementation& dhcpServer) 
     {
 
@@ -238,11 +224,13 @@ namespace Plugin {
 
     void DHCPServer::OnNewIPRequest(const string& interface, const DHCPServerImplementation::Lease* lease) 
     {
-        TRACE(Trace::Information, ("DHCP server granted address %s on interface %s", lease->Address().HostAddress().c_str(), interface.c_str()));
+        if (lease->Expiration() != 0) {
+            TRACE(Trace::Information, ("DHCP server granted address %s on interface %s", lease->Address().HostAddress().c_str(), interface.c_str()));
+        }
 
-        auto dhcpServer = _servers.find(interface);
-        if (dhcpServer != _servers.end()) {
-            SaveLeases(interface, dhcpServer->second);
+        auto store = _stores.find(interface);
+        if (store != _stores.end()) {
+            store->second.Append(*lease);
         }
     }
 
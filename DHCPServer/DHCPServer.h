@@ -20,7 +20,9 @@
 #pragma once
 
 #include "DHCPServerImplementation.h"
+#include "LeaseStore.h"
 #include <interfaces/json/JsonData_DHCPServer.h>
+#include "JsonData_DHCPServerStatistics.h"
 #include "Module.h"
 
 namespace WPEFramework {
@@ -277,10 +279,11 @@ namespace Plugin {
         uint32_t endpoint_activate(const JsonData::DHCPServer::ActivateParamsInfo& params);
         uint32_t endpoint_deactivate(const JsonData::DHCPServer::ActivateParamsInfo& params);
         uint32_t get_status(const string& index, Core::JSON::ArrayType<JsonData::DHCPServer::ServerData>& response) const;
+        uint32_t get_statistics(const string& index, Core::JSON::ArrayType<JsonData::DHCPServer::StatisticsData>& response) const;
 
         // Lease permanent storage
         // -------------------------------------------------------------------------------------------------------
-        void SaveLeases(const string& interface, const DHCPServerImplementation& dhcpServer) const;
+        // Leases saved by earlier versions, taken over once into the lease journal.
         void LoadLeases(const string& interface, DHCPServerImplementation& dhcpServer);
 
         // Callbacks
@@ -288,6 +291,7 @@ namespace Plugin {
     private:
         uint16_t _skipURL;
         std::map<const string, DHCPServerImplementation> _servers;
+        std::map<const string, LeaseStore> _stores;
         std::string _persistentPath;
     };
 
@@ -25,6 +25,7 @@ namespace Plugin {
 
     /* static */ constexpr uint8_t DHCPServerImplementation::MagicCookie[];
     /* static */ constexpr uint16_t DHCPServerImplementation::Identifier::maxLength;
+    /* static */ constexpr uint8_t DHCPServerImplementation::ResponseSlots;
 
     uint32_t DHCPServerImplementation::Open()
     {
@@ -56,6 +57,10 @@ namespace Plugin {
                 _maxAddress = ((address & (~mask)) + ((_poolStart + _poolSize) & mask));
                 _nextFreeIp = _minAddress;
 
+                _leases.Lock();
+                _leases.Pool(_minAddress, _maxAddress);
+                _leases.Unlock();
+
                 if (_router != static_cast<uint32_t>(~0)) {
                     if (_router == 0) {
                         _router = address;
@@ -75,8 +80,6 @@ namespace Plugin {
     {
         return (SocketDatagram::Close(Core::infinite));
     }
-
-    /* static */ Core::ProxyPoolType<DHCPServerImplementation::Response> DHCPServerImplementation::_responseFactory(2);
 }
 
 } // Namespace WPEFramework::plugin
@@ -22,6 +22,8 @@
 
 #include "Module.h"
 
+#include <unordered_map>
+
 namespace WPEFramework {
 
 namespace Plugin {
@@ -80,6 +82,9 @@ namespace Plugin {
         static constexpr uint16_t DefaultDHCPServerPort = 67;
         static constexpr uint16_t DefaultDHCPClientPort = 68;
 
+        // Replies that can wait to be sent, more requests than this in one go are dropped.
+        static constexpr uint8_t ResponseSlots = 32;
+
         // Broadcast bit for flags field (RFC 2131 section 2)
         static constexpr uint16_t BroadcastValue = 0x8000;
 
@@ -109,6 +114,12 @@ namespace Plugin {
             uint8_t pbMagicCookie[4];
         };
 
+        // A reply as it goes on the wire, the options follow the message directly.
+        struct Frame {
+            CoreMessage Message;
+            uint8_t Options[256];
+        };
+
 #pragma pack(pop)
 
         class Flow {
@@ -259,6 +270,18 @@ namespace Plugin {
                 Core::ToHexString(Id(), _length, text);
                 return (text);
             }
+            // FNV-1a over the identifier bytes.
+            inline size_t Hash() const
+            {
+                const uint8_t* id = Id();
+                uint32_t result = 2166136261U;
+
+                for (uint8_t index = 0; index < _length; index++) {
+                    result = (result ^ id[index]) * 16777619U;
+                }
+
+                return (result);
+            }
         public:
             static constexpr uint16_t maxLength = 16;
         private:
@@ -440,14 +463,46 @@ namespace Plugin {
             uint32_t _preferred;
             classifications _classification;
         };
+
+    public:
+        // The leases, in the order they were handed out, indexed by client identifier and by address. The
+        // addresses of the pool that are taken are kept in a bitmap, so the next free one is found a word
+        // at a time, and the expiration times of the leases in the pool in a heap, so the one that expired
+        // the longest ago is on top. Leases are never removed, only handed to another client.
+        // NOTE: All but the constructor need to be executed within the lock.
         class LeaseList : public std::list<Lease> {
         private:
             LeaseList(const LeaseList&) = delete;
             LeaseList& operator=(const LeaseList&) = delete;
 
+            struct IdentifierHash {
+                inline size_t operator()(const Identifier& id) const
+                {
+                    return (id.Hash());
+                }
+            };
+
+            // An entry is outdated once the expiration of the lease at its address changed.
+            struct Expiry {
+                uint64_t Expiration;
+                uint32_t Address;
+
+                inline bool operator<(const Expiry& rhs) const
+                {
+                    // Reversed, the heap keeps the earliest on top.
+                    return (Expiration > rhs.Expiration);
+                }
+            };
+
         public:
             LeaseList()
                 : std::list<Lease>()
+                , _byAddress()
+                , _byIdentifier()
+                , _taken()
+                , _expiries()
+                , _minAddress(1)
+                , _maxAddress(0)
             {
             }
             ~LeaseList()
@@ -472,10 +527,173 @@ namespace Plugin {
                 _adminLock.Unlock();
             }
 
+            // (Re)builds the bitmap and the heap for the pool [minAddress, maxAddress].
+            void Pool(const uint32_t minAddress, const uint32_t maxAddress)
+            {
+                _minAddress = minAddress;
+                _maxAddress = maxAddress;
+                _taken.assign((InPool(maxAddress) == true ? ((maxAddress - minAddress) / 64) + 1 : 0), 0);
+                _expiries.clear();
+
+                for (const Lease& lease : *this) {
+                    if (InPool(lease.Raw()) == true) {
+                        Take(lease.Raw());
+                        _expiries.push_back(Expiry { lease.Expiration(), lease.Raw() });
+                    }
+                }
+
+                std::make_heap(_expiries.begin(), _expiries.end());
+            }
+            inline Lease* Find(const uint32_t address)
+            {
+                std::unordered_map<uint32_t, Lease*>::iterator index(_byAddress.find(address));
+
+                return (index != _byAddress.end() ? index->second : nullptr);
+            }
+            inline Lease* Find(const Identifier& id)
+            {
+                std::unordered_map<Identifier, Lease*, IdentifierHash>::iterator index(_byIdentifier.find(id));
+
+                return (index != _byIdentifier.end() ? index->second : nullptr);
+            }
+            Lease* Create(const Identifier& id, const uint32_t address, const uint64_t expiration = 0)
+            {
+                Lease* result = nullptr;
+
+                // Only the first lease for an address counts.
+                if (_byAddress.find(address) == _byAddress.end()) {
+                    push_back(Lease(id, address, expiration));
+                    result = &(back());
+
+                    _byAddress.emplace(address, result);
+                    _byIdentifier.emplace(id, result);
+
+                    if (InPool(address) == true) {
+                        Take(address);
+                        Push(Expiry { expiration, address });
+                    }
+                }
+
+                return (result);
+            }
+            void Update(Lease& lease, const Identifier& id)
+            {
+                std::unordered_map<Identifier, Lease*, IdentifierHash>::iterator index(_byIdentifier.find(lease.Id()));
+
+                if ((index != _byIdentifier.end()) && (index->second == &lease)) {
+                    _byIdentifier.erase(index);
+                }
+
+                lease.Update(id);
+                _byIdentifier.emplace(id, &lease);
+            }
+            void Expiration(Lease& lease, const uint64_t time)
+            {
+                lease.Expiration(time);
+
+                if (InPool(lease.Raw()) == true) {
+                    Push(Expiry { time, lease.Raw() });
+                }
+            }
+            // The first address from "start" on that has no lease yet.
+            bool NextFree(const uint32_t start, uint32_t& address) const
+            {
+                bool result = false;
+
+                if ((InPool(start) == true) && (_taken.empty() == false)) {
+                    const uint32_t last = _maxAddress - _minAddress;
+                    uint32_t offset = start - _minAddress;
+                    uint32_t word = offset / 64;
+                    uint64_t free = (~_taken[word]) & (~static_cast<uint64_t>(0) << (offset % 64));
+
+                    while ((free == 0) && (++word < _taken.size())) {
+                        free = ~_taken[word];
+                    }
+
+                    if (free != 0) {
+                        offset = (word * 64) + LowestSet(free);
+
+                        if (offset <= last) {
+                            address = _minAddress + offset;
+                            result = true;
+                        }
+                    }
+                }
+
+                return (result);
+            }
+            // The lease in the pool that expired the longest ago, nullptr if none has expired.
+            Lease* Expired(const uint64_t now)
+            {
+                Lease* result = nullptr;
+
+                while ((result == nullptr) && (_expiries.empty() == false) && (_expiries.front().Expiration < now)) {
+                    Lease* lease = Find(_expiries.front().Address);
+
+                    if ((lease != nullptr) && (lease->Expiration() == _expiries.front().Expiration)) {
+                        result = lease;
+                    } else {
+                        std::pop_heap(_expiries.begin(), _expiries.end());
+                        _expiries.pop_back();
+                    }
+                }
+
+                return (result);
+            }
+
+        private:
+            // Index of the lowest bit that is set, the word is not 0. A de Bruijn multiplication, so it is the
+            // same on every compiler.
+            static inline uint32_t LowestSet(const uint64_t word)
+            {
+                static const uint8_t positions[64] = {
+                    0, 1, 48, 2, 57, 49, 28, 3, 61, 58, 50, 42, 38, 29, 17, 4,
+                    62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30, 24, 18, 12, 5,
+                    63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11,
+                    46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19, 9, 13, 8, 7, 6
+                };
+
+                ASSERT(word != 0);
+
+                return (positions[((word & (~word + 1)) * 0x03F79D71B4CB0A89ULL) >> 58]);
+            }
+            inline bool InPool(const uint32_t address) const
+            {
+                return ((address >= _minAddress) && (address <= _maxAddress));
+            }
+            inline void Take(const uint32_t address)
+            {
+                const uint32_t offset = address - _minAddress;
+                _taken[offset / 64] |= (static_cast<uint64_t>(1) << (offset % 64));
+            }
+            void Push(const Expiry& entry)
+            {
+                _expiries.push_back(entry);
+                std::push_heap(_expiries.begin(), _expiries.end());
+
+                // Every change of an expiration adds an entry, drop the outdated ones once they dominate.
+                if (_expiries.size() > ((2 * _byAddress.size()) + 64)) {
+                    std::vector<Expiry>::iterator end(std::remove_if(_expiries.begin(), _expiries.end(), [this](const Expiry& expiry) -> bool {
+                        const Lease* lease = Find(expiry.Address);
+                        return ((lease == nullptr) || (lease->Expiration() != expiry.Expiration));
+                    }));
+
+                    _expiries.erase(end, _expiries.end());
+                    std::make_heap(_expiries.begin(), _expiries.end());
+                }
+            }
+
         private:
             mutable Core::CriticalSection _adminLock;
+            std::unordered_map<uint32_t, Lease*> _byAddress;
+            std::unordered_map<Identifier, Lease*, IdentifierHash> _byIdentifier;
+            std::vector<uint64_t> _taken;
+            std::vector<Expiry> _expiries;
+            uint32_t _minAddress;
+            uint32_t _maxAddress;
         };
 
+    private:
         class Response {
         private:
             Response(const Response&) = delete;
@@ -493,28 +711,38 @@ namespace Plugin {
         public:
             inline void Clear()
             {
-                ::memset(&_dhcpReply, 0, sizeof(_dhcpReply));
+                ::memset(&_frame.Message, 0, sizeof(_frame.Message));
+                _frame.Options[2] = 0;
                 _optionSize = 0;
+                _received = 0;
             }
             inline bool IsValid() const
             {
-                return (_optionData[2] != 0);
+                return (_frame.Options[2] != 0);
             }
             inline uint8_t Option() const
             {
-                return (_optionData[2]);
+                return (_frame.Options[2]);
             }
             inline uint16_t SendData(uint8_t dataFrame[], const uint16_t length)
             {
-                ASSERT(length >= (sizeof(_dhcpReply) + _optionSize + 1));
+                const uint16_t size = (sizeof(_frame.Message) + _optionSize + 1);
 
-                ::memcpy(dataFrame, &_dhcpReply, sizeof(_dhcpReply));
-                if (_optionSize != 0) {
-                    ::memcpy(&dataFrame[sizeof(_dhcpReply)], &_optionData, _optionSize);
-                }
-                dataFrame[sizeof(_dhcpReply) + _optionSize] = OPTION_END;
+                ASSERT(length >= size);
+
+                // The options were encoded right behind the message, it goes out in one piece.
+                _frame.Options[_optionSize] = OPTION_END;
+                ::memcpy(dataFrame, &_frame, size);
 
-                return (sizeof(_dhcpReply) + _optionSize + 1);
+                return (size);
+            }
+            inline uint64_t Received() const
+            {
+                return (_received);
+            }
+            inline void Received(const uint64_t ticks)
+            {
+                _received = ticks;
             }
             inline void Base(const std::string& serverName, const uint32_t server, const CoreMessage& message, const uint32_t router, const uint32_t dns)
             {
@@ -523,31 +751,31 @@ namespace Plugin {
                 _ciaddr = message.ciaddr.s_addr;
                 _yiaddr = message.yiaddr.s_addr;
 
-                _dhcpReply.operation = OPERATION_BOOTREPLY;
-                _dhcpReply.htype = message.htype;
-                _dhcpReply.hlen = message.hlen;
+                _frame.Message.operation = OPERATION_BOOTREPLY;
+                _frame.Message.htype = message.htype;
+                _frame.Message.hlen = message.hlen;
                 // dhcpReply->hops = 0;
-                _dhcpReply.xid = message.xid;
+                _frame.Message.xid = message.xid;
                 // dhcpReply->ciaddr = 0;
                 // dhcpReply->yiaddr = 0;  Or changed below
-                _dhcpReply.siaddr.s_addr = server;
-                _dhcpReply.flags = (message.giaddr.s_addr != 0 ? htons(BroadcastValue) : 0) | message.flags;
-                _dhcpReply.giaddr = message.giaddr;
-                ::memcpy(_dhcpReply.chaddr, message.chaddr, sizeof(_dhcpReply.chaddr));
-                ::memcpy(_dhcpReply.sname, serverName.c_str(), std::min(sizeof(_dhcpReply.sname), serverName.length()));
+                _frame.Message.siaddr.s_addr = server;
+                _frame.Message.flags = (message.giaddr.s_addr != 0 ? htons(BroadcastValue) : 0) | message.flags;
+                _frame.Message.giaddr = message.giaddr;
+                ::memcpy(_frame.Message.chaddr, message.chaddr, sizeof(_frame.Message.chaddr));
+                ::memcpy(_frame.Message.sname, serverName.c_str(), std::min(sizeof(_frame.Message.sname), serverName.length()));
                 // dhcpReply->file = 0;
 
-                ::memcpy(_dhcpReply.pbMagicCookie, MagicCookie, sizeof(_dhcpReply.pbMagicCookie));
+                ::memcpy(_frame.Message.pbMagicCookie, MagicCookie, sizeof(_frame.Message.pbMagicCookie));
 
                 // DHCP Message Type - RFC 2132 section 9.6
-                _optionData[0] = OPTION_DHCPMESSAGETYPE;
-                _optionData[1] = 1;
-                _optionData[2] = 0;
+                _frame.Options[0] = OPTION_DHCPMESSAGETYPE;
+                _frame.Options[1] = 1;
+                _frame.Options[2] = 0;
 
                 // Server Identifier - RFC 2132 section 9.7
-                _optionData[3] = OPTION_SERVERIDENTIFIER;
-                _optionData[4] = 4;
-                ::memcpy(&(_optionData[5]), &server, 4);
+                _frame.Options[3] = OPTION_SERVERIDENTIFIER;
+                _frame.Options[4] = 4;
+                ::memcpy(&(_frame.Options[5]), &server, 4);
 
                 _optionSize = 9;
                 if (router != static_cast<uint32_t>(~0)) {
@@ -563,14 +791,14 @@ namespace Plugin {
 
                 // Determine how to send the reply  RFC 2131 section 4.1
                 if (result == 0) {
-                    switch (_optionData[2]) {
+                    switch (_frame.Options[2]) {
                     case CLASSIFICATION_OFFER:
                         // Fall-through
                         result = INADDR_BROADCAST;
                         break;
                     case CLASSIFICATION_ACK:
                         if (_ciaddr == 0) {
-                            result = (((htons(BroadcastValue) & _dhcpReply.flags) != 0) ? INADDR_BROADCAST : INADDR_BROADCAST);
+                            result = (((htons(BroadcastValue) & _frame.Message.flags) != 0) ? INADDR_BROADCAST : INADDR_BROADCAST);
                         } else {
                             result = _ciaddr; // Already in network order
                         }
@@ -579,7 +807,7 @@ namespace Plugin {
                         result = INADDR_BROADCAST;
                         break;
                     default:
-                        TRACE_L1("Unknown classification: %d \n", _optionData[2]);
+                        TRACE_L1("Unknown classification: %d \n", _frame.Options[2]);
                         break;
                     }
                 }
@@ -593,19 +821,19 @@ namespace Plugin {
             inline void Offer(const uint32_t address)
             {
 
-                _dhcpReply.yiaddr.s_addr = htonl(address);
-                _optionData[2] = CLASSIFICATION_OFFER;
+                _frame.Message.yiaddr.s_addr = htonl(address);
+                _frame.Options[2] = CLASSIFICATION_OFFER;
             }
             inline void Acknowledge(const bool positive, const uint32_t address)
             {
 
                 if (positive == true) {
 
-                    _optionData[2] = CLASSIFICATION_ACK;
-                    _dhcpReply.ciaddr.s_addr = htonl(address);
-                    _dhcpReply.yiaddr.s_addr = _dhcpReply.ciaddr.s_addr;
+                    _frame.Options[2] = CLASSIFICATION_ACK;
+                    _frame.Message.ciaddr.s_addr = htonl(address);
+                    _frame.Message.yiaddr.s_addr = _frame.Message.ciaddr.s_addr;
                 } else {
-                    _optionData[2] = CLASSIFICATION_NAK;
+                    _frame.Options[2] = CLASSIFICATION_NAK;
                 }
             }
             inline void LeaseTime(const uint16_t hours)
@@ -614,12 +842,12 @@ namespace Plugin {
                 uint32_t value = hours * 60 * 60;
 
                 // IP Address Lease Time - RFC 2132 section 9.2
-                _optionData[_optionSize] = OPTION_IPADDRESSLEASETIME;
-                _optionData[_optionSize + 1] = 4;
-                _optionData[_optionSize + 2] = (value >> 24) & 0xFF;
-                _optionData[_optionSize + 3] = (value >> 16) & 0xFF;
-                _optionData[_optionSize + 4] = (value >> 8) & 0xFF;
-                _optionData[_optionSize + 5] = value & 0xFF;
+                _frame.Options[_optionSize] = OPTION_IPADDRESSLEASETIME;
+                _frame.Options[_optionSize + 1] = 4;
+                _frame.Options[_optionSize + 2] = (value >> 24) & 0xFF;
+                _frame.Options[_optionSize + 3] = (value >> 16) & 0xFF;
+                _frame.Options[_optionSize + 4] = (value >> 8) & 0xFF;
+                _frame.Options[_optionSize + 5] = value & 0xFF;
 
                 _optionSize += 6;
             }
@@ -629,12 +857,12 @@ namespace Plugin {
                 const uint32_t mask(static_cast<uint32_t>(~0) << (32 - bits));
 
                 // Subnet Mask - RFC 2132 section 3.3
-                _optionData[_optionSize] = OPTION_SUBNETMASK;
-                _optionData[_optionSize + 1] = 4;
-                _optionData[_optionSize + 2] = (mask >> 24) & 0xFF;
-                _optionData[_optionSize + 3] = (mask >> 16) & 0xFF;
-                _optionData[_optionSize + 4] = (mask >> 8) & 0xFF;
-                _optionData[_optionSize + 5] = mask & 0xFF;
+                _frame.Options[_optionSize] = OPTION_SUBNETMASK;
+                _frame.Options[_optionSize + 1] = 4;
+                _frame.Options[_optionSize + 2] = (mask >> 24) & 0xFF;
+                _frame.Options[_optionSize + 3] = (mask >> 16) & 0xFF;
+                _frame.Options[_optionSize + 4] = (mask >> 8) & 0xFF;
+                _frame.Options[_optionSize + 5] = mask & 0xFF;
 
                 _optionSize += 6;
             }
@@ -642,30 +870,49 @@ namespace Plugin {
             {
 
                 const uint32_t value = htonl(address);
-                _optionData[_optionSize] = OPTION_ROUTER;
-                _optionData[_optionSize + 1] = 4;
-                ::memcpy(&(_optionData[_optionSize + 2]), &value, 4);
+                _frame.Options[_optionSize] = OPTION_ROUTER;
+                _frame.Options[_optionSize + 1] = 4;
+                ::memcpy(&(_frame.Options[_optionSize + 2]), &value, 4);
                 _optionSize += 6;
             }
             inline void DNS(const uint32_t address)
             {
 
                 const uint32_t value = htonl(address);
-                _optionData[_optionSize] = OPTION_DNS;
-                _optionData[_optionSize + 1] = 4;
-                ::memcpy(&(_optionData[_optionSize + 2]), &value, 4);
+                _frame.Options[_optionSize] = OPTION_DNS;
+                _frame.Options[_optionSize + 1] = 4;
+                ::memcpy(&(_frame.Options[_optionSize + 2]), &value, 4);
                 _optionSize += 6;
             }
 
         private:
-            CoreMessage _dhcpReply;
+            Frame _frame;
             uint8_t _optionSize;
-            uint8_t _optionData[256];
             uint32_t _replyAddress;
             uint32_t _ciaddr;
             uint32_t _yiaddr;
+            uint64_t _received;
         };
+
     public:
+        // Packets (and replies) per message type since the server was created. The latency (in microseconds)
+        // runs from the moment a request is received until its reply is handed to the socket.
+        struct Statistics {
+            uint32_t Discovers;
+            uint32_t Requests;
+            uint32_t Declines;
+            uint32_t Releases;
+            uint32_t Informs;
+            uint32_t Invalid; // malformed, or of an unknown or unexpected type
+            uint32_t Dropped; // no room left to queue the reply
+            uint32_t Offers;
+            uint32_t Acks;
+            uint32_t Naks;
+            uint32_t LatencyMin;
+            uint32_t LatencyMax;
+            uint64_t LatencyTotal;
+        };
+
         typedef Core::LockableIteratorType<const LeaseList, const Lease&, LeaseList::const_iterator> Iterator;
         typedef std::function<void(const string&, Lease*)> IPRequestCallback; 
 
@@ -683,11 +930,17 @@ namespace Plugin {
             , _router(router)
             , _dns(~0)
             , _leases()
+            , _adminLock()
             , _responses()
+            , _responseHead(0)
+            , _responseCount(0)
+            , _statistics()
             , _ipRequestCallback(ipRequestCallback)
         {
             static_assert(sizeof(uint32_t) == 4, "Incorrect architecture chosen. uint32_t must by 4 bytes");
 
+            ::memset(&_statistics, 0, sizeof(_statistics));
+
             if (DNS.IsValid() == true) {
                 _dns = ntohl(static_cast<const Core::NodeId::SocketInfo&>(DNS).IPV4Socket.sin_addr.s_addr);
             }
@@ -727,10 +980,19 @@ namespace Plugin {
         inline void AddLease(const Lease& lease)
         {
             _leases.Lock();
-            _leases.push_back(lease);
+            _leases.Create(lease.Id(), lease.Raw(), lease.Expiration());
             _leases.Unlock();
         }
 
+        inline Statistics Counters() const
+        {
+            _adminLock.Lock();
+            Statistics result(_statistics);
+            _adminLock.Unlock();
+
+            return (result);
+        }
+
         // IMPORTANT NOTE !!!!
         // The Leases() method will lock the lease list. Lifetime
         // of the returned Iterator object must be deterministic
@@ -744,47 +1006,22 @@ namespace Plugin {
         uint32_t Close();
 
     private:
-        // NOTE:
-        // The next three methods, Find,Find and Create need to be executed within the lock.
-        inline Lease* Find(const uint32_t address)
-        {
-            LeaseList::iterator index(_leases.begin());
-            while ((index != _leases.end()) && (index->Raw() != address)) {
-                index++;
-            }
-
-            return (index != _leases.end() ? &(*index) : nullptr);
-        }
-        inline Lease* Find(const Identifier& id)
-        {
-            LeaseList::iterator index(_leases.begin());
-            while ((index != _leases.end()) && (index->Id() != id)) {
-                index++;
-            }
-
-            return (index != _leases.end() ? &(*index) : nullptr);
-        }
-        inline Lease* Create(const Identifier& id, const uint32_t address)
-        {
-            _leases.push_back(Lease(id, address));
-            return &(_leases.back());
-        }
         void Discover(Response& response, const ScratchPad& scratchPad)
         {
             _leases.Lock();
-            Lease* result = Find(scratchPad.Id());
+            Lease* result = _leases.Find(scratchPad.Id());
 
             // RFC 2131 section 4.3.1
             if ((result == nullptr) && (scratchPad.RequestedIP() != 0)) {
                 // Make sure the preferred IP address is within the pool, otherwise offer a correct one anyway
                 if ((scratchPad.RequestedIP() >= _minAddress) && (scratchPad.RequestedIP() <= _maxAddress)) {
-                    result = Find(scratchPad.RequestedIP());
+                    result = _leases.Find(scratchPad.RequestedIP());
 
                     if (result == nullptr) {
                         // Ip address has not been taken yet, time to "assign" it to this client.
-                        result = Create(scratchPad.Id(), scratchPad.RequestedIP());
+                        result = _leases.Create(scratchPad.Id(), scratchPad.RequestedIP());
                     } else if (result->IsExpired() == true) {
-                        result->Update(scratchPad.Id());
+                        _leases.Update(*result, scratchPad.Id());
                     } else {
                         // IP address is taken
                         result = nullptr;
@@ -795,23 +1032,15 @@ namespace Plugin {
             if (result == nullptr) {
                 // First look in previously unallocated IP slots
                 uint32_t ip;
-                for (ip = _nextFreeIp; ip <= _maxAddress; ip++) {
-                    if (Find(ip) == nullptr) {
-                        result = Create(scratchPad.Id(), ip);
-                        _nextFreeIp = (ip + 1);
-                        break;
-                    }
-                }
-
-                if (result == nullptr) {
+                if (_leases.NextFree(_nextFreeIp, ip) == true) {
+                    result = _leases.Create(scratchPad.Id(), ip);
+                    _nextFreeIp = (ip + 1);
+                } else {
                     // Still not found a free IP slot, attempt picking up one of the expired ones
-                    for (ip = _minAddress; ip <= _maxAddress ; ip++) {
-                        Lease* lease = Find(ip);
-                        if ((lease != nullptr) && (lease->IsExpired() == true)) {
-                            result = lease;
-                            result->Update(scratchPad.Id());
-                            break;
-                        }
+                    result = _leases.Expired(Core::Time::Now().Ticks());
+
+                    if (result != nullptr) {
+                        _leases.Update(*result, scratchPad.Id());
                     }
                 }
             }
@@ -823,7 +1052,7 @@ namespace Plugin {
                     // Temporarily lock out the offered IP address until the client actually requests it
                     Core::Time timeout = Core::Time::Now();
                     timeout.Add(60 /* sec */ * 1000);
-                    result->Expiration(timeout.Ticks());
+                    _leases.Expiration(*result, timeout.Ticks());
                 }
 
                 response.Offer(result->Raw());
@@ -837,7 +1066,7 @@ namespace Plugin {
             _leases.Lock();
 
             // RFC 2131 section 4.3.2 Determine requested IP address
-            Lease* result = Find(scratchPad.Id());
+            Lease* result = _leases.Find(scratchPad.Id());
             uint32_t serverId = scratchPad.ServerIdentifier();
             uint32_t requested = scratchPad.RequestedIP();
             
@@ -848,21 +1077,45 @@ namespace Plugin {
                 Core::Time leaseExp = Core::Time::Now();
                 leaseExp.Add(DefaultLeaseTime * (60 /* min */ * 60 * 1000));
                 response.LeaseTime(DefaultLeaseTime);
-                result->Expiration(leaseExp.Ticks());
+                _leases.Expiration(*result, leaseExp.Ticks());
                 _ipRequestCallback(_interfaceName, result);
             } else {
                 if (result != nullptr) {
-                    result->Expiration(0); // Invalidate
+                    _leases.Expiration(*result, 0); // Invalidate
+                    _ipRequestCallback(_interfaceName, result);
                 }
             }
 
             _leases.Unlock();
         }
-        void Submit(const Core::ProxyType<Response> entry)
+        // Only the socket thread queues replies, so a slot that is handed out here stays untouched until
+        // it is committed. nullptr if all slots hold a reply that is still to be sent.
+        Response* Reserve()
+        {
+            Response* result = nullptr;
+
+            _adminLock.Lock();
+
+            if (_responseCount < ResponseSlots) {
+                result = &(_responses[(_responseHead + _responseCount) % ResponseSlots]);
+            } else {
+                _statistics.Dropped++;
+            }
+
+            _adminLock.Unlock();
+
+            return (result);
+        }
+        void Commit()
         {
-            _responses.push_back(entry);
+            _adminLock.Lock();
+
+            _responseCount++;
+            bool trigger = (_responseCount == 1);
 
-            if (_responses.size() == 1) {
+            _adminLock.Unlock();
+
+            if (trigger == true) {
                 SocketDatagram::Trigger();
             }
         }
@@ -870,31 +1123,60 @@ namespace Plugin {
         virtual void StateChange()
         {
         }
+        // Called as long as there is something to send, so all queued replies go out in one go.
         virtual uint16_t SendData(uint8_t dataFrame[], const uint16_t length)
         {
             uint16_t result = 0;
 
-            if (_responses.size() != 0) {
-
-                Core::ProxyType<Response> entry(_responses.front());
-
-                // Pop the front.
-                _responses.pop_front();
+            _adminLock.Lock();
+
+            if (_responseCount != 0) {
+                Response& entry(_responses[_responseHead]);
+                const uint32_t latency = static_cast<uint32_t>(Core::Time::Now().Ticks() - entry.Received());
+                const bool first = ((_statistics.Offers + _statistics.Acks + _statistics.Naks) == 0);
+
+                ASSERT(entry.IsValid() == true);
+
+                SocketDatagram::RemoteNode(entry.Reply());
+                TRACE_L1("Sending %d to %s:%d", entry.Option(), RemoteNode().HostAddress().c_str(), RemoteNode().PortNumber());
+                result = entry.SendData(dataFrame, length);
+
+                switch (entry.Option()) {
+                case CLASSIFICATION_OFFER:
+                    _statistics.Offers++;
+                    break;
+                case CLASSIFICATION_ACK:
+                    _statistics.Acks++;
+                    break;
+                case CLASSIFICATION_NAK:
+                    _statistics.Naks++;
+                    break;
+                default:
+                    break;
+                }
 
-                if (entry->IsValid() == false) {
-                    TRACE_L1("Dropped a response frame as it is invalid. [%d]", __LINE__);
-                } else {
-                    SocketDatagram::RemoteNode(entry->Reply());
-                    TRACE_L1("Sending %d to %s:%d", entry->Option(), RemoteNode().HostAddress().c_str(), RemoteNode().PortNumber());
-                    result = entry->SendData(dataFrame, length);
+                if ((first == true) || (latency < _statistics.LatencyMin)) {
+                    _statistics.LatencyMin = latency;
                 }
+                if (latency > _statistics.LatencyMax) {
+                    _statistics.LatencyMax = latency;
+                }
+                _statistics.LatencyTotal += latency;
+
+                _responseHead = (_responseHead + 1) % ResponseSlots;
+                _responseCount--;
             }
 
+            _adminLock.Unlock();
+
             return (result);
         }
         virtual uint16_t ReceiveData(uint8_t dataFrame[], const uint16_t length)
         {
             const CoreMessage* const message = reinterpret_cast<const CoreMessage*>(dataFrame);
+            classifications classification = CLASSIFICATION_INVALID;
+            bool ours = false;
+
             // Check the size of the message, certain elments need to be in there (RFC 2131 section 3)
             if (sizeof(CoreMessage) > length) {
                 TRACE(Trace::Information, (_T("Message is too short for a DHCP request. Size %d"), length));
@@ -904,48 +1186,87 @@ namespace Plugin {
                 TRACE(Trace::Information, (string(_T("Magic cookie does not comply."))));
             } else if (SocketDatagram::RemoteNode() == SocketDatagram::LocalNode()) {
                 TRACE(Trace::Information, (string(_T("Receiving a request from the our-selves, will not respond."))));
+                ours = true;
             } else {
                 // We got a legitimate DHCP request. Continue with it.
                 ScratchPad scratchPad(dataFrame, length);
 
+                classification = scratchPad.Classification();
+
                 if (scratchPad.HasClassification() == false) {
                     TRACE(Trace::Information, (string(_T("Request type unknown or unspecified."))));
                 } else {
                     // Create our selves a response we can reply.
-                    Core::ProxyType<Response> response(_responseFactory.Element());
-                    response->Base(_serverName, _server, *message, _router, _dns);
+                    Response* response = Reserve();
 
-                    switch (scratchPad.Classification()) {
-                    case CLASSIFICATION_DISCOVER:
-                        Discover(*response, scratchPad);
+                    if (response == nullptr) {
+                        TRACE_L1("Dropped a request, %d replies are still waiting to be sent. [%d]", ResponseSlots, __LINE__);
+                    } else {
+                        response->Clear();
+                        response->Received(Core::Time::Now().Ticks());
+                        response->Base(_serverName, _server, *message, _router, _dns);
 
-                        break;
-                    case CLASSIFICATION_REQUEST:
-                        Request(*response, scratchPad);
-                        break;
-                    case CLASSIFICATION_DECLINE:
-                        // Fall-through
-                    case CLASSIFICATION_RELEASE:
-                        // UNSUPPORTED: Mark address as unused
-                        break;
-                    case CLASSIFICATION_INFORM:
-                        // Unsupported DHCP message type - fail silently
-                        break;
-                    case CLASSIFICATION_OFFER:
-                    case CLASSIFICATION_ACK:
-                    case CLASSIFICATION_NAK:
-                        TRACE(Trace::Information, (_T("Unexpected DHCP message. Type: %d."), scratchPad.Classification()));
-                        break;
-                    default:
-                        ASSERT(false);
-                        break;
-                    }
+                        switch (classification) {
+                        case CLASSIFICATION_DISCOVER:
+                            Discover(*response, scratchPad);
+
+                            break;
+                        case CLASSIFICATION_REQUEST:
+                            Request(*response, scratchPad);
+                            break;
+                        case CLASSIFICATION_DECLINE:
+                            // Fall-through
+                        case CLASSIFICATION_RELEASE:
+                            // UNSUPPORTED: Mark address as unused
+                            break;
+                        case CLASSIFICATION_INFORM:
+                            // Unsupported DHCP message type - fail silently
+                            break;
+                        case CLASSIFICATION_OFFER:
+                        case CLASSIFICATION_ACK:
+                        case CLASSIFICATION_NAK:
+                            TRACE(Trace::Information, (_T("Unexpected DHCP message. Type: %d."), classification));
+                            classification = CLASSIFICATION_INVALID;
+                            break;
+                        default:
+                            ASSERT(false);
+                            break;
+                        }
 
-                    if (response.IsValid() == true) {
-                        Submit(response);
+                        if (response->IsValid() == true) {
+                            Commit();
+                        }
                     }
                 }
             }
+
+            if (ours == false) {
+                _adminLock.Lock();
+
+                switch (classification) {
+                case CLASSIFICATION_DISCOVER:
+                    _statistics.Discovers++;
+                    break;
+                case CLASSIFICATION_REQUEST:
+                    _statistics.Requests++;
+                    break;
+                case CLASSIFICATION_DECLINE:
+                    _statistics.Declines++;
+                    break;
+                case CLASSIFICATION_RELEASE:
+                    _statistics.Releases++;
+                    break;
+                case CLASSIFICATION_INFORM:
+                    _statistics.Informs++;
+                    break;
+                default:
+                    _statistics.Invalid++;
+                    break;
+                }
+
+                _adminLock.Unlock();
+            }
+
             return (length);
         }
 
@@ -961,11 +1282,12 @@ namespace Plugin {
         uint32_t _router;
         uint32_t _dns;
         LeaseList _leases;
-        std::list<Core::ProxyType<Response>> _responses;
+        mutable Core::CriticalSection _adminLock;
+        Response _responses[ResponseSlots];
+        uint8_t _responseHead;
+        uint8_t _responseCount;
+        Statistics _statistics;
         const IPRequestCallback _ipRequestCallback;
-
-
-        static Core::ProxyPoolType<Response> _responseFactory;
     };
 }
 } // Namespace WPEFramework::plugin
@@ -21,6 +21,7 @@
 #include "DHCPServer.h"
 #include "DHCPServerImplementation.h"
 #include <interfaces/json/JsonData_DHCPServer.h>
+#include "JsonData_DHCPServerStatistics.h"
 
 
 namespace WPEFramework {
@@ -51,6 +52,27 @@ namespace Plugin {
                 }
             }
         }
+
+        void Fill(StatisticsData& data, const DHCPServerImplementation& server)
+        {
+            const DHCPServerImplementation::Statistics counters(server.Counters());
+            const uint32_t replies = counters.Offers + counters.Acks + counters.Naks;
+
+            data.Interface = server.Interface();
+            data.Discovers = counters.Discovers;
+            data.Requests = counters.Requests;
+            data.Declines = counters.Declines;
+            data.Releases = counters.Releases;
+            data.Informs = counters.Informs;
+            data.Invalid = counters.Invalid;
+            data.Dropped = counters.Dropped;
+            data.Offers = counters.Offers;
+            data.Acks = counters.Acks;
+            data.Naks = counters.Naks;
+            data.Latencymin = counters.LatencyMin;
+            data.Latencymax = counters.LatencyMax;
+            data.Latencyavg = (replies != 0 ? static_cast<uint32_t>(counters.LatencyTotal / replies) : 0);
+        }
     }
 
     // Registration
@@ -61,6 +83,7 @@ namespace Plugin {
         Register<ActivateParamsInfo,void>(_T("activate"), &DHCPServer::endpoint_activate, this);
         Register<ActivateParamsInfo,void>(_T("deactivate"), &DHCPServer::endpoint_deactivate, this);
         Property<Core::JSON::ArrayType<ServerData>>(_T("status"), &DHCPServer::get_status, nullptr, this);
+        Property<Core::JSON::ArrayType<StatisticsData>>(_T("statistics"), &DHCPServer::get_statistics, nullptr, this);
     }
 
     void DHCPServer::UnregisterAll()
@@ -68,6 +91,7 @@ namespace Plugin {
         Unregister(_T("deactivate"));
         Unregister(_T("activate"));
         Unregister(_T("status"));
+        Unregister(_T("statistics"));
     }
 
     // API implementation
@@ -154,6 +178,36 @@ namespace Plugin {
         return result;
     }
 
+    // Property: statistics - Server request and reply counters
+    // Return codes:
+    //  - ERROR_NONE: Success
+    //  - ERROR_UNKNOWN_KEY: Invalid server name given
+    uint32_t DHCPServer::get_statistics(const string& index, Core::JSON::ArrayType<StatisticsData>& response) const
+    {
+        uint32_t result = Core::ERROR_NONE;
+
+        if (index.empty()) {
+            auto it = _servers.begin();
+            while (it != _servers.end()) {
+                StatisticsData info;
+                Fill(info, it->second);
+                response.Add(info);
+                it++;
+            }
+        } else {
+            auto it(_servers.find(index));
+            if (it != _servers.end()) {
+                StatisticsData info;
+                Fill(info, it->second);
+                response.Add(info);
+            } else {
+                result = Core::ERROR_UNKNOWN_KEY;
+            }
+        }
+
+        return result;
+    }
+
 } // namespace Plugin
 
 }
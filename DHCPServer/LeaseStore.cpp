@@ -0,0 +1,361 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LeaseStore.h"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifndef __WINDOWS__
+#include <unistd.h>
+#endif
+
+namespace WPEFramework {
+namespace Plugin {
+
+    /* static */ constexpr uint8_t LeaseStore::Magic[];
+
+#ifndef __WINDOWS__
+    namespace {
+
+        bool WriteAll(const int descriptor, const uint8_t data[], const uint32_t length)
+        {
+            uint32_t written = 0;
+
+            while (written < length) {
+                const ssize_t size = ::write(descriptor, &(data[written]), length - written);
+
+                if (size > 0) {
+                    written += static_cast<uint32_t>(size);
+                } else if ((size < 0) && (errno != EINTR)) {
+                    break;
+                }
+            }
+
+            return (written == length);
+        }
+
+        // A rename is only durable once the directory holding it is synced.
+        bool Sync(const string& directory)
+        {
+            bool result = false;
+            int descriptor = ::open((directory.empty() == true ? _T(".") : directory.c_str()), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+            if (descriptor != -1) {
+                result = (::fsync(descriptor) == 0);
+                ::close(descriptor);
+            }
+
+            return (result);
+        }
+
+    } // namespace
+#endif
+
+    LeaseStore::LeaseStore(const string& fileName, DHCPServerImplementation& server)
+        : _adminLock()
+        , _fileName(fileName)
+        , _server(server)
+        , _job(*this)
+        , _descriptor(-1)
+        , _records(0)
+        , _compacted(0)
+        , _compacting(false)
+        , _pending()
+    {
+    }
+
+    LeaseStore::~LeaseStore()
+    {
+        Close();
+    }
+
+    bool LeaseStore::Restore()
+    {
+        struct Entry {
+            DHCPServerImplementation::Identifier Id;
+            uint64_t Expiration;
+            uint32_t Record; // journal order of the last record of the address
+        };
+
+        std::vector<uint8_t> journal;
+        bool result = false;
+
+#ifndef __WINDOWS__
+        int descriptor = ::open(_fileName.c_str(), O_RDONLY | O_CLOEXEC);
+
+        if (descriptor != -1) {
+            struct stat info;
+
+            if ((::fstat(descriptor, &info) == 0) && (info.st_size >= static_cast<off_t>(sizeof(Header)))) {
+                journal.resize(static_cast<size_t>(info.st_size));
+
+                if (::read(descriptor, journal.data(), journal.size()) != static_cast<ssize_t>(journal.size())) {
+                    journal.clear();
+                }
+            }
+
+            ::close(descriptor);
+        }
+#endif
+
+        if (journal.empty() == false) {
+            const Header* header = reinterpret_cast<const Header*>(journal.data());
+
+            if ((::memcmp(header->Magic, Magic, sizeof(Magic)) != 0) || (header->Version != Version)) {
+                SYSLOG(Logging::Notification, (_T("Lease journal %s is not recognized, starting without it"), _fileName.c_str()));
+            } else {
+                std::unordered_map<uint32_t, Entry> entries;
+                uint32_t offset = sizeof(Header);
+                uint32_t records = 0;
+
+                while ((offset + sizeof(Record)) <= journal.size()) {
+                    Record record;
+                    ::memcpy(&record, &(journal[offset]), sizeof(record));
+
+                    const uint32_t size = sizeof(Record) + record.Length;
+
+                    // A record that was cut off, or garbled, ends the journal.
+                    if (((offset + size) > journal.size()) || (Check(&(journal[offset + sizeof(record.Check)]), size - sizeof(record.Check)) != record.Check)) {
+                        TRACE_L1("Lease journal %s ends in a broken record at %d", _fileName.c_str(), offset);
+                        break;
+                    }
+
+                    Entry& entry(entries[record.Address]);
+                    entry.Id = DHCPServerImplementation::Identifier(&(journal[offset + sizeof(Record)]), record.Length);
+                    entry.Expiration = record.Expiration;
+                    entry.Record = records;
+
+                    offset += size;
+                    records++;
+                }
+
+                // A client that moved to another address is in the journal under both, only its last record
+                // counts. The leases are handed over in journal order, as they were handed out.
+                std::unordered_map<string, uint32_t> latest;
+                std::vector<std::pair<const uint32_t, Entry>*> order;
+
+                for (std::pair<const uint32_t, Entry>& entry : entries) {
+                    uint32_t& record(latest[string(reinterpret_cast<const char*>(entry.second.Id.Id()), entry.second.Id.Length())]);
+
+                    record = std::max(record, entry.second.Record);
+                    order.push_back(&entry);
+                }
+
+                std::sort(order.begin(), order.end(), [](const std::pair<const uint32_t, Entry>* lhs, const std::pair<const uint32_t, Entry>* rhs) -> bool {
+                    return (lhs->second.Record < rhs->second.Record);
+                });
+
+                const uint64_t now = Core::Time::Now().Ticks();
+                uint32_t restored = 0;
+
+                for (const std::pair<const uint32_t, Entry>* entry : order) {
+                    const Entry& lease(entry->second);
+
+                    if ((latest[string(reinterpret_cast<const char*>(lease.Id.Id()), lease.Id.Length())] == lease.Record) && (Keep(lease.Expiration, now) == true)) {
+                        _server.AddLease(DHCPServerImplementation::Lease(lease.Id, entry->first, lease.Expiration));
+                        restored++;
+                    }
+                }
+
+                TRACE_L1("Restored %d leases from %d records of %s", restored, records, _fileName.c_str());
+
+                result = true;
+            }
+        }
+
+        return (result);
+    }
+
+    uint32_t LeaseStore::Open()
+    {
+        ASSERT(_descriptor == -1);
+
+        return (Compact());
+    }
+
+    void LeaseStore::Close()
+    {
+        _job.Revoke();
+
+        _adminLock.Lock();
+
+#ifndef __WINDOWS__
+        if (_descriptor != -1) {
+            ::close(_descriptor);
+            _descriptor = -1;
+        }
+#endif
+
+        _adminLock.Unlock();
+    }
+
+    void LeaseStore::Append(const DHCPServerImplementation::Lease& lease)
+    {
+#ifndef __WINDOWS__
+        std::vector<uint8_t> record;
+        bool compact = false;
+
+        Encode(record, lease);
+
+        _adminLock.Lock();
+
+        if (_descriptor != -1) {
+            if (WriteAll(_descriptor, record.data(), static_cast<uint32_t>(record.size())) == false) {
+                TRACE_L1("Could not write lease to %s", _fileName.c_str());
+            }
+
+            _records++;
+
+            if (_compacting == true) {
+                _pending.insert(_pending.end(), record.begin(), record.end());
+            } else if (_records >= ((2 * _compacted) + Slack)) {
+                compact = true;
+            }
+        }
+
+        _adminLock.Unlock();
+
+        if (compact == true) {
+            _job.Submit();
+        }
+#endif
+    }
+
+    void LeaseStore::Dispatch()
+    {
+        Compact();
+    }
+
+    uint32_t LeaseStore::Compact()
+    {
+#ifdef __WINDOWS__
+        // No journal, the leases are not kept over a restart.
+        return (Core::ERROR_UNAVAILABLE);
+#else
+        uint32_t result = Core::ERROR_NONE;
+        const string fileName(_fileName + _T(".new"));
+        const uint64_t now = Core::Time::Now().Ticks();
+        std::vector<uint8_t> journal(sizeof(Header));
+        uint32_t records = 0;
+
+        Header* header = reinterpret_cast<Header*>(journal.data());
+        ::memcpy(header->Magic, Magic, sizeof(Magic));
+        header->Version = Version;
+
+        {
+            // Changes are appended with the leases locked, so from here on they are also kept aside for
+            // the new journal.
+            DHCPServerImplementation::Iterator index(_server.Leases());
+
+            while (index.Next() == true) {
+                if (Keep(index.Current().Expiration(), now) == true) {
+                    Encode(journal, index.Current());
+                    records++;
+                }
+            }
+
+            _adminLock.Lock();
+            _compacting = true;
+            _pending.clear();
+            _records = records;
+            _adminLock.Unlock();
+        }
+
+        // The heavy part, without any lock.
+        int descriptor = ::open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, S_IRUSR | S_IWUSR);
+
+        if ((descriptor != -1) && (WriteAll(descriptor, journal.data(), static_cast<uint32_t>(journal.size())) == false)) {
+            ::close(descriptor);
+            descriptor = -1;
+        }
+
+        _adminLock.Lock();
+
+        if ((descriptor != -1) && (WriteAll(descriptor, _pending.data(), static_cast<uint32_t>(_pending.size())) == true) && (::fsync(descriptor) == 0) && (::rename(fileName.c_str(), _fileName.c_str()) == 0)) {
+            // The descriptor stays with the file under its new name.
+            if (_descriptor != -1) {
+                ::close(_descriptor);
+            }
+
+            _descriptor = descriptor;
+            _compacted = records;
+
+            // Without it, a power cut can bring back the old journal, without what was appended from here on.
+            if (Sync(Core::File::PathName(_fileName)) == false) {
+                TRACE_L1("Could not sync the directory of the lease journal %s", _fileName.c_str());
+            }
+        } else {
+            TRACE_L1("Could not rewrite the lease journal %s", _fileName.c_str());
+
+            if (descriptor != -1) {
+                ::close(descriptor);
+                ::unlink(fileName.c_str());
+            }
+
+            result = Core::ERROR_WRITE_ERROR;
+        }
+
+        _compacting = false;
+        _pending.clear();
+
+        _adminLock.Unlock();
+
+        return (result);
+#endif
+    }
+
+    /* static */ bool LeaseStore::Keep(const uint64_t expiration, const uint64_t now)
+    {
+        // Taken back (0), or expired so long ago the client is not likely to come back for it.
+        return ((expiration != 0) && ((expiration + Retention) > now));
+    }
+
+    /* static */ void LeaseStore::Encode(std::vector<uint8_t>& buffer, const DHCPServerImplementation::Lease& lease)
+    {
+        const size_t offset = buffer.size();
+        Record record;
+
+        record.Check = 0;
+        record.Address = lease.Raw();
+        record.Expiration = lease.Expiration();
+        record.Length = lease.Id().Length();
+
+        buffer.resize(offset + sizeof(Record) + record.Length);
+        ::memcpy(&(buffer[offset]), &record, sizeof(Record));
+        ::memcpy(&(buffer[offset + sizeof(Record)]), lease.Id().Id(), record.Length);
+
+        record.Check = Check(&(buffer[offset + sizeof(record.Check)]), static_cast<uint32_t>(sizeof(Record) - sizeof(record.Check) + record.Length));
+        ::memcpy(&(buffer[offset]), &(record.Check), sizeof(record.Check));
+    }
+
+    /* static */ uint32_t LeaseStore::Check(const uint8_t data[], const uint32_t length)
+    {
+        uint32_t result = 2166136261U;
+
+        for (uint32_t index = 0; index < length; index++) {
+            result = (result ^ data[index]) * 16777619U;
+        }
+
+        return (result);
+    }
+
+} // namespace Plugin
+} // namespace WPEFramework
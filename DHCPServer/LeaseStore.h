@@ -0,0 +1,95 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Module.h"
+#include "DHCPServerImplementation.h"
+
+namespace WPEFramework {
+namespace Plugin {
+
+    // Append only journal of the leases of a DHCP server. Every change of a lease that was acknowledged (or
+    // taken back) is written as a record at the end, the last record of an address is the one that counts.
+    // On startup the journal is read in one go and the leases are handed to the server, so clients keep their
+    // addresses over a restart. Once the journal holds twice as many records as there were leases at the last
+    // rewrite, it is rewritten on the worker pool with only the leases that are still of use. Leases that
+    // expired longer than the retention ago, or were taken back, are left out.
+    class LeaseStore {
+    private:
+        static constexpr uint32_t Version = 1;
+        static constexpr uint32_t Slack = 256; // records
+        static constexpr uint64_t Retention = 24ULL * 60 * 60 * 1000 * 1000; // microseconds
+
+#pragma pack(push, 1)
+        struct Header {
+            uint8_t Magic[4];
+            uint32_t Version;
+        };
+        struct Record {
+            uint32_t Check; // FNV-1a over the rest of the record and the identifier
+            uint32_t Address;
+            uint64_t Expiration;
+            uint8_t Length; // of the identifier that follows
+        };
+#pragma pack(pop)
+
+        static constexpr uint8_t Magic[] = { 'D', 'H', 'C', 'P' };
+
+    public:
+        LeaseStore() = delete;
+        LeaseStore(const LeaseStore&) = delete;
+        LeaseStore& operator=(const LeaseStore&) = delete;
+
+        LeaseStore(const string& fileName, DHCPServerImplementation& server);
+        ~LeaseStore();
+
+    public:
+        // Hands the leases in the journal to the server, false if there is no journal (yet).
+        bool Restore();
+        // Rewrites the journal with the leases the server has now, and keeps it open for the changes.
+        uint32_t Open();
+        void Close();
+
+        // Called with the leases of the server locked.
+        void Append(const DHCPServerImplementation::Lease& lease);
+
+        void Dispatch();
+
+    private:
+        uint32_t Compact();
+
+        static bool Keep(const uint64_t expiration, const uint64_t now);
+        static void Encode(std::vector<uint8_t>& buffer, const DHCPServerImplementation::Lease& lease);
+        static uint32_t Check(const uint8_t data[], const uint32_t length);
+
+    private:
+        Core::CriticalSection _adminLock;
+        const string _fileName;
+        DHCPServerImplementation& _server;
+        Core::WorkerPool::JobType<LeaseStore&> _job;
+        int _descriptor;
+        uint32_t _records;
+        uint32_t _compacted;
+        bool _compacting;
+        std::vector<uint8_t> _pending; // records appended while compacting
+    };
+
+} // namespace Plugin
+} // namespace WPEFramework
@@ -41,12 +41,32 @@ namespace Plugin {
         return ((value.empty() == false) && (value.find_first_of(Dictionary::NameSpaceDelimiter, 0) == static_cast<size_t>(~0)));
     }
 
+    // One or more names separated by the delimiter, the way the REST interface builds it, it may start with one.
+    static bool IsValidNameSpace(const string& value)
+    {
+        size_t start = (((value.empty() == false) && (value[0] == Dictionary::NameSpaceDelimiter)) ? 1 : 0);
+        bool result = (start < value.length());
+
+        while ((result == true) && (start < value.length())) {
+            size_t end = value.find(Dictionary::NameSpaceDelimiter, start);
+
+            if (end == string::npos) {
+                end = value.length();
+            }
+
+            result = ((end != start) && (end != (value.length() - 1)));
+            start = end + 1;
+        }
+
+        return (result);
+    }
+
     bool Dictionary::CreateInternalDictionary(const string& currentSpace, const NameSpace& current)
     {
         bool correctStructure(true);
         Core::JSON::ArrayType<NameSpace::Entry>::ConstIterator keyIndex(current.Dictionary.Elements());
         Core::JSON::ArrayType<NameSpace>::ConstIterator spaceIndex(current.Spaces.Elements());
-        std::list<RuntimeEntry>* currentList = NULL;
+        Space* currentList = NULL;
 
         // Fill in the keys from this name space...
         while ((correctStructure == true) && (keyIndex.Next() == true)) {
@@ -54,14 +74,24 @@ namespace Plugin {
 
             correctStructure = IsValidName(key);
 
-            if (correctStructure == true) {
+            if ((correctStructure == true) && (Journal::Fits(currentSpace, key, keyIndex.Current().Value.Value()) == false)) {
+                // It could never be written to the journal, the same as a Set would have done, leave it out.
+                SYSLOG(Logging::Startup, (_T("Dictionary key %s is too long to be stored, dropping it."), key.c_str()));
+            } else if (correctStructure == true) {
                 if (currentList == NULL) {
                     currentList = &(_dictionary[currentSpace]);
 
                     ASSERT(currentList != NULL);
                 }
 
-                currentList->push_back(RuntimeEntry(key, keyIndex.Current().Value.Value(), keyIndex.Current().Type.Value()));
+                RuntimeEntry* entry = currentList->Find(key);
+
+                if (entry == nullptr) {
+                    currentList->Add(key, keyIndex.Current().Value.Value(), keyIndex.Current().Type.Value());
+                } else {
+                    // Last one wins, as it would have been if it was set twice.
+                    *entry = RuntimeEntry(key, keyIndex.Current().Value.Value(), keyIndex.Current().Type.Value());
+                }
             }
         }
 
@@ -86,7 +116,7 @@ namespace Plugin {
                 NameSpace& blockToFill(current[index->first]);
 
                 // No we got the namespace bloc, fill in the keys..
-                const std::list<RuntimeEntry>& keyList(index->second);
+                const std::list<RuntimeEntry>& keyList(index->second.Entries());
                 std::list<RuntimeEntry>::const_iterator keyIndex(keyList.begin());
 
                 while (keyIndex != keyList.end()) {
@@ -109,16 +139,36 @@ namespace Plugin {
     {
         _config.FromString(service->ConfigLine());
 
-        Core::File dictionaryFile(service->PersistentPath() + _config.Storage.Value());
+        const string snapshot(service->PersistentPath() + _config.Snapshot.Value());
+        const string journal(service->PersistentPath() + _config.Journal.Value());
+        const bool existing((Core::File(snapshot).Exists() == true) || (Core::File(journal).Exists() == true));
+        Loader loader(*this);
 
-        if (dictionaryFile.Open(true) == true) {
-            NameSpace dictionary;
-            Core::OptionalType<Core::JSON::Error> error;
-            dictionary.IElement::FromFile(dictionaryFile, error);
-            if (error.IsSet() == true) {
-                SYSLOG(Logging::ParsingError, (_T("Parsing failed with %s"), ErrorDisplayMessage(error.Value()).c_str()));
+        _dataLock.WriteLock();
+
+        if (_journal.Open(snapshot, journal, loader) != Core::ERROR_NONE) {
+            SYSLOG(Logging::Startup, (_T("Could not open the dictionary journal %s, changes will not be persisted."), journal.c_str()));
+        }
+
+        _dataLock.WriteUnlock();
+
+        if (existing == false) {
+            // Nothing stored in the binary form yet, see if there is a JSON dump of an earlier version to start from.
+            Core::File dictionaryFile(service->PersistentPath() + _config.Storage.Value());
+
+            if (dictionaryFile.Open(true) == true) {
+                NameSpace dictionary;
+                Core::OptionalType<Core::JSON::Error> error;
+                dictionary.IElement::FromFile(dictionaryFile, error);
+                if (error.IsSet() == true) {
+                    SYSLOG(Logging::ParsingError, (_T("Parsing failed with %s"), ErrorDisplayMessage(error.Value()).c_str()));
+                }
+                _dataLock.WriteLock();
+                CreateInternalDictionary(EMPTY_STRING, dictionary);
+                _dataLock.WriteUnlock();
+
+                Compact();
             }
-            CreateInternalDictionary(EMPTY_STRING, dictionary);
         }
 
         _skipURL = static_cast<uint8_t>(service->WebPrefix().length());
@@ -127,16 +177,19 @@ namespace Plugin {
         return (_T(""));
     }
 
-    /* virtual */ void Dictionary::Deinitialize(PluginHost::IShell* service)
+    /* virtual */ void Dictionary::Deinitialize(PluginHost::IShell* /* service */)
     {
+        _job.Revoke();
 
-        Core::File dictionaryFile(service->PersistentPath() + _config.Storage.Value());
+        // Write out what is still pending and fold the journal into the snapshot, so the next start only
+        // has to load the snapshot.
+        Dispatch();
 
-        if (dictionaryFile.Open(true) == true) {
-            NameSpace dictionary;
-            CreateExternalDictionary(EMPTY_STRING, dictionary);
-            dictionary.IElement::ToFile(dictionaryFile);
+        if (_journal.Size() != 0) {
+            Compact();
         }
+
+        _journal.Close();
     }
 
     /* virtual */ string Dictionary::Information() const
@@ -147,12 +200,18 @@ namespace Plugin {
 
     /* virtual */ void Dictionary::Inbound(Web::Request& request)
     {
-        // There are no requests coming in with a body that require a JSON body. So continue without action here.
-        request.Body(Core::ProxyType<Web::IBody>(textBodyDataFactory.Element()));
+        if (request.Verb == Web::Request::HTTP_PUT) {
+            // A batch of keys, the "dictionary" of a namespace.
+            request.Body(Core::ProxyType<Web::IBody>(jsonBodyDataFactory.Element()));
+        } else {
+            request.Body(Core::ProxyType<Web::IBody>(textBodyDataFactory.Element()));
+        }
     }
 
     // <GET> ../[namespace/]{Key}
-    // <PUT> ../[namespace/]{Key}?Type=[persistent|volatile|closure]
+    // <GET> ../{namespace}?Prefix={prefix}
+    // <POST> ../[namespace/]{Key}?Type=[persistent|volatile|closure]
+    // <PUT> ../{namespace} with a body of { "dictionary": [ { "key": .., "value": .., "type": .. } ] }
     /* virtual */ Core::ProxyType<Web::Response> Dictionary::Process(const Web::Request& request)
     {
         ASSERT(_skipURL <= request.Path.length());
@@ -171,14 +230,67 @@ namespace Plugin {
         string key = index.Current().Text();
 
         while (index.Next() == true) {
-            if (nameSpace.empty() == true) {
+            if (key.empty() == false) {
                 nameSpace += NameSpaceDelimiter;
+                nameSpace += key;
             }
-            nameSpace += key;
             key = index.Current().Text();
         }
 
-        if (request.Verb == Web::Request::HTTP_GET) {
+        Core::TextSegmentIterator query(Core::TextFragment(request.Query), true, '=');
+        const bool hasQuery(query.Next() == true);
+
+        if ((request.Verb == Web::Request::HTTP_GET) && (hasQuery == true) && (query.Current() == _T("Prefix"))) {
+            // The path is the namespace, there is no key.
+            const string prefix(query.Next() == true ? query.Current().Text() : string());
+            Core::ProxyType<Web::JSONBodyType<Dictionary::NameSpace>> response(jsonBodyDataFactory.Element());
+            std::list<RuntimeEntry> entries;
+
+            if (key.empty() == false) {
+                nameSpace += NameSpaceDelimiter;
+                nameSpace += key;
+            }
+
+            _dataLock.ReadLock();
+
+            DictionaryMap::const_iterator space(_dictionary.find(nameSpace));
+
+            if (space != _dictionary.end()) {
+                Collect(space->second, prefix, entries);
+            }
+
+            _dataLock.ReadUnlock();
+
+            response->Name = nameSpace;
+
+            for (const RuntimeEntry& entry : entries) {
+                response->Dictionary.Add(NameSpace::Entry(entry.Key(), entry.Value(), entry.Type()));
+            }
+
+            result->Body(Core::proxy_cast<Web::IBody>(response));
+            result->ContentType = Web::MIMETypes::MIME_JSON;
+        } else if ((request.Verb == Web::Request::HTTP_PUT) && (request.HasBody() == true)) {
+            Core::ProxyType<const Web::JSONBodyType<Dictionary::NameSpace>> body(request.Body<Web::JSONBodyType<Dictionary::NameSpace>>());
+            std::list<Assignment> assignments;
+
+            if (key.empty() == false) {
+                nameSpace += NameSpaceDelimiter;
+                nameSpace += key;
+            }
+
+            if (body.IsValid() == true) {
+                Core::JSON::ArrayType<NameSpace::Entry>::ConstIterator entry(body->Dictionary.Elements());
+
+                while (entry.Next() == true) {
+                    assignments.push_back(Assignment { entry.Current().Key.Value(), entry.Current().Value.Value(), (entry.Current().Type.IsSet() == true ? Core::OptionalType<enumType>(entry.Current().Type.Value()) : Core::OptionalType<enumType>()) });
+                }
+            }
+
+            if ((nameSpace.empty() == true) || (assignments.empty() == true) || (Set(nameSpace, assignments) != Core::ERROR_NONE)) {
+                result->ErrorCode = Web::STATUS_BAD_REQUEST;
+                result->Message = _T("Bad request.");
+            }
+        } else if (request.Verb == Web::Request::HTTP_GET) {
             string value;
             Core::ProxyType<Web::TextBody> valueBody(textBodyDataFactory.Element());
 
@@ -192,18 +304,23 @@ namespace Plugin {
             Dictionary::enumType keyType(Dictionary::enumType::VOLATILE);
             Core::ProxyType<const Web::TextBody> valueBody(request.Body<Web::TextBody>());
             const string value(valueBody.IsValid() == true ? string(*valueBody) : string());
-            Core::TextSegmentIterator typeIterator(Core::TextSegmentIterator(Core::TextFragment(request.Query), true, '='));
 
-            if ((typeIterator.Next() == true) && (typeIterator.Current() == _T("Type")) && (typeIterator.Next() == true)) {
+            if ((hasQuery == true) && (query.Current() == _T("Type")) && (query.Next() == true)) {
                 // Seems we have a type specifier
-                keyType = Core::EnumerateType<Dictionary::enumType>(typeIterator.Current(), false).Value();
+                keyType = Core::EnumerateType<Dictionary::enumType>(query.Current(), false).Value();
             }
 
+            bool changed;
+
             TRACE(Trace::Information, (_T("SetKey ( %s, %s, %s)"), key.c_str(), value.c_str(), Core::EnumerateType<Dictionary::enumType>(keyType).Data()));
-            Set(nameSpace, key, value);
 
-            result->ErrorCode = Web::STATUS_OK;
-            result->Message = _T("OK");
+            if (Modify(nameSpace, key, value, keyType, changed) == Core::ERROR_NONE) {
+                result->ErrorCode = Web::STATUS_OK;
+                result->Message = _T("OK");
+            } else {
+                result->ErrorCode = Web::STATUS_BAD_REQUEST;
+                result->Message = _T("Key or value too long.");
+            }
         } else {
             result->ErrorCode = Web::STATUS_BAD_REQUEST;
             result->Message = _T("Bad request.");
@@ -216,25 +333,20 @@ namespace Plugin {
     {
         bool result = false;
 
-        _adminLock.Lock();
+        _dataLock.ReadLock();
 
         DictionaryMap::const_iterator index(_dictionary.find(nameSpace));
 
         if (index != _dictionary.end()) {
-            const std::list<RuntimeEntry>& container(index->second);
-            std::list<RuntimeEntry>::const_iterator listIndex(container.begin());
-
-            while ((listIndex != container.end()) && (listIndex->Key() != key)) {
-                listIndex++;
-            }
+            const RuntimeEntry* entry = index->second.Find(key);
 
-            if (listIndex != container.end()) {
+            if (entry != nullptr) {
                 result = true;
-                value = listIndex->Value();
+                value = entry->Value();
             }
         }
 
-        _adminLock.Unlock();
+        _dataLock.ReadUnlock();
 
         return (result);
     }
@@ -246,20 +358,20 @@ namespace Plugin {
 
         Exchange::IDictionary::IIterator* result = nullptr;
 
-        _adminLock.Lock();
+        _dataLock.ReadLock();
 
         DictionaryMap::const_iterator index(_dictionary.find(nameSpace));
 
         if (index != _dictionary.end()) {
             Core::ProxyType<Iterator> entries(iterators.Element());
 
-            entries->Load(InternalIterator(index->second));
+            entries->Load(InternalIterator(index->second.Entries()));
 
             result = &(*entries);
             result->AddRef();
         }
 
-        _adminLock.Unlock();
+        _dataLock.ReadUnlock();
 
         return (result);
     }
@@ -268,83 +380,303 @@ namespace Plugin {
     // NameSpace and key MUST be filled.
     /* virtual */ bool Dictionary::Set(const string& nameSpace, const string& key, const string& value)
     {
-        // Direct method to Set a value for a key in a certain namespace from the dictionary.
-        bool result = false;
+        bool changed = false;
 
-        _adminLock.Lock();
+        // New keys are volatile, existing keys keep their type.
+        Modify(nameSpace, key, value, Core::OptionalType<enumType>(), changed);
+
+        return (changed);
+    }
+
+    uint32_t Dictionary::Modify(const string& nameSpace, const string& key, const string& value, const Core::OptionalType<enumType>& type, bool& changed)
+    {
+        uint32_t result = Core::ERROR_INVALID_INPUT_LENGTH;
+
+        changed = false;
+
+        // A namespace is only created for a key that can be stored.
+        if (Journal::Fits(nameSpace, key, value) == true) {
+            _dataLock.WriteLock();
+
+            result = Update(nameSpace, _dictionary[nameSpace], key, value, type, changed);
+
+            _dataLock.WriteUnlock();
+
+            if (changed == true) {
+                Announce(nameSpace, std::list<std::pair<string, string>>({ std::pair<string, string>(key, value) }));
+            }
+        }
+
+        return (result);
+    }
+
+    void Dictionary::Get(const string& nameSpace, const std::list<string>& keys, std::list<RuntimeEntry>& entries) const
+    {
+        _dataLock.ReadLock();
 
-        std::list<RuntimeEntry>& container(_dictionary[nameSpace]);
-        std::list<RuntimeEntry>::iterator listIndex(container.begin());
+        DictionaryMap::const_iterator index(_dictionary.find(nameSpace));
+
+        if (index != _dictionary.end()) {
+            for (const string& key : keys) {
+                const RuntimeEntry* entry = index->second.Find(key);
+
+                if (entry != nullptr) {
+                    entries.push_back(*entry);
+                }
+            }
+        }
+
+        _dataLock.ReadUnlock();
+    }
+
+    uint32_t Dictionary::Set(const string& nameSpace, const std::list<Assignment>& assignments)
+    {
+        uint32_t result = Core::ERROR_NONE;
+        std::list<Assignment>::const_iterator index(assignments.begin());
+
+        while ((index != assignments.end()) && (IsValidName(index->Key) == true) && (Journal::Fits(nameSpace, index->Key, index->Value) == true)) {
+            index++;
+        }
+
+        if ((IsValidNameSpace(nameSpace) == false) || ((index != assignments.end()) && (IsValidName(index->Key) == false))) {
+            result = Core::ERROR_BAD_REQUEST;
+        } else if (index != assignments.end()) {
+            result = Core::ERROR_INVALID_INPUT_LENGTH;
+        } else {
+            std::list<std::pair<string, string>> changes;
+
+            _dataLock.WriteLock();
+
+            Space& container(_dictionary[nameSpace]);
 
-        while ((listIndex != container.end()) && (listIndex->Key() != key)) {
-            listIndex++;
+            for (const Assignment& assignment : assignments) {
+                bool changed;
+
+                if ((Update(nameSpace, container, assignment.Key, assignment.Value, assignment.Type, changed) == Core::ERROR_NONE) && (changed == true)) {
+                    changes.push_back(std::pair<string, string>(assignment.Key, assignment.Value));
+                }
+            }
+
+            _dataLock.WriteUnlock();
+
+            if (changes.empty() == false) {
+                Announce(nameSpace, changes);
+            }
         }
 
-        if (listIndex == container.end()) {
+        return (result);
+    }
+
+    Exchange::IDictionary::IIterator* Dictionary::Get(const string& nameSpace, const string& prefix) const
+    {
+        static Core::ProxyPoolType<Dictionary::Iterator> iterators(4);
+
+        Exchange::IDictionary::IIterator* result = nullptr;
+        std::list<RuntimeEntry> entries;
+
+        if (Get(nameSpace, prefix, entries) == true) {
+            Core::ProxyType<Iterator> iterator(iterators.Element());
+
+            iterator->Load(entries);
+
+            result = &(*iterator);
+            result->AddRef();
+        }
+
+        return (result);
+    }
+
+    bool Dictionary::Get(const string& nameSpace, const string& prefix, std::list<RuntimeEntry>& entries) const
+    {
+        bool result = false;
+
+        _dataLock.ReadLock();
+
+        DictionaryMap::const_iterator index(_dictionary.find(nameSpace));
+
+        if (index != _dictionary.end()) {
             result = true;
-            container.push_back(RuntimeEntry(key, value, VOLATILE));
-        } else if (listIndex->Value() != value) {
+            Collect(index->second, prefix, entries);
+        }
+
+        _dataLock.ReadUnlock();
+
+        return (result);
+    }
+
+    void Dictionary::Collect(const Space& container, const string& prefix, std::list<RuntimeEntry>& entries) const
+    {
+        for (const RuntimeEntry& entry : container.Entries()) {
+            if (entry.Key().compare(0, prefix.length(), prefix) == 0) {
+                entries.push_back(entry);
+            }
+        }
+
+        entries.sort([](const RuntimeEntry& lhs, const RuntimeEntry& rhs) { return (lhs.Key() < rhs.Key()); });
+    }
+
+    // Should be called with the dataLock taken for writing. Keys and values that could not be written to the
+    // journal are rejected, they would be lost at the next start.
+    uint32_t Dictionary::Update(const string& nameSpace, Space& container, const string& key, const string& value, const Core::OptionalType<enumType>& type, bool& changed)
+    {
+        changed = false;
+
+        if (Journal::Fits(nameSpace, key, value) == false) {
+            return (Core::ERROR_INVALID_INPUT_LENGTH);
+        }
+
+        bool result = false;
+        RuntimeEntry* entry = container.Find(key);
+        enumType previous = VOLATILE;
+        bool queued = false;
+
+        if (entry == nullptr) {
             result = true;
-            listIndex->Value(value);
+            entry = &(container.Add(key, value, (type.IsSet() == true ? type.Value() : VOLATILE)));
+        } else {
+            // Entries that are dirty are on the dirty list already.
+            previous = entry->Type();
+            queued = entry->IsDirty();
+
+            if (entry->Value() != value) {
+                result = true;
+                entry->Value(value);
+            }
+            if ((type.IsSet() == true) && (type.Value() != previous)) {
+                entry->Type(type.Value());
+            }
         }
 
-        if (result == true) {
-            ObserverMap::iterator index(_observers.begin());
+        // Like the JSON dump of earlier versions, all entries are persisted, whatever their type.
+        if ((queued == false) && ((result == true) || (entry->Type() != previous))) {
+            entry->Dirty();
+
+            if (_dirty.empty() == true) {
+                _job.Schedule(Core::Time::Now().Add(_config.FlushDelay.Value()));
+            }
 
-            // Right, we updated send out the modification !!!
-            while (index != _observers.end()) {
-                if (index->first == nameSpace) {
-                    index->second->Modified(nameSpace, key, value);
+            _dirty.push_back(std::pair<string, RuntimeEntry*>(nameSpace, entry));
+        }
+
+        changed = result;
+
+        return (Core::ERROR_NONE);
+    }
+
+    // Called without the dataLock, so the observers can read the dictionary from the callback.
+    void Dictionary::Announce(const string& nameSpace, const std::list<std::pair<string, string>>& changes)
+    {
+        _adminLock.Lock();
+
+        ObserverMap::iterator index(_observers.find(nameSpace));
+
+        // Right, we updated send out the modification !!!
+        if (index != _observers.end()) {
+            for (struct Exchange::IDictionary::INotification* observer : index->second) {
+                for (const std::pair<string, string>& change : changes) {
+                    observer->Modified(nameSpace, change.first, change.second);
                 }
-                index++;
             }
         }
 
         _adminLock.Unlock();
 
-        return (result);
+        event_modified(nameSpace, changes);
     }
 
     /* virtual */ void Dictionary::Register(const string& nameSpace, struct Exchange::IDictionary::INotification* sink)
     {
         _adminLock.Lock();
 
-#ifdef __DEBUG__
-        ObserverMap::iterator index(_observers.begin());
+        std::list<struct Exchange::IDictionary::INotification*>& observers(_observers[nameSpace]);
 
         // DO NOT REGISTER THE SAME NOTIFICATION SINK ON THE SAME NAMESPACE MORE THAN ONCE. !!!!!!
-        while (index != _observers.end()) {
-            ASSERT((index->second != sink) || (nameSpace != index->first));
-
-            index++;
-        }
-#endif
+        ASSERT(std::find(observers.begin(), observers.end(), sink) == observers.end());
 
-        _observers.push_back(std::pair<string, struct Exchange::IDictionary::INotification*>(nameSpace, sink));
+        observers.push_back(sink);
 
         _adminLock.Unlock();
     }
 
     /* virtual */ void Dictionary::Unregister(const string& nameSpace, struct Exchange::IDictionary::INotification* sink)
     {
-        bool found = false;
-
         _adminLock.Lock();
 
-        ObserverMap::iterator index(_observers.begin());
+        ObserverMap::iterator index(_observers.find(nameSpace));
+
+        if (index != _observers.end()) {
+            std::list<struct Exchange::IDictionary::INotification*>::iterator entry(std::find(index->second.begin(), index->second.end(), sink));
+
+            if (entry != index->second.end()) {
+                index->second.erase(entry);
 
-        while ((found == false) && (index != _observers.end())) {
-            found = ((index->second == sink) && (nameSpace == index->first));
-            if (found == false) {
-                index++;
+                if (index->second.empty() == true) {
+                    _observers.erase(index);
+                }
             }
         }
 
-        if (index != _observers.end()) {
-            _observers.erase(index);
+        _adminLock.Unlock();
+    }
+    void Dictionary::Dispatch()
+    {
+        string records;
+
+        _dataLock.WriteLock();
+
+        for (std::pair<string, RuntimeEntry*>& entry : _dirty) {
+            if (entry.second->IsDirty() == true) {
+                Journal::Encode(records, entry.second->Type(), entry.first, entry.second->Key(), entry.second->Value());
+                entry.second->Clean();
+            }
         }
 
-        _adminLock.Unlock();
+        _dirty.clear();
+
+        _dataLock.WriteUnlock();
+
+        if ((records.empty() == false) && (_journal.IsOpen() == true)) {
+            if (_journal.Append(records) != Core::ERROR_NONE) {
+                TRACE(Trace::Error, (_T("Could not append %d bytes to the dictionary journal"), static_cast<uint32_t>(records.length())));
+            } else if (_journal.Size() >= (_config.Compaction.Value() * 1024)) {
+                Compact();
+            }
+        }
+    }
+
+    void Dictionary::Compact()
+    {
+        if (_journal.IsOpen() == true) {
+            string records;
+
+            _dataLock.ReadLock();
+
+            for (const std::pair<const string, Space>& space : _dictionary) {
+                for (const RuntimeEntry& entry : space.second.Entries()) {
+                    Journal::Encode(records, entry.Type(), space.first, entry.Key(), entry.Value());
+                }
+            }
+
+            _dataLock.ReadUnlock();
+
+            if (_journal.Snapshot(records) != Core::ERROR_NONE) {
+                TRACE(Trace::Error, (_T("Could not write a new dictionary snapshot")));
+            }
+        }
+    }
+
+    void Dictionary::Restore(const uint8_t type, const string& nameSpace, const string& key, const string& value)
+    {
+        if ((type <= CLOSURE) && (IsValidName(key) == true)) {
+            Space& space(_dictionary[nameSpace]);
+            RuntimeEntry* entry = space.Find(key);
+
+            if (entry == nullptr) {
+                space.Add(key, value, static_cast<enumType>(type));
+            } else {
+                *entry = RuntimeEntry(key, value, static_cast<enumType>(type));
+            }
+        }
     }
 }
 }
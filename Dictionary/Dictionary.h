@@ -21,12 +21,17 @@
 #define __DICTIONARY_H
 
 #include "Module.h"
+#include "HashIndex.h"
+#include "Journal.h"
+#include "ReadWriteLock.h"
 #include <interfaces/IDictionary.h>
 
+#include <unordered_map>
+
 namespace WPEFramework {
 namespace Plugin {
 
-    class Dictionary : public PluginHost::IPlugin, public PluginHost::IWeb, public Exchange::IDictionary {
+    class Dictionary : public PluginHost::IPlugin, public PluginHost::IWeb, public PluginHost::JSONRPC, public Exchange::IDictionary {
     public:
         static const TCHAR NameSpaceDelimiter = '/';
         enum enumType {
@@ -35,6 +40,14 @@ namespace Plugin {
             CLOSURE
         };
 
+        // A single change of a batched Set. If no type is given, an existing key keeps its type and a new
+        // key is volatile, just like a plain Set.
+        struct Assignment {
+            string Key;
+            string Value;
+            Core::OptionalType<enumType> Type;
+        };
+
     private:
         Dictionary(const Dictionary&) = delete;
         Dictionary& operator=(const Dictionary&) = delete;
@@ -93,6 +106,24 @@ namespace Plugin {
             {
                 return (_type);
             }
+            inline void Type(const enumType type)
+            {
+                _dirty = true;
+                _type = type;
+            }
+            // Dirty entries changed since they were last written to the journal.
+            inline bool IsDirty() const
+            {
+                return (_dirty);
+            }
+            inline void Dirty()
+            {
+                _dirty = true;
+            }
+            inline void Clean()
+            {
+                _dirty = false;
+            }
 
         private:
             string _key;
@@ -101,8 +132,81 @@ namespace Plugin {
             bool _dirty;
         };
 
-        typedef std::map<const string, std::list<RuntimeEntry>> DictionaryMap;
-        typedef std::list<std::pair<const string, struct Exchange::IDictionary::INotification*>> ObserverMap;
+        // All keys of a namespace. The entries are kept in a list, so they do not move and can be iterated
+        // in the order they were created, the index finds them by key.
+        class Space {
+        private:
+            Space(const Space&) = delete;
+            Space& operator=(const Space&) = delete;
+
+        public:
+            Space()
+                : _entries()
+                , _index()
+            {
+            }
+            ~Space()
+            {
+            }
+
+        public:
+            inline const std::list<RuntimeEntry>& Entries() const
+            {
+                return (_entries);
+            }
+            inline const RuntimeEntry* Find(const string& key) const
+            {
+                return (_index.Find(key));
+            }
+            inline RuntimeEntry* Find(const string& key)
+            {
+                return (_index.Find(key));
+            }
+            RuntimeEntry& Add(const string& key, const string& value, const enumType type)
+            {
+                ASSERT(_index.Find(key) == nullptr);
+
+                _entries.push_back(RuntimeEntry(key, value, type));
+                _index.Insert(&(_entries.back()));
+
+                return (_entries.back());
+            }
+
+        private:
+            std::list<RuntimeEntry> _entries;
+            HashIndexType<RuntimeEntry> _index;
+        };
+
+        // Feeds the records found in the snapshot and the journal into the dictionary.
+        class Loader {
+        private:
+            Loader() = delete;
+            Loader(const Loader&) = delete;
+            Loader& operator=(const Loader&) = delete;
+
+        public:
+            Loader(Dictionary& parent)
+                : _parent(parent)
+            {
+            }
+            ~Loader()
+            {
+            }
+
+        public:
+            void Restore(const uint8_t type, const string& nameSpace, const string& key, const string& value)
+            {
+                _parent.Restore(type, nameSpace, key, value);
+            }
+
+        private:
+            Dictionary& _parent;
+        };
+
+        typedef std::unordered_map<string, Space> DictionaryMap;
+        typedef std::vector<std::pair<string, RuntimeEntry*>> DirtyList;
+        typedef Core::WorkerPool::JobType<Dictionary&> Job;
+        typedef std::unordered_map<string, std::list<struct Exchange::IDictionary::INotification*>> ObserverMap;
         typedef Core::IteratorType<const std::list<RuntimeEntry>, const RuntimeEntry&, std::list<RuntimeEntry>::const_iterator> InternalIterator;
 
     public:
@@ -113,7 +217,8 @@ namespace Plugin {
 
         public:
             Iterator()
-                : _iterator()
+                : _entries()
+                , _iterator()
                 , _lifeTime(nullptr)
             {
             }
@@ -130,8 +235,16 @@ namespace Plugin {
             void Load(const InternalIterator& iterator)
             {
                 ASSERT(_lifeTime != nullptr);
+                _entries.clear();
                 _iterator = iterator;
             }
+            // Iterate over a copy of the entries, owned by the iterator.
+            void Load(std::list<RuntimeEntry>& entries)
+            {
+                ASSERT(_lifeTime != nullptr);
+                _entries.swap(entries);
+                _iterator = InternalIterator(_entries);
+            }
             // IUnknown implementation
             // -----------------------------------------------
             virtual void AddRef() const
@@ -174,6 +287,7 @@ namespace Plugin {
             }
 
         private:
+            std::list<RuntimeEntry> _entries;
             InternalIterator _iterator;
             Core::IReferenceCounted* _lifeTime;
         };
@@ -318,6 +432,71 @@ namespace Plugin {
                 return (*current);
             }
         };
+        // JSON-RPC parameters.
+        class GetParams : public Core::JSON::Container {
+        private:
+            GetParams(const GetParams&) = delete;
+            GetParams& operator=(const GetParams&) = delete;
+
+        public:
+            GetParams()
+                : Core::JSON::Container()
+            {
+                Add(_T("namespace"), &NameSpace);
+                Add(_T("keys"), &Keys);
+                Add(_T("prefix"), &Prefix);
+            }
+            ~GetParams()
+            {
+            }
+
+        public:
+            Core::JSON::String NameSpace;
+            // Either the keys to get, or the prefix of the keys to get.
+            Core::JSON::ArrayType<Core::JSON::String> Keys;
+            Core::JSON::String Prefix;
+        };
+        class SetParams : public Core::JSON::Container {
+        private:
+            SetParams(const SetParams&) = delete;
+            SetParams& operator=(const SetParams&) = delete;
+
+        public:
+            SetParams()
+                : Core::JSON::Container()
+            {
+                Add(_T("namespace"), &NameSpace);
+                Add(_T("entries"), &Entries);
+            }
+            ~SetParams()
+            {
+            }
+
+        public:
+            Core::JSON::String NameSpace;
+            Core::JSON::ArrayType<Dictionary::NameSpace::Entry> Entries;
+        };
+        class ModifiedParams : public Core::JSON::Container {
+        private:
+            ModifiedParams(const ModifiedParams&) = delete;
+            ModifiedParams& operator=(const ModifiedParams&) = delete;
+
+        public:
+            ModifiedParams()
+                : Core::JSON::Container()
+            {
+                Add(_T("namespace"), &NameSpace);
+                Add(_T("keys"), &Keys);
+            }
+            ~ModifiedParams()
+            {
+            }
+
+        public:
+            Core::JSON::String NameSpace;
+            Core::JSON::ArrayType<Core::JSON::String> Keys;
+        };
+
         class Config : public Core::JSON::Container {
         private:
             Config(const Config&) = delete;
@@ -327,9 +506,17 @@ namespace Plugin {
             Config()
                 : Core::JSON::Container()
                 , Storage(_T("dictionary.json"))
+                , Snapshot(_T("dictionary.snapshot"))
+                , Journal(_T("dictionary.journal"))
+                , FlushDelay(100)
+                , Compaction(64)
                 , LingerTime(10)
             { // Time in minutes.
                 Add(_T("storage"), &Storage);
+                Add(_T("snapshot"), &Snapshot);
+                Add(_T("journal"), &Journal);
+                Add(_T("flushdelay"), &FlushDelay);
+                Add(_T("compaction"), &Compaction);
                 Add(_T("lingertime"), &LingerTime);
             }
             ~Config()
@@ -337,25 +524,40 @@ namespace Plugin {
             }
 
         public:
+            // JSON dump of the dictionary, only read if there is no snapshot or journal yet.
             Core::JSON::String Storage;
+            Core::JSON::String Snapshot;
+            Core::JSON::String Journal;
+            // Time, in ms, changes are collected before they are appended to the journal together.
+            Core::JSON::DecUInt16 FlushDelay;
+            // Size, in KB, the journal may grow to before it is compacted into a new snapshot.
+            Core::JSON::DecUInt32 Compaction;
             Core::JSON::DecUInt16 LingerTime;
         };
 
     public:
         Dictionary()
             : _adminLock()
+            , _dataLock()
             , _skipURL(0)
             , _config()
             , _dictionary()
+            , _observers()
+            , _journal()
+            , _dirty()
+            , _job(*this)
         {
+            RegisterAll();
         }
         virtual ~Dictionary()
         {
+            UnregisterAll();
         }
 
         BEGIN_INTERFACE_MAP(Dictionary)
         INTERFACE_ENTRY(IPlugin)
         INTERFACE_ENTRY(IWeb)
+        INTERFACE_ENTRY(PluginHost::IDispatcher)
         INTERFACE_ENTRY(Exchange::IDictionary)
         END_INTERFACE_MAP
 
@@ -406,16 +608,47 @@ namespace Plugin {
         virtual void Register(const string& nameSpace, struct Exchange::IDictionary::INotification* sink);
         virtual void Unregister(const string& nameSpace, struct Exchange::IDictionary::INotification* sink);
 
+        // Batched variants, done under a single lock. Get leaves out the keys that do not exist, Set applies
+        // all assignments or, if the namespace or one of the keys is not valid or a key or value is too long
+        // to be stored, none and reports all changes in one go.
+        void Get(const string& nameSpace, const std::list<string>& keys, std::list<RuntimeEntry>& entries) const;
+        uint32_t Set(const string& nameSpace, const std::list<Assignment>& assignments);
+
+        // Iterates, in key order, over a copy of the entries of a namespace of which the key starts with the prefix.
+        IDictionary::IIterator* Get(const string& nameSpace, const string& prefix) const;
+        bool Get(const string& nameSpace, const string& prefix, std::list<RuntimeEntry>& entries) const;
+
+        // Appends the dirty entries to the journal, scheduled on the workerpool after a change.
+        void Dispatch();
+
     private:
+        uint32_t Modify(const string& nameSpace, const string& key, const string& value, const Core::OptionalType<enumType>& type, bool& changed);
+        uint32_t Update(const string& nameSpace, Space& container, const string& key, const string& value, const Core::OptionalType<enumType>& type, bool& changed);
+        void Announce(const string& nameSpace, const std::list<std::pair<string, string>>& changes);
+        void Collect(const Space& container, const string& prefix, std::list<RuntimeEntry>& entries) const;
+
+        // JsonRpc
+        void RegisterAll();
+        void UnregisterAll();
+        uint32_t endpoint_get(const GetParams& params, Core::JSON::ArrayType<NameSpace::Entry>& response);
+        uint32_t endpoint_set(const SetParams& params);
+        void event_modified(const string& nameSpace, const std::list<std::pair<string, string>>& changes);
+        void Restore(const uint8_t type, const string& nameSpace, const string& key, const string& value);
+        void Compact();
         bool CreateInternalDictionary(const string& currentSpace, const NameSpace& data);
         void CreateExternalDictionary(const string& currentSpace, NameSpace& data) const;
 
     private:
+        // The adminLock guards the observers, the dataLock the dictionary itself.
         mutable Core::CriticalSection _adminLock;
+        mutable ReadWriteLock _dataLock;
         uint8_t _skipURL;
         Config _config;
         DictionaryMap _dictionary;
         ObserverMap _observers;
+        Journal _journal;
+        DirtyList _dirty;
+        Job _job;
     };
 }
 }
@@ -0,0 +1,110 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Module.h"
+#include "Dictionary.h"
+
+namespace WPEFramework {
+
+namespace Plugin {
+
+    // Registration
+    //
+
+    void Dictionary::RegisterAll()
+    {
+        JSONRPC::Register<GetParams, Core::JSON::ArrayType<NameSpace::Entry>>(_T("get"), &Dictionary::endpoint_get, this);
+        JSONRPC::Register<SetParams, void>(_T("set"), &Dictionary::endpoint_set, this);
+    }
+
+    void Dictionary::UnregisterAll()
+    {
+        JSONRPC::Unregister(_T("set"));
+        JSONRPC::Unregister(_T("get"));
+    }
+
+    // API implementation
+    //
+
+    // Method: get - Gets a set of keys, or all keys starting with a prefix, from a namespace
+    // Return codes:
+    //  - ERROR_NONE: Success
+    //  - ERROR_UNKNOWN_KEY: The namespace does not exist
+    uint32_t Dictionary::endpoint_get(const GetParams& params, Core::JSON::ArrayType<NameSpace::Entry>& response)
+    {
+        uint32_t result = Core::ERROR_NONE;
+        const string& nameSpace = params.NameSpace.Value();
+
+        std::list<RuntimeEntry> entries;
+
+        if (params.Keys.IsSet() == true) {
+            std::list<string> keys;
+            Core::JSON::ArrayType<Core::JSON::String>::ConstIterator index(params.Keys.Elements());
+
+            while (index.Next() == true) {
+                keys.push_back(index.Current().Value());
+            }
+
+            Get(nameSpace, keys, entries);
+        } else if (Get(nameSpace, params.Prefix.Value(), entries) == false) {
+            result = Core::ERROR_UNKNOWN_KEY;
+        }
+
+        for (const RuntimeEntry& entry : entries) {
+            response.Add(NameSpace::Entry(entry.Key(), entry.Value(), entry.Type()));
+        }
+
+        return (result);
+    }
+
+    // Method: set - Sets a batch of keys in a namespace, all or none of them
+    // Return codes:
+    //  - ERROR_NONE: Success
+    //  - ERROR_BAD_REQUEST: The namespace or a key is not valid, nothing was set
+    uint32_t Dictionary::endpoint_set(const SetParams& params)
+    {
+        std::list<Assignment> assignments;
+        Core::JSON::ArrayType<NameSpace::Entry>::ConstIterator index(params.Entries.Elements());
+
+        while (index.Next() == true) {
+            const NameSpace::Entry& entry(index.Current());
+
+            assignments.push_back(Assignment { entry.Key.Value(), entry.Value.Value(), (entry.Type.IsSet() == true ? Core::OptionalType<enumType>(entry.Type.Value()) : Core::OptionalType<enumType>()) });
+        }
+
+        return (Set(params.NameSpace.Value(), assignments));
+    }
+
+    // Event: modified - Signals the keys of a namespace that were changed together
+    void Dictionary::event_modified(const string& nameSpace, const std::list<std::pair<string, string>>& changes)
+    {
+        ModifiedParams params;
+        params.NameSpace = nameSpace;
+
+        for (const std::pair<string, string>& change : changes) {
+            Core::JSON::String& key(params.Keys.Add());
+            key = change.first;
+        }
+
+        Notify(_T("modified"), params);
+    }
+
+} // namespace Plugin
+
+}
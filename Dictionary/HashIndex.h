@@ -0,0 +1,131 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Module.h"
+
+namespace WPEFramework {
+namespace Plugin {
+
+    // Open addressing (linear probing) index on the Key() of elements that are owned elsewhere. The slots
+    // hold the hash next to the element, so a probe sequence only touches a key when the hashes match.
+    // The table is kept at most half full, which keeps the probe sequences short.
+    template <typename ELEMENT>
+    class HashIndexType {
+    private:
+        struct Slot {
+            size_t Hash;
+            ELEMENT* Element;
+        };
+
+    public:
+        HashIndexType(const HashIndexType<ELEMENT>&) = delete;
+        HashIndexType<ELEMENT>& operator=(const HashIndexType<ELEMENT>&) = delete;
+
+        HashIndexType()
+            : _slots()
+            , _count(0)
+        {
+        }
+        ~HashIndexType()
+        {
+        }
+
+    public:
+        inline uint32_t Count() const
+        {
+            return (_count);
+        }
+        ELEMENT* Find(const string& key) const
+        {
+            ELEMENT* result = nullptr;
+
+            if (_count != 0) {
+                const size_t hash = Hash(key);
+                const size_t mask = _slots.size() - 1;
+                size_t index = hash & mask;
+
+                while ((_slots[index].Element != nullptr) && (result == nullptr)) {
+                    if ((_slots[index].Hash == hash) && (_slots[index].Element->Key() == key)) {
+                        result = _slots[index].Element;
+                    } else {
+                        index = (index + 1) & mask;
+                    }
+                }
+            }
+
+            return (result);
+        }
+        // The key of the element should not be in the index yet.
+        void Insert(ELEMENT* element)
+        {
+            ASSERT(element != nullptr);
+            ASSERT(Find(element->Key()) == nullptr);
+
+            if (((_count + 1) * 2) > _slots.size()) {
+                Rehash(_slots.empty() == true ? 16 : (_slots.size() * 2));
+            }
+
+            Place(Hash(element->Key()), element);
+            _count++;
+        }
+        void Clear()
+        {
+            _slots.clear();
+            _count = 0;
+        }
+
+    private:
+        static inline size_t Hash(const string& key)
+        {
+            return (std::hash<string>()(key));
+        }
+        void Place(const size_t hash, ELEMENT* element)
+        {
+            const size_t mask = _slots.size() - 1;
+            size_t index = hash & mask;
+
+            while (_slots[index].Element != nullptr) {
+                index = (index + 1) & mask;
+            }
+
+            _slots[index].Hash = hash;
+            _slots[index].Element = element;
+        }
+        void Rehash(const size_t size)
+        {
+            std::vector<Slot> old(size, Slot { 0, nullptr });
+
+            _slots.swap(old);
+
+            for (const Slot& slot : old) {
+                if (slot.Element != nullptr) {
+                    Place(slot.Hash, slot.Element);
+                }
+            }
+        }
+
+    private:
+        std::vector<Slot> _slots;
+        uint32_t _count;
+    };
+
+} // namespace Plugin
+} // namespace WPEFramework
@@ -0,0 +1,388 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Module.h"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <limits>
+#include <sys/stat.h>
+
+#ifndef __WINDOWS__
+#include <unistd.h>
+#endif
+
+namespace WPEFramework {
+namespace Plugin {
+
+    // Persistent storage of key/value records as a binary snapshot plus an append only journal of the records
+    // that changed since. Every record is stored as:
+    //     [uint32 payload length][uint32 checksum][payload]
+    // with the payload:
+    //     [uint8 type][uint16 namespace length][namespace][uint16 key length][key][uint32 value length][value]
+    // A record that is cut short or does not match its checksum ends the journal, that is where the power
+    // was cut during the last append. Restoring reads both files sequentially, there is nothing to parse.
+    // Records that would not be replayed, as their fields do not fit, are not encoded at all. There is no
+    // journal on Windows.
+    class Journal {
+    private:
+        static constexpr uint8_t HeaderSize = 8;
+        static constexpr uint32_t MaxRecordSize = 16 * 1024 * 1024;
+        static constexpr uint8_t SignatureSize = 8;
+
+        static inline const char* Signature()
+        {
+            return ("DICTSNP1");
+        }
+
+    public:
+        Journal(const Journal&) = delete;
+        Journal& operator=(const Journal&) = delete;
+
+        Journal()
+            : _snapshot()
+            , _journal()
+            , _descriptor(-1)
+            , _size(0)
+        {
+        }
+        ~Journal()
+        {
+            Close();
+        }
+
+    public:
+        inline bool IsOpen() const
+        {
+            return (_descriptor != -1);
+        }
+        // Size, in bytes, of the journal, i.e. of what has been appended since the last snapshot.
+        inline uint32_t Size() const
+        {
+            return (_size);
+        }
+
+        // Whether a record with these fields can be encoded and replayed again.
+        static bool Fits(const string& nameSpace, const string& key, const string& value)
+        {
+            return ((nameSpace.length() <= std::numeric_limits<uint16_t>::max()) && (key.length() <= std::numeric_limits<uint16_t>::max()) && ((1 + 2 + nameSpace.length() + 2 + key.length() + 4 + static_cast<uint64_t>(value.length())) <= MaxRecordSize));
+        }
+        // Appends a record to a buffer, to be handed to Append or Snapshot. A record that does not fit is left out.
+        static uint32_t Encode(string& buffer, const uint8_t type, const string& nameSpace, const string& key, const string& value)
+        {
+            if (Fits(nameSpace, key, value) == false) {
+                return (Core::ERROR_INVALID_INPUT_LENGTH);
+            }
+
+            const uint32_t length = 1 + 2 + static_cast<uint32_t>(nameSpace.length()) + 2 + static_cast<uint32_t>(key.length()) + 4 + static_cast<uint32_t>(value.length());
+            const size_t start = buffer.length();
+
+            buffer.reserve(start + HeaderSize + length);
+            Store<uint32_t>(buffer, length);
+            Store<uint32_t>(buffer, 0);
+            Store<uint8_t>(buffer, type);
+            Store<uint16_t>(buffer, static_cast<uint16_t>(nameSpace.length()));
+            buffer.append(nameSpace);
+            Store<uint16_t>(buffer, static_cast<uint16_t>(key.length()));
+            buffer.append(key);
+            Store<uint32_t>(buffer, static_cast<uint32_t>(value.length()));
+            buffer.append(value);
+
+            const uint32_t checksum = Checksum(reinterpret_cast<const uint8_t*>(&(buffer[start + HeaderSize])), length);
+            ::memcpy(&(buffer[start + 4]), &checksum, sizeof(checksum));
+
+            return (Core::ERROR_NONE);
+        }
+
+        // Loads the snapshot and replays the journal on top of it, calling handler.Restore(type, nameSpace, key, value)
+        // for every record, after which the journal is open for appending.
+        template <typename HANDLER>
+        uint32_t Open(const string& snapshot, const string& journal, HANDLER& handler)
+        {
+            ASSERT(IsOpen() == false);
+
+#ifdef __WINDOWS__
+            return (Core::ERROR_UNAVAILABLE);
+#else
+            _snapshot = snapshot;
+            _journal = journal;
+
+            string content;
+
+            if ((Read(_snapshot, content) == true) && (content.length() >= SignatureSize)) {
+                if (::memcmp(content.data(), Signature(), SignatureSize) != 0) {
+                    SYSLOG(Logging::Startup, (_T("Dictionary snapshot %s is not recognized, ignoring it."), _snapshot.c_str()));
+                } else {
+                    Replay(content, SignatureSize, handler);
+                }
+            }
+
+            uint32_t valid = 0;
+
+            if (Read(_journal, content) == true) {
+                valid = Replay(content, 0, handler);
+
+                if (valid != content.length()) {
+                    SYSLOG(Logging::Startup, (_T("Dictionary journal is truncated after %d of %d bytes."), valid, static_cast<uint32_t>(content.length())));
+                }
+            }
+
+            _descriptor = ::open(_journal.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR | S_IRGRP);
+
+            if (_descriptor == -1) {
+                return (Core::ERROR_OPENING_FAILED);
+            }
+
+            // Drop whatever was left of a record that did not make it completely.
+            if ((::ftruncate(_descriptor, valid) != 0) || (::lseek(_descriptor, valid, SEEK_SET) != static_cast<off_t>(valid))) {
+                Close();
+                return (Core::ERROR_WRITE_ERROR);
+            }
+
+            _size = valid;
+
+            return (Core::ERROR_NONE);
+#endif
+        }
+        void Close()
+        {
+#ifndef __WINDOWS__
+            if (_descriptor != -1) {
+                ::close(_descriptor);
+                _descriptor = -1;
+            }
+#endif
+            _size = 0;
+        }
+        // Writes out the given records and waits till they are on the storage.
+        uint32_t Append(const string& records)
+        {
+            ASSERT(IsOpen() == true);
+
+            uint32_t result = Write(_descriptor, records);
+
+            if (result == Core::ERROR_NONE) {
+                _size += static_cast<uint32_t>(records.length());
+            } else {
+#ifndef __WINDOWS__
+                // Do not leave half a batch behind, the records that follow would never be replayed.
+                if (::ftruncate(_descriptor, _size) == 0) {
+                    ::lseek(_descriptor, _size, SEEK_SET);
+                }
+#endif
+            }
+
+            return (result);
+        }
+        // Replaces the snapshot by the given records and empties the journal. The new snapshot is written
+        // next to the old one and renamed over it, so there is always one complete snapshot on storage.
+        uint32_t Snapshot(const string& records)
+        {
+            ASSERT(IsOpen() == true);
+
+            uint32_t result = Core::ERROR_OPENING_FAILED;
+
+#ifndef __WINDOWS__
+            const string temporary(_snapshot + _T(".new"));
+            int descriptor = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR | S_IRGRP);
+
+            if (descriptor != -1) {
+                result = Write(descriptor, string(Signature(), SignatureSize) + records);
+                ::close(descriptor);
+
+                if (result != Core::ERROR_NONE) {
+                    ::unlink(temporary.c_str());
+                } else if (::rename(temporary.c_str(), _snapshot.c_str()) != 0) {
+                    ::unlink(temporary.c_str());
+                    result = Core::ERROR_WRITE_ERROR;
+                } else if (Sync(Core::File::PathName(_snapshot)) == false) {
+                    // The rename might not survive a power cut, so the journal can not be dropped yet.
+                    result = Core::ERROR_WRITE_ERROR;
+                } else if ((::ftruncate(_descriptor, 0) == 0) && (::lseek(_descriptor, 0, SEEK_SET) == 0)) {
+                    ::fdatasync(_descriptor);
+                    _size = 0;
+                } else {
+                    // The journal will be replayed on top of a snapshot that already holds it, no harm done.
+                    result = Core::ERROR_WRITE_ERROR;
+                }
+            }
+#endif
+
+            return (result);
+        }
+
+    private:
+        // A rename is only durable once the directory holding it is synced.
+        static bool Sync(const string& directory)
+        {
+            bool result = false;
+#ifndef __WINDOWS__
+            int descriptor = ::open((directory.empty() == true ? _T(".") : directory.c_str()), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+            if (descriptor != -1) {
+                result = (::fsync(descriptor) == 0);
+                ::close(descriptor);
+            }
+#endif
+
+            return (result);
+        }
+        template <typename TYPE>
+        static inline void Store(string& buffer, const TYPE value)
+        {
+            buffer.append(reinterpret_cast<const char*>(&value), sizeof(TYPE));
+        }
+        template <typename TYPE>
+        static inline bool Load(const string& buffer, uint32_t& offset, const uint32_t end, TYPE& value)
+        {
+            bool result = ((offset + sizeof(TYPE)) <= end);
+
+            if (result == true) {
+                ::memcpy(&value, &(buffer[offset]), sizeof(TYPE));
+                offset += sizeof(TYPE);
+            }
+
+            return (result);
+        }
+        static inline bool Load(const string& buffer, uint32_t& offset, const uint32_t end, const uint32_t length, string& value)
+        {
+            bool result = ((offset + length) <= end);
+
+            if (result == true) {
+                value.assign(buffer, offset, length);
+                offset += length;
+            }
+
+            return (result);
+        }
+        // FNV-1a, it only has to catch a torn write, not tampering.
+        static uint32_t Checksum(const uint8_t data[], const uint32_t length)
+        {
+            uint32_t result = 2166136261u;
+
+            for (uint32_t index = 0; index < length; index++) {
+                result = (result ^ data[index]) * 16777619u;
+            }
+
+            return (result);
+        }
+        // Returns the offset up to which the records were valid.
+        template <typename HANDLER>
+        static uint32_t Replay(const string& content, uint32_t offset, HANDLER& handler)
+        {
+            const uint32_t total = static_cast<uint32_t>(content.length());
+            bool valid = true;
+
+            while ((valid == true) && (offset < total)) {
+                uint32_t cursor = offset;
+                uint32_t length = 0;
+                uint32_t checksum = 0;
+
+                valid = (Load(content, cursor, total, length) == true) && (Load(content, cursor, total, checksum) == true) && (length <= MaxRecordSize) && ((cursor + length) <= total) && (Checksum(reinterpret_cast<const uint8_t*>(&(content[cursor])), length) == checksum);
+
+                if (valid == true) {
+                    const uint32_t end = cursor + length;
+                    uint8_t type = 0;
+                    uint16_t nameSpaceLength = 0;
+                    uint16_t keyLength = 0;
+                    uint32_t valueLength = 0;
+                    string nameSpace;
+                    string key;
+                    string value;
+
+                    valid = (Load(content, cursor, end, type) == true) && (Load(content, cursor, end, nameSpaceLength) == true) && (Load(content, cursor, end, nameSpaceLength, nameSpace) == true) && (Load(content, cursor, end, keyLength) == true) && (Load(content, cursor, end, keyLength, key) == true) && (Load(content, cursor, end, valueLength) == true) && (Load(content, cursor, end, valueLength, value) == true);
+
+                    if (valid == true) {
+                        handler.Restore(type, nameSpace, key, value);
+                        offset = end;
+                    }
+                }
+            }
+
+            return (offset);
+        }
+        static bool Read(const string& fileName, string& content)
+        {
+            bool result = false;
+
+            content.clear();
+
+#ifndef __WINDOWS__
+            int descriptor = ::open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+
+            if (descriptor != -1) {
+                struct stat info;
+
+                if ((::fstat(descriptor, &info) == 0) && (info.st_size > 0)) {
+                    ssize_t loaded = 0;
+
+                    content.resize(static_cast<size_t>(info.st_size));
+
+                    while ((loaded < info.st_size) && (result == false)) {
+                        ssize_t count = ::read(descriptor, &(content[loaded]), static_cast<size_t>(info.st_size - loaded));
+
+                        if (count > 0) {
+                            loaded += count;
+                        } else if ((count == 0) || (errno != EINTR)) {
+                            break;
+                        }
+                    }
+
+                    content.resize(static_cast<size_t>(loaded));
+                    result = (loaded != 0);
+                }
+
+                ::close(descriptor);
+            }
+#endif
+
+            return (result);
+        }
+        static uint32_t Write(const int descriptor, const string& data)
+        {
+#ifdef __WINDOWS__
+            return (Core::ERROR_UNAVAILABLE);
+#else
+            size_t written = 0;
+
+            while (written < data.length()) {
+                ssize_t count = ::write(descriptor, &(data[written]), data.length() - written);
+
+                if (count > 0) {
+                    written += static_cast<size_t>(count);
+                } else if ((count == 0) || (errno != EINTR)) {
+                    return (Core::ERROR_WRITE_ERROR);
+                }
+            }
+
+            return (::fdatasync(descriptor) == 0 ? Core::ERROR_NONE : Core::ERROR_WRITE_ERROR);
+#endif
+        }
+
+    private:
+        string _snapshot;
+        string _journal;
+        int _descriptor;
+        uint32_t _size;
+    };
+
+} // namespace Plugin
+} // namespace WPEFramework
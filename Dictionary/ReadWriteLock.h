@@ -0,0 +1,90 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Module.h"
+
+#include <condition_variable>
+#include <mutex>
+
+namespace WPEFramework {
+namespace Plugin {
+
+    // Many readers or a single writer. Lookups, by far the most common operation, do not have to wait for
+    // each other, only for a writer. Writers go first, so a steady stream of readers can not starve them.
+    class ReadWriteLock {
+    private:
+        ReadWriteLock(const ReadWriteLock&) = delete;
+        ReadWriteLock& operator=(const ReadWriteLock&) = delete;
+
+    public:
+        ReadWriteLock()
+            : _lock()
+            , _signal()
+            , _readers(0)
+            , _writers(0)
+            , _writing(false)
+        {
+        }
+        ~ReadWriteLock()
+        {
+        }
+
+    public:
+        void ReadLock() const
+        {
+            std::unique_lock<std::mutex> guard(_lock);
+            _signal.wait(guard, [this] { return ((_writers == 0) && (_writing == false)); });
+            _readers++;
+        }
+        void ReadUnlock() const
+        {
+            std::unique_lock<std::mutex> guard(_lock);
+            ASSERT(_readers > 0);
+            if (--_readers == 0) {
+                _signal.notify_all();
+            }
+        }
+        void WriteLock()
+        {
+            std::unique_lock<std::mutex> guard(_lock);
+            _writers++;
+            _signal.wait(guard, [this] { return ((_readers == 0) && (_writing == false)); });
+            _writers--;
+            _writing = true;
+        }
+        void WriteUnlock()
+        {
+            std::unique_lock<std::mutex> guard(_lock);
+            ASSERT(_writing == true);
+            _writing = false;
+            _signal.notify_all();
+        }
+
+    private:
+        mutable std::mutex _lock;
+        mutable std::condition_variable _signal;
+        mutable uint32_t _readers;
+        uint32_t _writers;
+        bool _writing;
+    };
+
+} // namespace Plugin
+} // namespace WPEFramework
@@ -29,6 +29,7 @@ namespace Plugin {
         Config config;
         config.FromString(service->ConfigLine());
 
+        _logOutput.Configure(config.Batch.Value(), config.Datagram.Value(), config.Compress.Value(), config.Rate.Value(), config.Queue.Value());
         _logOutput.SetDestination(config.Destination.Binding.Value(), config.Destination.Port.Value());
         _observer.Register(config.FilePath.Value(), &_fileUpdate, config.FullFile.Value());
 
@@ -42,7 +43,19 @@ namespace Plugin {
 
     string FileTransfer::Information() const
     {
-        return string();
+        Statistics statistics;
+        uint64_t lines, dropped, datagrams, bytes;
+        string result;
+
+        _logOutput.Statistics(lines, dropped, datagrams, bytes);
+
+        statistics.Lines = lines;
+        statistics.Dropped = dropped;
+        statistics.Datagrams = datagrams;
+        statistics.Bytes = bytes;
+        statistics.ToString(result);
+
+        return (result);
     }
 } // namespace Plugin
 } // namespace WPEFramework
@@ -24,6 +24,10 @@
 #include <fstream>
 #include "../FileTransfer/Module.h"
 
+#ifdef FILETRANSFER_LZ4
+#include <lz4.h>
+#endif
+
 namespace WPEFramework {
 namespace Core {
     class FileSystemMonitor : public Core::IResource {
@@ -342,28 +346,205 @@ namespace Plugin
             string _path;
         };
 
+    // Preallocated ring of text lines, every line is stored as its length (16 bits) followed by its characters.
+    // Lines are taken out in the order they came in. Not thread safe, the owner serializes.
+    class LineRing {
+        public:
+            LineRing() = delete;
+            LineRing(const LineRing &) = delete;
+            LineRing &operator=(const LineRing &) = delete;
+
+            LineRing(const uint32_t size)
+                : _buffer(size)
+                , _head(0)
+                , _tail(0)
+                , _used(0)
+                , _count(0)
+            {
+            }
+            ~LineRing()
+            {
+            }
+
+        public:
+            inline bool IsEmpty() const
+            {
+                return (_count == 0);
+            }
+            inline uint32_t Count() const
+            {
+                return (_count);
+            }
+            // Position of the oldest line.
+            inline uint32_t Head() const
+            {
+                return (_head);
+            }
+            // Drops all lines and (re)allocates the storage.
+            void Reset(const uint32_t size)
+            {
+                _buffer.assign(size, 0);
+                _head = 0;
+                _tail = 0;
+                _used = 0;
+                _count = 0;
+            }
+            // False if there is no room, the line is not taken.
+            bool Push(const uint8_t data[], const uint16_t length)
+            {
+                bool result = ((_used + sizeof(length) + length) <= _buffer.size());
+
+                if (result == true) {
+                    Write(reinterpret_cast<const uint8_t *>(&length), sizeof(length));
+                    Write(data, length);
+                    _count++;
+                }
+
+                return (result);
+            }
+            uint16_t Length(const uint32_t position) const
+            {
+                ASSERT(IsEmpty() == false);
+
+                uint16_t length;
+                Read(position, reinterpret_cast<uint8_t *>(&length), sizeof(length));
+                return (length);
+            }
+            uint32_t Next(const uint32_t position) const
+            {
+                return (Advance(position, sizeof(uint16_t) + Length(position)));
+            }
+            void Copy(const uint32_t position, const uint16_t offset, uint8_t buffer[], const uint16_t length) const
+            {
+                Read(Advance(position, sizeof(uint16_t) + offset), buffer, length);
+            }
+            // Takes out the oldest lines.
+            void Pop(uint32_t count)
+            {
+                ASSERT(count <= _count);
+
+                while (count-- != 0) {
+                    const uint32_t size = sizeof(uint16_t) + Length(_head);
+
+                    _head = Advance(_head, size);
+                    _used -= size;
+                    _count--;
+                }
+            }
+
+        private:
+            inline uint32_t Advance(const uint32_t position, const uint32_t delta) const
+            {
+                const uint32_t result = position + delta;
+                return (result >= _buffer.size() ? result - _buffer.size() : result);
+            }
+            void Write(const uint8_t data[], const uint32_t length)
+            {
+                const uint32_t first = std::min(length, static_cast<uint32_t>(_buffer.size() - _tail));
+
+                ::memcpy(&(_buffer[_tail]), data, first);
+                ::memcpy(&(_buffer[0]), &(data[first]), length - first);
+
+                _tail = Advance(_tail, length);
+                _used += length;
+            }
+            void Read(const uint32_t position, uint8_t data[], const uint32_t length) const
+            {
+                const uint32_t first = std::min(length, static_cast<uint32_t>(_buffer.size() - position));
+
+                ::memcpy(data, &(_buffer[position]), first);
+                ::memcpy(&(data[first]), &(_buffer[0]), length - first);
+            }
+
+        private:
+            std::vector<uint8_t> _buffer;
+            uint32_t _head;
+            uint32_t _tail;
+            uint32_t _used;
+            uint32_t _count;
+    };
+
     class FileTransfer : public PluginHost::IPlugin {
         private:
 
             static constexpr uint16_t MAX_BUFFER_LENGHT = 1024;
+            // Largest UDP payload that fits an ethernet frame without fragmentation.
+            static constexpr uint16_t MAX_DATAGRAM_LENGTH = 1472;
             static constexpr uint16_t TIMEOUT_MS = 0;
 
+            // Lines read from the file are queued in a preallocated ring, a line that does not fit anymore is
+            // dropped (and counted), the file is never waited for. By default every line goes out in a datagram
+            // of its own. In batch mode as many whole lines as fit are packed in a datagram, optionally LZ4
+            // compressed. A compressed datagram starts with the size of the text (16 bits, big endian) followed
+            // by the LZ4 block, a size of 0 means the text that follows is not compressed.
+            // The rate (in bytes per second) is kept by a token bucket, the socket is triggered again when
+            // there are enough tokens to go on.
             class TextChannel : public Core::SocketDatagram
             {
+                private:
+                    static constexpr uint8_t FRAME_HEADER = 2;
+                    // The text compressed in one datagram is at most this many datagrams in size.
+                    static constexpr uint8_t COMPRESSION_WINDOW = 4;
+
                 public:
+                    TextChannel(const TextChannel &) = delete;
+                    TextChannel &operator=(const TextChannel &) = delete;
+
                     TextChannel()
-                        : Core::SocketDatagram(false, Core::NodeId().Origin(), Core::NodeId(), MAX_BUFFER_LENGHT, 0)
-                        , _sendQueue()
+                        : Core::SocketDatagram(false, Core::NodeId().Origin(), Core::NodeId(), MAX_DATAGRAM_LENGTH, 0)
+                        , _adminLock()
+                        , _queue(0)
                         , _offset(0)
+                        , _terminator()
+                        , _job(*this)
+                        , _batch(false)
+                        , _compress(false)
+                        , _datagram(MAX_BUFFER_LENGHT)
+                        , _rate(0)
+                        , _credit(0)
+                        , _refilled(0)
+                        , _frame()
+                        , _ends()
+                        , _lines(0)
+                        , _dropped(0)
+                        , _datagrams(0)
+                        , _bytes(0)
                     {
                     }
                     virtual ~TextChannel()
                     {
-                        _sendQueue.clear();
-                        _offset = 0;
+                        _job.Revoke();
                         Close(Core::infinite);
                     }
 
+                    void Configure(const bool batch, const uint16_t datagram, const bool compress, const uint32_t rate, const uint32_t queue)
+                    {
+                        _adminLock.Lock();
+
+                        _batch = batch;
+                        _datagram = std::max(static_cast<uint16_t>(FRAME_HEADER + _terminator.SizeOf() + 1), std::min(datagram, static_cast<uint16_t>(MAX_DATAGRAM_LENGTH)));
+                        _rate = rate;
+                        _credit = static_cast<int64_t>(Burst()) * 1000000;
+                        _refilled = Core::Time::Now().Ticks();
+                        _queue.Reset(queue);
+                        _offset = 0;
+
+#ifdef FILETRANSFER_LZ4
+                        _compress = ((batch == true) && (compress == true));
+#else
+                        if (compress == true) {
+                            SYSLOG(Logging::Notification, (_T("FileTransfer is built without LZ4, lines are sent uncompressed")));
+                        }
+                        _compress = false;
+#endif
+
+                        if (_compress == true) {
+                            _frame.assign(_datagram * COMPRESSION_WINDOW, 0);
+                            _ends.reserve(_frame.size() / (_terminator.SizeOf() + 1));
+                        }
+
+                        _adminLock.Unlock();
+                    }
                     void SetDestination(const string& binding, const uint16_t &port)
                     {
                         Core::NodeId logNode(binding.c_str(), port);
@@ -375,10 +556,23 @@ namespace Plugin
 
                     void NewLine(const string& text)
                     {
+                        uint16_t length = static_cast<uint16_t>(std::min(text.size() * sizeof(TCHAR), static_cast<size_t>(0xFFFF)));
+
                         _adminLock.Lock();
 
-                        _sendQueue.emplace_back(text);
-                        bool trigger = (_sendQueue.size() == 1);
+                        if (_batch == true) {
+                            // A line always fits a datagram of its own, the rest of it is cut off.
+                            length = std::min(length, static_cast<uint16_t>(_datagram - (_terminator.SizeOf() * sizeof(TCHAR)) - (_compress == true ? FRAME_HEADER : 0)));
+                        }
+
+                        bool trigger = _queue.IsEmpty();
+
+                        if (_queue.Push(reinterpret_cast<const uint8_t *>(text.c_str()), length) == true) {
+                            _lines++;
+                        } else {
+                            _dropped++;
+                            trigger = false;
+                        }
 
                         _adminLock.Unlock();
 
@@ -387,47 +581,51 @@ namespace Plugin
                             Trigger();
                         }
                     }
-                private:
-                    // Methods to extract and insert data into the socket buffers
-                    uint16_t SendData(uint8_t *dataFrame, const uint16_t maxSendSize) override
-                    {
-                        uint16_t result = 0;
 
+                    void Statistics(uint64_t &lines, uint64_t &dropped, uint64_t &datagrams, uint64_t &bytes) const
+                    {
                         _adminLock.Lock();
 
-                        if (_offset == static_cast<uint32_t>(~0)) {
-                            // We are done with this entry it has been sent!!! discard it.
-                            _sendQueue.pop_front();
-                            _offset = 0;
-                        }
-
-                        if (_sendQueue.size() > 0) {
-                            const string& sendObject = _sendQueue.front();
+                        lines = _lines;
+                        dropped = _dropped;
+                        datagrams = _datagrams;
+                        bytes = _bytes;
 
-                            // Do we still need to send data from the text..
-                            if (_offset < (sendObject.size() * sizeof(TCHAR))) {
-                                result = (((sendObject.size() * sizeof(TCHAR)) - _offset) > maxSendSize ? maxSendSize : ((sendObject.size() * sizeof(TCHAR)) - _offset));
+                        _adminLock.Unlock();
+                    }
 
-                                _offset += SendCharacters(dataFrame, &(sendObject.c_str()[(_offset / sizeof(TCHAR))]), (_offset % sizeof(TCHAR)), result);
-                            }
+                    // Fires when the rate allows to send again.
+                    void Dispatch()
+                    {
+                        Trigger();
+                    }
 
-                            // See if we can write the closing marker
-                            if ((maxSendSize != result) && (_offset >= (sendObject.size() * sizeof(TCHAR))) && (_offset < ((sendObject.size() + (_terminator.SizeOf())) * sizeof(TCHAR)))) {
-                                uint8_t markerSize = (static_cast<uint8_t>(_terminator.SizeOf()) * sizeof(TCHAR));
-                                uint8_t markerOffset = ((sendObject.size() * sizeof(TCHAR)) - _offset);
-                                uint16_t size = ((markerSize - markerOffset) > (maxSendSize - result) ? (maxSendSize - result) : (markerSize - markerOffset));
+                private:
+                    // Methods to extract and insert data into the socket buffers
+                    uint16_t SendData(uint8_t *dataFrame, const uint16_t maxSendSize) override
+                    {
+                        uint16_t result = 0;
 
-                                _offset += SendCharacters(&(dataFrame[result]), &(_terminator.Marker()[(markerOffset / sizeof(TCHAR))]), (markerOffset % sizeof(TCHAR)), size);
-                                result += size;
+                        _adminLock.Lock();
 
-                                if ((size + markerOffset) == markerSize) {
-                                    // Report as completed on the next run
-                                    _offset = static_cast<uint32_t>(~0);
-                                }
+                        if ((_queue.IsEmpty() == false) && (Refill() == true)) {
+                            if (_batch == false) {
+                                result = SendLine(dataFrame, std::min(maxSendSize, static_cast<uint16_t>(MAX_BUFFER_LENGHT)));
+                            } else {
+                                const uint16_t size = std::min(maxSendSize, _datagram);
+#ifdef FILETRANSFER_LZ4
+                                result = (_compress == true ? SendCompressed(dataFrame, size) : SendBatch(dataFrame, size));
+#else
+                                result = SendBatch(dataFrame, size);
+#endif
                             }
 
                             // If we went through this entry we must have processed something....
                             ASSERT(result != 0);
+
+                            _credit -= static_cast<int64_t>(result) * 1000000;
+                            _datagrams++;
+                            _bytes += result;
                         }
 
                         _adminLock.Unlock();
@@ -444,19 +642,177 @@ namespace Plugin
                     {
                     }
 
-                    uint16_t SendCharacters(uint8_t *dataFrame, const TCHAR stream[], const uint8_t delta, const uint16_t total)
+                    inline uint32_t Burst() const
+                    {
+                        // A tenth of a second worth of data, at least a full datagram.
+                        return (std::max(_rate / 10, static_cast<uint32_t>(MAX_DATAGRAM_LENGTH)));
+                    }
+                    // Tops up the tokens (in millionths of a byte) for the time that passed. If there are none
+                    // left the socket is triggered again once there are.
+                    bool Refill()
+                    {
+                        bool result = true;
+
+                        if (_rate != 0) {
+                            const uint64_t now = Core::Time::Now().Ticks();
+                            const uint64_t elapsed = std::min(now - _refilled, static_cast<uint64_t>(1000000));
+
+                            _credit = std::min(_credit + static_cast<int64_t>(elapsed * _rate), static_cast<int64_t>(Burst()) * 1000000);
+                            _refilled = now;
+
+                            if (_credit <= 0) {
+                                const uint32_t wait = static_cast<uint32_t>(((-_credit) / _rate) / 1000) + 1;
+
+                                _job.Schedule(Core::Time::Now().Add(wait));
+                                result = false;
+                            }
+                        }
+
+                        return (result);
+                    }
+                    // One line per datagram, a line that is larger than a datagram continues in the next one.
+                    uint16_t SendLine(uint8_t dataFrame[], const uint16_t maxSendSize)
+                    {
+                        const uint16_t length = _queue.Length(_queue.Head());
+                        const uint16_t markerSize = (static_cast<uint16_t>(_terminator.SizeOf()) * sizeof(TCHAR));
+                        uint16_t result = 0;
+
+                        // Do we still need to send data from the text..
+                        if (_offset < length) {
+                            result = std::min(static_cast<uint16_t>(length - _offset), maxSendSize);
+                            _queue.Copy(_queue.Head(), static_cast<uint16_t>(_offset), dataFrame, result);
+                            _offset += result;
+                        }
+
+                        // See if we can write (the rest of) the closing marker
+                        const uint16_t markerOffset = static_cast<uint16_t>(_offset - length);
+                        const uint16_t size = std::min(static_cast<uint16_t>(markerSize - markerOffset), static_cast<uint16_t>(maxSendSize - result));
+
+                        ::memcpy(&(dataFrame[result]), &(reinterpret_cast<const uint8_t *>(_terminator.Marker())[markerOffset]), size);
+                        _offset += size;
+                        result += size;
+
+                        if (_offset == static_cast<uint32_t>(length + markerSize)) {
+                            // We are done with this entry it has been sent!!! discard it.
+                            _queue.Pop(1);
+                            _offset = 0;
+                        }
+
+                        return (result);
+                    }
+                    // Whole lines, as many as fit.
+                    uint16_t SendBatch(uint8_t dataFrame[], const uint16_t maxSendSize)
+                    {
+                        const uint16_t markerSize = (static_cast<uint16_t>(_terminator.SizeOf()) * sizeof(TCHAR));
+                        uint16_t result = 0;
+                        uint32_t count = 0;
+                        uint32_t position = _queue.Head();
+
+                        while (count < _queue.Count()) {
+                            const uint16_t length = _queue.Length(position);
+
+                            if ((result + length + markerSize) > maxSendSize) {
+                                break;
+                            }
+
+                            _queue.Copy(position, 0, &(dataFrame[result]), length);
+                            ::memcpy(&(dataFrame[result + length]), _terminator.Marker(), markerSize);
+                            result += (length + markerSize);
+
+                            position = _queue.Next(position);
+                            count++;
+                        }
+
+                        if (count != 0) {
+                            _queue.Pop(count);
+                        } else {
+                            // Only when the datagram size was lowered below what is queued.
+                            result = SendLine(dataFrame, maxSendSize);
+                        }
+
+                        return (result);
+                    }
+#ifdef FILETRANSFER_LZ4
+                    // Whole lines, as many as fit once compressed. The text of a few datagrams is compressed, and
+                    // halved until it fits. If even a single line does not get any smaller, it goes as is.
+                    uint16_t SendCompressed(uint8_t dataFrame[], const uint16_t maxSendSize)
                     {
-                        ASSERT(delta == 0);
-                        // Copying from an aligned position..
-                        ::memcpy(dataFrame, stream, total);
-                        return (total);
+                        const uint16_t markerSize = (static_cast<uint16_t>(_terminator.SizeOf()) * sizeof(TCHAR));
+                        const int capacity = static_cast<int>(maxSendSize - FRAME_HEADER);
+                        uint16_t result = 0;
+                        uint32_t count = 0;
+                        uint32_t position = _queue.Head();
+                        uint32_t size = 0;
+
+                        _ends.clear();
+
+                        while (count < _queue.Count()) {
+                            const uint16_t length = _queue.Length(position);
+
+                            if ((size + length + markerSize) > _frame.size()) {
+                                break;
+                            }
+
+                            _queue.Copy(position, 0, &(_frame[size]), length);
+                            ::memcpy(&(_frame[size + length]), _terminator.Marker(), markerSize);
+                            size += (length + markerSize);
+                            _ends.push_back(static_cast<uint16_t>(size));
+
+                            position = _queue.Next(position);
+                            count++;
+                        }
+
+                        ASSERT(count != 0);
+
+                        while ((count != 0) && (result == 0)) {
+                            const uint16_t text = _ends[count - 1];
+                            const int compressed = LZ4_compress_default(reinterpret_cast<const char *>(_frame.data()), reinterpret_cast<char *>(&(dataFrame[FRAME_HEADER])), text, std::min(capacity, static_cast<int>(text) - 1));
+
+                            if (compressed > 0) {
+                                dataFrame[0] = static_cast<uint8_t>(text >> 8);
+                                dataFrame[1] = static_cast<uint8_t>(text & 0xFF);
+                                result = static_cast<uint16_t>(FRAME_HEADER + compressed);
+                            } else if (count == 1) {
+                                break;
+                            } else {
+                                count /= 2;
+                            }
+                        }
+
+                        if (result == 0) {
+                            // A line is cut on the way in so it always fits.
+                            ASSERT((count == 1) && (_ends[0] <= capacity));
+
+                            dataFrame[0] = 0;
+                            dataFrame[1] = 0;
+                            ::memcpy(&(dataFrame[FRAME_HEADER]), _frame.data(), _ends[0]);
+                            result = (FRAME_HEADER + _ends[0]);
+                        }
+
+                        _queue.Pop(count);
+
+                        return (result);
                     }
+#endif
 
                 private:
-                    Core::CriticalSection _adminLock;
-                    std::list<string> _sendQueue;
+                    mutable Core::CriticalSection _adminLock;
+                    LineRing _queue;
                     uint32_t _offset;
                     Core::TerminatorCarriageReturn _terminator;
+                    Core::WorkerPool::JobType<TextChannel&> _job;
+                    bool _batch;
+                    bool _compress;
+                    uint16_t _datagram;
+                    uint32_t _rate;
+                    int64_t _credit;
+                    uint64_t _refilled;
+                    std::vector<uint8_t> _frame;
+                    std::vector<uint16_t> _ends;
+                    uint64_t _lines;
+                    uint64_t _dropped;
+                    uint64_t _datagrams;
+                    uint64_t _bytes;
             };
 
             class OnChangeFile: public FileObserver::ICallback
@@ -526,10 +882,16 @@ namespace Plugin
                 public:
                     Config()
                         : FilePath(_T("/var/log/messages")), FullFile(false), Destination()
+                        , Batch(false), Datagram(MAX_DATAGRAM_LENGTH), Compress(false), Rate(0), Queue(64 * 1024)
                     {
                         Add(_T("filepath"), &FilePath);
                         Add(_T("fullfile"), &FullFile);
                         Add(_T("destination"), &Destination);
+                        Add(_T("batch"), &Batch);
+                        Add(_T("datagram"), &Datagram);
+                        Add(_T("compress"), &Compress);
+                        Add(_T("rate"), &Rate);
+                        Add(_T("queue"), &Queue);
                     }
                     ~Config() override {}
 
@@ -537,6 +899,34 @@ namespace Plugin
                     Core::JSON::String FilePath;
                     Core::JSON::Boolean FullFile;
                     NetworkNode Destination;
+                    Core::JSON::Boolean Batch; // pack lines up to the datagram size
+                    Core::JSON::DecUInt16 Datagram; // bytes, batch mode only
+                    Core::JSON::Boolean Compress; // LZ4, batch mode only
+                    Core::JSON::DecUInt32 Rate; // bytes per second, 0 is unlimited
+                    Core::JSON::DecUInt32 Queue; // bytes of lines waiting to be sent
+            };
+
+            class Statistics : public Core::JSON::Container {
+                private:
+                    Statistics(const Statistics &) = delete;
+                    Statistics &operator=(const Statistics &) = delete;
+
+                public:
+                    Statistics()
+                        : Lines(0), Dropped(0), Datagrams(0), Bytes(0)
+                    {
+                        Add(_T("lines"), &Lines);
+                        Add(_T("dropped"), &Dropped);
+                        Add(_T("datagrams"), &Datagrams);
+                        Add(_T("bytes"), &Bytes);
+                    }
+                    ~Statistics() override {}
+
+                public:
+                    Core::JSON::DecUInt64 Lines;
+                    Core::JSON::DecUInt64 Dropped;
+                    Core::JSON::DecUInt64 Datagrams;
+                    Core::JSON::DecUInt64 Bytes;
             };
 
             public:
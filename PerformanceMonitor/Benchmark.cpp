@@ -0,0 +1,590 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Benchmark.h"
+
+#include <interfaces/json/JsonData_PerformanceMonitor.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace WPEFramework {
+
+ENUM_CONVERSION_BEGIN(Plugin::Benchmark::distribution)
+
+    { Plugin::Benchmark::distribution::FIXED, _TXT("fixed") },
+    { Plugin::Benchmark::distribution::UNIFORM, _TXT("uniform") },
+    { Plugin::Benchmark::distribution::LOGARITHMIC, _TXT("logarithmic") },
+
+    ENUM_CONVERSION_END(Plugin::Benchmark::distribution);
+
+ENUM_CONVERSION_BEGIN(Plugin::Benchmark::transport)
+
+    { Plugin::Benchmark::transport::JSONRPC, _TXT("jsonrpc") },
+    { Plugin::Benchmark::transport::COMRPC, _TXT("comrpc") },
+    { Plugin::Benchmark::transport::SHAREDMEMORY, _TXT("sharedmemory") },
+
+    ENUM_CONVERSION_END(Plugin::Benchmark::transport);
+
+ENUM_CONVERSION_BEGIN(Plugin::Benchmark::state)
+
+    { Plugin::Benchmark::state::IDLE, _TXT("idle") },
+    { Plugin::Benchmark::state::RUNNING, _TXT("running") },
+    { Plugin::Benchmark::state::COMPLETED, _TXT("completed") },
+
+    ENUM_CONVERSION_END(Plugin::Benchmark::state);
+
+namespace Plugin {
+
+    // Samples kept per stage, shared by all threads of a run. Beyond this, reservoir sampling keeps a uniform
+    // selection of all samples, so long runs do not grow without bound and the percentiles stay representative.
+    static constexpr uint32_t MaxSamples = 256 * 1024;
+
+    /* virtual */ uint32_t Benchmark::Generator::Worker()
+    {
+        Reservoir reservoir;
+        uint64_t errors = 0;
+        uint64_t bytes = 0;
+
+        reservoir.Seen = 0;
+
+        for (uint8_t index = 0; index < STAGES; index++) {
+            reservoir.Minimum[index] = ~0ULL;
+            reservoir.Maximum[index] = 0;
+            reservoir.Sum[index] = 0;
+            reservoir.Values[index].reserve(4096);
+        }
+
+        while ((IsRunning() == true) && (_parent.Call(*this, reservoir, errors, bytes) == true)) {
+        }
+
+        _parent.Completed(reservoir, errors, bytes);
+
+        Block();
+
+        return (Core::infinite);
+    }
+
+    Benchmark::Benchmark(Histograms& histograms)
+        : _runLock()
+        , _adminLock()
+        , _histograms(histograms)
+        , _target(nullptr)
+        , _loopback(nullptr)
+        , _shared(nullptr)
+        , _generators()
+        , _state(IDLE)
+        , _transport(JSONRPC)
+        , _callsign()
+        , _method()
+        , _parameters()
+        , _exportFile()
+        , _concurrency(0)
+        , _capacity(0)
+        , _minSize(0)
+        , _maxSize(0)
+        , _distribution(FIXED)
+        , _deadline(0)
+        , _limit(0)
+        , _issued(0)
+        , _completed(0)
+        , _stopped(false)
+        , _started(0)
+        , _finished(0)
+        , _running(0)
+        , _errors(0)
+        , _bytes(0)
+        , _reservoirs()
+    {
+        for (uint8_t index = 0; index < STAGES; index++) {
+            _minimum[index] = 0;
+            _maximum[index] = 0;
+            _sum[index] = 0;
+        }
+    }
+
+    Benchmark::~Benchmark()
+    {
+        Stop();
+
+        for (Generator* generator : _generators) {
+            delete generator;
+        }
+
+        Release();
+    }
+
+    uint32_t Benchmark::Start(PluginHost::IDispatcher* target, const string& callsign, const Settings& settings, const string& exportFile)
+    {
+        ASSERT(target != nullptr);
+
+        uint32_t result = Core::ERROR_INPROGRESS;
+
+        _runLock.Lock();
+        _adminLock.Lock();
+
+        if (_state != RUNNING) {
+            _target = target;
+            _target->AddRef();
+            _callsign = callsign;
+            _method = settings.Method.Value();
+            _parameters = settings.Parameters.Value();
+
+            result = Launch(JSONRPC, settings, exportFile);
+        }
+
+        _adminLock.Unlock();
+        _runLock.Unlock();
+
+        return (result);
+    }
+
+    uint32_t Benchmark::Start(IPerformanceLoopback* loopback, const transport kind, const string& sharedFile, const Settings& settings, const string& exportFile)
+    {
+        ASSERT(loopback != nullptr);
+        ASSERT(kind != JSONRPC);
+
+        uint32_t result = Core::ERROR_INPROGRESS;
+
+        _runLock.Lock();
+        _adminLock.Lock();
+
+        if (_state != RUNNING) {
+            const uint32_t size = std::max(settings.Concurrency.Value(), static_cast<uint8_t>(1)) * static_cast<uint32_t>(std::max(settings.MaxSize.Value(), settings.MinSize.Value()));
+
+            result = Core::ERROR_NONE;
+
+            if (kind == SHAREDMEMORY) {
+                // One slot of maxsize per generator, the other side maps the same file.
+                _shared = new Core::DataElementFile(sharedFile, Core::File::SHAREABLE | Core::File::CREATE | Core::File::USER_READ | Core::File::USER_WRITE, size);
+
+                if ((_shared->IsValid() == false) || (_shared->Size() < size) || (loopback->Attach(sharedFile, size) != Core::ERROR_NONE)) {
+                    delete _shared;
+                    _shared = nullptr;
+                    result = Core::ERROR_OPENING_FAILED;
+                }
+            }
+
+            if (result == Core::ERROR_NONE) {
+                _loopback = loopback;
+                _loopback->AddRef();
+                _callsign.clear();
+                _method.clear();
+                _parameters.clear();
+
+                result = Launch(kind, settings, exportFile);
+            }
+        }
+
+        _adminLock.Unlock();
+        _runLock.Unlock();
+
+        return (result);
+    }
+
+    uint32_t Benchmark::Launch(const transport kind, const Settings& settings, const string& exportFile)
+    {
+        // The generators of the previous run are done, they are blocked.
+        for (Generator* generator : _generators) {
+            delete generator;
+        }
+        _generators.clear();
+
+        for (uint8_t index = 0; index < STAGES; index++) {
+            _minimum[index] = ~0ULL;
+            _maximum[index] = 0;
+            _sum[index] = 0;
+            _samples[index].clear();
+        }
+        _reservoirs.clear();
+
+        _state = RUNNING;
+        _transport = kind;
+        _exportFile = exportFile;
+        _concurrency = std::max(settings.Concurrency.Value(), static_cast<uint8_t>(1));
+        _capacity = MaxSamples / _concurrency;
+        _minSize = std::max(settings.MinSize.Value(), static_cast<uint16_t>(1));
+        _maxSize = std::max(settings.MaxSize.Value(), _minSize);
+        _distribution = settings.Distribution.Value();
+        _limit = settings.Requests.Value();
+        _issued = 0;
+        _completed = 0;
+        _stopped = false;
+        _started = Now();
+        _deadline = (settings.Duration.Value() != 0 ? _started + (static_cast<uint64_t>(settings.Duration.Value()) * 1000000000ULL) : 0);
+        _finished = 0;
+        _running = _concurrency;
+        _errors = 0;
+        _bytes = 0;
+
+        for (uint8_t index = 0; index < _concurrency; index++) {
+            _generators.push_back(new Generator(*this, static_cast<uint32_t>(_started) + index, index, _maxSize));
+        }
+        for (Generator* generator : _generators) {
+            generator->Run();
+        }
+
+        return (Core::ERROR_NONE);
+    }
+
+    void Benchmark::Stop()
+    {
+        // No new run can delete the generators while we wait for them.
+        _runLock.Lock();
+
+        _stopped = true;
+
+        _adminLock.Lock();
+        std::list<Generator*> generators(_generators);
+        _adminLock.Unlock();
+
+        // Wait outside of the adminLock, the generators need it to hand in their samples.
+        for (Generator* generator : generators) {
+            generator->Wait(Core::Thread::BLOCKED | Core::Thread::STOPPED, Core::infinite);
+        }
+
+        _runLock.Unlock();
+    }
+
+    void Benchmark::Snapshot(Report& report) const
+    {
+        _adminLock.Lock();
+
+        report.State = _state;
+
+        if (_state != IDLE) {
+            const uint64_t elapsed = (_state == RUNNING ? Now() : _finished) - _started;
+
+            report.Transport = _transport;
+            if (_transport == JSONRPC) {
+                report.Callsign = _callsign;
+                report.Method = _method;
+            }
+            report.Concurrency = _concurrency;
+            report.Requests = _completed.load();
+            report.Duration = elapsed / 1000000;
+            report.Throughput = (elapsed != 0 ? (_completed.load() * 1000000000ULL) / elapsed : 0);
+
+            if (_state == COMPLETED) {
+                report.Errors = _errors;
+                report.Bytes = _bytes;
+                report.Bandwidth = (elapsed != 0 ? (_bytes * 1000000000ULL) / elapsed : 0);
+                Fill(report.Serialization, SERIALIZATION);
+                Fill(report.Execution, EXECUTION);
+                Fill(report.Deserialization, DESERIALIZATION);
+                Fill(report.Total, TOTAL);
+            }
+        }
+
+        _adminLock.Unlock();
+    }
+
+    bool Benchmark::Call(Generator& generator, Reservoir& reservoir, uint64_t& errors, uint64_t& bytes)
+    {
+        if ((_stopped == true) || ((_limit != 0) && (_issued.fetch_add(1) >= _limit)) || ((_deadline != 0) && (Now() >= _deadline))) {
+            return (false);
+        }
+
+        // Start, serialized, executed and end of the call.
+        uint64_t moments[4];
+        uint32_t size = 0;
+
+        if ((_transport == JSONRPC ? InvokeJSONRPC(generator, size, moments) : InvokeLoopback(generator, size, moments)) == false) {
+            errors++;
+        }
+
+        bytes += size;
+
+        _completed.fetch_add(1);
+
+        // The reservoir only holds the calls of this thread, so it is sampled from what this thread did.
+        const uint64_t count = ++reservoir.Seen;
+        const uint64_t values[STAGES] = { moments[1] - moments[0], moments[2] - moments[1], moments[3] - moments[2], moments[3] - moments[0] };
+
+        // The histograms tell about the JSON-RPC path, the other transports are only there to compare against.
+        if (_transport == JSONRPC) {
+            _histograms.Record(Histograms::SERIALIZATION, size, values[SERIALIZATION], moments[3]);
+            _histograms.Record(Histograms::EXECUTION, size, values[EXECUTION], moments[3]);
+            _histograms.Record(Histograms::DESERIALIZATION, size, values[DESERIALIZATION], moments[3]);
+            _histograms.Record(Histograms::TOTAL, size, values[TOTAL], moments[3]);
+        }
+
+        for (uint8_t index = 0; index < STAGES; index++) {
+            reservoir.Minimum[index] = std::min(reservoir.Minimum[index], values[index]);
+            reservoir.Maximum[index] = std::max(reservoir.Maximum[index], values[index]);
+            reservoir.Sum[index] += values[index];
+        }
+
+        if (reservoir.Values[TOTAL].size() < _capacity) {
+            for (uint8_t index = 0; index < STAGES; index++) {
+                reservoir.Values[index].push_back(values[index]);
+            }
+        } else {
+            const uint64_t slot = std::uniform_int_distribution<uint64_t>(0, count - 1)(generator.Random());
+
+            if (slot < _capacity) {
+                for (uint8_t index = 0; index < STAGES; index++) {
+                    reservoir.Values[index][slot] = values[index];
+                }
+            }
+        }
+
+        return (true);
+    }
+
+    bool Benchmark::InvokeJSONRPC(Generator& generator, uint32_t& size, uint64_t (&moments)[4])
+    {
+        uint8_t* buffer = generator.Buffer();
+
+        size = static_cast<uint32_t>(_parameters.length());
+
+        // Making up the payload is not part of the call, only turning it into a request is.
+        if (_parameters.empty() == true) {
+            size = Size(generator.Random());
+
+            for (uint16_t index = 0; index < size; index++) {
+                buffer[index] = static_cast<uint8_t>(generator.Random()());
+            }
+        }
+
+        moments[0] = Now();
+
+        Core::JSONRPC::Message message;
+        message.JSONRPC = Core::JSONRPC::Message::DefaultVersion;
+        message.Id = static_cast<uint32_t>(_completed.load());
+        message.Designator = _callsign + _T(".1.") + _method;
+
+        if (_parameters.empty() == false) {
+            message.Parameters = _parameters;
+        } else {
+            JsonData::PerformanceMonitor::BufferInfo data;
+            string encoded;
+            string parameters;
+
+            Core::ToString(buffer, static_cast<uint16_t>(size), false, encoded);
+            data.Data = encoded;
+            data.Length = static_cast<uint16_t>(size);
+            data.ToString(parameters);
+            message.Parameters = parameters;
+        }
+
+        moments[1] = Now();
+
+        Core::ProxyType<Core::JSONRPC::Message> response(_target->Invoke(string(), 0, message));
+
+        moments[2] = Now();
+
+        const bool result = (response.IsValid() == true) && (response->Error.IsSet() == false);
+
+        if ((result == true) && (response->Result.IsSet() == true)) {
+            Core::JSON::Variant value;
+            value.FromString(response->Result.Value());
+        }
+
+        moments[3] = Now();
+
+        return (result);
+    }
+
+    bool Benchmark::InvokeLoopback(Generator& generator, uint32_t& size, uint64_t (&moments)[4])
+    {
+        const uint32_t offset = generator.Index() * _maxSize;
+        uint8_t* buffer = generator.Buffer();
+        const uint8_t seed = static_cast<uint8_t>(generator.Random()());
+        uint32_t expected = 2166136261u;
+        uint32_t checksum = 0;
+
+        size = Size(generator.Random());
+
+        // Making up the payload is not part of the call. For COM-RPC the call itself marshals the buffer, for
+        // shared memory placing it in the shared buffer is.
+        for (uint16_t index = 0; index < size; index++) {
+            buffer[index] = static_cast<uint8_t>(seed + index);
+            expected = (expected ^ buffer[index]) * 16777619u;
+        }
+
+        moments[0] = Now();
+
+        if (_transport == SHAREDMEMORY) {
+            buffer = &(_shared->Buffer()[offset]);
+            ::memcpy(buffer, generator.Buffer(), size);
+        }
+
+        moments[1] = Now();
+
+        uint32_t result = (_transport == SHAREDMEMORY ? _loopback->Touch(offset, static_cast<uint16_t>(size), checksum) : _loopback->Exchange(static_cast<uint16_t>(size), buffer, checksum));
+
+        moments[2] = Now();
+
+        // The data should have made it to the other side, and back, with every byte inverted.
+        bool valid = (result == Core::ERROR_NONE) && (checksum == expected);
+
+        for (uint16_t index = 0; (valid == true) && (index < size); index++) {
+            valid = (buffer[index] == static_cast<uint8_t>(~(seed + index)));
+        }
+
+        moments[3] = Now();
+
+        return (valid);
+    }
+
+    void Benchmark::Completed(Reservoir& reservoir, const uint64_t errors, const uint64_t bytes)
+    {
+        _adminLock.Lock();
+
+        _reservoirs.emplace_back();
+        _reservoirs.back().Seen = reservoir.Seen;
+
+        for (uint8_t index = 0; index < STAGES; index++) {
+            _minimum[index] = std::min(_minimum[index], reservoir.Minimum[index]);
+            _maximum[index] = std::max(_maximum[index], reservoir.Maximum[index]);
+            _sum[index] += reservoir.Sum[index];
+            _reservoirs.back().Values[index].swap(reservoir.Values[index]);
+        }
+
+        _errors += errors;
+        _bytes += bytes;
+
+        ASSERT(_running > 0);
+
+        if (--_running == 0) {
+            _finished = Now();
+            _state = COMPLETED;
+
+            Merge();
+
+            Release();
+
+            TRACE(Trace::Information, (_T("Benchmark of %s.%s completed, %llu calls"), _callsign.c_str(), _method.c_str(), static_cast<unsigned long long>(_completed.load())));
+
+            if (_exportFile.empty() == false) {
+                Report report;
+                Core::File file(_exportFile);
+
+                Snapshot(report);
+
+                if (file.Create() == true) {
+                    report.IElement::ToFile(file);
+                    file.Close();
+                } else {
+                    TRACE(Trace::Error, (_T("Could not write the benchmark report to %s"), _exportFile.c_str()));
+                }
+            }
+        }
+
+        _adminLock.Unlock();
+    }
+
+    // A thread that did more calls than another, kept a smaller part of them. Before the reservoirs are
+    // combined, they are thinned out to the same fraction of the calls, so every call had the same chance to
+    // end up in the percentiles, whatever thread did it.
+    void Benchmark::Merge()
+    {
+        double fraction = 1.0;
+        std::mt19937 random(static_cast<uint32_t>(_started));
+
+        for (const Reservoir& reservoir : _reservoirs) {
+            if (reservoir.Seen != 0) {
+                fraction = std::min(fraction, static_cast<double>(reservoir.Values[TOTAL].size()) / static_cast<double>(reservoir.Seen));
+            }
+        }
+
+        for (Reservoir& reservoir : _reservoirs) {
+            const uint32_t kept = static_cast<uint32_t>(reservoir.Values[TOTAL].size());
+            const uint32_t keep = std::min(kept, static_cast<uint32_t>(std::lround(fraction * static_cast<double>(reservoir.Seen))));
+
+            // Partial shuffle, the first ones are a random selection. All stages of a call stay together.
+            for (uint32_t index = 0; (keep < kept) && (index < keep); index++) {
+                const uint32_t other = std::uniform_int_distribution<uint32_t>(index, kept - 1)(random);
+
+                for (uint8_t stage = 0; stage < STAGES; stage++) {
+                    std::swap(reservoir.Values[stage][index], reservoir.Values[stage][other]);
+                }
+            }
+
+            for (uint8_t stage = 0; stage < STAGES; stage++) {
+                _samples[stage].insert(_samples[stage].end(), reservoir.Values[stage].begin(), reservoir.Values[stage].begin() + keep);
+            }
+        }
+
+        _reservoirs.clear();
+
+        for (uint8_t index = 0; index < STAGES; index++) {
+            std::sort(_samples[index].begin(), _samples[index].end());
+        }
+    }
+
+    void Benchmark::Release()
+    {
+        if (_target != nullptr) {
+            _target->Release();
+            _target = nullptr;
+        }
+        if (_loopback != nullptr) {
+            if (_shared != nullptr) {
+                _loopback->Attach(string(), 0);
+            }
+            _loopback->Release();
+            _loopback = nullptr;
+        }
+        if (_shared != nullptr) {
+            delete _shared;
+            _shared = nullptr;
+        }
+    }
+
+    uint16_t Benchmark::Size(std::mt19937& random) const
+    {
+        uint16_t result = _minSize;
+
+        if (_distribution == UNIFORM) {
+            result = static_cast<uint16_t>(std::uniform_int_distribution<uint32_t>(_minSize, _maxSize)(random));
+        } else if (_distribution == LOGARITHMIC) {
+            // As many small as large payloads per order of magnitude.
+            const double exponent = std::uniform_real_distribution<double>(std::log(static_cast<double>(_minSize)), std::log(static_cast<double>(_maxSize)))(random);
+            result = static_cast<uint16_t>(std::min(std::max(std::lround(std::exp(exponent)), static_cast<long>(_minSize)), static_cast<long>(_maxSize)));
+        }
+
+        return (result);
+    }
+
+    void Benchmark::Fill(Report::Stage& stage, const Benchmark::stage index) const
+    {
+        // The samples are sorted once the run completed.
+        const Samples& samples(_samples[index]);
+        const uint64_t count = samples.size();
+
+        stage.Count = _completed.load();
+
+        if (_completed.load() != 0) {
+            stage.Minimum = _minimum[index];
+            stage.Maximum = _maximum[index];
+            stage.Average = _sum[index] / _completed.load();
+        }
+
+        if (count != 0) {
+            stage.P50 = samples[((count * 500) + 999) / 1000 - 1];
+            stage.P90 = samples[((count * 900) + 999) / 1000 - 1];
+            stage.P99 = samples[((count * 990) + 999) / 1000 - 1];
+            stage.P999 = samples[((count * 999) + 999) / 1000 - 1];
+        }
+    }
+
+} // namespace Plugin
+} // namespace WPEFramework
@@ -0,0 +1,343 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Module.h"
+#include "Histogram.h"
+#include "IPerformanceLoopback.h"
+
+#include <atomic>
+#include <random>
+
+namespace WPEFramework {
+namespace Plugin {
+
+    // Load generator for the JSON-RPC interface of a plugin. A number of threads call a method of the target
+    // plugin through its dispatcher, as fast as they can, for a given time or number of calls. Every call is
+    // timed per stage and once the run is over the percentiles of each stage are reported.
+    // To compare against, the same payloads can be send over COM-RPC to the out of process loopback, or be
+    // placed in shared memory with only the COM-RPC call to signal the other side.
+    class Benchmark {
+    public:
+        enum transport {
+            JSONRPC,
+            COMRPC,
+            SHAREDMEMORY
+        };
+        enum distribution {
+            FIXED,
+            UNIFORM,
+            LOGARITHMIC
+        };
+        enum state {
+            IDLE,
+            RUNNING,
+            COMPLETED
+        };
+        enum stage {
+            SERIALIZATION,
+            EXECUTION,
+            DESERIALIZATION,
+            TOTAL,
+            STAGES
+        };
+
+        class Settings : public Core::JSON::Container {
+        public:
+            Settings(const Settings&) = delete;
+            Settings& operator=(const Settings&) = delete;
+
+            Settings()
+                : Core::JSON::Container()
+                , Transport(JSONRPC)
+                , Callsign()
+                , Method(_T("send"))
+                , Parameters()
+                , Concurrency(1)
+                , Duration(10)
+                , Requests(0)
+                , MinSize(64)
+                , MaxSize(64)
+                , Distribution(FIXED)
+                , Export()
+            {
+                Add(_T("transport"), &Transport);
+                Add(_T("callsign"), &Callsign);
+                Add(_T("method"), &Method);
+                Add(_T("parameters"), &Parameters);
+                Add(_T("concurrency"), &Concurrency);
+                Add(_T("duration"), &Duration);
+                Add(_T("requests"), &Requests);
+                Add(_T("minsize"), &MinSize);
+                Add(_T("maxsize"), &MaxSize);
+                Add(_T("distribution"), &Distribution);
+                Add(_T("export"), &Export);
+            }
+            ~Settings() override
+            {
+            }
+
+        public:
+            Core::JSON::EnumType<transport> Transport;
+            // Plugin and method to call over JSON-RPC, by default the "send" method of this plugin.
+            Core::JSON::String Callsign;
+            Core::JSON::String Method;
+            // Parameters to send as is. If not set, a buffer of a size picked from [minsize, maxsize] is send.
+            Core::JSON::String Parameters;
+            Core::JSON::DecUInt8 Concurrency;
+            // Seconds to run, and/or the number of calls to do, whichever comes first. 0 is no limit.
+            Core::JSON::DecUInt32 Duration;
+            Core::JSON::DecUInt32 Requests;
+            Core::JSON::DecUInt16 MinSize;
+            Core::JSON::DecUInt16 MaxSize;
+            Core::JSON::EnumType<distribution> Distribution;
+            // File, in the volatile path, the report is written to once the run completes.
+            Core::JSON::String Export;
+        };
+
+        class Report : public Core::JSON::Container {
+        public:
+            class Stage : public Core::JSON::Container {
+            public:
+                Stage& operator=(const Stage&) = delete;
+
+                Stage()
+                    : Core::JSON::Container()
+                {
+                    Init();
+                }
+                Stage(const Stage& copy)
+                    : Core::JSON::Container()
+                    , Count(copy.Count)
+                    , Minimum(copy.Minimum)
+                    , Maximum(copy.Maximum)
+                    , Average(copy.Average)
+                    , P50(copy.P50)
+                    , P90(copy.P90)
+                    , P99(copy.P99)
+                    , P999(copy.P999)
+                {
+                    Init();
+                }
+                ~Stage() override
+                {
+                }
+
+            private:
+                void Init()
+                {
+                    Add(_T("count"), &Count);
+                    Add(_T("minimum"), &Minimum);
+                    Add(_T("maximum"), &Maximum);
+                    Add(_T("average"), &Average);
+                    Add(_T("p50"), &P50);
+                    Add(_T("p90"), &P90);
+                    Add(_T("p99"), &P99);
+                    Add(_T("p999"), &P999);
+                }
+
+            public:
+                Core::JSON::DecUInt64 Count;
+                // All in nanoseconds. Minimum, maximum and average are taken over all calls, the percentiles
+                // over the samples kept of them.
+                Core::JSON::DecUInt64 Minimum;
+                Core::JSON::DecUInt64 Maximum;
+                Core::JSON::DecUInt64 Average;
+                Core::JSON::DecUInt64 P50;
+                Core::JSON::DecUInt64 P90;
+                Core::JSON::DecUInt64 P99;
+                Core::JSON::DecUInt64 P999;
+            };
+
+        public:
+            Report(const Report&) = delete;
+            Report& operator=(const Report&) = delete;
+
+            Report()
+                : Core::JSON::Container()
+            {
+                Add(_T("state"), &State);
+                Add(_T("transport"), &Transport);
+                Add(_T("callsign"), &Callsign);
+                Add(_T("method"), &Method);
+                Add(_T("concurrency"), &Concurrency);
+                Add(_T("requests"), &Requests);
+                Add(_T("errors"), &Errors);
+                Add(_T("bytes"), &Bytes);
+                Add(_T("duration"), &Duration);
+                Add(_T("throughput"), &Throughput);
+                Add(_T("bandwidth"), &Bandwidth);
+                Add(_T("serialization"), &Serialization);
+                Add(_T("execution"), &Execution);
+                Add(_T("deserialization"), &Deserialization);
+                Add(_T("total"), &Total);
+            }
+            ~Report() override
+            {
+            }
+
+        public:
+            Core::JSON::EnumType<state> State;
+            Core::JSON::EnumType<transport> Transport;
+            Core::JSON::String Callsign;
+            Core::JSON::String Method;
+            Core::JSON::DecUInt8 Concurrency;
+            Core::JSON::DecUInt64 Requests;
+            Core::JSON::DecUInt64 Errors;
+            // Payload bytes send.
+            Core::JSON::DecUInt64 Bytes;
+            // Milliseconds the run took, the calls completed per second and the payload bytes per second.
+            Core::JSON::DecUInt64 Duration;
+            Core::JSON::DecUInt64 Throughput;
+            Core::JSON::DecUInt64 Bandwidth;
+            Stage Serialization;
+            Stage Execution;
+            Stage Deserialization;
+            Stage Total;
+        };
+
+    private:
+        class Generator : public Core::Thread {
+        public:
+            Generator() = delete;
+            Generator(const Generator&) = delete;
+            Generator& operator=(const Generator&) = delete;
+
+            Generator(Benchmark& parent, const uint32_t seed, const uint8_t index, const uint16_t bufferSize)
+                : Core::Thread(0, _T("Benchmark"))
+                , _parent(parent)
+                , _random(seed)
+                , _index(index)
+                , _buffer(bufferSize)
+            {
+            }
+            ~Generator() override
+            {
+                Stop();
+                Wait(Core::Thread::BLOCKED | Core::Thread::STOPPED, Core::infinite);
+            }
+
+        public:
+            inline std::mt19937& Random()
+            {
+                return (_random);
+            }
+            inline uint8_t Index() const
+            {
+                return (_index);
+            }
+            inline uint8_t* Buffer()
+            {
+                return (_buffer.data());
+            }
+
+        private:
+            uint32_t Worker() override;
+
+        private:
+            Benchmark& _parent;
+            std::mt19937 _random;
+            uint8_t _index;
+            std::vector<uint8_t> _buffer;
+        };
+
+        // Samples of one stage, in nanoseconds.
+        typedef std::vector<uint64_t> Samples;
+
+        // What a generator handed in: a uniform selection of the calls it timed, out of the calls it did, and
+        // the extremes and sum of all of them.
+        struct Reservoir {
+            uint64_t Seen;
+            uint64_t Minimum[STAGES];
+            uint64_t Maximum[STAGES];
+            uint64_t Sum[STAGES];
+            Samples Values[STAGES];
+        };
+
+    public:
+        Benchmark(const Benchmark&) = delete;
+        Benchmark& operator=(const Benchmark&) = delete;
+
+        Benchmark() = delete;
+
+        Benchmark(Histograms& histograms);
+        ~Benchmark();
+
+    public:
+        // Returns ERROR_INPROGRESS if a run is still going on.
+        uint32_t Start(PluginHost::IDispatcher* target, const string& callsign, const Settings& settings, const string& exportFile);
+        uint32_t Start(IPerformanceLoopback* loopback, const transport kind, const string& sharedFile, const Settings& settings, const string& exportFile);
+        void Stop();
+        void Snapshot(Report& report) const;
+
+    private:
+        uint32_t Launch(const transport kind, const Settings& settings, const string& exportFile);
+        void Release();
+        bool Call(Generator& generator, Reservoir& reservoir, uint64_t& errors, uint64_t& bytes);
+        bool InvokeJSONRPC(Generator& generator, uint32_t& size, uint64_t (&moments)[4]);
+        bool InvokeLoopback(Generator& generator, uint32_t& size, uint64_t (&moments)[4]);
+        void Completed(Reservoir& reservoir, const uint64_t errors, const uint64_t bytes);
+        void Merge();
+        uint16_t Size(std::mt19937& random) const;
+        void Fill(Report::Stage& stage, const stage index) const;
+        static inline uint64_t Now()
+        {
+            return (Histograms::Now());
+        }
+
+    private:
+        // The runLock keeps a run from being started while Stop() waits for the generators of the previous run.
+        Core::CriticalSection _runLock;
+        mutable Core::CriticalSection _adminLock;
+        Histograms& _histograms;
+        PluginHost::IDispatcher* _target;
+        IPerformanceLoopback* _loopback;
+        Core::DataElementFile* _shared;
+        std::list<Generator*> _generators;
+        state _state;
+        transport _transport;
+        string _callsign;
+        string _method;
+        string _parameters;
+        string _exportFile;
+        uint8_t _concurrency;
+        uint32_t _capacity;
+        uint16_t _minSize;
+        uint16_t _maxSize;
+        distribution _distribution;
+        uint64_t _deadline;
+        uint64_t _limit;
+        std::atomic<uint64_t> _issued;
+        std::atomic<uint64_t> _completed;
+        std::atomic<bool> _stopped;
+        uint64_t _started;
+        uint64_t _finished;
+        uint8_t _running;
+        uint64_t _errors;
+        uint64_t _bytes;
+        std::list<Reservoir> _reservoirs;
+        uint64_t _minimum[STAGES];
+        uint64_t _maximum[STAGES];
+        uint64_t _sum[STAGES];
+        Samples _samples[STAGES];
+    };
+
+} // namespace Plugin
+} // namespace WPEFramework
@@ -0,0 +1,305 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Module.h"
+
+#include <atomic>
+#include <chrono>
+
+namespace WPEFramework {
+namespace Plugin {
+
+    // Latency histogram with logarithmic buckets, in the spirit of HdrHistogram: every power of two is split
+    // in SubBuckets linear buckets, so a value is known within 1/SubBuckets (~6%) of its magnitude, from 1ns
+    // up to MaxBits (~68s). Recording is a handful of relaxed atomic increments, no locks.
+    // Next to the lifetime counters, the samples are recorded in a small ring of time slices, so the last
+    // Slices - 1 slices (the window) can be looked at separately. A slice is cleared by the first recording
+    // that finds it belongs to an old period; a sample recorded by another thread at that very moment might
+    // get lost, the price for not taking a lock.
+    class Histogram {
+    private:
+        static constexpr uint8_t SubBits = 4;
+        static constexpr uint8_t MaxBits = 36;
+        static constexpr uint8_t Slices = 4;
+
+    public:
+        static constexpr uint16_t SubBuckets = (1 << SubBits);
+        static constexpr uint16_t Buckets = (MaxBits - SubBits + 1) * SubBuckets;
+
+        struct Summary {
+            uint64_t Count;
+            uint64_t Sum;
+            uint64_t Maximum;
+            uint64_t Counts[Buckets];
+        };
+
+    private:
+        struct Counters {
+            std::atomic<uint64_t> Epoch;
+            std::atomic<uint64_t> Count;
+            std::atomic<uint64_t> Sum;
+            std::atomic<uint64_t> Maximum;
+            std::atomic<uint32_t> Counts[Buckets];
+
+            void Clear()
+            {
+                Count.store(0, std::memory_order_relaxed);
+                Sum.store(0, std::memory_order_relaxed);
+                Maximum.store(0, std::memory_order_relaxed);
+                for (uint16_t index = 0; index < Buckets; index++) {
+                    Counts[index].store(0, std::memory_order_relaxed);
+                }
+            }
+            void Add(const uint16_t index, const uint64_t value)
+            {
+                uint64_t maximum = Maximum.load(std::memory_order_relaxed);
+
+                Counts[index].fetch_add(1, std::memory_order_relaxed);
+                Count.fetch_add(1, std::memory_order_relaxed);
+                Sum.fetch_add(value, std::memory_order_relaxed);
+
+                while ((value > maximum) && (Maximum.compare_exchange_weak(maximum, value, std::memory_order_relaxed) == false)) {
+                }
+            }
+            void Collect(Summary& summary) const
+            {
+                uint64_t maximum = Maximum.load(std::memory_order_relaxed);
+
+                summary.Count += Count.load(std::memory_order_relaxed);
+                summary.Sum += Sum.load(std::memory_order_relaxed);
+                summary.Maximum = std::max(summary.Maximum, maximum);
+                for (uint16_t index = 0; index < Buckets; index++) {
+                    summary.Counts[index] += Counts[index].load(std::memory_order_relaxed);
+                }
+            }
+        };
+
+    public:
+        Histogram(const Histogram&) = delete;
+        Histogram& operator=(const Histogram&) = delete;
+
+        Histogram()
+            : _period(0)
+        {
+            Period(60);
+            Clear();
+        }
+        ~Histogram()
+        {
+        }
+
+    public:
+        // The window covers at least the given number of seconds, and at most a third more.
+        void Period(const uint32_t window)
+        {
+            _period = (static_cast<uint64_t>(std::max(window, static_cast<uint32_t>(1))) * 1000000000ULL) / (Slices - 1);
+        }
+        uint32_t Window() const
+        {
+            return (static_cast<uint32_t>((_period * (Slices - 1)) / 1000000000ULL));
+        }
+        void Clear()
+        {
+            _lifetime.Clear();
+            for (uint8_t index = 0; index < Slices; index++) {
+                _slices[index].Clear();
+                _slices[index].Epoch.store(0, std::memory_order_relaxed);
+            }
+        }
+        void Record(const uint64_t value, const uint64_t now)
+        {
+            const uint16_t index = Index(value);
+            const uint64_t epoch = (now / _period) + 1;
+            Counters& slice(_slices[epoch % Slices]);
+            uint64_t current = slice.Epoch.load(std::memory_order_acquire);
+
+            _lifetime.Add(index, value);
+
+            if ((current != epoch) && (slice.Epoch.compare_exchange_strong(current, epoch, std::memory_order_acq_rel) == true)) {
+                slice.Clear();
+            }
+
+            slice.Add(index, value);
+        }
+        void Snapshot(Summary& summary, const bool windowed, const uint64_t now) const
+        {
+            ::memset(&summary, 0, sizeof(summary));
+
+            if (windowed == false) {
+                _lifetime.Collect(summary);
+            } else {
+                const uint64_t epoch = (now / _period) + 1;
+
+                for (uint8_t index = 0; index < Slices; index++) {
+                    const uint64_t slice = _slices[index].Epoch.load(std::memory_order_acquire);
+
+                    if ((slice != 0) && ((slice + Slices) > epoch)) {
+                        _slices[index].Collect(summary);
+                    }
+                }
+            }
+        }
+
+        static inline uint16_t Index(const uint64_t value)
+        {
+            uint16_t result = static_cast<uint16_t>(value);
+
+            if (value >= SubBuckets) {
+                const uint8_t msb = static_cast<uint8_t>(63 - __builtin_clzll(value));
+
+                if (msb >= MaxBits) {
+                    result = Buckets - 1;
+                } else {
+                    const uint8_t shift = msb - SubBits;
+                    result = static_cast<uint16_t>(((shift + 1) * SubBuckets) + (value >> shift) - SubBuckets);
+                }
+            }
+
+            return (result);
+        }
+        // Highest value that ends up in the given bucket.
+        static inline uint64_t Upper(const uint16_t index)
+        {
+            uint64_t result = index;
+
+            if (index >= SubBuckets) {
+                const uint8_t shift = static_cast<uint8_t>((index / SubBuckets) - 1);
+                result = ((static_cast<uint64_t>(SubBuckets + (index % SubBuckets)) + 1) << shift) - 1;
+            }
+
+            return (result);
+        }
+        // Value below which the given permille of the samples are, reported as the upper bound of its bucket.
+        static uint64_t Percentile(const Summary& summary, const uint16_t permille)
+        {
+            uint64_t result = 0;
+
+            if (summary.Count != 0) {
+                const uint64_t rank = std::max(static_cast<uint64_t>(1), ((summary.Count * permille) + 999) / 1000);
+                uint64_t seen = 0;
+                uint16_t index = 0;
+
+                while ((index < (Buckets - 1)) && ((seen += summary.Counts[index]) < rank)) {
+                    index++;
+                }
+
+                result = std::min(Upper(index), summary.Maximum);
+            }
+
+            return (result);
+        }
+
+    private:
+        uint64_t _period;
+        Counters _lifetime;
+        Counters _slices[Slices];
+    };
+
+    // Histograms per stage of a call and per package size, package sizes go up by a factor four from 64 bytes.
+    class Histograms {
+    public:
+        enum stage {
+            SERIALIZATION,
+            EXECUTION,
+            DESERIALIZATION,
+            TOTAL,
+            HANDLER,
+            STAGES
+        };
+
+        static constexpr uint8_t Sizes = 6;
+
+    public:
+        Histograms(const Histograms&) = delete;
+        Histograms& operator=(const Histograms&) = delete;
+
+        Histograms()
+        {
+        }
+        ~Histograms()
+        {
+        }
+
+    public:
+        void Window(const uint32_t seconds)
+        {
+            for (uint8_t index = 0; index < STAGES; index++) {
+                for (uint8_t size = 0; size < Sizes; size++) {
+                    _histograms[index][size].Period(seconds);
+                }
+            }
+        }
+        uint32_t Window() const
+        {
+            return (_histograms[0][0].Window());
+        }
+        void Clear()
+        {
+            for (uint8_t index = 0; index < STAGES; index++) {
+                for (uint8_t size = 0; size < Sizes; size++) {
+                    _histograms[index][size].Clear();
+                }
+            }
+        }
+        inline void Record(const stage index, const uint32_t packageSize, const uint64_t duration, const uint64_t now)
+        {
+            ASSERT(index < STAGES);
+
+            _histograms[index][Size(packageSize)].Record(duration, now);
+        }
+        inline const Histogram& Get(const stage index, const uint32_t packageSize) const
+        {
+            ASSERT(index < STAGES);
+
+            return (_histograms[index][Size(packageSize)]);
+        }
+
+        // Largest package size that is accounted to the same histograms as the given one, the last
+        // histograms take all that is larger.
+        static inline uint32_t Limit(const uint32_t packageSize)
+        {
+            return (64 << (2 * Size(packageSize)));
+        }
+        static inline uint64_t Now()
+        {
+            return (static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count()));
+        }
+
+    private:
+        static inline uint8_t Size(const uint32_t packageSize)
+        {
+            uint8_t result = 0;
+            uint32_t limit = 64;
+
+            while ((result < (Sizes - 1)) && (packageSize > limit)) {
+                limit <<= 2;
+                result++;
+            }
+
+            return (result);
+        }
+
+    private:
+        Histogram _histograms[STAGES][Sizes];
+    };
+
+} // namespace Plugin
+} // namespace WPEFramework
@@ -0,0 +1,54 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Module.h"
+
+namespace WPEFramework {
+
+namespace Plugin {
+
+    // The interface is private to this plugin, so it stays out of the Exchange namespace and the ID ranges
+    // handed out there. Its ID is taken from the top of the ID space, no shared interface is assigned there.
+    enum performance_ids {
+        ID_PERFORMANCE_LOOPBACK = 0xF0002000
+    };
+
+    // Counterpart of the PerformanceMonitor benchmarks, running in a process of its own, so the COM-RPC
+    // path and a transfer through shared memory can be measured against the JSON-RPC one. The marshalling
+    // code is generated from this header by the ProxyStubGenerator, at build time.
+    struct IPerformanceLoopback : virtual public Core::IUnknown {
+        enum { ID = ID_PERFORMANCE_LOOPBACK };
+
+        virtual ~IPerformanceLoopback() {}
+
+        // The buffer goes to the other side and comes back with every byte inverted. Returns the checksum
+        // (FNV-1a) of what was received.
+        virtual uint32_t Exchange(const uint16_t length, uint8_t buffer[] /* @inout @length:length */, uint32_t& checksum /* @out */) = 0;
+
+        // Maps the given file, of the given size, in which the benchmark places the data. An empty name
+        // unmaps it.
+        virtual uint32_t Attach(const string& name, const uint32_t size) = 0;
+        // Same as Exchange, on the data that is in the mapped file at the given offset.
+        virtual uint32_t Touch(const uint32_t offset, const uint16_t length, uint32_t& checksum /* @out */) = 0;
+    };
+
+} // namespace Plugin
+} // namespace WPEFramework
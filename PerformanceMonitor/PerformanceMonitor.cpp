@@ -31,12 +31,55 @@ namespace Plugin {
 
         ASSERT(service != nullptr);
         _skipURL = static_cast<uint8_t>(service->WebPrefix().length());
+        _service = service;
+        _histograms.Window(config.Window.Value());
+
+        // The loopback for the COM-RPC and shared memory benchmarks. The remote process might die before
+        // we get a change to "register" the sink for these events, so do it ahead of instantiation.
+        _service->Register(&_notification);
+
+        _loopback = _service->Root<IPerformanceLoopback>(_connectionId, 2000, _T("PerformanceMonitorImplementation"));
+
+        if (_loopback == nullptr) {
+            _service->Unregister(&_notification);
+            SYSLOG(Logging::Startup, (_T("PerformanceMonitor loopback could not be instantiated, only JSON-RPC can be benchmarked.")));
+        }
 
         return string();
     }
 
     /* virtual */ void PerformanceMonitor::Deinitialize(PluginHost::IShell* service)
     {
+        ASSERT(_service == service);
+
+        _job.Revoke();
+
+        // The generators might be calling into this plugin, wait for them before it goes.
+        _benchmark.Stop();
+
+        if (_loopback != nullptr) {
+            _service->Unregister(&_notification);
+
+            if (_loopback->Release() != Core::ERROR_DESTRUCTION_SUCCEEDED) {
+
+                ASSERT(_connectionId != 0);
+
+                TRACE_L1("OutOfProcess Plugin is not properly destructed. PID: %d", _connectionId);
+
+                RPC::IRemoteConnection* connection(_service->RemoteConnection(_connectionId));
+
+                // The process can disappear in the meantime...
+                if (connection != nullptr) {
+                    connection->Terminate();
+                    connection->Release();
+                }
+            }
+
+            _loopback = nullptr;
+        }
+
+        _connectionId = 0;
+        _service = nullptr;
     }
 
     /* virtual */ string PerformanceMonitor::Information() const
@@ -44,6 +87,38 @@ namespace Plugin {
         // No additional info to report.
         return ((_T("The purpose of this plugin is provide ability to collect performance values of JSONRPC communication")));
     }
+    void PerformanceMonitor::Deactivated(RPC::IRemoteConnection* connection)
+    {
+        // The loopback is only there to compare against, without it the JSON-RPC benchmarks still work, so the
+        // plugin stays up. This can potentially be called on a socket thread, so the loopback is dropped on a
+        // seperate thread.
+        if (_connectionId == connection->Id()) {
+
+            ASSERT(_service != nullptr);
+
+            _job.Submit();
+        }
+    }
+
+    void PerformanceMonitor::Dispatch()
+    {
+        _adminLock.Lock();
+
+        IPerformanceLoopback* loopback = _loopback;
+        _loopback = nullptr;
+        _connectionId = 0;
+
+        _adminLock.Unlock();
+
+        if (loopback != nullptr) {
+            // A benchmark still running over the loopback counts its calls as errors until it completes.
+            _service->Unregister(&_notification);
+            loopback->Release();
+
+            SYSLOG(Logging::Notification, (_T("PerformanceMonitor loopback went away, only JSON-RPC can be benchmarked.")));
+        }
+    }
+
     uint32_t PerformanceMonitor::RetrieveInfo(const uint32_t packageSize, JsonData::PerformanceMonitor::MeasurementData& measurementData) const {
         const PluginHost::PerformanceAdministrator::Statistics& statistics(PluginHost::PerformanceAdministrator::Instance().Retrieve(packageSize));
 
@@ -57,6 +132,47 @@ namespace Plugin {
         return Core::ERROR_NONE;
     }
 
+    void PerformanceMonitor::RetrieveHistograms(const uint32_t packageSize, HistogramData& histogramData) const
+    {
+        const uint64_t now = Histograms::Now();
+
+        histogramData.Size = Histograms::Limit(packageSize);
+        histogramData.Window = _histograms.Window();
+
+        Fill(Histograms::SERIALIZATION, packageSize, now, histogramData.Serialization);
+        Fill(Histograms::EXECUTION, packageSize, now, histogramData.Execution);
+        Fill(Histograms::DESERIALIZATION, packageSize, now, histogramData.Deserialization);
+        Fill(Histograms::TOTAL, packageSize, now, histogramData.Total);
+        Fill(Histograms::HANDLER, packageSize, now, histogramData.Handler);
+    }
+
+    void PerformanceMonitor::Fill(const Histograms::stage stage, const uint32_t packageSize, const uint64_t now, StageData& stageData) const
+    {
+        // Too big for the stack of a worker thread.
+        std::unique_ptr<Histogram::Summary> summary(new Histogram::Summary);
+        const Histogram& histogram(_histograms.Get(stage, packageSize));
+
+        for (uint8_t windowed = 0; windowed < 2; windowed++) {
+            Distribution& distribution(windowed != 0 ? stageData.Window : stageData.Lifetime);
+
+            histogram.Snapshot(*summary, (windowed != 0), now);
+
+            distribution.Count = summary->Count;
+            distribution.Average = (summary->Count != 0 ? summary->Sum / summary->Count : 0);
+            distribution.Maximum = summary->Maximum;
+            distribution.P50 = Histogram::Percentile(*summary, 500);
+            distribution.P90 = Histogram::Percentile(*summary, 900);
+            distribution.P99 = Histogram::Percentile(*summary, 990);
+            distribution.P999 = Histogram::Percentile(*summary, 999);
+
+            for (uint16_t index = 0; index < Histogram::Buckets; index++) {
+                if (summary->Counts[index] != 0) {
+                    distribution.Buckets.Add(Distribution::Bucket(Histogram::Upper(index), summary->Counts[index]));
+                }
+            }
+        }
+    }
+
     uint32_t PerformanceMonitor::Send(const JsonData::PerformanceMonitor::BufferInfo& data, Core::JSON::DecUInt32& result)
     {
         uint16_t length = static_cast<uint16_t>(((data.Data.Value().length() * 6) + 7) / 8);
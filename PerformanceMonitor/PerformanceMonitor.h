@@ -20,6 +20,8 @@
 #pragma once
 
 #include "Module.h"
+#include "Benchmark.h"
+#include "Histogram.h"
 
 #include <interfaces/json/JsonData_PerformanceMonitor.h>
 
@@ -27,13 +29,221 @@ namespace WPEFramework {
 namespace Plugin {
 
     class PerformanceMonitor : public PluginHost::IPlugin, public PluginHost::JSONRPC {
+    private:
+        typedef Core::WorkerPool::JobType<PerformanceMonitor&> Job;
+
+        class Notification : public RPC::IRemoteConnection::INotification {
+        public:
+            Notification() = delete;
+            Notification(const Notification&) = delete;
+            Notification& operator=(const Notification&) = delete;
+
+            explicit Notification(PerformanceMonitor& parent)
+                : _parent(parent)
+            {
+            }
+            ~Notification() override
+            {
+            }
+
+        public:
+            void Activated(RPC::IRemoteConnection* /* connection */) override
+            {
+            }
+            void Deactivated(RPC::IRemoteConnection* connection) override
+            {
+                _parent.Deactivated(connection);
+            }
+
+            BEGIN_INTERFACE_MAP(Notification)
+            INTERFACE_ENTRY(RPC::IRemoteConnection::INotification)
+            END_INTERFACE_MAP
+
+        private:
+            PerformanceMonitor& _parent;
+        };
+
+        class Config : public Core::JSON::Container {
+        public:
+            Config(const Config&) = delete;
+            Config& operator=(const Config&) = delete;
+
+            Config()
+                : Core::JSON::Container()
+                , Window(60)
+            {
+                Add(_T("window"), &Window);
+            }
+            ~Config() override
+            {
+            }
+
+        public:
+            // Seconds of recent calls the windowed histograms cover.
+            Core::JSON::DecUInt32 Window;
+        };
+
+    public:
+        class Distribution : public Core::JSON::Container {
+        public:
+            class Bucket : public Core::JSON::Container {
+            public:
+                Bucket& operator=(const Bucket&) = delete;
+
+                Bucket()
+                    : Core::JSON::Container()
+                {
+                    Init();
+                }
+                Bucket(const uint64_t upper, const uint64_t count)
+                    : Core::JSON::Container()
+                {
+                    Init();
+                    Upper = upper;
+                    Count = count;
+                }
+                Bucket(const Bucket& copy)
+                    : Core::JSON::Container()
+                    , Upper(copy.Upper)
+                    , Count(copy.Count)
+                {
+                    Init();
+                }
+                ~Bucket() override
+                {
+                }
+
+            private:
+                void Init()
+                {
+                    Add(_T("upper"), &Upper);
+                    Add(_T("count"), &Count);
+                }
+
+            public:
+                Core::JSON::DecUInt64 Upper;
+                Core::JSON::DecUInt64 Count;
+            };
+
+        public:
+            Distribution(const Distribution&) = delete;
+            Distribution& operator=(const Distribution&) = delete;
+
+            Distribution()
+                : Core::JSON::Container()
+            {
+                Add(_T("count"), &Count);
+                Add(_T("average"), &Average);
+                Add(_T("maximum"), &Maximum);
+                Add(_T("p50"), &P50);
+                Add(_T("p90"), &P90);
+                Add(_T("p99"), &P99);
+                Add(_T("p999"), &P999);
+                Add(_T("buckets"), &Buckets);
+            }
+            ~Distribution() override
+            {
+            }
+
+        public:
+            Core::JSON::DecUInt64 Count;
+            // All in nanoseconds.
+            Core::JSON::DecUInt64 Average;
+            Core::JSON::DecUInt64 Maximum;
+            Core::JSON::DecUInt64 P50;
+            Core::JSON::DecUInt64 P90;
+            Core::JSON::DecUInt64 P99;
+            Core::JSON::DecUInt64 P999;
+            // Only the buckets that hold samples.
+            Core::JSON::ArrayType<Bucket> Buckets;
+        };
+
+        class StageData : public Core::JSON::Container {
+        public:
+            StageData(const StageData&) = delete;
+            StageData& operator=(const StageData&) = delete;
+
+            StageData()
+                : Core::JSON::Container()
+            {
+                Add(_T("window"), &Window);
+                Add(_T("lifetime"), &Lifetime);
+            }
+            ~StageData() override
+            {
+            }
+
+        public:
+            Distribution Window;
+            Distribution Lifetime;
+        };
+
+        class HistogramData : public Core::JSON::Container {
+        public:
+            HistogramData(const HistogramData&) = delete;
+            HistogramData& operator=(const HistogramData&) = delete;
+
+            HistogramData()
+                : Core::JSON::Container()
+            {
+                Add(_T("size"), &Size);
+                Add(_T("window"), &Window);
+                Add(_T("serialization"), &Serialization);
+                Add(_T("execution"), &Execution);
+                Add(_T("deserialization"), &Deserialization);
+                Add(_T("total"), &Total);
+                Add(_T("handler"), &Handler);
+            }
+            ~HistogramData() override
+            {
+            }
+
+        public:
+            // Largest package size accounted to these histograms, and the seconds the window covers.
+            Core::JSON::DecUInt32 Size;
+            Core::JSON::DecUInt32 Window;
+            // Stages of the calls done by the benchmark.
+            StageData Serialization;
+            StageData Execution;
+            StageData Deserialization;
+            StageData Total;
+            // Time spent in the send, receive and exchange methods, whoever called them.
+            StageData Handler;
+        };
+
+        class MeasurementInfo : public JsonData::PerformanceMonitor::MeasurementData {
+        public:
+            MeasurementInfo(const MeasurementInfo&) = delete;
+            MeasurementInfo& operator=(const MeasurementInfo&) = delete;
+
+            MeasurementInfo()
+                : JsonData::PerformanceMonitor::MeasurementData()
+            {
+                Add(_T("histogram"), &Histogram);
+            }
+            ~MeasurementInfo() override
+            {
+            }
+
+        public:
+            HistogramData Histogram;
+        };
+
     public:
         PerformanceMonitor(const PerformanceMonitor&) = delete;
         PerformanceMonitor& operator=(const PerformanceMonitor&) = delete;
 
     public:
         PerformanceMonitor()
-            : _skipURL(0)
+            : _adminLock()
+            , _skipURL(0)
+            , _service(nullptr)
+            , _connectionId(0)
+            , _loopback(nullptr)
+            , _notification(*this)
+            , _job(*this)
+            , _histograms()
+            , _benchmark(_histograms)
         {
             RegisterAll();
         }
@@ -54,20 +264,31 @@ namespace Plugin {
         virtual void Deinitialize(PluginHost::IShell* service) override;
         virtual string Information() const override;
 
+        // Drops the loopback once its process went away, scheduled on the workerpool.
+        void Dispatch();
+
     private:
+        void Deactivated(RPC::IRemoteConnection* connection);
+
         void RegisterAll();
         void UnregisterAll();
         uint32_t endpoint_clear();
         uint32_t endpoint_send(const JsonData::PerformanceMonitor::BufferInfo& params, Core::JSON::DecUInt32& response);
         uint32_t endpoint_receive(const Core::JSON::DecUInt32& params, JsonData::PerformanceMonitor::BufferInfo& response);
         uint32_t endpoint_exchange(const JsonData::PerformanceMonitor::BufferInfo& params, JsonData::PerformanceMonitor::BufferInfo& response);
-        uint32_t get_measurement(const string& index, JsonData::PerformanceMonitor::MeasurementData& response) const;
+        uint32_t get_measurement(const string& index, MeasurementInfo& response) const;
+        uint32_t endpoint_startbenchmark(const Benchmark::Settings& params);
+        uint32_t endpoint_stopbenchmark();
+        uint32_t get_benchmark(Benchmark::Report& response) const;
 
         uint32_t RetrieveInfo(const uint32_t packageSize, JsonData::PerformanceMonitor::MeasurementData& measurementData) const;
         uint32_t Send(const JsonData::PerformanceMonitor::BufferInfo& data, Core::JSON::DecUInt32& result);
         uint32_t Receive(const Core::JSON::DecUInt32& maxSize, JsonData::PerformanceMonitor::BufferInfo& data);
         uint32_t Exchange(const JsonData::PerformanceMonitor::BufferInfo& data, JsonData::PerformanceMonitor::BufferInfo& result);
 
+        void RetrieveHistograms(const uint32_t packageSize, HistogramData& histogramData) const;
+        void Fill(const Histograms::stage stage, const uint32_t packageSize, const uint64_t now, StageData& stageData) const;
+
         inline void Measurement(const PluginHost::PerformanceAdministrator::Statistics::Tuple& statistics, JsonData::PerformanceMonitor::MeasurementData::StatisticsData& statisticsData) const {
 
             statisticsData.Minimum = statistics.Minimum();
@@ -77,7 +298,15 @@ namespace Plugin {
         }
 
     private:
+        Core::CriticalSection _adminLock;
         uint8_t _skipURL;
+        PluginHost::IShell* _service;
+        uint32_t _connectionId;
+        IPerformanceLoopback* _loopback;
+        Core::Sink<Notification> _notification;
+        Job _job;
+        Histograms _histograms;
+        Benchmark _benchmark;
     };
 
 } // namespace Plugin
@@ -0,0 +1,113 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Module.h"
+#include "IPerformanceLoopback.h"
+
+namespace WPEFramework {
+namespace Plugin {
+
+    class PerformanceMonitorImplementation : public IPerformanceLoopback {
+    public:
+        PerformanceMonitorImplementation(const PerformanceMonitorImplementation&) = delete;
+        PerformanceMonitorImplementation& operator=(const PerformanceMonitorImplementation&) = delete;
+
+        PerformanceMonitorImplementation()
+            : _adminLock()
+            , _shared(nullptr)
+        {
+        }
+        ~PerformanceMonitorImplementation() override
+        {
+            Attach(string(), 0);
+        }
+
+        BEGIN_INTERFACE_MAP(PerformanceMonitorImplementation)
+        INTERFACE_ENTRY(IPerformanceLoopback)
+        END_INTERFACE_MAP
+
+    public:
+        uint32_t Exchange(const uint16_t length, uint8_t buffer[], uint32_t& checksum) override
+        {
+            checksum = Invert(buffer, length);
+
+            return (Core::ERROR_NONE);
+        }
+        uint32_t Attach(const string& name, const uint32_t size) override
+        {
+            uint32_t result = Core::ERROR_NONE;
+
+            _adminLock.Lock();
+
+            if (_shared != nullptr) {
+                delete _shared;
+                _shared = nullptr;
+            }
+
+            if (name.empty() == false) {
+                _shared = new Core::DataElementFile(name, Core::File::SHAREABLE | Core::File::USER_READ | Core::File::USER_WRITE, size);
+
+                if ((_shared->IsValid() == false) || (_shared->Size() < size)) {
+                    delete _shared;
+                    _shared = nullptr;
+                    result = Core::ERROR_OPENING_FAILED;
+                }
+            }
+
+            _adminLock.Unlock();
+
+            return (result);
+        }
+        uint32_t Touch(const uint32_t offset, const uint16_t length, uint32_t& checksum) override
+        {
+            uint32_t result = Core::ERROR_ILLEGAL_STATE;
+
+            // The benchmark does not attach or detach while it is running, the lock does not
+            // serialize the calls of the generators.
+            if ((_shared != nullptr) && ((static_cast<uint64_t>(offset) + length) <= _shared->Size())) {
+                checksum = Invert(&(_shared->Buffer()[offset]), length);
+                result = Core::ERROR_NONE;
+            }
+
+            return (result);
+        }
+
+    private:
+        // FNV-1a of the buffer as it came in, leaving it with every byte inverted.
+        static uint32_t Invert(uint8_t buffer[], const uint16_t length)
+        {
+            uint32_t result = 2166136261u;
+
+            for (uint16_t index = 0; index < length; index++) {
+                result = (result ^ buffer[index]) * 16777619u;
+                buffer[index] = ~buffer[index];
+            }
+
+            return (result);
+        }
+
+    private:
+        Core::CriticalSection _adminLock;
+        Core::DataElementFile* _shared;
+    };
+
+    SERVICE_REGISTRATION(PerformanceMonitorImplementation, 1, 0);
+
+} // namespace Plugin
+} // namespace WPEFramework
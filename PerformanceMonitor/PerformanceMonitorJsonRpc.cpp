@@ -16,7 +16,10 @@ namespace Plugin {
         Register<BufferInfo,Core::JSON::DecUInt32>(_T("send"), &PerformanceMonitor::endpoint_send, this);
         Register<Core::JSON::DecUInt32,BufferInfo>(_T("receive"), &PerformanceMonitor::endpoint_receive, this);
         Register<BufferInfo,BufferInfo>(_T("exchange"), &PerformanceMonitor::endpoint_exchange, this);
-        Property<MeasurementData>(_T("measurement"), &PerformanceMonitor::get_measurement, nullptr, this);
+        Property<MeasurementInfo>(_T("measurement"), &PerformanceMonitor::get_measurement, nullptr, this);
+        Register<Benchmark::Settings,void>(_T("startbenchmark"), &PerformanceMonitor::endpoint_startbenchmark, this);
+        Register<void,void>(_T("stopbenchmark"), &PerformanceMonitor::endpoint_stopbenchmark, this);
+        Property<Benchmark::Report>(_T("benchmark"), &PerformanceMonitor::get_benchmark, nullptr, this);
     }
 
     void PerformanceMonitor::UnregisterAll()
@@ -26,6 +29,9 @@ namespace Plugin {
         Unregister(_T("exchange"));
         Unregister(_T("clear"));
         Unregister(_T("measurement"));
+        Unregister(_T("startbenchmark"));
+        Unregister(_T("stopbenchmark"));
+        Unregister(_T("benchmark"));
     }
 
     // API implementation
@@ -37,6 +43,7 @@ namespace Plugin {
     uint32_t PerformanceMonitor::endpoint_clear()
     {
         PluginHost::PerformanceAdministrator::Instance().Clear();
+        _histograms.Clear();
         return Core::ERROR_NONE;
     }
 
@@ -45,32 +52,109 @@ namespace Plugin {
     //  - ERROR_NONE: Success
     uint32_t PerformanceMonitor::endpoint_send(const BufferInfo& params, Core::JSON::DecUInt32& response)
     {
-        return Send(params, response);
+        const uint64_t start = Histograms::Now();
+        const uint32_t result = Send(params, response);
+        const uint64_t end = Histograms::Now();
+
+        _histograms.Record(Histograms::HANDLER, response.Value(), end - start, end);
+
+        return (result);
     }
 
     // Return codes:
     //  - ERROR_NONE: Success
     uint32_t PerformanceMonitor::endpoint_receive(const Core::JSON::DecUInt32& params, BufferInfo& response)
     {
-        return Receive(params, response);
+        const uint64_t start = Histograms::Now();
+        const uint32_t result = Receive(params, response);
+        const uint64_t end = Histograms::Now();
+
+        _histograms.Record(Histograms::HANDLER, params.Value(), end - start, end);
+
+        return (result);
     }
 
     // Return codes:
     //  - ERROR_NONE: Success
     uint32_t PerformanceMonitor::endpoint_exchange(const BufferInfo& params, BufferInfo& response)
     {
-        return Exchange(params, response);
+        const uint64_t start = Histograms::Now();
+        const uint32_t result = Exchange(params, response);
+        const uint64_t end = Histograms::Now();
+
+        _histograms.Record(Histograms::HANDLER, params.Length.Value(), end - start, end);
+
+        return (result);
     }
 
-    // Property: measurement - Retrieve the performance measurement against given package size
+    // Property: measurement - Retrieve the performance measurement against given package size, with the
+    //                        latency percentiles and histograms of the window and of the lifetime
     // Return codes:
     //  - ERROR_NONE: Success
-    uint32_t PerformanceMonitor::get_measurement(const string& index, MeasurementData& response) const
+    uint32_t PerformanceMonitor::get_measurement(const string& index, MeasurementInfo& response) const
     {
         const uint32_t& packageSize = atoi(index.c_str());
+        RetrieveHistograms(packageSize, response.Histogram);
         return RetrieveInfo(packageSize, response);
     }
 
+    // Method: startbenchmark - Start calling a JSON-RPC method of a plugin, or the COM-RPC loopback, from a number
+    //                           of threads, and time the calls
+    // Return codes:
+    //  - ERROR_NONE: Success
+    //  - ERROR_UNAVAILABLE: The target plugin is not active or has no JSON-RPC interface, or the loopback is not running
+    //  - ERROR_OPENING_FAILED: The shared memory could not be set up
+    //  - ERROR_INPROGRESS: A benchmark is already running
+    uint32_t PerformanceMonitor::endpoint_startbenchmark(const Benchmark::Settings& params)
+    {
+        uint32_t result = Core::ERROR_UNAVAILABLE;
+        string exportFile;
+
+        ASSERT(_service != nullptr);
+
+        if (params.Export.Value().empty() == false) {
+            exportFile = _service->VolatilePath() + Core::File::FileName(params.Export.Value());
+        }
+
+        if (params.Transport.Value() != Benchmark::JSONRPC) {
+            _adminLock.Lock();
+
+            if (_loopback != nullptr) {
+                result = _benchmark.Start(_loopback, params.Transport.Value(), _service->VolatilePath() + _T("benchmark.shm"), params, exportFile);
+            }
+
+            _adminLock.Unlock();
+        } else {
+            const string callsign(params.Callsign.IsSet() == true ? params.Callsign.Value() : _service->Callsign());
+            PluginHost::IDispatcher* target = _service->QueryInterfaceByCallsign<PluginHost::IDispatcher>(callsign);
+
+            if (target != nullptr) {
+                result = _benchmark.Start(target, callsign, params, exportFile);
+                target->Release();
+            }
+        }
+
+        return (result);
+    }
+
+    // Method: stopbenchmark - Stop the running benchmark, the calls done so far are reported
+    // Return codes:
+    //  - ERROR_NONE: Success
+    uint32_t PerformanceMonitor::endpoint_stopbenchmark()
+    {
+        _benchmark.Stop();
+        return Core::ERROR_NONE;
+    }
+
+    // Property: benchmark - Progress, or the latency percentiles per stage once completed, of the last benchmark
+    // Return codes:
+    //  - ERROR_NONE: Success
+    uint32_t PerformanceMonitor::get_benchmark(Benchmark::Report& response) const
+    {
+        _benchmark.Snapshot(response);
+        return Core::ERROR_NONE;
+    }
+
 } // namespace Plugin
 }
 
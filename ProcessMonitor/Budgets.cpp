@@ -0,0 +1,515 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Budgets.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace WPEFramework {
+
+ENUM_CONVERSION_BEGIN(Plugin::Budgets::action)
+
+    { Plugin::Budgets::action::NOTIFY, _TXT("notify") },
+    { Plugin::Budgets::action::RENICE, _TXT("renice") },
+    { Plugin::Budgets::action::THROTTLE, _TXT("throttle") },
+    { Plugin::Budgets::action::RESTART, _TXT("restart") },
+
+    ENUM_CONVERSION_END(Plugin::Budgets::action);
+
+namespace Plugin {
+
+    namespace {
+
+        bool ReadFile(const string& path, char buffer[], const uint32_t length)
+        {
+            bool result = false;
+            int descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+            if (descriptor != -1) {
+                ssize_t count = ::read(descriptor, buffer, length - 1);
+
+                if (count > 0) {
+                    buffer[count] = '\0';
+                    result = true;
+                }
+
+                ::close(descriptor);
+            }
+
+            return (result);
+        }
+
+        bool WriteFile(const string& path, const string& content)
+        {
+            bool result = false;
+            int descriptor = ::open(path.c_str(), O_WRONLY | O_CLOEXEC);
+
+            if (descriptor != -1) {
+                result = (::write(descriptor, content.c_str(), content.length()) == static_cast<ssize_t>(content.length()));
+                ::close(descriptor);
+            }
+
+            return (result);
+        }
+
+        string ProcPath(const uint32_t pid, const TCHAR file[])
+        {
+            return (_T("/proc/") + std::to_string(pid) + '/' + file);
+        }
+
+        const TCHAR* LevelName(const uint8_t level)
+        {
+            return (level == 0 ? _T("soft") : _T("hard"));
+        }
+
+    } // namespace
+
+    Budgets::Budgets()
+        : _adminLock()
+        , _service(nullptr)
+        , _settings()
+        , _processes()
+        , _restarting()
+        , _job(*this)
+        , _interval(0)
+        , _ticksPerSecond(static_cast<uint32_t>(::sysconf(_SC_CLK_TCK)))
+        , _pageSize(static_cast<uint32_t>(::sysconf(_SC_PAGESIZE)))
+    {
+    }
+
+    Budgets::~Budgets()
+    {
+        ASSERT(_service == nullptr);
+    }
+
+    void Budgets::Open(PluginHost::IShell* service, const Core::JSON::ArrayType<Budget>& budgets, const uint16_t interval)
+    {
+        ASSERT((service != nullptr) && (_service == nullptr));
+
+        _service = service;
+        _service->AddRef();
+        _interval = std::max(interval, static_cast<uint16_t>(1));
+
+        Core::JSON::ArrayType<Budget>::ConstIterator index(budgets.Elements());
+
+        while (index.Next() == true) {
+            const Budget& budget(index.Current());
+            Settings& settings(_settings[budget.Callsign.Value()]);
+
+            settings.CPU[SOFT] = budget.CPU.Soft.Value();
+            settings.CPU[HARD] = budget.CPU.Hard.Value();
+            settings.RSS[SOFT] = budget.RSS.Soft.Value();
+            settings.RSS[HARD] = budget.RSS.Hard.Value();
+            settings.FDs[SOFT] = budget.FDs.Soft.Value();
+            settings.FDs[HARD] = budget.FDs.Hard.Value();
+            settings.Action[SOFT] = budget.SoftAction.Value();
+            settings.Action[HARD] = budget.HardAction.Value();
+            settings.Grace = std::max(budget.Grace.Value(), static_cast<uint8_t>(1));
+            settings.Nice = budget.Nice.Value();
+            settings.Throttle = std::max(budget.Throttle.Value(), static_cast<uint8_t>(1));
+        }
+
+        if (_settings.empty() == false) {
+            _job.Schedule(Core::Time::Now().Add(_interval * 1000));
+        }
+    }
+
+    void Budgets::Close()
+    {
+        std::vector<Undo> undos;
+
+        _job.Revoke();
+
+        _adminLock.Lock();
+
+        // What was done to the processes is not to outlive the monitoring.
+        for (const std::pair<const uint32_t, Process>& entry : _processes) {
+            if ((entry.second.Reniced == true) || (entry.second.Throttled.empty() == false)) {
+                undos.push_back(Undo { entry.first, entry.second.Nice, entry.second.Reniced, entry.second.Throttled });
+            }
+        }
+
+        _processes.clear();
+        _restarting.clear();
+        _settings.clear();
+
+        _adminLock.Unlock();
+
+        for (const Undo& undo : undos) {
+            Recover(undo);
+        }
+
+        if (_service != nullptr) {
+            _service->Release();
+            _service = nullptr;
+        }
+    }
+
+    void Budgets::Add(const string& callsign, const uint32_t pid)
+    {
+        string throttled;
+
+        _adminLock.Lock();
+
+        if (_settings.find(callsign) != _settings.end()) {
+            Process& process(_processes[pid]);
+            uint64_t rss;
+
+            // A reused pid, the process that had it can have left a capped cgroup behind.
+            throttled = process.Throttled;
+
+            process.Callsign = callsign;
+            process.Start = 0;
+            process.Jiffies = 0;
+            process.Sampled = 0;
+            process.Over[SOFT] = process.Over[HARD] = 0;
+            process.Acted[SOFT] = process.Acted[HARD] = false;
+            process.Reniced = false;
+            process.Throttled.clear();
+
+            // -1 is a valid nice value, only errno tells it apart from a failure.
+            errno = 0;
+            process.Nice = ::getpriority(PRIO_PROCESS, static_cast<id_t>(pid));
+            if (errno != 0) {
+                process.Nice = 0;
+            }
+
+            // The first sample is the base for the CPU load of the next one.
+            if (Stat(pid, process.Start, process.Jiffies, rss) == true) {
+                process.Sampled = Core::Time::Now().Ticks();
+            } else {
+                _processes.erase(pid);
+            }
+        }
+
+        _adminLock.Unlock();
+
+        if (throttled.empty() == false) {
+            Recover(Undo { pid, 0, false, throttled });
+        }
+    }
+
+    void Budgets::Deactivated(PluginHost::IShell* plugin)
+    {
+        _adminLock.Lock();
+
+        const bool restart = (_restarting.erase(plugin->Callsign()) != 0);
+
+        _adminLock.Unlock();
+
+        if (restart == true) {
+            SYSLOG(Logging::Notification, (_T("ProcessMonitor restarting: [%s]"), plugin->Callsign().c_str()));
+            Core::IWorkerPool::Instance().Submit(PluginHost::IShell::Job::Create(plugin, PluginHost::IShell::ACTIVATED, PluginHost::IShell::REQUESTED));
+        }
+    }
+
+    void Budgets::Dispatch()
+    {
+        std::vector<Measure> measures;
+        std::vector<Undo> undos;
+        const uint64_t now = Core::Time::Now().Ticks();
+
+        _adminLock.Lock();
+
+        std::unordered_map<uint32_t, Process>::iterator index(_processes.begin());
+
+        while (index != _processes.end()) {
+            Usage usage;
+
+            if (Sample(index->first, index->second, now, usage) == false) {
+                // Gone, or the pid is in use by someone else by now. The cgroup can outlive the process.
+                if (index->second.Throttled.empty() == false) {
+                    undos.push_back(Undo { index->first, 0, false, index->second.Throttled });
+                }
+                index = _processes.erase(index);
+            } else {
+                Process& process(index->second);
+                const Settings& settings(_settings[process.Callsign]);
+                bool over[LEVELS];
+
+                for (uint8_t limit = SOFT; limit < LEVELS; limit++) {
+                    over[limit] = ((settings.CPU[limit] != 0) && (usage.CPU > settings.CPU[limit]))
+                        || ((settings.RSS[limit] != 0) && (usage.RSS > settings.RSS[limit]))
+                        || ((settings.FDs[limit] != 0) && (usage.FDs > settings.FDs[limit]));
+                }
+
+                // Over the hard limit is over the soft limit as well, even if that one was not set.
+                over[SOFT] = over[SOFT] || over[HARD];
+
+                for (uint8_t limit = SOFT; limit < LEVELS; limit++) {
+                    if (over[limit] == false) {
+                        process.Over[limit] = 0;
+                    } else if (process.Over[limit] < settings.Grace) {
+                        process.Over[limit]++;
+                    }
+                }
+
+                if (over[SOFT] == false) {
+                    process.Acted[SOFT] = false;
+                    process.Acted[HARD] = false;
+
+                    if ((process.Reniced == true) || (process.Throttled.empty() == false)) {
+                        undos.push_back(Undo { index->first, process.Nice, process.Reniced, process.Throttled });
+                        process.Reniced = false;
+                        process.Throttled.clear();
+                    }
+                }
+
+                // The hard action makes the soft one moot.
+                for (int8_t limit = HARD; limit >= SOFT; limit--) {
+                    if ((process.Over[limit] >= settings.Grace) && (process.Acted[limit] == false)) {
+                        process.Acted[limit] = true;
+                        measures.push_back(Measure { index->first, process.Start, process.Callsign, static_cast<level>(limit), usage, settings });
+                        break;
+                    }
+                }
+
+                index++;
+            }
+        }
+
+        _adminLock.Unlock();
+
+        for (const Undo& undo : undos) {
+            Recover(undo);
+        }
+
+        // Acting can take a while, and a restart comes back in here through the notifications.
+        for (const Measure& measure : measures) {
+            Act(measure);
+        }
+
+        _job.Schedule(Core::Time::Now().Add(_interval * 1000));
+    }
+
+    bool Budgets::Sample(const uint32_t pid, Process& process, const uint64_t now, Usage& usage) const
+    {
+        uint64_t start = 0;
+        uint64_t jiffies = 0;
+        uint64_t rss = 0;
+        bool result = ((Stat(pid, start, jiffies, rss) == true) && (start == process.Start));
+
+        if (result == true) {
+            const uint64_t elapsed = now - process.Sampled;
+
+            // Jiffies are in clock ticks, the time is in microseconds.
+            usage.CPU = (elapsed == 0 ? 0 : static_cast<uint32_t>(((jiffies - process.Jiffies) * 100 * 1000000) / (static_cast<uint64_t>(_ticksPerSecond) * elapsed)));
+            usage.RSS = static_cast<uint32_t>((rss * _pageSize) / 1024);
+            usage.FDs = Descriptors(pid);
+
+            process.Jiffies = jiffies;
+            process.Sampled = now;
+        }
+
+        return (result);
+    }
+
+    void Budgets::Act(const Measure& measure)
+    {
+        const action todo = measure.Limits.Action[measure.Level];
+        bool reniced = false;
+        string throttled;
+
+        SYSLOG(Logging::Notification, (_T("ProcessMonitor: [%s] (%d) over its %s budget, cpu %d%%, rss %d kB, fds %d"),
+            measure.Callsign.c_str(), measure.Pid, LevelName(measure.Level), measure.Current.CPU, measure.Current.RSS, measure.Current.FDs));
+
+        switch (todo) {
+        case RENICE:
+            reniced = Renice(measure.Pid, measure.Limits.Nice);
+            break;
+        case THROTTLE:
+            if (Throttle(measure, throttled) == false) {
+                TRACE_L1("No cgroup of its own for %s, reniced instead of throttled", measure.Callsign.c_str());
+                reniced = Renice(measure.Pid, measure.Limits.Nice);
+            }
+            break;
+        case RESTART:
+            Restart(measure);
+            break;
+        case NOTIFY:
+        default:
+            break;
+        }
+
+        if ((reniced == true) || (throttled.empty() == false)) {
+            _adminLock.Lock();
+
+            std::unordered_map<uint32_t, Process>::iterator index(_processes.find(measure.Pid));
+
+            // Remembered, to be undone once the process is back under its soft limits.
+            if ((index != _processes.end()) && (index->second.Start == measure.Start)) {
+                index->second.Reniced = index->second.Reniced || reniced;
+                if (throttled.empty() == false) {
+                    index->second.Throttled = throttled;
+                }
+            }
+
+            _adminLock.Unlock();
+        }
+    }
+
+    // Linux keeps a nice value per thread, all of them are set.
+    bool Budgets::Renice(const uint32_t pid, const int nice) const
+    {
+        DIR* directory = ::opendir(ProcPath(pid, _T("task")).c_str());
+
+        if (directory != nullptr) {
+            struct dirent* entry;
+
+            while ((entry = ::readdir(directory)) != nullptr) {
+                if (entry->d_name[0] != '.') {
+                    ::setpriority(PRIO_PROCESS, static_cast<id_t>(::atoi(entry->d_name)), nice);
+                }
+            }
+
+            ::closedir(directory);
+        }
+
+        return (directory != nullptr);
+    }
+
+    // Only if the process is alone in its cgroup, the cap should not hit others.
+    bool Budgets::Throttle(const Measure& measure, string& group) const
+    {
+        char buffer[1024];
+        bool result = false;
+
+        if (ReadFile(ProcPath(measure.Pid, _T("cgroup")), buffer, sizeof(buffer)) == true) {
+            const char* line = ::strstr(buffer, "0::");
+
+            if ((line != nullptr) && ((line == buffer) || (line[-1] == '\n'))) {
+                const char* end = ::strchr(line, '\n');
+                const string path(line + 3, (end != nullptr ? end - (line + 3) : ::strlen(line + 3)));
+
+                group = _T("/sys/fs/cgroup") + path;
+
+                if ((path != _T("/")) && (ReadFile(group + _T("/cgroup.procs"), buffer, sizeof(buffer)) == true)) {
+                    char* next = nullptr;
+                    const uint32_t pid = static_cast<uint32_t>(::strtoul(buffer, &next, 10));
+
+                    // Nothing but white space after the one pid.
+                    while ((*next == '\n') || (*next == ' ')) {
+                        next++;
+                    }
+
+                    if ((pid == measure.Pid) && (*next == '\0')) {
+                        const uint32_t period = 100000;
+                        const uint32_t quota = (period / 100) * measure.Limits.Throttle;
+
+                        result = WriteFile(group + _T("/cpu.max"), std::to_string(quota) + ' ' + std::to_string(period));
+                    }
+                }
+            }
+        }
+
+        if (result == false) {
+            group.clear();
+        }
+
+        return (result);
+    }
+
+    void Budgets::Recover(const Undo& undo) const
+    {
+        if (undo.Renice == true) {
+            Renice(undo.Pid, undo.Nice);
+        }
+        if ((undo.Group.empty() == false) && (WriteFile(undo.Group + _T("/cpu.max"), _T("max 100000")) == false)) {
+            TRACE_L1("Could not lift the CPU cap of %s", undo.Group.c_str());
+        }
+    }
+
+    void Budgets::Restart(const Measure& measure)
+    {
+        PluginHost::IShell* plugin = _service->QueryInterfaceByCallsign<PluginHost::IShell>(measure.Callsign);
+
+        if (plugin != nullptr) {
+            _adminLock.Lock();
+            _restarting.insert(measure.Callsign);
+            _adminLock.Unlock();
+
+            Core::IWorkerPool::Instance().Submit(PluginHost::IShell::Job::Create(plugin, PluginHost::IShell::DEACTIVATED, PluginHost::IShell::FAILURE));
+
+            plugin->Release();
+        }
+    }
+
+    // Start time (field 22), utime + stime (14 and 15) and the resident set in pages (24) from stat.
+    /* static */ bool Budgets::Stat(const uint32_t pid, uint64_t& start, uint64_t& jiffies, uint64_t& rss)
+    {
+        char buffer[1024];
+        bool result = false;
+
+        if (ReadFile(ProcPath(pid, _T("stat")), buffer, sizeof(buffer)) == true) {
+            // The name, between parentheses, can hold anything, start counting fields after it.
+            const char* position = ::strrchr(buffer, ')');
+
+            if (position != nullptr) {
+                uint64_t fields[25];
+                uint8_t field = 3;
+
+                // Field 3 is the state, a character, the rest up to 24 are numbers.
+                position = ::strchr(position + 2, ' ');
+
+                while ((position != nullptr) && (field < 24)) {
+                    char* end = nullptr;
+
+                    field++;
+                    fields[field] = ::strtoull(position + 1, &end, 10);
+                    position = (end != (position + 1) ? end : nullptr);
+                }
+
+                if (field == 24) {
+                    start = fields[22];
+                    jiffies = fields[14] + fields[15];
+                    rss = fields[24];
+                    result = true;
+                }
+            }
+        }
+
+        return (result);
+    }
+
+    /* static */ uint32_t Budgets::Descriptors(const uint32_t pid)
+    {
+        uint32_t result = 0;
+        DIR* directory = ::opendir(ProcPath(pid, _T("fd")).c_str());
+
+        if (directory != nullptr) {
+            struct dirent* entry;
+
+            while ((entry = ::readdir(directory)) != nullptr) {
+                if (entry->d_name[0] != '.') {
+                    result++;
+                }
+            }
+
+            ::closedir(directory);
+        }
+
+        return (result);
+    }
+
+} // namespace Plugin
+} // namespace WPEFramework
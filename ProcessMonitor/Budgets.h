@@ -0,0 +1,228 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Module.h"
+
+#include <unordered_map>
+#include <unordered_set>
+
+namespace WPEFramework {
+namespace Plugin {
+
+    // Resource budgets of the out of process plugin hosts. Every interval the CPU load (in percent of one
+    // core), the resident set (in kB) and the number of open file descriptors of the hosts of the plugins
+    // that have a budget are sampled. Going over a soft or a hard limit for "grace" intervals in a row
+    // triggers the action configured for that level, once, until the process is back under its soft limits.
+    // Once it is, a renice or a throttle is undone.
+    class Budgets {
+    public:
+        enum action {
+            NOTIFY, // log it
+            RENICE, // lower the priority of all threads of the process to "nice"
+            THROTTLE, // cap the CPU of the cgroup (v2) of the process to "throttle" percent of a core
+            RESTART // deactivate the plugin and activate it again
+        };
+
+        class Limit : public Core::JSON::Container {
+        public:
+            Limit& operator=(const Limit&) = delete;
+
+            Limit()
+                : Core::JSON::Container()
+                , Soft(0)
+                , Hard(0)
+            {
+                Add(_T("soft"), &Soft);
+                Add(_T("hard"), &Hard);
+            }
+            Limit(const Limit& copy)
+                : Core::JSON::Container()
+                , Soft(copy.Soft)
+                , Hard(copy.Hard)
+            {
+                Add(_T("soft"), &Soft);
+                Add(_T("hard"), &Hard);
+            }
+            ~Limit() override
+            {
+            }
+
+        public:
+            // 0 is no limit.
+            Core::JSON::DecUInt32 Soft;
+            Core::JSON::DecUInt32 Hard;
+        };
+
+        class Budget : public Core::JSON::Container {
+        public:
+            Budget& operator=(const Budget&) = delete;
+
+            Budget()
+                : Core::JSON::Container()
+                , Callsign()
+                , CPU()
+                , RSS()
+                , FDs()
+                , SoftAction(NOTIFY)
+                , HardAction(RESTART)
+                , Grace(1)
+                , Nice(10)
+                , Throttle(50)
+            {
+                Init();
+            }
+            Budget(const Budget& copy)
+                : Core::JSON::Container()
+                , Callsign(copy.Callsign)
+                , CPU(copy.CPU)
+                , RSS(copy.RSS)
+                , FDs(copy.FDs)
+                , SoftAction(copy.SoftAction)
+                , HardAction(copy.HardAction)
+                , Grace(copy.Grace)
+                , Nice(copy.Nice)
+                , Throttle(copy.Throttle)
+            {
+                Init();
+            }
+            ~Budget() override
+            {
+            }
+
+        private:
+            void Init()
+            {
+                Add(_T("callsign"), &Callsign);
+                Add(_T("cpu"), &CPU);
+                Add(_T("rss"), &RSS);
+                Add(_T("fds"), &FDs);
+                Add(_T("softaction"), &SoftAction);
+                Add(_T("hardaction"), &HardAction);
+                Add(_T("grace"), &Grace);
+                Add(_T("nice"), &Nice);
+                Add(_T("throttle"), &Throttle);
+            }
+
+        public:
+            Core::JSON::String Callsign;
+            Limit CPU;
+            Limit RSS;
+            Limit FDs;
+            Core::JSON::EnumType<action> SoftAction;
+            Core::JSON::EnumType<action> HardAction;
+            Core::JSON::DecUInt8 Grace;
+            Core::JSON::DecSInt8 Nice;
+            Core::JSON::DecUInt8 Throttle;
+        };
+
+    private:
+        enum level : uint8_t {
+            SOFT,
+            HARD,
+            LEVELS
+        };
+
+        struct Settings {
+            uint32_t CPU[LEVELS];
+            uint32_t RSS[LEVELS];
+            uint32_t FDs[LEVELS];
+            action Action[LEVELS];
+            uint8_t Grace;
+            int8_t Nice;
+            uint8_t Throttle;
+        };
+
+        struct Usage {
+            uint32_t CPU;
+            uint32_t RSS;
+            uint32_t FDs;
+        };
+
+        struct Process {
+            string Callsign;
+            uint64_t Start; // clock ticks since boot, tells a reused pid apart
+            uint64_t Jiffies;
+            uint64_t Sampled;
+            uint8_t Over[LEVELS];
+            bool Acted[LEVELS];
+            int Nice; // of the process when it was added, what a renice is undone to
+            bool Reniced;
+            string Throttled; // cgroup of which the CPU is capped, empty if none
+        };
+
+        struct Measure {
+            uint32_t Pid;
+            uint64_t Start;
+            string Callsign;
+            level Level;
+            Usage Current;
+            Settings Limits;
+        };
+
+        struct Undo {
+            uint32_t Pid;
+            int Nice;
+            bool Renice;
+            string Group;
+        };
+
+    public:
+        Budgets(const Budgets&) = delete;
+        Budgets& operator=(const Budgets&) = delete;
+
+        Budgets();
+        ~Budgets();
+
+    public:
+        void Open(PluginHost::IShell* service, const Core::JSON::ArrayType<Budget>& budgets, const uint16_t interval);
+        void Close();
+
+        void Add(const string& callsign, const uint32_t pid);
+        // A plugin that was deactivated to be restarted, is activated again.
+        void Deactivated(PluginHost::IShell* plugin);
+
+        void Dispatch();
+
+    private:
+        bool Sample(const uint32_t pid, Process& process, const uint64_t now, Usage& usage) const;
+        void Act(const Measure& measure);
+        bool Renice(const uint32_t pid, const int nice) const;
+        bool Throttle(const Measure& measure, string& group) const;
+        void Restart(const Measure& measure);
+        void Recover(const Undo& undo) const;
+
+        static bool Stat(const uint32_t pid, uint64_t& start, uint64_t& jiffies, uint64_t& rss);
+        static uint32_t Descriptors(const uint32_t pid);
+
+    private:
+        Core::CriticalSection _adminLock;
+        PluginHost::IShell* _service;
+        std::unordered_map<string, Settings> _settings;
+        std::unordered_map<uint32_t, Process> _processes;
+        std::unordered_set<string> _restarting;
+        Core::WorkerPool::JobType<Budgets&> _job;
+        uint32_t _interval;
+        uint32_t _ticksPerSecond;
+        uint32_t _pageSize;
+    };
+
+} // namespace Plugin
+} // namespace WPEFramework
@@ -0,0 +1,441 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ExitWatcher.h"
+
+#include <fcntl.h>
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Not in the headers of older toolchains, the numbers are the same on all architectures.
+#ifndef __NR_pidfd_open
+#define __NR_pidfd_open 434
+#endif
+#ifndef __NR_pidfd_send_signal
+#define __NR_pidfd_send_signal 424
+#endif
+
+namespace WPEFramework {
+namespace Plugin {
+
+    namespace {
+
+        // Process ids fit in 32 bits, the other things epoll watches are tagged above that.
+        constexpr uint64_t EventTag = (1ULL << 32);
+        constexpr uint64_t ConnectorTag = (2ULL << 32);
+
+        int PidOpen(const uint32_t pid)
+        {
+            return (static_cast<int>(::syscall(__NR_pidfd_open, static_cast<pid_t>(pid), 0)));
+        }
+
+        // Start time (field 22 of stat) of the process, in clock ticks after boot. With the pid it tells a process
+        // from the one that got the same pid later on. 0 if the process is not there.
+        uint64_t StartTime(const uint32_t pid)
+        {
+            uint64_t result = 0;
+            char buffer[1024];
+            int descriptor = ::open((_T("/proc/") + std::to_string(pid) + _T("/stat")).c_str(), O_RDONLY | O_CLOEXEC);
+
+            if (descriptor != -1) {
+                const ssize_t count = ::read(descriptor, buffer, sizeof(buffer) - 1);
+
+                ::close(descriptor);
+
+                if (count > 0) {
+                    buffer[count] = '\0';
+
+                    // The name, between parentheses, can hold anything, start counting fields after it.
+                    const char* position = ::strrchr(buffer, ')');
+                    uint8_t field = 2;
+
+                    while ((position != nullptr) && (field < 22)) {
+                        position = ::strchr(position + 1, ' ');
+                        field++;
+                    }
+
+                    if (position != nullptr) {
+                        result = ::strtoull(position + 1, nullptr, 10);
+                    }
+                }
+            }
+
+            return (result);
+        }
+
+        bool Watch(const int epoll, const int descriptor, const uint64_t tag)
+        {
+            struct epoll_event event;
+
+            event.events = EPOLLIN;
+            event.data.u64 = tag;
+
+            return (::epoll_ctl(epoll, EPOLL_CTL_ADD, descriptor, &event) == 0);
+        }
+
+        // Subscribes to the process events of the proc connector, -1 if that is not allowed.
+        int ConnectorOpen()
+        {
+            int descriptor = ::socket(PF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_CONNECTOR);
+
+            if (descriptor != -1) {
+                struct sockaddr_nl address;
+                char buffer[NLMSG_SPACE(sizeof(struct cn_msg) + sizeof(enum proc_cn_mcast_op))];
+                struct nlmsghdr* header = reinterpret_cast<struct nlmsghdr*>(buffer);
+                struct cn_msg* message = static_cast<struct cn_msg*>(NLMSG_DATA(header));
+                const enum proc_cn_mcast_op operation = PROC_CN_MCAST_LISTEN;
+
+                ::memset(&address, 0, sizeof(address));
+                address.nl_family = AF_NETLINK;
+                address.nl_groups = CN_IDX_PROC;
+
+                ::memset(buffer, 0, sizeof(buffer));
+                header->nlmsg_len = NLMSG_LENGTH(sizeof(struct cn_msg) + sizeof(operation));
+                header->nlmsg_type = NLMSG_DONE;
+                header->nlmsg_pid = ::getpid();
+                message->id.idx = CN_IDX_PROC;
+                message->id.val = CN_VAL_PROC;
+                message->len = sizeof(operation);
+                ::memcpy(message->data, &operation, sizeof(operation));
+
+                if ((::bind(descriptor, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0) || (::send(descriptor, header, header->nlmsg_len, 0) != static_cast<ssize_t>(header->nlmsg_len))) {
+                    ::close(descriptor);
+                    descriptor = -1;
+                }
+            }
+
+            return (descriptor);
+        }
+
+    } // namespace
+
+    ExitWatcher::ExitWatcher()
+        : Core::Thread(0, _T("ProcessMonitor"))
+        , _adminLock()
+        , _entries()
+        , _wheel(Resolution, Slots)
+        , _source(NONE)
+        , _epoll(-1)
+        , _event(-1)
+        , _connector(-1)
+    {
+    }
+
+    ExitWatcher::~ExitWatcher()
+    {
+        ASSERT(_epoll == -1);
+
+        Stop();
+        Wait(Core::Thread::BLOCKED | Core::Thread::STOPPED, Core::infinite);
+    }
+
+    uint32_t ExitWatcher::Open()
+    {
+        ASSERT(_epoll == -1);
+
+        uint32_t result = Core::ERROR_OPENING_FAILED;
+
+        _epoll = ::epoll_create1(EPOLL_CLOEXEC);
+        _event = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+        if ((_epoll != -1) && (_event != -1) && (Watch(_epoll, _event, EventTag) == true)) {
+            int probe = PidOpen(::getpid());
+
+            if (probe != -1) {
+                ::close(probe);
+                _source = PIDFD;
+            } else {
+                _connector = ConnectorOpen();
+
+                if ((_connector != -1) && (Watch(_epoll, _connector, ConnectorTag) == true)) {
+                    _source = CONNECTOR;
+                } else {
+                    TRACE_L1("No pidfd and no proc connector, process exits are only seen at their deadline");
+                }
+            }
+
+            result = Core::ERROR_NONE;
+
+            Run();
+        }
+
+        return (result);
+    }
+
+    void ExitWatcher::Close()
+    {
+        if (_epoll != -1) {
+            Block();
+            Wake();
+            Wait(Core::Thread::BLOCKED | Core::Thread::STOPPED, Core::infinite);
+        }
+
+        _adminLock.Lock();
+
+        Entries::iterator index(_entries.begin());
+        while (index != _entries.end()) {
+            Forget(index);
+        }
+
+        _adminLock.Unlock();
+
+        if (_connector != -1) {
+            ::close(_connector);
+            _connector = -1;
+        }
+        if (_event != -1) {
+            ::close(_event);
+            _event = -1;
+        }
+        if (_epoll != -1) {
+            ::close(_epoll);
+            _epoll = -1;
+        }
+
+        _source = NONE;
+    }
+
+    void ExitWatcher::Add(const string& callsign, const uint32_t pid)
+    {
+        int descriptor = -1;
+
+        if (_source == PIDFD) {
+            descriptor = PidOpen(pid);
+
+            if (descriptor == -1) {
+                TRACE_L1("Process %d of %s is already gone", pid, callsign.c_str());
+                return;
+            }
+        }
+
+        const uint64_t started = StartTime(pid);
+
+        _adminLock.Lock();
+
+        Entries::iterator index(_entries.find(pid));
+
+        // A pid that is reused before the exit was seen, the old entry is stale.
+        if (index != _entries.end()) {
+            Forget(index);
+        }
+
+        // Without an exit source a process is never forgotten on its own. A plugin has one host at a time, so
+        // the ones that came before are gone, and must not be killed once their pid is reused.
+        if (_source == NONE) {
+            index = _entries.begin();
+
+            while (index != _entries.end()) {
+                if (index->second.Callsign == callsign) {
+                    Forget(index);
+                } else {
+                    index++;
+                }
+            }
+        }
+
+        _entries.emplace(pid, Entry { callsign, descriptor, 0, started });
+
+        // Still under the lock, so an exit that is reported right away finds the entry.
+        if ((descriptor != -1) && (Watch(_epoll, descriptor, pid) == false)) {
+            TRACE_L1("Could not watch process %d of %s", pid, callsign.c_str());
+        }
+
+        _adminLock.Unlock();
+    }
+
+    void ExitWatcher::Deadline(const string& callsign, const uint64_t deadline)
+    {
+        bool armed = false;
+
+        _adminLock.Lock();
+
+        for (std::pair<const uint32_t, Entry>& entry : _entries) {
+            if (entry.second.Callsign == callsign) {
+                if (entry.second.Deadline != 0) {
+                    _wheel.Remove(entry.first, entry.second.Deadline);
+                }
+
+                entry.second.Deadline = deadline;
+                _wheel.Insert(entry.first, deadline);
+                armed = true;
+            }
+        }
+
+        _adminLock.Unlock();
+
+        if (armed == true) {
+            Wake();
+        }
+    }
+
+    /* virtual */ uint32_t ExitWatcher::Worker()
+    {
+        struct epoll_event events[16];
+        uint64_t deadline = 0;
+        int timeout = -1;
+
+        _adminLock.Lock();
+
+        if (_wheel.Next(deadline) == true) {
+            const uint64_t now = Core::Time::Now().Ticks();
+
+            // Rounded up, waking up early would only mean another round.
+            timeout = (deadline <= now ? 0 : static_cast<int>(std::min(static_cast<uint64_t>(INT32_MAX), (deadline - now + 999) / 1000)));
+        }
+
+        _adminLock.Unlock();
+
+        const int count = ::epoll_wait(_epoll, events, (sizeof(events) / sizeof(events[0])), timeout);
+
+        for (int index = 0; index < count; index++) {
+            const uint64_t tag = events[index].data.u64;
+
+            if (tag == EventTag) {
+                uint64_t value;
+                ssize_t VARIABLE_IS_NOT_USED size = ::read(_event, &value, sizeof(value));
+            } else if (tag == ConnectorTag) {
+                Connector();
+            } else {
+                Exited(static_cast<uint32_t>(tag));
+            }
+        }
+
+        Expire();
+
+        return (0);
+    }
+
+    void ExitWatcher::Exited(const uint32_t pid)
+    {
+        _adminLock.Lock();
+
+        Entries::iterator index(_entries.find(pid));
+
+        if (index != _entries.end()) {
+            TRACE_L1("Process %d of %s exited", pid, index->second.Callsign.c_str());
+            Forget(index);
+        }
+
+        _adminLock.Unlock();
+    }
+
+    void ExitWatcher::Expire()
+    {
+        struct Victim {
+            uint32_t Pid;
+            int Descriptor;
+            uint64_t Started;
+            string Callsign;
+        };
+
+        std::vector<uint32_t> expired;
+        std::vector<Victim> victims;
+
+        _adminLock.Lock();
+
+        _wheel.Expire(Core::Time::Now().Ticks(), expired);
+
+        for (const uint32_t pid : expired) {
+            Entries::iterator index(_entries.find(pid));
+
+            if (index != _entries.end()) {
+                // The pidfd goes with it, it is closed once the kill is done.
+                victims.push_back(Victim { pid, index->second.Descriptor, index->second.Started, index->second.Callsign });
+                _entries.erase(index);
+            }
+        }
+
+        _adminLock.Unlock();
+
+        // Without the lock, a kill can take a while and new processes can come and go meanwhile.
+        for (const Victim& victim : victims) {
+            bool killed = false;
+
+            if (victim.Descriptor != -1) {
+                // Through the pidfd the signal can not end up at a process that reused the pid.
+                killed = (::syscall(__NR_pidfd_send_signal, victim.Descriptor, SIGKILL, nullptr, 0) == 0);
+                ::close(victim.Descriptor);
+            } else {
+                Core::Process process(victim.Pid);
+
+                // Only if the pid is still held by the process that was added, not by one that reused it.
+                if ((process.IsActive() == true) && (victim.Started != 0) && (StartTime(victim.Pid) == victim.Started)) {
+                    process.Kill(true);
+                    killed = true;
+                }
+            }
+
+            if (killed == true) {
+                SYSLOG(Logging::Notification, (_T("ProcessMonitor killed: [%s]!"), victim.Callsign.c_str()));
+            }
+        }
+    }
+
+    void ExitWatcher::Connector()
+    {
+        uint8_t buffer[4096] __attribute__((aligned(NLMSG_ALIGNTO)));
+        ssize_t length;
+
+        while ((length = ::recv(_connector, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0) {
+            struct nlmsghdr* header = reinterpret_cast<struct nlmsghdr*>(buffer);
+
+            for (; NLMSG_OK(header, static_cast<uint32_t>(length)); header = NLMSG_NEXT(header, length)) {
+                if ((header->nlmsg_type == NLMSG_ERROR) || (header->nlmsg_type == NLMSG_NOOP)) {
+                    continue;
+                }
+
+                const struct cn_msg* message = static_cast<const struct cn_msg*>(NLMSG_DATA(header));
+                const struct proc_event* event = reinterpret_cast<const struct proc_event*>(message->data);
+
+                // Only the exit of the process itself, not of one of its threads.
+                if ((event->what == proc_event::PROC_EVENT_EXIT) && (event->event_data.exit.process_pid == event->event_data.exit.process_tgid)) {
+                    Exited(static_cast<uint32_t>(event->event_data.exit.process_pid));
+                }
+            }
+        }
+    }
+
+    void ExitWatcher::Wake()
+    {
+        const uint64_t value = 1;
+        ssize_t VARIABLE_IS_NOT_USED size = ::write(_event, &value, sizeof(value));
+    }
+
+    // Lock held by the caller, moves the iterator on.
+    void ExitWatcher::Forget(Entries::iterator& index)
+    {
+        if (index->second.Deadline != 0) {
+            _wheel.Remove(index->first, index->second.Deadline);
+        }
+        if (index->second.Descriptor != -1) {
+            ::close(index->second.Descriptor);
+        }
+
+        index = _entries.erase(index);
+    }
+
+} // namespace Plugin
+} // namespace WPEFramework
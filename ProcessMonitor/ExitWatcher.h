@@ -0,0 +1,98 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Module.h"
+#include "TimerWheel.h"
+
+#include <unordered_map>
+
+namespace WPEFramework {
+namespace Plugin {
+
+    // Keeps track of the out of process hosts of the plugins, and kills the ones that are still there when
+    // their deadline passes. The exit of a process is reported by the kernel, through a pidfd (Linux 5.3 and
+    // up) that becomes readable, or else through the exit events of the proc connector (needs CAP_NET_ADMIN).
+    // A process is forgotten the moment it is gone, so there is nothing to poll. The deadlines are kept in
+    // a timer wheel, the thread sleeps in epoll until the first one, or until an exit or a new deadline.
+    // If neither exit source is there, a process is only looked at when its deadline passes, as before.
+    class ExitWatcher : public Core::Thread {
+    private:
+        struct Entry {
+            string Callsign;
+            int Descriptor; // pidfd, -1 if there is none
+            uint64_t Deadline; // 0 as long as the plugin is not deactivating
+            uint64_t Started; // start time (field 22 of /proc/<pid>/stat) of the process, 0 if unknown
+        };
+
+        typedef std::unordered_map<uint32_t, Entry> Entries;
+
+        // Slots of 10ms, a rotation covers the default exit timeout.
+        static constexpr uint32_t Resolution = 10 * 1000;
+        static constexpr uint16_t Slots = 256;
+
+    public:
+        enum source {
+            NONE,
+            PIDFD,
+            CONNECTOR
+        };
+
+    public:
+        ExitWatcher(const ExitWatcher&) = delete;
+        ExitWatcher& operator=(const ExitWatcher&) = delete;
+
+        ExitWatcher();
+        ~ExitWatcher() override;
+
+    public:
+        inline source Source() const
+        {
+            return (_source);
+        }
+
+        uint32_t Open();
+        void Close();
+
+        void Add(const string& callsign, const uint32_t pid);
+        // Kill whatever is still running for this callsign at the deadline (in Core::Time ticks).
+        void Deadline(const string& callsign, const uint64_t deadline);
+
+    private:
+        uint32_t Worker() override;
+
+        void Exited(const uint32_t pid);
+        void Expire();
+        void Connector();
+        void Wake();
+        void Forget(Entries::iterator& index);
+
+    private:
+        Core::CriticalSection _adminLock;
+        Entries _entries;
+        TimerWheel<uint32_t> _wheel;
+        source _source;
+        int _epoll;
+        int _event;
+        int _connector;
+    };
+
+} // namespace Plugin
+} // namespace WPEFramework
@@ -29,7 +29,7 @@ const string ProcessMonitor::Initialize(PluginHost::IShell* service)
     Config config;
     config.FromString(service->ConfigLine());
 
-    _notification.Open(service, config.ExitTimeout.Value());
+    _notification.Open(service, config);
 
     return (_T(""));
 }
@@ -21,6 +21,8 @@
 #define __PROCESS_MONITOR_H
 
 #include "Module.h"
+#include "Budgets.h"
+#include "ExitWatcher.h"
 
 #include <string>
 #include <syslog.h>
@@ -43,15 +45,20 @@ public:
 
     public:
         Config()
-            : Core::JSON::Container(), ExitTimeout()
+            : Core::JSON::Container(), ExitTimeout(), BudgetInterval(5), Budgets()
         {
             Add(_T("exittimeout"), &ExitTimeout);
+            Add(_T("budgetinterval"), &BudgetInterval);
+            Add(_T("budgets"), &Budgets);
         }
         ~Config() override
         {
         }
     public:
         Core::JSON::DecUInt32 ExitTimeout;
+        // Seconds between samples of the processes that have a budget.
+        Core::JSON::DecUInt16 BudgetInterval;
+        Core::JSON::ArrayType<Plugin::Budgets::Budget> Budgets;
     };
 
     class Notification: public PluginHost::IPlugin::INotification,
@@ -62,49 +69,10 @@ public:
         Notification(const Notification&) = delete;
         Notification& operator=(const Notification&) = delete;
 
-        using Job = Core::WorkerPool::JobType<Notification&>;
-
-        class ProcessObject
-        {
-        public:
-            ProcessObject() = delete;
-            ProcessObject(const ProcessObject&) = default;
-            ProcessObject& operator=(const ProcessObject&) = default;
-
-        public:
-            ProcessObject(
-                const uint32_t processId)
-                : _processId(processId)
-                , _exitTime(0)
-            {
-                ASSERT(_processId != 0);
-            }
-            ~ProcessObject()
-            {
-            }
-            uint32_t ProcessId()
-            {
-                return _processId;
-            }
-            void SetExitTime(const uint64_t exitTime)
-            {
-                _exitTime = exitTime;
-            }
-            uint64_t ExitTime()
-            {
-                return _exitTime;
-            }
-
-        private:
-            const uint32_t _processId;
-            uint64_t _exitTime;
-        };
-
     public:
         Notification(ProcessMonitor* parent)
-            : _adminLock()
-            , _processMap()
-            , _job(*this)
+            : _watcher()
+            , _budgets()
             , _service(nullptr)
             , _parent(*parent)
             ,_exittimeout(10000000)
@@ -117,15 +85,21 @@ public:
         }
 
     public:
-        inline void Open(PluginHost::IShell* service, const uint32_t exittimeout)
+        inline void Open(PluginHost::IShell* service, const Config& config)
         {
             ASSERT((service != nullptr) && (_service == nullptr));
             
-            _exittimeout = exittimeout * 1000 * 1000; // microseconds
+            _exittimeout = config.ExitTimeout.Value() * 1000 * 1000; // microseconds
 
             _service = service;
             _service->AddRef();
 
+            if (_watcher.Open() != Core::ERROR_NONE) {
+                SYSLOG(Logging::Notification, (_T("ProcessMonitor could not start watching processes")));
+            }
+
+            _budgets.Open(service, config.Budgets, config.BudgetInterval.Value());
+
             _service->Register(static_cast<IPlugin::INotification*>(this));
             _service->Register(
                     static_cast<RPC::IRemoteConnection::INotification*>(this));
@@ -141,87 +115,22 @@ public:
             _service->Release();
             _service = nullptr;
 
-            _job.Revoke();
-
-            _processMap.clear();
+            _watcher.Close();
+            _budgets.Close();
         }
         void StateChange(PluginHost::IShell* service) override
         {
             PluginHost::IShell::state currentState(service->State());
             if (currentState == PluginHost::IShell::DEACTIVATION) {
-
-                uint64_t exitTime = 0;
-
-                _adminLock.Lock();
-
-                std::unordered_map<string, ProcessObject>::iterator itr(
-                        _processMap.find(service->Callsign()));
-                if (itr != _processMap.end()) {
-                    exitTime = Core::Time::Now().Ticks() + _exittimeout;
-                    itr->second.SetExitTime(exitTime);
-                }
-
-                if (exitTime != 0) {
-                    ScheduleJob();
-                }
-
-                _adminLock.Unlock();
+                _watcher.Deadline(service->Callsign(), Core::Time::Now().Ticks() + _exittimeout);
+            } else if (currentState == PluginHost::IShell::DEACTIVATED) {
+                _budgets.Deactivated(service);
             }
         }
         void AddProcess(const string callsign, const uint32_t processId)
         {
-            _adminLock.Lock();
-
-            _processMap.emplace(callsign, ProcessObject(processId));
-
-            _adminLock.Unlock();
-        }
-        void Dispatch()
-        {
-            uint64_t currTime(Core::Time::Now().Ticks());
-
-            _adminLock.Lock();
-
-            auto itr = _processMap.begin();
-            while (itr != _processMap.end()) {
-
-                uint64_t exitTime = itr->second.ExitTime();
-                if ((exitTime != 0) && (exitTime <= currTime)) {
-                    Core::Process proc(itr->second.ProcessId());
-                    if (proc.IsActive()) {
-                        proc.Kill(true);
-                        SYSLOG(Logging::Notification,
-                                (_T("ProcessMonitor killed: [%s]!"),
-                                        itr->first.c_str()));
-                    }
-                    itr = _processMap.erase(itr);
-                }
-                else {
-                    itr++;
-                }
-            }
-
-            ScheduleJob();
-
-            _adminLock.Unlock();
-        }
-        void ScheduleJob()
-        {
-            uint64_t scheduleTime = 0;
-
-            for (auto itr : _processMap) {
-                uint64_t exitTime = itr.second.ExitTime();
-                if (exitTime != 0) {
-                    if ((scheduleTime == 0) || (scheduleTime > exitTime)) {
-                        scheduleTime = exitTime;
-                    }
-                }
-            }
-
-            if (scheduleTime != 0) {
-                _job.Revoke();
-                _job.Schedule(scheduleTime);
-            }
+            _watcher.Add(callsign, processId);
+            _budgets.Add(callsign, processId);
         }
         void Activated(RPC::IRemoteConnection* connection) override
         {
@@ -242,9 +151,8 @@ public:
         END_INTERFACE_MAP
 
     private:
-        Core::CriticalSection _adminLock;
-        std::unordered_map<string, ProcessObject> _processMap;
-        Job  _job;
+        ExitWatcher _watcher;
+        Budgets _budgets;
         PluginHost::IShell* _service;
         ProcessMonitor& _parent;
         uint32_t _exittimeout;
@@ -0,0 +1,172 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Module.h"
+
+#include <vector>
+
+namespace WPEFramework {
+namespace Plugin {
+
+    // Hashed timer wheel. A deadline (in Core::Time ticks) lands in the slot of its tick, deadlines that are
+    // more than a rotation away share the slot with nearer ones and are passed over until their round comes.
+    // Inserting and removing only touch one slot, expiring only the slots that passed since the last time.
+    // Not thread safe, the owner serializes.
+    template <typename KEY>
+    class TimerWheel {
+    private:
+        struct Timer {
+            uint64_t Deadline;
+            KEY Key;
+        };
+
+        typedef std::vector<Timer> Slot;
+
+    public:
+        TimerWheel() = delete;
+        TimerWheel(const TimerWheel&) = delete;
+        TimerWheel& operator=(const TimerWheel&) = delete;
+
+        TimerWheel(const uint32_t resolution, const uint16_t slots)
+            : _slots(slots)
+            , _resolution(resolution)
+            , _tick(Core::Time::Now().Ticks() / resolution)
+            , _count(0)
+        {
+            ASSERT((resolution != 0) && (slots != 0));
+        }
+        ~TimerWheel()
+        {
+        }
+
+    public:
+        inline bool IsEmpty() const
+        {
+            return (_count == 0);
+        }
+        void Insert(const KEY& key, const uint64_t deadline)
+        {
+            // Deadlines that already passed go in the current slot, they are up on the next Expire.
+            _slots[Index(std::max(deadline / _resolution, _tick))].push_back(Timer { deadline, key });
+            _count++;
+        }
+        bool Remove(const KEY& key, const uint64_t deadline)
+        {
+            bool result = Remove(_slots[Index(deadline / _resolution)], key);
+
+            for (uint32_t index = 0; (result == false) && (index < _slots.size()); index++) {
+                result = Remove(_slots[index], key);
+            }
+
+            return (result);
+        }
+        // Takes out all timers with a deadline at or before now.
+        void Expire(const uint64_t now, std::vector<KEY>& expired)
+        {
+            const uint64_t tick = now / _resolution;
+
+            if (_count != 0) {
+                const uint64_t last = std::min(tick, _tick + _slots.size() - 1);
+
+                for (uint64_t current = _tick; current <= last; current++) {
+                    Slot& slot(_slots[Index(current)]);
+                    typename Slot::iterator index(slot.begin());
+
+                    while (index != slot.end()) {
+                        if (index->Deadline <= now) {
+                            expired.push_back(index->Key);
+                            index = slot.erase(index);
+                            _count--;
+                        } else {
+                            index++;
+                        }
+                    }
+                }
+            }
+
+            // The current tick is seen again next time, it can still hold deadlines later in the tick.
+            _tick = std::max(_tick, tick);
+        }
+        // The earliest deadline, false if there is none.
+        bool Next(uint64_t& deadline) const
+        {
+            bool result = false;
+
+            if (_count != 0) {
+                // Walk one rotation, the first slot that has a timer due in this round holds the earliest.
+                for (uint32_t offset = 0; (result == false) && (offset < _slots.size()); offset++) {
+                    const uint64_t tick = _tick + offset;
+
+                    for (const Timer& timer : _slots[Index(tick)]) {
+                        if (((timer.Deadline / _resolution) <= tick) && ((result == false) || (timer.Deadline < deadline))) {
+                            deadline = timer.Deadline;
+                            result = true;
+                        }
+                    }
+                }
+
+                // All of them are more than a rotation away.
+                if (result == false) {
+                    for (const Slot& slot : _slots) {
+                        for (const Timer& timer : slot) {
+                            if ((result == false) || (timer.Deadline < deadline)) {
+                                deadline = timer.Deadline;
+                                result = true;
+                            }
+                        }
+                    }
+                }
+            }
+
+            return (result);
+        }
+
+    private:
+        inline uint32_t Index(const uint64_t tick) const
+        {
+            return (static_cast<uint32_t>(tick % _slots.size()));
+        }
+        bool Remove(Slot& slot, const KEY& key)
+        {
+            typename Slot::iterator index(slot.begin());
+
+            while ((index != slot.end()) && (index->Key != key)) {
+                index++;
+            }
+
+            if (index != slot.end()) {
+                slot.erase(index);
+                _count--;
+                return (true);
+            }
+
+            return (false);
+        }
+
+    private:
+        std::vector<Slot> _slots;
+        const uint32_t _resolution;
+        uint64_t _tick;
+        uint32_t _count;
+    };
+
+} // namespace Plugin
+} // namespace WPEFramework
@@ -0,0 +1,99 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Module.h"
+
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+namespace WPEFramework {
+namespace Plugin {
+
+    // Counting on the physical page bitmaps. The bitmaps are uint32_t words, as that is what the pagemap is
+    // marked in, but they are counted in wider words: NEON vectors where available, else four independent
+    // 64-bit words per iteration, which is a single popcnt instruction each when the target has it.
+    // Both the set bits and the set bits that are not in the mask are counted in the same pass, so the
+    // bitmap and the mask are only read once.
+    struct PageBitmap {
+        static void Count(const uint32_t map[], const uint32_t mask[], const uint32_t begin, const uint32_t end, uint32_t& total, uint32_t& exclusive)
+        {
+            uint64_t all = 0;
+            uint64_t unique = 0;
+            uint32_t index = begin;
+
+#ifdef __ARM_NEON
+            uint64x2_t allSum = vdupq_n_u64(0);
+            uint64x2_t uniqueSum = vdupq_n_u64(0);
+
+            while ((index + 4) <= end) {
+                // A byte lane counts at most 8 per vector, so 31 vectors fit in the 8 bit lanes.
+                const uint32_t blockEnd = std::min(end, index + (31 * 4));
+                uint8x16_t allBlock = vdupq_n_u8(0);
+                uint8x16_t uniqueBlock = vdupq_n_u8(0);
+
+                for (; (index + 4) <= blockEnd; index += 4) {
+                    const uint32x4_t pages = vld1q_u32(&map[index]);
+                    const uint32x4_t others = vld1q_u32(&mask[index]);
+
+                    allBlock = vaddq_u8(allBlock, vcntq_u8(vreinterpretq_u8_u32(pages)));
+                    uniqueBlock = vaddq_u8(uniqueBlock, vcntq_u8(vreinterpretq_u8_u32(vbicq_u32(pages, others))));
+                }
+
+                allSum = vaddq_u64(allSum, vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(allBlock))));
+                uniqueSum = vaddq_u64(uniqueSum, vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(uniqueBlock))));
+            }
+
+            all = vgetq_lane_u64(allSum, 0) + vgetq_lane_u64(allSum, 1);
+            unique = vgetq_lane_u64(uniqueSum, 0) + vgetq_lane_u64(uniqueSum, 1);
+#else
+            uint64_t allCounts[4] = { 0, 0, 0, 0 };
+            uint64_t uniqueCounts[4] = { 0, 0, 0, 0 };
+
+            for (; (index + 8) <= end; index += 8) {
+                uint64_t pages[4];
+                uint64_t others[4];
+
+                ::memcpy(pages, &map[index], sizeof(pages));
+                ::memcpy(others, &mask[index], sizeof(others));
+
+                for (uint8_t lane = 0; lane < 4; lane++) {
+                    allCounts[lane] += __builtin_popcountll(pages[lane]);
+                    uniqueCounts[lane] += __builtin_popcountll(pages[lane] & ~others[lane]);
+                }
+            }
+
+            all = allCounts[0] + allCounts[1] + allCounts[2] + allCounts[3];
+            unique = uniqueCounts[0] + uniqueCounts[1] + uniqueCounts[2] + uniqueCounts[3];
+#endif
+
+            for (; index < end; index++) {
+                all += __builtin_popcount(map[index]);
+                unique += __builtin_popcount(map[index] & ~mask[index]);
+            }
+
+            total = static_cast<uint32_t>(all);
+            exclusive = static_cast<uint32_t>(unique);
+        }
+    };
+
+} // namespace Plugin
+} // namespace WPEFramework
@@ -0,0 +1,209 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Module.h"
+#include <core/ProcessInfo.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+namespace WPEFramework {
+namespace Plugin {
+
+    // Physical pages in use per process, kept from one interval to the next. A process is known by its pid
+    // and its start time, so a recycled pid is never mistaken for the process that had it before. Walking
+    // the pagemap of a process is by far the most expensive part of an interval, so it is only done again
+    // if the size or the resident set of the process changed (taken from statm), or once every "refresh"
+    // intervals, to catch pages that were swapped or moved without changing the totals.
+    // The pages are stored sparse, as the non-zero words of the physical page bitmap, most processes only
+    // touch a small part of it.
+    class PageCache {
+    public:
+        typedef std::vector<std::pair<uint32_t, uint32_t>> Pages;
+
+    private:
+        struct Entry {
+            uint64_t Start;
+            uint64_t Size;
+            uint64_t Resident;
+            uint32_t Generation;
+            Pages Words;
+        };
+
+        typedef std::unordered_map<::ThreadId, Entry> Entries;
+
+    public:
+        PageCache() = delete;
+        PageCache(const PageCache&) = delete;
+        PageCache& operator=(const PageCache&) = delete;
+
+        PageCache(const uint32_t bufferEntries, const uint16_t refresh)
+            : _entries()
+            , _scratch(bufferEntries, 0)
+            , _refresh(refresh)
+            , _generation(0)
+            , _scanned(0)
+        {
+        }
+        ~PageCache()
+        {
+        }
+
+    public:
+        // Number of pagemap walks done in the current interval.
+        inline uint32_t Scanned() const
+        {
+            return (_scanned);
+        }
+
+        void Begin()
+        {
+            _generation++;
+            _scanned = 0;
+        }
+        // Drops the processes that were not asked for in this interval, they are gone.
+        void End()
+        {
+            Entries::iterator index(_entries.begin());
+
+            while (index != _entries.end()) {
+                if (index->second.Generation != _generation) {
+                    index = _entries.erase(index);
+                } else {
+                    index++;
+                }
+            }
+        }
+        const Pages& Get(const ::ThreadId id)
+        {
+            static const Pages empty;
+
+            uint64_t start = 0;
+            uint64_t size = 0;
+            uint64_t resident = 0;
+
+            if (Identify(id, start, size, resident) == false) {
+                // It is gone, or it is a kernel thread without a user space.
+                _entries.erase(id);
+                return (empty);
+            }
+
+            Entry& entry(_entries[id]);
+
+            if ((entry.Generation == 0) || (entry.Start != start) || (entry.Size != size) || (entry.Resident != resident) || ((_refresh != 0) && ((_generation % _refresh) == (id % _refresh)))) {
+                Scan(id, entry.Words);
+                _scanned++;
+            }
+
+            entry.Start = start;
+            entry.Size = size;
+            entry.Resident = resident;
+            entry.Generation = _generation;
+
+            return (entry.Words);
+        }
+
+    private:
+        void Scan(const ::ThreadId id, Pages& words)
+        {
+            const uint32_t entries = static_cast<uint32_t>(_scratch.size());
+            Core::ProcessInfo process(id);
+
+            process.MarkOccupiedPages(_scratch.data(), entries * sizeof(uint32_t));
+
+            words.clear();
+
+            for (uint32_t index = 0; index < entries; index++) {
+                if (_scratch[index] != 0) {
+                    words.emplace_back(index, _scratch[index]);
+                    _scratch[index] = 0;
+                }
+            }
+        }
+        // Start time (in clock ticks since boot, field 22 of stat), size and resident set (in pages, from statm).
+        static bool Identify(const ::ThreadId id, uint64_t& start, uint64_t& size, uint64_t& resident)
+        {
+            char buffer[1024];
+            bool result = false;
+
+            if (Read(id, _T("stat"), buffer, sizeof(buffer)) == true) {
+                // The name, between parentheses, can hold anything, start counting fields after it.
+                const char* position = ::strrchr(buffer, ')');
+
+                if (position != nullptr) {
+                    uint8_t field = 2;
+
+                    while ((field < 22) && (position != nullptr)) {
+                        position = ::strchr(position + 1, ' ');
+                        field++;
+                    }
+
+                    if (position != nullptr) {
+                        start = ::strtoull(position + 1, nullptr, 10);
+
+                        if (Read(id, _T("statm"), buffer, sizeof(buffer)) == true) {
+                            char* end = nullptr;
+
+                            size = ::strtoull(buffer, &end, 10);
+                            resident = ::strtoull(end, nullptr, 10);
+                            result = (size != 0);
+                        }
+                    }
+                }
+            }
+
+            return (result);
+        }
+        static bool Read(const ::ThreadId id, const TCHAR file[], char buffer[], const uint32_t length)
+        {
+            char path[64];
+            bool result = false;
+
+            ::snprintf(path, sizeof(path), "/proc/%d/%s", static_cast<int>(id), file);
+
+            int descriptor = ::open(path, O_RDONLY | O_CLOEXEC);
+
+            if (descriptor != -1) {
+                ssize_t count = ::read(descriptor, buffer, length - 1);
+
+                if (count > 0) {
+                    buffer[count] = '\0';
+                    result = true;
+                }
+
+                ::close(descriptor);
+            }
+
+            return (result);
+        }
+
+    private:
+        Entries _entries;
+        std::vector<uint32_t> _scratch;
+        uint16_t _refresh;
+        uint32_t _generation;
+        uint32_t _scanned;
+    };
+
+} // namespace Plugin
+} // namespace WPEFramework
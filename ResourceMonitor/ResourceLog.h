@@ -0,0 +1,579 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Module.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace WPEFramework {
+namespace Plugin {
+
+    // History of the resource monitor as a ring of fixed size records in a memory mapped file. The collector
+    // (usually out of process) appends, the plugin maps the same file read only to answer queries, so a query
+    // is neither a round trip to the collector nor a parse of the whole history.
+    // Records are appended in time order, so the ring itself is the time index: the first record of a range
+    // is found with a binary search on the timestamps. Only in between two runs of the collector the time can
+    // go back (the clock was not set yet, or set back); the header keeps where it did, the last MaxBacks times,
+    // and every stretch in between is searched on its own. Every record carries the sequence number it was written
+    // under; the writer invalidates it while it fills in the record, so a reader skips records that are being
+    // overwritten under its feet.
+    // The name table is kept in the header, next to the last sequence every name was written under. Once all
+    // records of a name have been overwritten its entry is free again, so processes that come and go (and with
+    // that, names that carry a pid) do not fill up the table for good.
+    class ResourceLog {
+    public:
+        static constexpr uint16_t MaxNames = 128;
+        static constexpr uint16_t NameSize = 64;
+        static constexpr uint16_t NoName = 0xFFFF;
+        static constexpr uint32_t ChunkSize = 4096;
+        static constexpr uint8_t MaxBacks = 8;
+
+        // How the memory figures were taken. The bitmap backend only fills in VSS and USS, the rollup
+        // backend all of them, with VSS and USS as the sum over the processes of their resident and private
+        // pages. So for the rollup backend the VSS is reported as what it is, the RSS.
+        enum backend : uint32_t {
+            BITMAP,
+            ROLLUP
+        };
+
+        // Memory in pages, jiffies of the processes and the stall time (PSI "some" of memory, in microseconds)
+        // of the cgroup they are in, the latter two cumulative.
+        struct Sample {
+            uint32_t VSS;
+            uint32_t USS;
+            uint32_t PSS;
+            uint32_t Swap;
+            uint32_t Anon;
+            uint32_t File;
+            uint64_t Jiffies;
+            uint64_t Stall;
+        };
+
+        // All samples taken in one interval, per name index. Names without a sample have their VSS set to ~0.
+        struct Line {
+            uint32_t Timestamp;
+            uint64_t Jiffies;
+            std::vector<Sample> Samples;
+        };
+
+    private:
+        static constexpr uint32_t Version = 4;
+        static constexpr uint64_t Invalid = ~0ULL;
+
+        struct Header {
+            char Magic[8];
+            uint32_t Version;
+            uint32_t RecordSize;
+            uint32_t Capacity;
+            uint32_t Names;
+            uint64_t Head;
+            uint32_t Lines;
+            backend Backend;
+            // Sequences of the records at which the time went back, Backs in total of which the last MaxBacks
+            // are kept. Older ones than that, if still in the ring, make a stretch that is not in order.
+            uint32_t Backs;
+            uint64_t Back[MaxBacks];
+            uint64_t Used[MaxNames];
+            char Name[MaxNames][NameSize];
+        };
+
+        struct Record {
+            uint64_t Sequence;
+            uint32_t Timestamp;
+            uint32_t Line;
+            uint16_t Name;
+            uint16_t Reserved[3];
+            Sample Values;
+            uint64_t Total;
+        };
+
+        static inline const char* Magic()
+        {
+            return ("RESLOG\0\0");
+        }
+
+    public:
+        ResourceLog(const ResourceLog&) = delete;
+        ResourceLog& operator=(const ResourceLog&) = delete;
+
+        ResourceLog()
+            : _header(nullptr)
+            , _records(nullptr)
+            , _size(0)
+            , _line(0)
+        {
+        }
+        ~ResourceLog()
+        {
+            Close();
+        }
+
+    public:
+        inline bool IsOpen() const
+        {
+            return (_header != nullptr);
+        }
+
+        // Opens the log for appending. A log that is there, and has the same layout, is continued.
+        uint32_t Create(const string& path, const uint32_t capacity, const backend type)
+        {
+            ASSERT(IsOpen() == false);
+            ASSERT(capacity != 0);
+
+            uint32_t result = Core::ERROR_OPENING_FAILED;
+            int descriptor = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+
+            if (descriptor != -1) {
+                const size_t size = sizeof(Header) + (static_cast<size_t>(capacity) * sizeof(Record));
+                struct stat info;
+
+                if ((::fstat(descriptor, &info) == 0) && ((static_cast<size_t>(info.st_size) == size) || (::ftruncate(descriptor, 0) == 0)) && (::ftruncate(descriptor, size) == 0)) {
+                    void* memory = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+
+                    if (memory != MAP_FAILED) {
+                        _header = static_cast<Header*>(memory);
+                        _records = reinterpret_cast<Record*>(static_cast<uint8_t*>(memory) + sizeof(Header));
+                        _size = size;
+
+                        if ((::memcmp(_header->Magic, Magic(), sizeof(_header->Magic)) != 0) || (_header->Version != Version) || (_header->RecordSize != sizeof(Record)) || (_header->Capacity != capacity) || (_header->Backend != type)) {
+                            ::memset(memory, 0, sizeof(Header));
+                            for (uint32_t index = 0; index < capacity; index++) {
+                                _records[index].Sequence = Invalid;
+                            }
+                            _header->Version = Version;
+                            _header->RecordSize = sizeof(Record);
+                            _header->Capacity = capacity;
+                            _header->Backend = type;
+                            // Last, a reader only takes the log for what it is once the magic is there.
+                            __atomic_thread_fence(__ATOMIC_RELEASE);
+                            ::memcpy(_header->Magic, Magic(), sizeof(_header->Magic));
+                        }
+
+                        _line = _header->Lines;
+                        result = Core::ERROR_NONE;
+                    }
+                }
+
+                ::close(descriptor);
+            }
+
+            return (result);
+        }
+        // Opens the log, as it is written by someone else, for queries.
+        uint32_t Open(const string& path)
+        {
+            ASSERT(IsOpen() == false);
+
+            uint32_t result = Core::ERROR_OPENING_FAILED;
+            int descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+            if (descriptor != -1) {
+                struct stat info;
+
+                if ((::fstat(descriptor, &info) == 0) && (static_cast<size_t>(info.st_size) > sizeof(Header))) {
+                    void* memory = ::mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, descriptor, 0);
+
+                    if (memory != MAP_FAILED) {
+                        const Header* header = static_cast<const Header*>(memory);
+
+                        if ((::memcmp(header->Magic, Magic(), sizeof(header->Magic)) == 0) && (header->Version == Version) && (header->RecordSize == sizeof(Record)) && ((sizeof(Header) + (static_cast<size_t>(header->Capacity) * sizeof(Record))) == static_cast<size_t>(info.st_size))) {
+                            _header = static_cast<Header*>(memory);
+                            _records = reinterpret_cast<Record*>(static_cast<uint8_t*>(memory) + sizeof(Header));
+                            _size = info.st_size;
+                            result = Core::ERROR_NONE;
+                        } else {
+                            ::munmap(memory, info.st_size);
+                            result = Core::ERROR_INCORRECT_HASH;
+                        }
+                    }
+                }
+
+                ::close(descriptor);
+            }
+
+            return (result);
+        }
+        void Close()
+        {
+            if (_header != nullptr) {
+                ::munmap(_header, _size);
+                _header = nullptr;
+                _records = nullptr;
+                _size = 0;
+            }
+        }
+
+        // Writer side, a line is started and the sample of every tracked process is appended to it.
+        void StartLine()
+        {
+            ASSERT(IsOpen() == true);
+
+            _line = _header->Lines + 1;
+            __atomic_store_n(&(_header->Lines), _line, __ATOMIC_RELEASE);
+        }
+        void Append(const uint32_t timestamp, const uint64_t total, const string& name, const Sample& sample)
+        {
+            ASSERT(IsOpen() == true);
+
+            const uint64_t sequence = _header->Head;
+            const uint16_t nameIndex = Name(name, sequence);
+
+            if (nameIndex == NoName) {
+                TRACE_L1("Resource log is out of names, dropping %s", name.c_str());
+            } else {
+                Record& record(_records[sequence % _header->Capacity]);
+                const Record& previous(_records[(sequence + _header->Capacity - 1) % _header->Capacity]);
+
+                _header->Used[nameIndex] = sequence;
+
+                // The writer keeps the time going up within a run, so this is the start of a run.
+                if ((sequence != 0) && (previous.Sequence == (sequence - 1)) && (previous.Timestamp > timestamp)) {
+                    _header->Back[_header->Backs % MaxBacks] = sequence;
+                    __atomic_store_n(&(_header->Backs), _header->Backs + 1, __ATOMIC_RELEASE);
+                }
+
+                __atomic_store_n(&(record.Sequence), Invalid, __ATOMIC_RELAXED);
+                __atomic_thread_fence(__ATOMIC_RELEASE);
+
+                record.Timestamp = timestamp;
+                record.Line = _line;
+                record.Name = nameIndex;
+                record.Values = sample;
+                record.Total = total;
+
+                __atomic_store_n(&(record.Sequence), sequence, __ATOMIC_RELEASE);
+                __atomic_store_n(&(_header->Head), sequence + 1, __ATOMIC_RELEASE);
+            }
+        }
+
+        // Reader side.
+        inline backend Backend() const
+        {
+            ASSERT(IsOpen() == true);
+
+            return (_header->Backend);
+        }
+        void Names(std::vector<string>& names) const
+        {
+            ASSERT(IsOpen() == true);
+
+            const uint32_t count = std::min(__atomic_load_n(&(_header->Names), __ATOMIC_ACQUIRE), static_cast<uint32_t>(MaxNames));
+
+            names.clear();
+            for (uint32_t index = 0; index < count; index++) {
+                names.emplace_back(_header->Name[index], ::strnlen(_header->Name[index], NameSize));
+            }
+        }
+        // Reports, oldest first, the lines with a timestamp in [from, to], with at most one line per step seconds.
+        // The handler is called as handler(const Line&) and can return false to stop.
+        template <typename HANDLER>
+        void Range(const uint32_t from, const uint32_t to, const uint32_t step, HANDLER& handler) const
+        {
+            ASSERT(IsOpen() == true);
+
+            const uint32_t names = std::min(__atomic_load_n(&(_header->Names), __ATOMIC_ACQUIRE), static_cast<uint32_t>(MaxNames));
+            const uint64_t head = __atomic_load_n(&(_header->Head), __ATOMIC_ACQUIRE);
+            // Leave some slack at the tail, the writer might be about to overwrite it.
+            const uint64_t slack = std::min(static_cast<uint64_t>(_header->Capacity / 16 + 1), static_cast<uint64_t>(_header->Capacity));
+            const uint64_t oldest = (head > (_header->Capacity - slack) ? head - (_header->Capacity - slack) : 0);
+            uint64_t begin = oldest;
+            uint32_t bucket = ~0;
+            bool proceed = true;
+            Line line;
+            Record record;
+
+            // The start of the oldest line might have been overwritten, skip what is left of it.
+            if ((oldest != 0) && (Load(begin, record) == true)) {
+                const uint32_t partial = record.Line;
+
+                while ((begin < head) && (Load(begin, record) == true) && (record.Line == partial)) {
+                    begin++;
+                }
+            }
+
+            line.Timestamp = 0;
+            line.Samples.resize(names);
+
+            // Oldest first, every stretch in which the time went up.
+            while ((proceed == true) && (begin < head)) {
+                const uint64_t end = Back(begin, head);
+
+                proceed = Range(begin, end, from, to, step, bucket, line, handler);
+                begin = end;
+            }
+        }
+
+        // The range as text, in chunks of about ChunkSize characters, handed to sink(const string&) as they are
+        // filled. The CSV form is what CompileMemoryCsv always returned: times relative to the first line and a
+        // 0 for processes that were not there.
+        template <typename SINK>
+        void Csv(const uint32_t from, const uint32_t to, const uint32_t step, SINK& sink) const
+        {
+            std::vector<string> names;
+            string chunk;
+            bool first = true;
+            uint32_t start = 0;
+
+            Names(names);
+
+            chunk.reserve(ChunkSize + 256);
+            const bool rollup = (Backend() == ROLLUP);
+
+            chunk += _T("time (s)\tJiffies");
+            for (const string& name : names) {
+                chunk += _T("\t") + name + (rollup == true ? _T(" (RSS)\t") : _T(" (VSS)\t")) + name + _T(" (USS)\t") + name + _T(" (jiffies)");
+                if (rollup == true) {
+                    chunk += _T("\t") + name + _T(" (PSS)\t") + name + _T(" (swap)\t") + name + _T(" (anon)\t") + name + _T(" (file)\t") + name + _T(" (stall)");
+                }
+            }
+            chunk += '\n';
+
+            auto handler = [&](const Line& line) -> bool {
+                if (first == true) {
+                    start = line.Timestamp;
+                    first = false;
+                }
+
+                // A later run might have started before the clock was set, so this can be negative.
+                chunk += std::to_string(static_cast<int64_t>(line.Timestamp) - static_cast<int64_t>(start)) + '\t' + std::to_string(line.Jiffies);
+                for (const Sample& sample : line.Samples) {
+                    if (sample.VSS == static_cast<uint32_t>(~0)) {
+                        chunk += (rollup == true ? _T("\t0\t0\t0\t0\t0\t0\t0\t0") : _T("\t0\t0\t0"));
+                    } else {
+                        chunk += '\t' + std::to_string(sample.VSS) + '\t' + std::to_string(sample.USS) + '\t' + std::to_string(sample.Jiffies);
+                        if (rollup == true) {
+                            chunk += '\t' + std::to_string(sample.PSS) + '\t' + std::to_string(sample.Swap) + '\t' + std::to_string(sample.Anon) + '\t' + std::to_string(sample.File) + '\t' + std::to_string(sample.Stall);
+                        }
+                    }
+                }
+                chunk += '\n';
+
+                Flush(chunk, sink);
+                return (true);
+            };
+
+            Range(from, to, step, handler);
+
+            sink(static_cast<const string&>(chunk));
+        }
+        // As an object with the names and the lines, absolute timestamps, and null for processes that were not there.
+        template <typename SINK>
+        void Json(const uint32_t from, const uint32_t to, const uint32_t step, SINK& sink) const
+        {
+            std::vector<string> names;
+            string chunk;
+            bool first = true;
+
+            Names(names);
+
+            const bool rollup = (Backend() == ROLLUP);
+
+            chunk.reserve(ChunkSize + 256);
+            chunk += _T("{\"backend\":\"") + string(rollup == true ? _T("rollup") : _T("bitmap")) + _T("\",\"names\":[");
+            for (uint32_t index = 0; index < names.size(); index++) {
+                chunk += (index == 0 ? _T("\"") : _T(",\""));
+                for (const char character : names[index]) {
+                    if ((character == '\"') || (character == '\\')) {
+                        chunk += '\\';
+                    }
+                    chunk += character;
+                }
+                chunk += '\"';
+            }
+            chunk += _T("],\"lines\":[");
+
+            auto handler = [&](const Line& line) -> bool {
+                chunk += (first == true ? _T("{\"time\":") : _T(",{\"time\":")) + std::to_string(line.Timestamp) + _T(",\"jiffies\":") + std::to_string(line.Jiffies) + _T(",\"processes\":[");
+                first = false;
+
+                for (uint32_t index = 0; index < line.Samples.size(); index++) {
+                    const Sample& sample(line.Samples[index]);
+
+                    if (index != 0) {
+                        chunk += ',';
+                    }
+                    if (sample.VSS == static_cast<uint32_t>(~0)) {
+                        chunk += _T("null");
+                    } else {
+                        chunk += (rollup == true ? _T("{\"rss\":") : _T("{\"vss\":")) + std::to_string(sample.VSS) + _T(",\"uss\":") + std::to_string(sample.USS) + _T(",\"jiffies\":") + std::to_string(sample.Jiffies);
+                        if (rollup == true) {
+                            chunk += _T(",\"pss\":") + std::to_string(sample.PSS) + _T(",\"swap\":") + std::to_string(sample.Swap) + _T(",\"anon\":") + std::to_string(sample.Anon) + _T(",\"file\":") + std::to_string(sample.File) + _T(",\"stall\":") + std::to_string(sample.Stall);
+                        }
+                        chunk += '}';
+                    }
+                }
+                chunk += _T("]}");
+
+                Flush(chunk, sink);
+                return (true);
+            };
+
+            Range(from, to, step, handler);
+
+            chunk += _T("]}");
+            sink(static_cast<const string&>(chunk));
+        }
+
+    private:
+        template <typename SINK>
+        static void Flush(string& chunk, SINK& sink)
+        {
+            if (chunk.length() >= ChunkSize) {
+                sink(static_cast<const string&>(chunk));
+                chunk.clear();
+            }
+        }
+        // Index of the name, for a record to be written under the given sequence. A new name takes a free entry,
+        // or else the one that was used longest ago, as long as none of its records is left in the ring.
+        uint16_t Name(const string& name, const uint64_t sequence)
+        {
+            uint32_t count = _header->Names;
+            uint32_t index = 0;
+
+            while ((index < count) && (::strncmp(_header->Name[index], name.c_str(), NameSize - 1) != 0)) {
+                index++;
+            }
+
+            if (index == count) {
+                if (count < MaxNames) {
+                    ::strncpy(_header->Name[index], name.c_str(), NameSize - 1);
+                    __atomic_store_n(&(_header->Names), count + 1, __ATOMIC_RELEASE);
+                } else {
+                    uint32_t oldest = 0;
+
+                    for (uint32_t entry = 1; entry < count; entry++) {
+                        if (_header->Used[entry] < _header->Used[oldest]) {
+                            oldest = entry;
+                        }
+                    }
+
+                    if ((_header->Used[oldest] + _header->Capacity) <= sequence) {
+                        index = oldest;
+                        ::memset(_header->Name[index], 0, NameSize);
+                        ::strncpy(_header->Name[index], name.c_str(), NameSize - 1);
+                    }
+                }
+            }
+
+            return (index < MaxNames ? static_cast<uint16_t>(index) : NoName);
+        }
+        // Copies out the record written under the given sequence, false if it was, or is being, overwritten.
+        bool Load(const uint64_t sequence, Record& record) const
+        {
+            const Record& source(_records[sequence % _header->Capacity]);
+
+            if (__atomic_load_n(&(source.Sequence), __ATOMIC_ACQUIRE) != sequence) {
+                return (false);
+            }
+
+            record = source;
+
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+            return (__atomic_load_n(&(source.Sequence), __ATOMIC_RELAXED) == sequence);
+        }
+        // End of the stretch of ordered records that starts at begin: the first place after it where the time
+        // went back, or end.
+        uint64_t Back(const uint64_t begin, const uint64_t end) const
+        {
+            const uint32_t backs = __atomic_load_n(&(_header->Backs), __ATOMIC_ACQUIRE);
+            uint64_t result = end;
+
+            for (uint32_t index = 0; index < std::min(backs, static_cast<uint32_t>(MaxBacks)); index++) {
+                const uint64_t sequence = _header->Back[index];
+
+                if ((sequence > begin) && (sequence < result)) {
+                    result = sequence;
+                }
+            }
+
+            return (result);
+        }
+        // Reports the lines in [from, to] of the ordered records in [begin, end), see Range above.
+        template <typename HANDLER>
+        bool Range(const uint64_t begin, const uint64_t end, const uint32_t from, const uint32_t to, const uint32_t step, uint32_t& bucket, Line& line, HANDLER& handler) const
+        {
+            uint64_t sequence = First(begin, end, from);
+            bool proceed = true;
+            Record record;
+
+            while ((proceed == true) && (sequence < end) && (Load(sequence, record) == true) && (record.Timestamp <= to)) {
+                const uint32_t current = record.Line;
+                const uint32_t slot = (step != 0 ? record.Timestamp / step : static_cast<uint32_t>(sequence));
+                const bool report = (slot != bucket);
+
+                if (report == true) {
+                    line.Timestamp = record.Timestamp;
+                    line.Jiffies = record.Total;
+                    for (Sample& sample : line.Samples) {
+                        sample.VSS = ~0;
+                    }
+                }
+
+                // All records of this line, also the ones that are not reported, are passed.
+                do {
+                    if ((report == true) && (record.Name < line.Samples.size())) {
+                        line.Samples[record.Name] = record.Values;
+                    }
+                    sequence++;
+                } while ((sequence < end) && (Load(sequence, record) == true) && (record.Line == current));
+
+                if (report == true) {
+                    bucket = slot;
+                    proceed = handler(static_cast<const Line&>(line));
+                }
+            }
+
+            return (proceed);
+        }
+        // First sequence in [begin, end) with a timestamp at or after the given one, records that can not be
+        // loaded are considered too old. All records of a line have the same timestamp, so this is the start
+        // of a line.
+        uint64_t First(uint64_t begin, uint64_t end, const uint32_t timestamp) const
+        {
+            Record record;
+
+            while (begin < end) {
+                const uint64_t middle = begin + ((end - begin) / 2);
+
+                if ((Load(middle, record) == false) || (record.Timestamp < timestamp)) {
+                    begin = middle + 1;
+                } else {
+                    end = middle;
+                }
+            }
+
+            return (begin);
+        }
+
+    private:
+        Header* _header;
+        Record* _records;
+        size_t _size;
+        uint32_t _line;
+    };
+
+} // namespace Plugin
+} // namespace WPEFramework
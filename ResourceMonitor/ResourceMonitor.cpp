@@ -1,4 +1,5 @@
 #include "ResourceMonitor.h"
+#include "ResourceLog.h"
 
 namespace WPEFramework {
 
@@ -19,6 +20,7 @@ namespace Plugin {
         Config config;
         config.FromString(_service->ConfigLine());
         _skipURL = static_cast<uint32_t>(_service->WebPrefix().length());
+        _path = config.Path.Value();
 
         _monitor = _service->Root<Exchange::IResourceMonitor>(_connectionId, 2000, _T("ResourceMonitorImplementation"));
 
@@ -57,6 +59,69 @@ namespace Plugin {
         return "";
     }
 
+    // history?from=<s>&to=<s>&step=<s>&format=csv|json, all optional. The times are seconds since the epoch,
+    // step thins out the lines to at most one per that many seconds. The log is mapped read only, only the
+    // lines in the range are visited, and they are formatted in chunks straight into the body.
+    void ResourceMonitor::History(const string& query, Web::Response& response)
+    {
+        uint32_t from = 0;
+        uint32_t to = ~0;
+        uint32_t step = 0;
+        bool json = false;
+        bool valid = true;
+
+        Core::TextSegmentIterator options(Core::TextFragment(query), true, '&');
+
+        while ((valid == true) && (options.Next() == true)) {
+            const string option(options.Current().Text());
+            const size_t separator = option.find('=');
+            const string key(option.substr(0, separator));
+            const string value(separator != string::npos ? option.substr(separator + 1) : string());
+
+            if (key == _T("from")) {
+                from = static_cast<uint32_t>(::strtoul(value.c_str(), nullptr, 10));
+            } else if (key == _T("to")) {
+                to = static_cast<uint32_t>(::strtoul(value.c_str(), nullptr, 10));
+            } else if (key == _T("step")) {
+                step = static_cast<uint32_t>(::strtoul(value.c_str(), nullptr, 10));
+            } else if (key == _T("format")) {
+                json = (value == _T("json"));
+                valid = (json == true) || (value == _T("csv"));
+            }
+        }
+
+        if (valid == false) {
+            response.ErrorCode = Web::STATUS_BAD_REQUEST;
+            response.Message = _T("Unknown history format requested.");
+        } else {
+            Core::ProxyType<Web::TextBody> body(webBodyFactory.Element());
+            ResourceLog log;
+
+            body->clear();
+
+            if (log.Open(_path) == Core::ERROR_NONE) {
+                Web::TextBody& text(*body);
+                auto sink = [&text](const string& chunk) { text += chunk; };
+
+                if (json == true) {
+                    log.Json(from, to, step, sink);
+                } else {
+                    log.Csv(from, to, step, sink);
+                }
+            } else if (json == false) {
+                // Not (yet) there or written by a different version, let the collector have a go at it.
+                *body = _monitor->CompileMemoryCsv();
+            } else {
+                *body = _T("{\"names\":[],\"lines\":[]}");
+            }
+
+            response.ErrorCode = Web::STATUS_OK;
+            response.Message.clear();
+            response.ContentType = (json == true ? Web::MIMETypes::MIME_JSON : Web::MIMETypes::MIME_TEXT);
+            response.Body(body);
+        }
+    }
+
     /* static */ Core::ProxyPoolType<Web::TextBody> ResourceMonitor::webBodyFactory(4);
 }
 }
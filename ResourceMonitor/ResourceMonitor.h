@@ -20,8 +20,10 @@ namespace Plugin {
             Config()
                 : Core::JSON::Container()
                 , OutOfProcess(true)
+                , Path(_T("/tmp/resource-log.bin"))
             {
                 Add(_T("outofprocess"), &OutOfProcess);
+                Add(_T("path"), &Path);
             }
             ~Config()
             {
@@ -29,6 +31,7 @@ namespace Plugin {
 
         public:
             Core::JSON::Boolean OutOfProcess;
+            Core::JSON::String Path;
         };
 
     public:
@@ -36,6 +39,7 @@ namespace Plugin {
             : _service(nullptr)
             , _monitor(nullptr)
             , _connectionId(0)
+            , _path()
         {
 
         }
@@ -63,12 +67,8 @@ namespace Plugin {
                 if (index.IsValid() == true && index.Next() == true) {
                     const string requestStr = index.Current().Text();
                     if (requestStr == "history") {
-                        // Asked for history csv
-                        result->ErrorCode = Web::STATUS_OK;
-                        result->ContentType = Web::MIMETypes::MIME_TEXT;
-                        Core::ProxyType<Web::TextBody> body(webBodyFactory.Element());
-                        *body = _monitor->CompileMemoryCsv();
-                        result->Body(body);
+                        // Asked for history, all of it as csv unless the query says otherwise
+                        History((request.Query.IsSet() == true ? request.Query.Value() : string()), *result);
                     }
                 }
             }
@@ -88,12 +88,16 @@ namespace Plugin {
         void Deinitialize(PluginHost::IShell* service) override;
         string Information() const override;
 
+    private:
+        void History(const string& query, Web::Response& response);
+
     private:
         PluginHost::IShell* _service;
         Exchange::IResourceMonitor* _monitor;
         uint32_t _connectionId;
         static Core::ProxyPoolType<Web::TextBody> webBodyFactory;
         uint32_t _skipURL;
+        string _path;
     };
 }
 }
@@ -1,14 +1,17 @@
 #include "Module.h"
+#include "PageBitmap.h"
+#include "PageCache.h"
+#include "ResourceLog.h"
+#include "Rollup.h"
 #include <core/ProcessInfo.h>
 #include <interfaces/IMemory.h>
 #include <interfaces/IResourceMonitor.h>
-#include <sstream>
+#include <time.h>
+#include <unordered_set>
 #include <vector>
 
-using std::endl;
 using std::cerr; // TODO: temp
 using std::list;
-using std::stringstream;
 using std::vector;
 
 // TODO: don't create our own thread, use threadpool from WPEFramework
@@ -37,11 +40,17 @@ namespace Plugin {
              , Interval()
              , Mode()
              , ParentName()
+             , Refresh(12)
+             , Capacity(65536)
+             , Backend(_T("bitmap"))
          {
             Add(_T("path"), &Path);
             Add(_T("interval"), &Interval);
             Add(_T("mode"), &Mode);
             Add(_T("parent-name"), &ParentName);
+            Add(_T("refresh"), &Refresh);
+            Add(_T("capacity"), &Capacity);
+            Add(_T("backend"), &Backend);
          }
          Config(const Config& copy)
              : Core::JSON::Container()
@@ -49,11 +58,17 @@ namespace Plugin {
              , Interval(copy.Interval)
              , Mode(copy.Mode)
              , ParentName(copy.ParentName)
+             , Refresh(copy.Refresh)
+             , Capacity(copy.Capacity)
+             , Backend(copy.Backend)
          {
             Add(_T("path"), &Path);
             Add(_T("interval"), &Interval);
             Add(_T("mode"), &Mode);
             Add(_T("parent-name"), &ParentName);
+            Add(_T("refresh"), &Refresh);
+            Add(_T("capacity"), &Capacity);
+            Add(_T("backend"), &Backend);
          }
          ~Config()
          {
@@ -81,289 +96,342 @@ namespace Plugin {
          Core::JSON::DecUInt32 Interval;
          Core::JSON::String Mode;
          Core::JSON::String ParentName;
+         // Intervals after which the pages of a process are walked again, even if its size did not change.
+         Core::JSON::DecUInt16 Refresh;
+         // Samples (one per process per interval) kept in the log, the oldest are overwritten.
+         Core::JSON::DecUInt32 Capacity;
+         // "bitmap" (page maps), "rollup" (smaps_rollup, cgroup v2 and PSI) or "auto" (rollup where it can be read
+         // for all processes that are measured).
+         Core::JSON::String Backend;
       };
 
       class StatCollecter {
+     private:
+         // Processes that are accounted as one, with the name they are logged under.
+         struct Tracked {
+            string Name;
+            Core::ProcessInfo Info;
+            std::list<::ThreadId> Ids;
+         };
+
      public:
          explicit StatCollecter(const Config& config)
-             : _binFile(nullptr)
-             , _otherMap(nullptr)
-             , _ourMap(nullptr)
+             : _log()
+             , _timestamp(0)
+             , _jiffies(0)
+             , _seenMap(nullptr)
+             , _sharedMap(nullptr)
              , _bufferEntries(0)
              , _interval(0)
              , _collectMode(Config::CollectMode::Invalid)
+             , _path(config.Path.Value())
+             , _capacity(std::max(config.Capacity.Value(), 1u))
+             , _refresh(config.Refresh.Value())
+             , _auto(config.Backend.Value() == _T("auto"))
+             , _cache(nullptr)
+             , _rollup(nullptr)
              , _activity(*this)
          {
-            _binFile = fopen(config.Path.Value().c_str(), "w");
-
-            uint32_t pageCount = Core::SystemInfo::Instance().GetPhysicalPageCount();
-            const uint32_t bitPersUint32 = 32;
-            _bufferEntries = pageCount / bitPersUint32;
-            if ((pageCount % bitPersUint32) != 0) {
-               _bufferEntries++;
-            }
-
-            // Because linux doesn't report the first couple of pages it uses itself,
-            //    allocate a little extra to make sure we don't miss the highest ones.
-            _bufferEntries += _bufferEntries / 10;
-
-            _ourMap = new uint32_t[_bufferEntries];
-            _otherMap = new uint32_t[_bufferEntries];
             _interval = config.Interval.Value();
             _collectMode = config.GetCollectMode();
             _parentName = config.ParentName.Value();
 
+            if (config.Backend.Value() == _T("rollup")) {
+               if (Rollup::IsAvailable() == true) {
+                  _rollup = new Rollup();
+               } else {
+                  TRACE_L1("No smaps_rollup on this kernel, falling back to page bitmaps");
+               }
+            }
+
+            // With "auto" the backend is picked once the processes to measure are known.
+            if (_auto == false) {
+               Open();
+            }
+
             _activity.Submit();
          }
 
          ~StatCollecter()
          {
-            fclose(_binFile);
+            _activity.Revoke();
 
-            delete [] _ourMap;
-            delete [] _otherMap;
+            delete _rollup;
+            delete _cache;
+            delete [] _seenMap;
+            delete [] _sharedMap;
          }
 
-         void GetProcessNames(vector<string>& processNames)
+      private:
+         void Open()
          {
-            _namesLock.Lock();
-            processNames = _processNames;
-            _namesLock.Unlock();
+            if (_log.Create(_path, _capacity, (_rollup != nullptr ? ResourceLog::ROLLUP : ResourceLog::BITMAP)) != Core::ERROR_NONE) {
+               TRACE_L1("Failed to open resource log %s", _path.c_str());
+            }
+
+            if (_rollup == nullptr) {
+               AllocateMaps(_refresh);
+            }
          }
 
-      private:
-         // TODO: combine these "Collect*" methods
-         void CollectSingle()
+         // The rollups, if they can be read for all processes to measure, else the page bitmaps. The rollup of a
+         // process this one may not look into reads as nothing, where the bitmaps still account its pages.
+         void Pick(const vector<Tracked>& tracked)
          {
-            list<Core::ProcessInfo> processes;
-            Core::ProcessInfo::FindByName(_parentName, false, processes);
+            bool available = Rollup::IsAvailable();
 
-            // TODO: check if only one, warning otherwise?
-            // TOOD: what if none found? will cause segfault when using .front() later on.
-            if (processes.empty()) {
-               TRACE_L1("Failed to find process %s", _parentName);
-               return;
+            for (uint32_t index = 0; (available == true) && (index < tracked.size()); index++) {
+               available = Rollup::IsAvailable(tracked[index].Ids);
             }
 
-            if (processes.size() > 1) {
-               TRACE_L1("Found more than one process named %s, only tracking first", _parentName);
+            if (available == true) {
+               _rollup = new Rollup();
+            } else {
+               TRACE_L1("Not all smaps_rollup of the processes can be read, using page bitmaps");
             }
 
-            uint32_t mapBufferSize = sizeof(_ourMap[0]) * _bufferEntries;
-            memset(_ourMap, 0, mapBufferSize);
-            memset(_otherMap, 0, mapBufferSize);
+            _auto = false;
 
-            vector<::ThreadId> processIds;
+            Open();
+         }
 
-            for (const Core::ProcessInfo& processInfo : processes) {
-               string processName = processInfo.Name();
+         void AllocateMaps(const uint16_t refresh)
+         {
+            uint32_t pageCount = Core::SystemInfo::Instance().GetPhysicalPageCount();
+            const uint32_t bitPersUint32 = 32;
+            _bufferEntries = pageCount / bitPersUint32;
+            if ((pageCount % bitPersUint32) != 0) {
+               _bufferEntries++;
+            }
 
-               _namesLock.Lock();
-               if (find(_processNames.begin(), _processNames.end(), _parentName) == _processNames.end()) {
-                  _processNames.push_back(_parentName);
-               }
-               _namesLock.Unlock();
+            // Because linux doesn't report the first couple of pages it uses itself,
+            //    allocate a little extra to make sure we don't miss the highest ones.
+            _bufferEntries += _bufferEntries / 10;
 
-               Core::ProcessTree processTree(processInfo.Id());
+            _seenMap = new uint32_t[_bufferEntries];
+            _sharedMap = new uint32_t[_bufferEntries];
+            _cache = new PageCache(_bufferEntries, refresh);
+         }
 
-               processTree.MarkOccupiedPages(_ourMap, mapBufferSize);
+         void CollectSingle(vector<Tracked>& tracked)
+         {
+            list<Core::ProcessInfo> processes;
+            Core::ProcessInfo::FindByName(_parentName, false, processes);
 
-               std::list<::ThreadId> addedProcessIds;
-               processTree.GetProcessIds(addedProcessIds);
-               processIds.insert(processIds.end(), addedProcessIds.begin(), addedProcessIds.end());
+            if (processes.empty()) {
+               TRACE_L1("Failed to find process %s", _parentName.c_str());
+               return;
             }
 
-            memset(_otherMap, 0, mapBufferSize);
-
-            // Find other processes
-            list<Core::ProcessInfo> otherProcesses;
-            Core::ProcessInfo::Iterator otherIterator;
-            while (otherIterator.Next()) {
-               ::ThreadId otherId = otherIterator.Current().Id();
-               if (find(processIds.begin(), processIds.end(), otherId) == processIds.end()) {
-                  otherIterator.Current().MarkOccupiedPages(_otherMap, mapBufferSize);
-               }
+            if (processes.size() > 1) {
+               TRACE_L1("Found more than one process named %s, only tracking first", _parentName.c_str());
             }
 
-            StartLogLine(1);
-            LogProcess(_parentName, processes.front());
+            // All processes by that name, and their children, are accounted as one.
+            tracked.push_back(Tracked { _parentName, processes.front(), std::list<::ThreadId>() });
+
+            for (const Core::ProcessInfo& processInfo : processes) {
+               Core::ProcessTree processTree(processInfo.Id());
+               processTree.GetProcessIds(tracked.back().Ids);
+            }
          }
 
-         void CollectMultiple()
+         void CollectMultiple(vector<Tracked>& tracked)
          {
             list<Core::ProcessInfo> processes;
             Core::ProcessInfo::FindByName(_parentName, false, processes);
 
-            StartLogLine(processes.size());
-
             for (const Core::ProcessInfo& processInfo : processes) {
-               uint32_t mapBufferSize = sizeof(_ourMap[0]) * _bufferEntries;
-               memset(_ourMap, 0, mapBufferSize);
-               memset(_otherMap, 0, mapBufferSize);
-
                string processName = processInfo.Name() + " (" + std::to_string(processInfo.Id()) + ")";
 
-               _namesLock.Lock();
-               if (find(_processNames.begin(), _processNames.end(), processName) == _processNames.end()) {
-                  _processNames.push_back(processName);
-               }
-               _namesLock.Unlock();
+               tracked.push_back(Tracked { processName, processInfo, std::list<::ThreadId>() });
 
                Core::ProcessTree processTree(processInfo.Id());
-
-               processTree.MarkOccupiedPages(_ourMap, mapBufferSize);
-
-               list<Core::ProcessInfo> otherProcesses;
-               Core::ProcessInfo::Iterator otherIterator;
-               while (otherIterator.Next()) {
-                  ::ThreadId otherId = otherIterator.Current().Id();
-                  if (!processTree.ContainsProcess(otherId)) {
-                     otherIterator.Current().MarkOccupiedPages(_otherMap, mapBufferSize);
-                  }
-               }
-
-               LogProcess(processName, processInfo);
+               processTree.GetProcessIds(tracked.back().Ids);
             }
          }
 
-         void CollectWPEProcess(const string& argument)
+         void CollectWPEProcess(vector<Tracked>& tracked, const string& argument)
          {
             const string processName = "WPEProcess-1.0.0";
 
             list<Core::ProcessInfo> processes;
             Core::ProcessInfo::FindByName(processName, false, processes);
 
-            vector<std::pair<Core::ProcessInfo, string> > processIds;
             for (const Core::ProcessInfo& processInfo : processes) {
                std::list<string> commandLine = processInfo.CommandLine();
 
-               bool shouldTrack = false;
-               string columnName;
-
                // Get callsign/classname
                std::list<string>::const_iterator i = std::find(commandLine.cbegin(), commandLine.cend(), argument);
-               if (i != commandLine.cend()) {
-                  i++;
-                  if (i != commandLine.cend()) {
-                     if (*i == _parentName) {
-                        columnName = _parentName + " (" + std::to_string(processInfo.Id()) + ")";
-                        processIds.push_back(std::pair<::ThreadId, string>(processInfo.Id(), columnName));
-                        shouldTrack = true;
+               if ((i != commandLine.cend()) && (++i != commandLine.cend()) && (*i == _parentName)) {
+                  string columnName = _parentName + " (" + std::to_string(processInfo.Id()) + ")";
+
+                  tracked.push_back(Tracked { columnName, processInfo, std::list<::ThreadId>() });
+
+                  Core::ProcessTree tree(processInfo.Id());
+                  tree.GetProcessIds(tracked.back().Ids);
+               }
+            }
+         }
+
+         // Accounts the pages of all tracked trees in one pass over the processes on the system. Every tracked
+         // tree, and every other process, is an owner of its pages; a page that is claimed by more than one owner
+         // is shared, the rest of the pages of a tree are unique to it (USS). A process that ends up in more than
+         // one tree (nested matches in multiple mode) makes its pages shared between those trees.
+         void Account(const vector<Tracked>& tracked)
+         {
+            const uint32_t mapBufferSize = sizeof(_seenMap[0]) * _bufferEntries;
+            std::unordered_set<::ThreadId> trackedIds;
+
+            _cache->Begin();
+
+            if (_treeMaps.size() < tracked.size()) {
+               _treeMaps.resize(tracked.size(), vector<uint32_t>(_bufferEntries));
+               _treeBounds.resize(tracked.size(), std::pair<uint32_t, uint32_t>(0, 0));
+            }
+
+            memset(_seenMap, 0, mapBufferSize);
+            memset(_sharedMap, 0, mapBufferSize);
+
+            for (uint32_t index = 0; index < tracked.size(); index++) {
+               uint32_t* treeMap = _treeMaps[index].data();
+               std::pair<uint32_t, uint32_t>& bounds(_treeBounds[index]);
+
+               // Only the words between the bounds were set in the previous interval.
+               memset(&treeMap[bounds.first], 0, (bounds.second - bounds.first) * sizeof(treeMap[0]));
+               bounds.first = _bufferEntries;
+               bounds.second = 0;
+
+               for (const ::ThreadId id : tracked[index].Ids) {
+                  trackedIds.insert(id);
+
+                  const PageCache::Pages& pages(_cache->Get(id));
+
+                  if (pages.empty() == false) {
+                     bounds.first = std::min(bounds.first, pages.front().first);
+                     bounds.second = std::max(bounds.second, pages.back().first + 1);
+
+                     for (const std::pair<uint32_t, uint32_t>& word : pages) {
+                        treeMap[word.first] |= word.second;
                      }
                   }
                }
 
-               if (!shouldTrack) {
-                  continue;
+               if (bounds.first > bounds.second) {
+                  bounds.first = 0;
+                  bounds.second = 0;
                }
 
-               _namesLock.Lock();
-               if (std::find(_processNames.cbegin(), _processNames.cend(), columnName) == _processNames.cend()) {
-                  _processNames.push_back(columnName);
+               for (uint32_t entry = bounds.first; entry < bounds.second; entry++) {
+                  _sharedMap[entry] |= _seenMap[entry] & treeMap[entry];
+                  _seenMap[entry] |= treeMap[entry];
                }
-               _namesLock.Unlock();
             }
 
-            StartLogLine(processIds.size());
-            for (std::pair<Core::ProcessInfo, string> processDesc : processIds) {
-               Core::ProcessTree tree(processDesc.first);
-
-               uint32_t mapBufferSize = sizeof(_ourMap[0]) * _bufferEntries;
-               memset(_ourMap, 0, mapBufferSize);
-               memset(_otherMap, 0, mapBufferSize);
-
-               tree.MarkOccupiedPages(_ourMap, mapBufferSize);
+            Core::ProcessInfo::Iterator otherIterator;
+            while (otherIterator.Next()) {
+               ::ThreadId otherId = otherIterator.Current().Id();
 
-               list<Core::ProcessInfo> otherProcesses;
-               Core::ProcessInfo::Iterator otherIterator;
-               while (otherIterator.Next()) {
-                  ::ThreadId otherId = otherIterator.Current().Id();
-                  if (!tree.ContainsProcess(otherId)) {
-                     otherIterator.Current().MarkOccupiedPages(_otherMap, mapBufferSize);
+               if (trackedIds.find(otherId) == trackedIds.end()) {
+                  for (const std::pair<uint32_t, uint32_t>& word : _cache->Get(otherId)) {
+                     _sharedMap[word.first] |= _seenMap[word.first] & word.second;
+                     _seenMap[word.first] |= word.second;
                   }
                }
-
-               LogProcess(processDesc.second, processDesc.first);
             }
+
+            _cache->End();
+
+            TRACE_L1("Accounted %d tracked processes, %d pagemaps walked", static_cast<uint32_t>(trackedIds.size()), _cache->Scanned());
          }
 
      protected:
          void Dispatch()
          {
+            vector<Tracked> tracked;
+
             switch(_collectMode) {
                case Config::CollectMode::Single:
-                  CollectSingle();
+                  CollectSingle(tracked);
                   break;
                case Config::CollectMode::Multiple: 
-                  CollectMultiple();
+                  CollectMultiple(tracked);
                   break;
                case Config::CollectMode::Callsign: 
-                  CollectWPEProcess("-C");
+                  CollectWPEProcess(tracked, "-C");
                   break;
                case Config::CollectMode::ClassName:
-                  CollectWPEProcess("-c");
+                  CollectWPEProcess(tracked, "-c");
                   break;
                case Config::CollectMode::Invalid:
                   // TODO: ASSERT?
                   break;
             }
 
+            if ((_auto == true) && (tracked.empty() == false)) {
+               Pick(tracked);
+            }
+
+            // Single mode skips the line if the process is not there.
+            if (((tracked.empty() == false) || (_collectMode != Config::CollectMode::Single)) && (_log.IsOpen() == true)) {
+               if ((tracked.empty() == false) && (_rollup == nullptr)) {
+                  Account(tracked);
+               }
+
+               StartLogLine();
+
+               for (uint32_t index = 0; index < tracked.size(); index++) {
+                  LogProcess(tracked[index], index);
+               }
+            }
+
             _activity.Schedule(Core::Time::Now().Add(_interval * 1000));
          }
 
     private:
-         uint32_t CountSetBits(uint32_t pageBuffer[], const uint32_t* inverseMask)
+         void LogProcess(const Tracked& entry, const uint32_t index)
          {
-            uint32_t count = 0;
+            ResourceLog::Sample sample {};
 
-            if (inverseMask == nullptr) {
-               for (uint32_t index = 0; index < _bufferEntries; index++) {
-                  count += __builtin_popcount(pageBuffer[index]);
-               }
+            if (_rollup != nullptr) {
+               _rollup->Measure(entry.Ids, sample);
             } else {
-               for (uint32_t index = 0; index < _bufferEntries; index++) {
-                  count += __builtin_popcount(pageBuffer[index] & (~inverseMask[index]));
-               }
+               PageBitmap::Count(_treeMaps[index].data(), _sharedMap, _treeBounds[index].first, _treeBounds[index].second, sample.VSS, sample.USS);
             }
 
-            return count;
-         }
+            sample.Jiffies = entry.Info.Jiffies();
 
-         void LogProcess(const string& name, const Core::ProcessInfo& info)
-         {
-            uint32_t vss = CountSetBits(_ourMap, nullptr);
-            uint32_t uss = CountSetBits(_ourMap, _otherMap);
-            uint64_t jiffies = info.Jiffies();
-
-            uint32_t nameSize = name.length();
-            fwrite(&nameSize, sizeof(nameSize), 1, _binFile);
-            fwrite(name.c_str(), sizeof(name[0]), name.length(), _binFile);
-            fwrite(&vss, 1, sizeof(vss), _binFile);
-            fwrite(&uss, 1, sizeof(uss), _binFile);
-            fwrite(&jiffies, 1, sizeof(jiffies), _binFile);
-            fflush(_binFile);
+            _log.Append(_timestamp, _jiffies, entry.Name, sample);
          }
 
-         void StartLogLine(uint32_t processCount)
+         void StartLogLine()
          {
-            // TODO: no simple time_t alike in Thunder?
-            uint32_t timestamp = static_cast<uint32_t>(Core::Time::Now().Ticks() / 1000 / 1000);
-            uint64_t jiffies = Core::SystemInfo::Instance().GetJiffies();
+            // The wall clock is taken every interval, so once the time is set (NTP, the user) the log follows.
+            // Within this run the log does not go back in time: if the clock was set back, the time stands still
+            // until it caught up again.
+            _timestamp = std::max(static_cast<uint32_t>(Core::Time::Now().Ticks() / 1000 / 1000), _timestamp);
+            _jiffies = Core::SystemInfo::Instance().GetJiffies();
 
-            fwrite(&timestamp, 1, sizeof(timestamp), _binFile);
-            fwrite(&processCount, 1, sizeof(processCount), _binFile);
-            fwrite(&jiffies, 1, sizeof(jiffies), _binFile);
+            _log.StartLine();
          }
 
-         FILE *_binFile;
-         vector<string> _processNames; // Seen process names.
-         Core::CriticalSection _namesLock;
-         uint32_t * _otherMap; // Buffer used to mark other processes pages.
-         uint32_t * _ourMap;   // Buffer for pages used by our process (tree).
+         ResourceLog _log; // Samples, shared with the plugin through the file.
+         uint32_t _timestamp; // Of the line being logged, wall clock time in seconds.
+         uint64_t _jiffies; // Total jiffies at the start of the line being logged.
+         uint32_t * _seenMap;   // Pages claimed by any owner so far.
+         uint32_t * _sharedMap; // Pages claimed by more than one owner.
+         vector<vector<uint32_t> > _treeMaps; // Pages per tracked tree, kept between intervals to reuse the buffers.
+         vector<std::pair<uint32_t, uint32_t> > _treeBounds; // Range of words in use in each of the _treeMaps.
          uint32_t _bufferEntries; // Numer of entries in each buffer.
          uint32_t _interval; // Seconds between measurement.
          Config::CollectMode _collectMode; // Collection style.
          string _parentName; // Process/plugin name we are looking for.
+         string _path; // Of the log.
+         uint32_t _capacity; // Records in the log.
+         uint16_t _refresh; // Intervals after which a page map is walked again.
+         bool _auto; // Set until the backend is picked, see Pick().
+         PageCache* _cache; // Pages per process, from the previous intervals.
+         Rollup* _rollup; // Set if the kernel figures are used instead of the bitmaps.
          Core::WorkerPool::JobType<StatCollecter&> _activity;
 
          friend Core::ThreadPool::JobType<StatCollecter&>;
@@ -409,84 +477,16 @@ namespace Plugin {
 
       string CompileMemoryCsv() override
       {
-         // TODO: should we worry about doing this as repsonse to RPC (could take too long?)
-         FILE* inFile = fopen(_binPath.c_str(), "rb");
-
-         stringstream output;
-         if (inFile != nullptr) {
-
-            vector<string> processNames;
-            _processThread->GetProcessNames(processNames);
-
-            output << _T("time (s)\tJiffies");
-            for (const string& processName : processNames) {
-               output << _T("\t") << processName << _T(" (VSS)\t") << processName << _T(" (USS)\t") << processName << _T(" (jiffies)");
-            }
-            output << endl;
-
-            vector<uint64_t> pageVector(processNames.size() * 3);
-            bool seenFirstTimestamp = false;
-            uint32_t firstTimestamp = 0;
-
-            while (true) {
-               std::fill(pageVector.begin(), pageVector.end(), 0);
-
-               uint32_t timestamp = 0;
-               size_t readCount = fread(&timestamp, sizeof(timestamp), 1, inFile);
-               if (readCount != 1) {
-                  break;
-               }
-
-               if (!seenFirstTimestamp) {
-                  firstTimestamp = timestamp;
-                  seenFirstTimestamp = true;
-               }
-
-               uint32_t processCount = 0;
-               fread(&processCount, sizeof(processCount), 1, inFile);
-
-               uint64_t totalJiffies = 0;
-               fread(&totalJiffies, sizeof(totalJiffies), 1, inFile);
-
-               for (uint32_t processIndex = 0; processIndex < processCount; processIndex++) {
-                  uint32_t nameLength = 0;
-                  fread(&nameLength, sizeof(nameLength), 1, inFile);
-                  // TODO: unicode?
-                  char nameBuffer[nameLength + 1];
-                  fread(nameBuffer, sizeof(char), nameLength, inFile);
-
-                  nameBuffer[nameLength] = '\0';
-                  string name(nameBuffer);
+         ResourceLog log;
+         string output;
 
-                  vector<string>::const_iterator nameIterator = std::find(processNames.cbegin(), processNames.cend(), name);
-
-                  uint32_t vss, uss;
-                  uint64_t jiffies;
-                  fread(&vss, sizeof(vss), 1, inFile);
-                  fread(&uss, sizeof(uss), 1, inFile);
-                  fread(&jiffies, sizeof(jiffies), 1, inFile);
-                  if (nameIterator == processNames.cend()) {
-                     continue;
-                  }
-
-                  int index = nameIterator - processNames.cbegin();
-
-                  pageVector[index * 3] = static_cast<uint64_t>(vss);
-                  pageVector[index * 3 + 1] = static_cast<uint64_t>(uss);
-                  pageVector[index * 3 + 2] = jiffies;
-               }
-
-               output << (timestamp - firstTimestamp) << "\t" << totalJiffies;
-               for (uint32_t pageEntry : pageVector) {
-                  output << "\t" << pageEntry;
-               }
-               output << endl;
-            }
+         if (log.Open(_binPath) == Core::ERROR_NONE) {
+            auto sink = [&output](const string& chunk) { output += chunk; };
 
-            fclose(inFile);
+            log.Csv(0, ~0, 0, sink);
          }
 
-         return output.str();
+         return (output);
       }
 
       BEGIN_INTERFACE_MAP(ResourceMonitorImplementation)
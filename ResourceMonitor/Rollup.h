@@ -0,0 +1,267 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Module.h"
+#include "ResourceLog.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <unordered_set>
+
+namespace WPEFramework {
+namespace Plugin {
+
+    // Memory figures as the kernel keeps them, instead of walking the page maps. Per process smaps_rollup
+    // (kernel 4.14 and up) has the resident, proportional, private and swapped out memory in one small
+    // file. If the processes run in a cgroup (v2) of their own, its memory.stat splits their memory in
+    // anonymous and file backed pages; otherwise that split is taken from the rollups as well. The memory
+    // stall time comes from the pressure (PSI) file of the cgroup, or of the system if there is none.
+    // Reading a handful of small files per process is a fraction of the cost of the bitmaps, and the PSS
+    // is a better answer to "what does this plugin cost" than a USS that drops everything that is shared.
+    class Rollup {
+    private:
+        static constexpr uint32_t BufferSize = 4096;
+
+    public:
+        Rollup(const Rollup&) = delete;
+        Rollup& operator=(const Rollup&) = delete;
+
+        Rollup()
+            : _pageSize(static_cast<uint32_t>(::sysconf(_SC_PAGESIZE)))
+            , _unified(::access("/sys/fs/cgroup/cgroup.controllers", R_OK) == 0)
+        {
+        }
+        ~Rollup()
+        {
+        }
+
+    public:
+        // Whether the kernel has the rollups at all.
+        static bool IsAvailable()
+        {
+            return (::access("/proc/self/smaps_rollup", R_OK) == 0);
+        }
+        // Whether the rollups of these processes can be read. Next to the kernel having them, this process
+        // must be allowed to look into them, as for tracing them, which it is not for every process.
+        static bool IsAvailable(const std::list<::ThreadId>& ids)
+        {
+            char buffer[BufferSize];
+            bool result = true;
+
+            for (std::list<::ThreadId>::const_iterator index(ids.begin()); (result == true) && (index != ids.end()); index++) {
+                result = Read(Path(*index, _T("smaps_rollup")), buffer, sizeof(buffer));
+            }
+
+            return (result);
+        }
+
+        // The processes are accounted as one, the first is the one that decides the cgroup.
+        void Measure(const std::list<::ThreadId>& ids, ResourceLog::Sample& sample)
+        {
+            char buffer[BufferSize];
+            uint64_t rss = 0;
+            uint64_t pss = 0;
+            uint64_t privates = 0;
+            uint64_t swap = 0;
+            uint64_t anonymous = 0;
+
+            for (const ::ThreadId id : ids) {
+                if (Read(Path(id, _T("smaps_rollup")), buffer, sizeof(buffer)) == true) {
+                    uint64_t processRss = Value(buffer, _T("Rss:"));
+                    uint64_t processAnonymous = Value(buffer, _T("Anonymous:"));
+
+                    rss += processRss;
+                    pss += Value(buffer, _T("Pss:"));
+                    privates += Value(buffer, _T("Private_Clean:")) + Value(buffer, _T("Private_Dirty:"));
+                    swap += Value(buffer, _T("Swap:"));
+                    anonymous += std::min(processAnonymous, processRss);
+                }
+            }
+
+            // All in kB, logged in pages like the bitmaps.
+            sample.VSS = Pages(rss * 1024);
+            sample.USS = Pages(privates * 1024);
+            sample.PSS = Pages(pss * 1024);
+            sample.Swap = Pages(swap * 1024);
+            sample.Anon = Pages(anonymous * 1024);
+            sample.File = Pages((rss - anonymous) * 1024);
+            sample.Stall = 0;
+
+            string group;
+
+            if ((ids.empty() == false) && (Group(ids.front(), group) == true)) {
+                if ((group != _T("/")) && (IsExclusive(group, ids) == true) && (Read(group + _T("/memory.stat"), buffer, sizeof(buffer)) == true)) {
+                    sample.Anon = Pages(Value(buffer, _T("anon ")));
+                    sample.File = Pages(Value(buffer, _T("file ")));
+                }
+
+                if (Read(group + _T("/memory.pressure"), buffer, sizeof(buffer)) == true) {
+                    sample.Stall = Stall(buffer);
+                } else if (Read(_T("/proc/pressure/memory"), buffer, sizeof(buffer)) == true) {
+                    sample.Stall = Stall(buffer);
+                }
+            } else if (Read(_T("/proc/pressure/memory"), buffer, sizeof(buffer)) == true) {
+                sample.Stall = Stall(buffer);
+            }
+        }
+
+    private:
+        inline uint32_t Pages(const uint64_t bytes) const
+        {
+            return (static_cast<uint32_t>(bytes / _pageSize));
+        }
+        // Directory of the v2 cgroup the process is in, from the "0::<path>" line of /proc/<pid>/cgroup.
+        bool Group(const ::ThreadId id, string& group) const
+        {
+            char buffer[BufferSize];
+            bool result = false;
+
+            if ((_unified == true) && (Read(Path(id, _T("cgroup")), buffer, sizeof(buffer)) == true)) {
+                const char* line = buffer;
+
+                while ((result == false) && (line != nullptr) && (*line != '\0')) {
+                    if (::strncmp(line, "0::", 3) == 0) {
+                        const char* end = ::strchr(line, '\n');
+                        const string path(line + 3, (end != nullptr ? end - (line + 3) : ::strlen(line + 3)));
+
+                        group = _T("/sys/fs/cgroup") + (path == _T("/") ? string() : path);
+                        result = true;
+                    } else {
+                        line = ::strchr(line, '\n');
+                        line = (line != nullptr ? line + 1 : nullptr);
+                    }
+                }
+            }
+
+            return (result);
+        }
+        // The cgroup figures are only those of the processes if nothing else runs in it.
+        static bool IsExclusive(const string& group, const std::list<::ThreadId>& ids)
+        {
+            string procs;
+            bool result = false;
+
+            if (ReadAll(group + _T("/cgroup.procs"), procs) == true) {
+                std::unordered_set<::ThreadId> tracked(ids.begin(), ids.end());
+                const char* position = procs.c_str();
+                char* end = nullptr;
+
+                result = true;
+
+                while (result == true) {
+                    const unsigned long id = ::strtoul(position, &end, 10);
+
+                    if (end == position) {
+                        break;
+                    }
+
+                    result = (tracked.find(static_cast<::ThreadId>(id)) != tracked.end());
+                    position = end;
+                }
+            }
+
+            return (result);
+        }
+        // The "total" of the "some" line, in microseconds.
+        static uint64_t Stall(const char buffer[])
+        {
+            uint64_t result = 0;
+
+            if (::strncmp(buffer, "some ", 5) == 0) {
+                const char* end = ::strchr(buffer, '\n');
+                const char* total = ::strstr(buffer, "total=");
+
+                if ((total != nullptr) && ((end == nullptr) || (total < end))) {
+                    result = ::strtoull(total + 6, nullptr, 10);
+                }
+            }
+
+            return (result);
+        }
+        // Number after the key, the key is matched at the start of a line.
+        static uint64_t Value(const char buffer[], const char key[])
+        {
+            const size_t length = ::strlen(key);
+            const char* line = buffer;
+            uint64_t result = 0;
+
+            while (line != nullptr) {
+                if (::strncmp(line, key, length) == 0) {
+                    result = ::strtoull(line + length, nullptr, 10);
+                    break;
+                }
+
+                line = ::strchr(line, '\n');
+                line = (line != nullptr ? line + 1 : nullptr);
+            }
+
+            return (result);
+        }
+        static string Path(const ::ThreadId id, const TCHAR file[])
+        {
+            return (_T("/proc/") + std::to_string(id) + '/' + file);
+        }
+        static bool Read(const string& path, char buffer[], const uint32_t length)
+        {
+            bool result = false;
+            int descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+            if (descriptor != -1) {
+                ssize_t count = ::read(descriptor, buffer, length - 1);
+
+                if (count > 0) {
+                    buffer[count] = '\0';
+                    result = true;
+                }
+
+                ::close(descriptor);
+            }
+
+            return (result);
+        }
+        static bool ReadAll(const string& path, string& content)
+        {
+            bool result = false;
+            int descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+            if (descriptor != -1) {
+                char buffer[BufferSize];
+                ssize_t count;
+
+                content.clear();
+                while ((count = ::read(descriptor, buffer, sizeof(buffer))) > 0) {
+                    content.append(buffer, count);
+                }
+
+                result = (count == 0);
+                ::close(descriptor);
+            }
+
+            return (result);
+        }
+
+    private:
+        const uint32_t _pageSize;
+        const bool _unified;
+    };
+
+} // namespace Plugin
+} // namespace WPEFramework
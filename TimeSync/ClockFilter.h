@@ -0,0 +1,243 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Module.h"
+
+#include <cmath>
+
+namespace WPEFramework {
+namespace Plugin {
+
+    // The clock filter and the selection of NTP (RFC 5905 sections 10 and 11.2.1). Every server keeps its last
+    // samples, the filter makes an offset and an error estimate of them, the selection picks the servers that
+    // agree on the time and combines their offsets, the frequency loop turns what is left into a correction of
+    // the rate of the local clock. All times are in seconds, epochs are in ticks.
+    struct ClockFilter {
+        // Samples kept per server.
+        static constexpr uint8_t Length = 8;
+
+        // Constants of RFC 5905 section 7.2.
+        static constexpr double Frequency = 15e-6; // PHI, tolerance of the local clock (15 PPM)
+        static constexpr double Precision = 1e-6; // local clock, Core::Time is in microseconds
+        static constexpr double MinimumDispersion = 0.005; // MINDISP
+
+        // Frequency loop of the discipline.
+        static constexpr double MaximumFrequency = 500e-6; // what the kernel can correct, 500 PPM
+        static constexpr double FrequencyGain = 0.25; // part of the measured frequency error that is taken over
+
+        struct Sample {
+            double Offset;
+            double Delay; // round trip
+            double Dispersion; // when it was taken
+            uint64_t Epoch; // when it was taken
+        };
+
+        // A server as the filter and the selection see it.
+        struct Source {
+            uint8_t Count;
+            Sample Samples[Length]; // newest first
+            double RootDelay;
+            double RootDispersion;
+            double Offset;
+            double Delay;
+            double Dispersion;
+            double Jitter;
+            double Distance;
+            bool Selected;
+        };
+
+        static void Add(Source& source, const Sample& sample)
+        {
+            for (uint8_t index = (Length - 1); index > 0; index--) {
+                source.Samples[index] = source.Samples[index - 1];
+            }
+
+            source.Samples[0] = sample;
+
+            if (source.Count < Length) {
+                source.Count++;
+            }
+        }
+
+        // The sample with the shortest round trip is the most trustworthy, the spread of the others tells how much
+        // it can be trusted.
+        static void Filter(Source& source, const uint64_t now)
+        {
+            Sample samples[Length];
+
+            for (uint8_t index = 0; index < source.Count; index++) {
+                // If the clock was set back behind our back, a sample is from the future, take it as a fresh one.
+                const uint64_t age = (now > source.Samples[index].Epoch ? now - source.Samples[index].Epoch : 0);
+
+                samples[index] = source.Samples[index];
+                // Samples get less accurate as the local clock drifts away from them.
+                samples[index].Dispersion += Frequency * (static_cast<double>(age) / 1000000);
+            }
+
+            std::stable_sort(&samples[0], &samples[source.Count], [](const Sample& lhs, const Sample& rhs) {
+                return (lhs.Delay < rhs.Delay);
+            });
+
+            double dispersion = 0;
+            double jitter = 0;
+
+            for (uint8_t index = 0; index < source.Count; index++) {
+                dispersion += std::ldexp(samples[index].Dispersion, -(index + 1));
+
+                if (index != 0) {
+                    jitter += (samples[index].Offset - samples[0].Offset) * (samples[index].Offset - samples[0].Offset);
+                }
+            }
+
+            source.Offset = samples[0].Offset;
+            source.Delay = samples[0].Delay;
+            source.Dispersion = dispersion;
+            source.Jitter = std::max((source.Count > 1 ? std::sqrt(jitter / (source.Count - 1)) : 0.0), static_cast<double>(Precision));
+
+            // Root distance, the maximum error of the offset relative to the primary reference.
+            source.Distance = (std::max(static_cast<double>(MinimumDispersion), source.RootDelay + source.Delay) / 2) + source.RootDispersion + source.Dispersion + source.Jitter;
+        }
+
+        // The true time lies within [offset - distance, offset + distance] of every correct server, so the largest
+        // group of servers that agree on that wins. The offsets of that group are combined, weighted by their
+        // distance. If there is no majority, the most accurate server is taken. Returns the most accurate of the
+        // selected, nullptr if there are no candidates.
+        static const Source* Select(const std::vector<Source*>& candidates, double& offset, double& jitter)
+        {
+            struct Edge {
+                double Value;
+                int8_t Type; // -1 lower, 0 middle, +1 upper
+            };
+
+            const uint32_t count = static_cast<uint32_t>(candidates.size());
+            std::vector<Edge> edges;
+            double low = 0;
+            double high = 0;
+            bool found = false;
+
+            for (const Source* source : candidates) {
+                edges.push_back({ source->Offset - source->Distance, -1 });
+                edges.push_back({ source->Offset, 0 });
+                edges.push_back({ source->Offset + source->Distance, +1 });
+            }
+
+            std::sort(edges.begin(), edges.end(), [](const Edge& lhs, const Edge& rhs) {
+                return (lhs.Value < rhs.Value);
+            });
+
+            for (uint32_t allow = 0; ((found == false) && ((2 * allow) < count)); allow++) {
+                uint32_t midpoints = 0;
+                int32_t chime = 0;
+
+                for (std::vector<Edge>::const_iterator index(edges.begin()); index != edges.end(); index++) {
+                    chime -= index->Type;
+                    if (chime >= static_cast<int32_t>(count - allow)) {
+                        low = index->Value;
+                        break;
+                    }
+                    if (index->Type == 0) {
+                        midpoints++;
+                    }
+                }
+
+                chime = 0;
+
+                for (std::vector<Edge>::const_reverse_iterator index(edges.rbegin()); index != edges.rend(); index++) {
+                    chime += index->Type;
+                    if (chime >= static_cast<int32_t>(count - allow)) {
+                        high = index->Value;
+                        break;
+                    }
+                    if (index->Type == 0) {
+                        midpoints++;
+                    }
+                }
+
+                found = ((midpoints <= allow) && (low < high));
+            }
+
+            if (found == false) {
+                Source* closest = nullptr;
+
+                if (count != 0) {
+                    // No majority, better the most accurate server than no time at all.
+                    TRACE(Trace::Warning, (_T("TimeSync: The NTP Servers do not agree on the time")));
+                }
+
+                for (Source* source : candidates) {
+                    source->Selected = false;
+
+                    if ((closest == nullptr) || (source->Distance < closest->Distance)) {
+                        closest = source;
+                    }
+                }
+
+                if (closest != nullptr) {
+                    closest->Selected = true;
+                }
+            } else {
+                for (Source* source : candidates) {
+                    source->Selected = ((source->Offset >= low) && (source->Offset <= high));
+                }
+            }
+
+            const Source* best = nullptr;
+            double weights = 0;
+
+            offset = 0;
+
+            for (const Source* source : candidates) {
+                if (source->Selected == true) {
+                    offset += source->Offset / source->Distance;
+                    weights += 1.0 / source->Distance;
+
+                    if ((best == nullptr) || (source->Distance < best->Distance)) {
+                        best = source;
+                    }
+                }
+            }
+
+            if (best != nullptr) {
+                offset /= weights;
+                jitter = best->Jitter;
+            }
+
+            return (best);
+        }
+
+        // The offset that is left after a slew, over the interval since, is an error in the rate of the local
+        // clock, part of it is taken over in the frequency correction. The part of the previous slew the kernel
+        // did not get to yet (pending) is no error. Returns the new frequency correction, in seconds per second.
+        static double Discipline(const double frequency, const double offset, const double pending, const double interval)
+        {
+            double result = frequency;
+
+            if (interval > 0) {
+                result += FrequencyGain * ((offset - pending) / interval);
+                result = std::max(-MaximumFrequency, std::min(result, static_cast<double>(MaximumFrequency)));
+            }
+
+            return (result);
+        }
+    };
+
+} // namespace Plugin
+} // namespace WPEFramework
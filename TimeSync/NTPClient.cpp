@@ -19,11 +19,29 @@
 
 #include "NTPClient.h"
 #include <stdio.h>
+#include <cerrno>
+#include <cmath>
+#include <limits>
+
+#ifndef __WINDOWS__
+#include <sys/timex.h>
+#endif
 
 namespace WPEFramework {
 namespace Plugin {
 
     constexpr uint32_t WaitForResponse = 2000;
+    // The queries of a burst are spaced out, so they do not all end up in the same queue on the way.
+    constexpr uint32_t BurstInterval = 2000;
+
+    // Discipline of the local clock, offsets in seconds.
+    constexpr double StepThreshold = 0.128; // STEPT, further off than this and the clock is set straight
+    constexpr double PollGate = 4; // an offset within this many times the jitter is a quiet one
+    constexpr double MinimumGate = 0.0005;
+    constexpr uint8_t PollAdjust = 4; // quiet polls in a row before the poll interval is doubled
+    constexpr uint8_t MaximumPoll = 17; // MAXPOLL, 36 hours
+
+    /* static */ constexpr uint8_t NTPClient::BurstLength;
 
 #ifdef __WINDOWS__
 #pragma warning(disable : 4355)
@@ -34,9 +52,21 @@ namespace Plugin {
         , _packet()
         , _syncedTimestamp()
         , _state(INITIAL)
-        , _fired(true)
+        , _querying(false)
+        , _lastSent(0)
         , _WaitForNetwork(2000) // Wait for 2 Seconds for a new attempt
         , _retryAttempts(5)
+        , _currentAttempt(0)
+        , _peers()
+        , _source()
+        , _discipline(false)
+        , _minPoll(6)
+        , _maxPoll(10)
+        , _poll(6)
+        , _stable(0)
+        , _frequency(0)
+        , _tracked(0)
+        , _slewing(0)
         , _activity(Core::ProxyType<Activity>::Create(this))
         , _clients()
     {
@@ -65,7 +95,7 @@ namespace Plugin {
     {
         _retryAttempts = retries;
         _WaitForNetwork = (delay * 1000); /* in ms */
-        _servers.clear();
+        _peers.clear();
 
         while (sources.Next() == true) {
             Core::URL url(sources.Current().Value());
@@ -82,11 +112,51 @@ namespace Plugin {
                     hostname += ':' + Core::NumberType<uint16_t>(Core::URL::Port(url.Type())).Text();
                 }
 
-                _servers.push_back(hostname);
+                Peer peer;
+                peer.Name = hostname;
+                peer.Queued = false;
+                peer.Pending = false;
+                peer.Burst = 0;
+                peer.Answers = 0;
+                peer.Count = 0;
+                peer.RootDelay = 0;
+                peer.RootDispersion = 0;
+                peer.Offset = 0;
+                peer.Delay = 0;
+                peer.Dispersion = 0;
+                peer.Jitter = 0;
+                peer.Distance = 0;
+                peer.Queries = 0;
+                peer.Responses = 0;
+                peer.Poll = 0;
+                peer.Selected = false;
+
+                _peers.push_back(peer);
             }
         }
+    }
+
+    void NTPClient::Discipline(const uint8_t minPoll, const uint8_t maxPoll)
+    {
+        _adminLock.Lock();
+
+        _discipline = true;
+        _minPoll = std::min(minPoll, MaximumPoll);
+        _maxPoll = std::min(std::max(_minPoll, maxPoll), MaximumPoll);
+        _poll = _minPoll;
+        _stable = 0;
+
+#ifndef __WINDOWS__
+        // Carry on from the frequency correction the kernel has now, it is likely better than none at all.
+        struct timex info;
+        ::memset(&info, 0, sizeof(info));
+
+        if (::adjtimex(&info) != -1) {
+            _frequency = static_cast<double>(info.freq) / (65536.0 * MicroSeconds);
+        }
+#endif
 
-        _serverIndex = ServerIterator(_servers);
+        _adminLock.Unlock();
     }
 
     /* virtual */ uint32_t NTPClient::Synchronize()
@@ -97,12 +167,23 @@ namespace Plugin {
 
         _adminLock.Lock();
 
-        if ((_state == INITIAL) || (_state == SUCCESS) || ((_state == FAILED) && (_serverIndex.IsValid() == false))) {
+        if (_peers.empty() == true) {
+            TRACE(Trace::Warning, (_T("TimeSync: No NTP servers configured")));
+        } else if ((_state == INITIAL) || (_state == SUCCESS) || (_state == FAILED)) {
             result = Core::ERROR_NONE;
             _state = SENDREQUEST;
             Core::IWorkerPool::Instance().Submit(_activity);
         } else if (_state == SENDREQUEST || _state == INPROGRESS) {
             result = Core::ERROR_INPROGRESS;
+        } else if (_state == TRACKING) {
+            if (_querying == true) {
+                result = Core::ERROR_INPROGRESS;
+            } else {
+                // Do not wait for the next poll.
+                result = Core::ERROR_NONE;
+                Core::IWorkerPool::Instance().Revoke(_activity);
+                Core::IWorkerPool::Instance().Submit(_activity);
+            }
         }
 
         _adminLock.Unlock();
@@ -114,7 +195,20 @@ namespace Plugin {
     {
         _adminLock.Lock();
 
-        if ((_state != INITIAL) && (_state != FAILED) && (_state != SUCCESS)) {
+        // Cancelling is what comes before the time is set by hand, after that the samples are of no use.
+        Clear();
+
+        if (_state == TRACKING) {
+            // The time is good, just stop keeping it on track.
+            TRACE_L1("TimeSync: %s", "Stop tracking, Closing socket");
+            Close(0);
+
+            _state = SUCCESS;
+            _querying = false;
+
+            Core::IWorkerPool::Instance().Revoke(_activity);
+        }
+        else if ((_state != INITIAL) && (_state != FAILED) && (_state != SUCCESS)) {
 
             if (!IsClosed()) {
                 TRACE_L1("TimeSync: %s", "Cancelling, Closing socket");
@@ -122,6 +216,7 @@ namespace Plugin {
             }
 
             _state = FAILED;
+            _querying = false;
 
             Core::IWorkerPool::Instance().Revoke(_activity);
             Core::IWorkerPool::Instance().Submit(_activity);
@@ -136,7 +231,45 @@ namespace Plugin {
 
     /* virtual */ string NTPClient::Source() const
     {
-        return (_serverIndex.IsValid() == true ? string(_T("NTP://")) + (*_serverIndex) + '/' : _T("NTP:///"));
+        _adminLock.Lock();
+        string result(string(_T("NTP://")) + _source + '/');
+        _adminLock.Unlock();
+
+        return (result);
+    }
+
+    // Seconds as a whole number of microseconds, out of range values (a server that is way off, an unknown
+    // distance) end up at the limits of the type rather than wherever the conversion takes them.
+    template <typename TYPE>
+    inline static TYPE Microseconds(const double seconds)
+    {
+        const double value = std::round(seconds * NTPClient::MicroSeconds);
+        const double lowest = static_cast<double>(std::numeric_limits<TYPE>::lowest());
+        const double highest = static_cast<double>(std::numeric_limits<TYPE>::max());
+
+        return (std::isnan(value) ? 0 : (value <= lowest ? std::numeric_limits<TYPE>::lowest() : (value >= highest ? std::numeric_limits<TYPE>::max() : static_cast<TYPE>(value))));
+    }
+
+    void NTPClient::Peers(std::list<Statistics>& peers) const
+    {
+        _adminLock.Lock();
+
+        for (const Peer& peer : _peers) {
+            Statistics entry;
+
+            entry.Server = peer.Name;
+            entry.Queries = peer.Queries;
+            entry.Responses = peer.Responses;
+            entry.Offset = Microseconds<int64_t>(peer.Offset);
+            entry.Delay = Microseconds<uint32_t>(peer.Delay);
+            entry.Jitter = Microseconds<uint32_t>(peer.Jitter);
+            entry.Distance = Microseconds<uint32_t>(peer.Distance);
+            entry.Selected = peer.Selected;
+
+            peers.push_back(entry);
+        }
+
+        _adminLock.Unlock();
     }
 
     /* virtual */ void NTPClient::Register(Exchange::ITimeSync::INotification* notification)
@@ -174,17 +307,37 @@ namespace Plugin {
 
         _adminLock.Lock();
 
-        if (_fired == false) {
+        // One query per call, the socket keeps on asking as long as there is something to send.
+        std::vector<Peer>::iterator index(_peers.begin());
+
+        while ((index != _peers.end()) && (index->Queued == false)) {
+            index++;
+        }
+
+        if (index != _peers.end()) {
+            uint64_t now = Core::Time::Now().Ticks();
+
+            // The transmit timestamp is what tells the answers apart, so no two queries get the same one.
+            if (now <= _lastSent) {
+                now = _lastSent + 1;
+            }
+            _lastSent = now;
+
+            index->Queued = false;
+            index->Pending = true;
+            index->Burst--;
+            index->Queries++;
+            index->Sent = NTPPacket::Timestamp(Core::Time(now));
 
-            _fired = true;
+            RemoteNode(index->Node);
 
             DataFrame newFrame(dataFrame, maxSendSize);
             DataFrame::Writer writer(newFrame, 0);
-            _packet.TransmitTimestamp(NTPPacket::Timestamp(Core::Time::Now()));
+            _packet.TransmitTimestamp(index->Sent);
             _packet.Serialize(writer);
 
             result = newFrame.Size();
-            TRACE_L1("Timesync: Send data: %d bytes", result);
+            TRACE_L1("Timesync: Send data: %d bytes to %s", result, index->Name.c_str());
         }
 
         _adminLock.Unlock();
@@ -192,20 +345,20 @@ namespace Plugin {
         return result;
     }
 
-    inline static uint64_t SecondsToTicks(double seconds)
+    inline static int64_t SecondsToTicks(double seconds)
     {
-        return static_cast<uint64_t>(seconds * NTPClient::MicroSeconds);
+        return static_cast<int64_t>(seconds * NTPClient::MicroSeconds);
     }
 
     /* virtual */ uint16_t NTPClient::ReceiveData(uint8_t* dataFrame, const uint16_t receivedSize)
     {
-        double received = static_cast<double>(Core::Time::Now().Ticks() / MicroSeconds);
+        double received = static_cast<double>(Core::Time::Now().Ticks()) / MicroSeconds;
 
         TRACE_L1("Timesync: Received data: %d bytes", receivedSize);
 
         _adminLock.Lock();
 
-        if (receivedSize == NTPPacket::PacketSize) {
+        if ((receivedSize == NTPPacket::PacketSize) && (_querying == true)) {
 
             DataFrame frame(dataFrame, receivedSize, receivedSize);
             NTPPacket packet;
@@ -215,49 +368,63 @@ namespace Plugin {
 // packet.DisplayPacket();
 #endif
 
-            double receivedServerTS = packet.ReceiveTimestamp().TimeSeconds();
-            double sentServerTS = packet.TransmitTimestamp().TimeSeconds();
-            double sentTS = packet.OriginalTimestamp().TimeSeconds();
+            const NTPPacket::Timestamp origin(packet.OriginalTimestamp());
+            std::vector<Peer>::iterator peer(_peers.begin());
 
-            double diffRequest = receivedServerTS - sentTS;
-            double diffResponse = sentServerTS - received;
-            double offset = (diffRequest + diffResponse) / 2;
+            while ((peer != _peers.end()) && ((peer->Pending == false) || (peer->Sent != origin))) {
+                peer++;
+            }
 
-#ifdef __DEBUG__
-            double elapsedServer = sentServerTS - receivedServerTS;
-            double elapsedTotal = received - sentTS;
-            double roundTrip = elapsedTotal - elapsedServer;
-#endif
+            if (peer == _peers.end()) {
+                TRACE_L1("TimeSync: %s", "Dropped a response that does not match any query in flight");
+            } else {
+                peer->Pending = false;
 
-            TRACE_L1("Request time diff  = %lf", diffRequest);
-            TRACE_L1("Response time diff = %lf", diffResponse);
-            TRACE_L1("Offset time        = %lf", offset);
+                if ((packet.NTPMode() != 4) || (packet.Stratum() == 0) || (packet.Stratum() >= 16) || (packet.LeapIndicator() == 3)) {
+                    // Not synchronized, or a kiss-o'-death, do not bother this server any further this round.
+                    TRACE(Trace::Warning, (_T("TimeSync: [%s] is not usable, stratum %d, leap %d"), peer->Name.c_str(), packet.Stratum(), packet.LeapIndicator()));
+                    peer->Burst = 0;
+                } else {
+                    const double Fraction_16_16 = 65536.0;
 
-#ifdef __DEBUG__
-            TRACE_L1("Server elapsed time = %lf", elapsedServer);
-            TRACE_L1("Total elapsed time  = %lf", elapsedTotal);
-            TRACE_L1("Round trip time     = %lf", roundTrip);
-#endif
-            TRACE(Trace::Information, (_T("TimeSync: Request time diff   = %lf s"), diffRequest));
-            TRACE(Trace::Information, (_T("TimeSync: Response time diff  = %lf s"), diffResponse));
-            TRACE(Trace::Information, (_T("TimeSync: Offset time         = %lf s"), offset));
+                    double receivedServerTS = packet.ReceiveTimestamp().TimeSeconds();
+                    double sentServerTS = packet.TransmitTimestamp().TimeSeconds();
+                    double sentTS = origin.TimeSeconds();
 
-            uint64_t receivedTicks = SecondsToTicks(received);
-            TRACE(Trace::Information, (_T("TimeSync: Current time: %s"), Core::Time(receivedTicks).ToRFC1123(false).c_str()));
-            _syncedTimestamp = Core::Time(receivedTicks + SecondsToTicks(offset));
-            TRACE(Trace::Information, (_T("TimeSync: New time:     %s"), _syncedTimestamp.ToRFC1123(false).c_str()));
+                    double diffRequest = receivedServerTS - sentTS;
+                    double diffResponse = sentServerTS - received;
+                    double offset = (diffRequest + diffResponse) / 2;
+                    double elapsedServer = sentServerTS - receivedServerTS;
+                    double elapsedTotal = received - sentTS;
+                    double roundTrip = std::max(elapsedTotal - elapsedServer, static_cast<double>(ClockFilter::Precision));
 
-            _state = SUCCESS;
+                    TRACE(Trace::Information, (_T("TimeSync: [%s] offset %lf s, round trip %lf s"), peer->Name.c_str(), offset, roundTrip));
 
-            // We don't need the socket anymore, so close it
-            TRACE_L1("TimeSync: %s", "Closing socket, no longer needed");
-            Close(0);
+                    // The samples already in the filter are to be relative to the clock as it is now as well.
+                    Slewed();
 
-            // Lets remove the watchdog subject, we do not want to wait anymore, we got an answer.
-            Core::IWorkerPool::Instance().Revoke(_activity);
+                    ClockFilter::Sample sample;
+                    sample.Offset = offset;
+                    sample.Delay = roundTrip;
+                    sample.Dispersion = std::ldexp(1.0, static_cast<int8_t>(packet.Precision())) + ClockFilter::Precision + (ClockFilter::Frequency * elapsedTotal);
+                    sample.Epoch = static_cast<uint64_t>(SecondsToTicks(received));
 
-            // Schedule it again to broadcast the successfull update of the time.
-            Core::IWorkerPool::Instance().Submit(_activity);
+                    ClockFilter::Add(*peer, sample);
+
+                    peer->RootDelay = packet.RootDelay() / Fraction_16_16;
+                    peer->RootDispersion = packet.RootDispersion() / Fraction_16_16;
+                    peer->Poll = packet.Poll();
+                    peer->Answers++;
+                    peer->Responses++;
+                }
+
+                // The next query of a burst waits for its turn, see Continue().
+                if (Outstanding() == false) {
+                    // Everybody answered, no need to wait for the watchdog.
+                    Core::IWorkerPool::Instance().Revoke(_activity);
+                    Core::IWorkerPool::Instance().Submit(_activity);
+                }
+            }
         }
 
         _adminLock.Unlock();
@@ -275,65 +442,292 @@ namespace Plugin {
         }
     }
 
-    bool NTPClient::FireRequest()
+    bool NTPClient::FireRequest(const uint8_t burst)
     {
 
         bool activated = false;
 
-        // Make sure socket is closed otherwise an assert will fire.
-        if (!IsClosed()) {
+        // Make sure socket is closed otherwise an assert will fire. While tracking, the socket stays.
+        if ((_discipline == false) && (!IsClosed())) {
             TRACE(Trace::Information, (_T("Lingering socket, closing")));
             Close(1000);
         }
 
-        if (true == IsClosed() && (_serverIndex.Count() > 0)) {
+        if ((true == IsClosed()) || (_discipline == true)) {
 
-            uint32_t lastonetried = _serverIndex.Index();
+            // All servers are asked at once, over the same socket. The answers are told apart by the origin
+            // timestamp, which is the transmit timestamp of the query they answer.
+            for (Peer& peer : _peers) {
 
-            do {
+                TRACE(Trace::Information, (_T("Trying NTP Server: [%s]"), peer.Name.c_str()));
 
-                // next server
-                if( _serverIndex.Index() >= _serverIndex.Count() ) {
-                    _serverIndex.Reset(0);
+                // A server that answered before is not looked up again, unless the socket was gone.
+                if ((IsClosed() == true) || (peer.Answers == 0) || (peer.Node.IsValid() == false)) {
+                    peer.Node = Core::NodeId(peer.Name.c_str(), Core::NodeId::TYPE_IPV4);
                 }
-                _serverIndex.Next();
-                ASSERT(_serverIndex.IsValid());
-
-                TRACE(Trace::Information, (_T("Trying NTP Server: [%s]"), (*_serverIndex).c_str()));
 
-                // Set the socket to send to the remote
-                Core::NodeId remote((*_serverIndex).c_str(), Core::NodeId::TYPE_IPV4);
+                peer.Queued = false;
+                peer.Pending = false;
+                peer.Burst = 0;
+                peer.Answers = 0;
 
-                if (remote.IsValid() == true) {
-                    // Set the remote endpoint for the socket to the selected NTP server
-                    RemoteNode(remote);
-                    LocalNode(remote.AnyInterface());
+                if (peer.Node.IsValid() == true) {
+                    if ((activated == false) && (IsClosed() == true)) {
+                        // Set the socket up for the first server, every query sets its own destination.
+                        RemoteNode(peer.Node);
+                        LocalNode(peer.Node.AnyInterface());
+                    }
 
-                    // UDP should open by definition directly...
-                    uint32_t status = Open(100);
+                    activated = true;
+                    peer.Queued = true;
+                    peer.Burst = burst;
+                }
+                else {
+                    TRACE(Trace::Warning, (_T("Could not resolve NTP Server [%s]"), peer.Name.c_str()));
+                }
+            }
 
-                    if ((status == Core::ERROR_NONE) || (status == Core::ERROR_INPROGRESS)) {
+            if (activated == true) {
+                // UDP should open by definition directly...
+                uint32_t status = (IsClosed() == true ? Open(100) : Core::ERROR_NONE);
 
-                        activated = true;
-                        _fired = false;
-                        Trigger();
-                    }
-                    else {
-                        TRACE(Trace::Warning, (_T("Could not open connection to NTP Server [%s]"), (*_serverIndex).c_str()));
-                    }
+                if ((status == Core::ERROR_NONE) || (status == Core::ERROR_INPROGRESS)) {
+                    _querying = true;
+                    Trigger();
                 }
                 else {
-                    TRACE(Trace::Warning, (_T("Could not resolve NTP Server [%s]"), (*_serverIndex).c_str()));
+                    TRACE(Trace::Warning, (_T("Could not open a socket for the NTP Servers")));
+                    activated = false;
                 }
             }
-            while ((activated == false) && ( ((lastonetried != 0) && (lastonetried != _serverIndex.Index())) ||
-                                             ((lastonetried == 0) && (_serverIndex.Index() != _serverIndex.Count())) 
-                                           ) );
         }
 
         return (activated);
     }
 
+    bool NTPClient::Outstanding() const
+    {
+        std::vector<Peer>::const_iterator index(_peers.begin());
+
+        while ((index != _peers.end()) && (index->Queued == false) && (index->Pending == false) && (index->Burst == 0)) {
+            index++;
+        }
+
+        return (index != _peers.end());
+    }
+
+    // Sends the next query of the burst to all servers that have some left, whether the previous one was answered
+    // or not. Returns false once the bursts are over.
+    bool NTPClient::Continue()
+    {
+        bool queued = false;
+
+        for (Peer& peer : _peers) {
+            if (peer.Burst != 0) {
+                peer.Queued = true;
+                peer.Pending = false;
+                queued = true;
+            }
+        }
+
+        if (queued == true) {
+            Trigger();
+        }
+
+        return (queued);
+    }
+
+    // Only the servers that answered this round take part, with what their clock filter makes of their samples.
+    bool NTPClient::Select(double& offset, double& jitter)
+    {
+        const uint64_t now = Core::Time::Now().Ticks();
+        std::vector<ClockFilter::Source*> candidates;
+
+        for (Peer& peer : _peers) {
+            peer.Selected = false;
+
+            if ((peer.Answers != 0) && (peer.Count != 0)) {
+                ClockFilter::Filter(peer, now);
+                candidates.push_back(&peer);
+            }
+        }
+
+        const Peer* best = static_cast<const Peer*>(ClockFilter::Select(candidates, offset, jitter));
+
+        if (best != nullptr) {
+            uint32_t selected = 0;
+
+            for (const Peer& peer : _peers) {
+                if (peer.Selected == true) {
+                    selected++;
+                }
+            }
+
+            _source = best->Name;
+
+            TRACE(Trace::Information, (_T("TimeSync: Offset time         = %lf s, from %d of %d servers"), offset, selected, static_cast<uint32_t>(candidates.size())));
+
+            int64_t ticks = static_cast<int64_t>(now) + SecondsToTicks(offset);
+            TRACE(Trace::Information, (_T("TimeSync: Current time: %s"), Core::Time(now).ToRFC1123(false).c_str()));
+            _syncedTimestamp = Core::Time(static_cast<uint64_t>(ticks));
+            TRACE(Trace::Information, (_T("TimeSync: New time:     %s"), _syncedTimestamp.ToRFC1123(false).c_str()));
+        }
+
+        return (best != nullptr);
+    }
+
+    // Clock discipline, while tracking. Small offsets are slewed away by the kernel, larger ones are stepped. What
+    // was left of the previous correction comes back from the kernel, the offset that built up on top of that since
+    // the previous poll is an error in the rate of the local clock, so part of it goes into the frequency correction.
+    // A slew takes a while (about half a millisecond per second), the samples are only corrected for what the kernel
+    // actually slewed, as it goes, see Slewed().
+    // The poll interval doubles after a few quiet polls in a row, and halves on every restless one. Returns the
+    // time (in ms) until the next poll.
+    uint32_t NTPClient::Track(const double offset, const double jitter)
+    {
+        const uint64_t now = Core::Time::Now().Ticks();
+        bool slewed = false;
+
+#ifndef __WINDOWS__
+        struct timex info;
+
+        if (std::fabs(offset) <= StepThreshold) {
+            ::memset(&info, 0, sizeof(info));
+            info.modes = ADJ_OFFSET_SINGLESHOT;
+            info.offset = std::lround(offset * MicroSeconds);
+
+            if (::adjtimex(&info) != -1) {
+                const double pending = static_cast<double>(info.offset) / MicroSeconds;
+                const double interval = static_cast<double>(now - _tracked) / MicroSeconds;
+
+                if (_tracked != 0) {
+                    _frequency = ClockFilter::Discipline(_frequency, offset, pending, interval);
+                }
+
+                ::memset(&info, 0, sizeof(info));
+
+                if (::adjtimex(&info) != -1) {
+                    // Our own loop runs the clock, tell the kernel it is synchronized, but not by its own PLL.
+                    info.modes = ADJ_FREQUENCY | ADJ_STATUS | ADJ_MAXERROR | ADJ_ESTERROR;
+                    info.freq = std::lround(_frequency * MicroSeconds * 65536.0);
+                    info.status &= ~(STA_UNSYNC | STA_PLL | STA_FLL);
+                    info.maxerror = std::lround((std::fabs(offset) + jitter) * MicroSeconds);
+                    info.esterror = std::lround(jitter * MicroSeconds);
+
+                    slewed = (::adjtimex(&info) != -1);
+                }
+
+                // What is left of the previous offset was replaced by this one.
+                _slewing = offset;
+            }
+
+            if (slewed == false) {
+                TRACE(Trace::Warning, (_T("TimeSync: Could not slew the clock, error %d"), errno));
+            }
+        }
+#endif
+
+        if (slewed == true) {
+            TRACE(Trace::Information, (_T("TimeSync: Slewing %lf s, frequency %lf PPM"), offset, _frequency * MicroSeconds));
+
+            if (std::fabs(offset) < std::max(PollGate * jitter, MinimumGate)) {
+                if (++_stable >= PollAdjust) {
+                    _stable = 0;
+
+                    if (_poll < _maxPoll) {
+                        _poll++;
+                    }
+                }
+            } else {
+                _stable = 0;
+
+                if (_poll > _minPoll) {
+                    _poll--;
+                }
+            }
+
+            _tracked = now;
+        } else {
+            TRACE(Trace::Information, (_T("TimeSync: Stepping %lf s"), offset));
+
+#ifndef __WINDOWS__
+            // Whatever was still to be slewed is void now.
+            ::memset(&info, 0, sizeof(info));
+            info.modes = ADJ_OFFSET_SINGLESHOT;
+            ::adjtimex(&info);
+#endif
+
+            // After a step the samples are of no use, start over (RFC 5905, clear on step).
+            Clear();
+            _slewing = 0;
+
+            _poll = _minPoll;
+            _stable = 0;
+            _tracked = 0;
+
+            // Report the new time, it is set by whom is interested.
+            Update();
+        }
+
+        _packet.Poll(_poll);
+
+        // Servers may ask to be polled less often than we would.
+        uint8_t poll = _poll;
+
+        for (const Peer& peer : _peers) {
+            if ((peer.Selected == true) && (peer.Poll > poll)) {
+                poll = std::min(peer.Poll, _maxPoll);
+            }
+        }
+
+        return (MilliSeconds << poll);
+    }
+
+    // The samples taken so far are relative to the local clock, after a correction they are off by as much, and
+    // so are the times they were taken at.
+    void NTPClient::Correct(const double offset)
+    {
+        const int64_t ticks = SecondsToTicks(offset);
+
+        for (Peer& peer : _peers) {
+            for (uint8_t index = 0; index < peer.Count; index++) {
+                ClockFilter::Sample& sample(peer.Samples[index]);
+
+                sample.Offset -= offset;
+                sample.Epoch = ((ticks >= 0) || (sample.Epoch > static_cast<uint64_t>(-ticks)) ? sample.Epoch + ticks : 0);
+            }
+        }
+    }
+
+    // Corrects the samples for the part of the slew the kernel did since it was asked last. Lock should be taken
+    // by the caller.
+    void NTPClient::Slewed()
+    {
+#ifndef __WINDOWS__
+        if (_slewing != 0) {
+            struct timex info;
+
+            ::memset(&info, 0, sizeof(info));
+            info.modes = ADJ_OFFSET_SS_READ;
+
+            if (::adjtimex(&info) != -1) {
+                const double pending = static_cast<double>(info.offset) / MicroSeconds;
+
+                Correct(_slewing - pending);
+                _slewing = pending;
+            }
+        }
+#endif
+    }
+
+    // Empties the clock filter of every server. Lock should be taken by the caller.
+    void NTPClient::Clear()
+    {
+        for (Peer& peer : _peers) {
+            peer.Count = 0;
+        }
+    }
+
     void NTPClient::Update()
     {
 
@@ -360,17 +754,56 @@ namespace Plugin {
 
         switch (_state) {
         case SENDREQUEST: {
-            // This case means that nothing has started yet, let reset the list of servers and start at the beginning...
-            _serverIndex.Reset(0);
+            // This case means that nothing has started yet, let start a fresh round...
             _state = INPROGRESS;
+            _querying = false;
             _currentAttempt = _retryAttempts;
         }
         case INPROGRESS: {
-            // If we end up here in this state, it means that the package was send but no response was received,
-            // or a response was received but is was not properly formatted...
-            // Lets move to the next server in the list, see if that one responds correctly, if we tried all servers let's
-            // start at the first one again, this time it might work
-            if (FireRequest() == true) {
+            if ((_querying == true) && (Continue() == true)) {
+                result = BurstInterval;
+                break;
+            }
+
+            // If we end up here with queries out, all servers answered or the time is up. Pick the best of
+            // what came in. If nothing usable came in, ask all servers again, this time it might work.
+            if (_querying == true) {
+                double offset;
+                double jitter;
+
+                _querying = false;
+
+                if (_discipline == false) {
+                    // We don't need the socket anymore, so close it
+                    TRACE_L1("TimeSync: %s", "Closing socket, no longer needed");
+                    Close(0);
+                }
+
+                if (Select(offset, jitter) == true) {
+                    // The clock is set to this, which leaves the samples taken so far off by as much.
+                    Clear();
+
+                    if (_discipline == false) {
+                        _state = SUCCESS;
+                    } else {
+                        // The first time the clock is set straight, from here on it is kept on track.
+                        _state = TRACKING;
+                        _poll = _minPoll;
+                        _stable = 0;
+                        _tracked = 0;
+                        _slewing = 0;
+                        _packet.Poll(_poll);
+
+                        result = (MilliSeconds << _poll);
+                    }
+
+                    // Report the success. Always report back when we are finished.
+                    Update();
+                    break;
+                }
+            }
+
+            if (FireRequest(BurstLength) == true) {
               result = WaitForResponse;
             } else {
                 if (_currentAttempt-- != 0) {
@@ -389,6 +822,34 @@ namespace Plugin {
             }
             break;
         }
+        case TRACKING: {
+            // Time for the next poll, or the poll is over and its outcome can be used.
+            if (_querying == true) {
+                double offset;
+                double jitter;
+
+                _querying = false;
+
+                Slewed();
+
+                if (Select(offset, jitter) == true) {
+                    result = Track(offset, jitter);
+                } else {
+                    // Nobody answered, keep a closer eye on it for a while.
+                    TRACE(Trace::Warning, (_T("TimeSync: None of the NTP servers answered")));
+                    _poll = _minPoll;
+                    _stable = 0;
+                    _packet.Poll(_poll);
+
+                    result = (MilliSeconds << _poll);
+                }
+            } else if (FireRequest(1) == true) {
+                result = WaitForResponse;
+            } else {
+                result = _WaitForNetwork;
+            }
+            break;
+        }
         case FAILED:
         case SUCCESS: {
             Update();
@@ -21,6 +21,7 @@
 #define TIMESYNC_NTPCLIENT_H
 
 #include "Module.h"
+#include "ClockFilter.h"
 #include <interfaces/ITimeSync.h>
 
 namespace WPEFramework {
@@ -34,11 +35,25 @@ namespace Plugin {
 
         using SourceIterator = Core::JSON::ArrayType<Core::JSON::String>::Iterator;
 
+        // What is known of a server, times in microseconds. The offset, delay and jitter are the outcome of
+        // the clock filter, the distance is the root distance the selection was based on.
+        struct Statistics {
+            string Server;
+            uint32_t Queries;
+            uint32_t Responses;
+            int64_t Offset;
+            uint32_t Delay;
+            uint32_t Jitter;
+            uint32_t Distance;
+            bool Selected;
+        };
+
     private:
-        using ServerList = std::vector<string>;
-        using ServerIterator = Core::IteratorType<const ServerList, const string&, ServerList::const_iterator>;
         using DataFrame = Core::FrameType<0>;
 
+        // Queries sent to a server per synchronization, a while apart (iburst, RFC 5905).
+        static constexpr uint8_t BurstLength = 4;
+
         // This enum tracks the state for actions begin performed. As the Worker() method is re-entered,
         // we need to keep track of state.
         enum state {
@@ -46,7 +61,8 @@ namespace Plugin {
             SENDREQUEST, // Let send out an NTP request to a legitimate server.
             INPROGRESS, // A request has been sent to a NTP server, waiting for a response
             SUCCESS, // Action succeeded, we received a valid response from an NTP server
-            FAILED // Action failed, we did not receive any valid response from any of the NTP servers
+            FAILED, // Action failed, we did not receive any valid response from any of the NTP servers
+            TRACKING // The time was set, from now on the clock is kept on track by slewing it
         };
         // As this forms the exact package to be sent for NTP, we need to make sure all members are byte
         // aligned
@@ -117,6 +133,14 @@ namespace Plugin {
 
                     return (*this);
                 }
+                bool operator==(const Timestamp& rhs) const
+                {
+                    return ((_source.tv_sec == rhs._source.tv_sec) && (_source.tv_nsec == rhs._source.tv_nsec));
+                }
+                bool operator!=(const Timestamp& rhs) const
+                {
+                    return (!operator==(rhs));
+                }
 
             public:
                 uint32_t Seconds() const
@@ -328,6 +352,19 @@ namespace Plugin {
                 // bit (NTP time)
         };
 
+        struct Peer : public ClockFilter::Source {
+            string Name;
+            Core::NodeId Node;
+            NTPPacket::Timestamp Sent; // transmit timestamp of the query in flight, comes back as the origin
+            bool Queued;
+            bool Pending;
+            uint8_t Burst; // queries left in this round
+            uint8_t Answers; // valid responses in this round
+            uint32_t Queries;
+            uint32_t Responses;
+            uint8_t Poll; // log2 seconds, the poll interval the server asks for
+        };
+
         class Activity : public Core::IDispatchType<void> {
         private:
             Activity() = delete;
@@ -364,6 +401,9 @@ namespace Plugin {
 
     public:
         void Initialize(SourceIterator& sources, const uint16_t retries, const uint16_t delay);
+        // Keep on polling after the first synchronization, and slew the clock instead of setting it. The poll
+        // interval is 2^minPoll up to 2^maxPoll seconds.
+        void Discipline(const uint8_t minPoll, const uint8_t maxPoll);
         virtual void Register(Exchange::ITimeSync::INotification* notification) override;
         virtual void Unregister(Exchange::ITimeSync::INotification* notification) override;
 
@@ -372,6 +412,8 @@ namespace Plugin {
         virtual string Source() const override;
         virtual uint64_t SyncTime() const override;
 
+        void Peers(std::list<Statistics>& peers) const;
+
         // ITime methods
         virtual uint64_t TimeSync() const override
         {
@@ -393,19 +435,35 @@ namespace Plugin {
 
         void Update();
         void Dispatch();
-        bool FireRequest();
+        bool FireRequest(const uint8_t burst);
+        bool Outstanding() const;
+        bool Continue();
+        bool Select(double& offset, double& jitter);
+        uint32_t Track(const double offset, const double jitter);
+        void Correct(const double offset);
+        void Slewed();
+        void Clear();
 
     private:
-        Core::CriticalSection _adminLock;
+        mutable Core::CriticalSection _adminLock;
         NTPPacket _packet;
         Core::Time _syncedTimestamp;
         state _state;
-        bool _fired;
+        bool _querying;
+        uint64_t _lastSent;
         uint32_t _WaitForNetwork;
         uint32_t _retryAttempts;
         uint32_t _currentAttempt;
-        ServerList _servers;
-        ServerIterator _serverIndex;
+        std::vector<Peer> _peers;
+        string _source;
+        bool _discipline;
+        uint8_t _minPoll;
+        uint8_t _maxPoll;
+        uint8_t _poll;
+        uint8_t _stable;
+        double _frequency; // seconds per second, the correction of the rate of the local clock
+        uint64_t _tracked;
+        double _slewing; // seconds, what was left to slew when the kernel was last asked
         Core::ProxyType<Core::IDispatchType<void>> _activity;
         std::list<Exchange::ITimeSync::INotification*> _clients;
     };
@@ -37,6 +37,7 @@ namespace Plugin {
     TimeSync::TimeSync()
         : _skipURL(0)
         , _periodicity(0)
+        , _discipline(false)
         , _client(Core::Service<NTPClient>::Create<Exchange::ITimeSync>())
         , _activity(Core::ProxyType<PeriodicSync>::Create(_client))
         , _sink(this)
@@ -67,6 +68,14 @@ namespace Plugin {
 
         static_cast<NTPClient*>(_client)->Initialize(index, config.Retries.Value(), config.Interval.Value());
 
+        _discipline = config.Discipline.Value();
+
+        if (_discipline == true) {
+            // The client keeps on polling by itself, there is no need to synchronize periodically.
+            static_cast<NTPClient*>(_client)->Discipline(config.MinPoll.Value(), config.MaxPoll.Value());
+            _periodicity = 0;
+        }
+
         ASSERT(service != nullptr);
         ASSERT(_service == nullptr);
         _service = service;
@@ -178,7 +187,10 @@ namespace Plugin {
 
         Core::SystemInfo::Instance().SetTime(newTime);
 
-        if (_periodicity != 0) {
+        if (_discipline == true) {
+            // Only the first time and steps come by here, small offsets are slewed away by the client.
+            event_timechange();
+        } else if (_periodicity != 0) {
             Core::Time newSyncTime(Core::Time::Now());
 
             newSyncTime.Add(_periodicity);
@@ -21,8 +21,10 @@
 #define TIMESYNC_H
 
 #include "Module.h"
+#include "NTPClient.h"
 #include <interfaces/ITimeSync.h>
 #include <interfaces/json/JsonData_TimeSync.h>
+#include "JsonData_TimeSyncStatistics.h"
 
 namespace WPEFramework {
 namespace Plugin {
@@ -155,12 +157,18 @@ namespace Plugin {
                 , Retries(8)
                 , Sources()
                 , Periodicity(0)
+                , Discipline(false)
+                , MinPoll(6)
+                , MaxPoll(10)
             {
                 Add(_T("deferred"), &Deferred);
                 Add(_T("interval"), &Interval);
                 Add(_T("retries"), &Retries);
                 Add(_T("sources"), &Sources);
                 Add(_T("periodicity"), &Periodicity);
+                Add(_T("discipline"), &Discipline);
+                Add(_T("minpoll"), &MinPoll);
+                Add(_T("maxpoll"), &MaxPoll);
             }
             ~Config()
             {
@@ -172,6 +180,9 @@ namespace Plugin {
             Core::JSON::DecUInt8 Retries;
             Core::JSON::ArrayType<Core::JSON::String> Sources;
             Core::JSON::DecUInt16 Periodicity;
+            Core::JSON::Boolean Discipline;
+            Core::JSON::DecUInt8 MinPoll;
+            Core::JSON::DecUInt8 MaxPoll;
         };
 
         class PeriodicSync : public Core::IDispatch {
@@ -241,6 +252,7 @@ namespace Plugin {
         void UnregisterAll();
         uint32_t endpoint_synchronize();
         uint32_t get_synctime(JsonData::TimeSync::SynctimeData& response) const;
+        uint32_t get_statistics(Core::JSON::ArrayType<JsonData::TimeSync::PeerData>& response) const;
         uint32_t get_time(Core::JSON::String& response) const;
         uint32_t set_time(const Core::JSON::String& param);
         void event_timechange();
@@ -248,6 +260,7 @@ namespace Plugin {
     private:
         uint16_t _skipURL;
         uint32_t _periodicity;
+        bool _discipline;
         Exchange::ITimeSync* _client;
         Core::ProxyType<Core::IDispatch> _activity;
         Core::Sink<Notification> _sink;
@@ -18,6 +18,7 @@
  */
 
 #include <interfaces/json/JsonData_TimeSync.h>
+#include "JsonData_TimeSyncStatistics.h"
 #include "TimeSync.h"
 #include "Module.h"
 
@@ -34,6 +35,7 @@ namespace Plugin {
     {
         Register<void,void>(_T("synchronize"), &TimeSync::endpoint_synchronize, this);
         Property<SynctimeData>(_T("synctime"), &TimeSync::get_synctime, nullptr, this);
+        Property<Core::JSON::ArrayType<PeerData>>(_T("statistics"), &TimeSync::get_statistics, nullptr, this);
         Property<Core::JSON::String>(_T("time"), &TimeSync::get_time, &TimeSync::set_time, this);
     }
 
@@ -42,6 +44,7 @@ namespace Plugin {
         Unregister(_T("synchronize"));
         Unregister(_T("time"));
         Unregister(_T("synctime"));
+        Unregister(_T("statistics"));
     }
 
     // API implementation
@@ -77,6 +80,31 @@ namespace Plugin {
         return Core::ERROR_NONE;
     }
 
+    // Property: statistics - NTP server statistics
+    // Return codes:
+    //  - ERROR_NONE: Success
+    uint32_t TimeSync::get_statistics(Core::JSON::ArrayType<PeerData>& response) const
+    {
+        std::list<NTPClient::Statistics> peers;
+
+        static_cast<const NTPClient*>(_client)->Peers(peers);
+
+        for (const NTPClient::Statistics& peer : peers) {
+            PeerData& entry(response.Add());
+
+            entry.Server = peer.Server;
+            entry.Queries = peer.Queries;
+            entry.Responses = peer.Responses;
+            entry.Offset = peer.Offset;
+            entry.Delay = peer.Delay;
+            entry.Jitter = peer.Jitter;
+            entry.Distance = peer.Distance;
+            entry.Selected = peer.Selected;
+        }
+
+        return Core::ERROR_NONE;
+    }
+
     // Property: time - Current system time
     // Return codes:
     //  - ERROR_NONE: Success
@@ -26,6 +26,10 @@ ENUM_CONVERSION_BEGIN(Plugin::WebProxy::Config::Link::enumType){ Plugin::WebProx
     { Plugin::WebProxy::Config::Link::SERIAL, _TXT("serial") },
     ENUM_CONVERSION_END(Plugin::WebProxy::Config::Link::enumType);
 
+ENUM_CONVERSION_BEGIN(Plugin::WebProxy::Config::Link::framingType){ Plugin::WebProxy::Config::Link::RAW, _TXT("raw") },
+    { Plugin::WebProxy::Config::Link::LENGTH, _TXT("length") },
+    ENUM_CONVERSION_END(Plugin::WebProxy::Config::Link::framingType);
+
 ENUM_CONVERSION_BEGIN(Core::SerialPort::Parity){ Core::SerialPort::EVEN, _TXT("even") },
     { Core::SerialPort::ODD, _TXT("odd") },
     { Core::SerialPort::NONE, _TXT("none") },
@@ -177,18 +181,19 @@ namespace Plugin {
 #ifdef __WINDOWS__
 #pragma warning(disable : 4355)
 #endif
-        inline ConnectorWrapper(PluginHost::Channel& channel, const uint32_t bufferSize)
-            : WebProxy::Connector(channel, &_streamType)
+        inline ConnectorWrapper(PluginHost::Channel& channel, const uint32_t ringSize, const uint32_t bufferSize)
+            : WebProxy::Connector(channel, &_streamType, ringSize)
             , _streamType(*this, bufferSize)
         {
         }
-        inline ConnectorWrapper(PluginHost::Channel& channel, const uint32_t bufferSize, const Core::NodeId& remoteId)
-            : WebProxy::Connector(channel, &_streamType)
+        inline ConnectorWrapper(PluginHost::Channel& channel, const uint32_t ringSize, const uint32_t bufferSize, const Core::NodeId& remoteId)
+            : WebProxy::Connector(channel, &_streamType, ringSize)
             , _streamType(*this, bufferSize, remoteId)
         {
         }
         inline ConnectorWrapper(
             PluginHost::Channel& channel,
+            const uint32_t ringSize,
             const uint32_t bufferSize,
             const string& deviceName,
             const Core::SerialPort::BaudRate baudrate,
@@ -196,7 +201,7 @@ namespace Plugin {
             const Core::SerialPort::DataBits dataBits,
             const Core::SerialPort::StopBits stopBits,
             const Core::SerialPort::FlowControl flowControl)
-            : WebProxy::Connector(channel, &_streamType)
+            : WebProxy::Connector(channel, &_streamType, ringSize)
             , _streamType(*this, bufferSize, deviceName, baudrate, parityE, dataBits, stopBits, flowControl)
         {
         }
@@ -225,6 +230,7 @@ namespace Plugin {
         config.FromString(service->ConfigLine());
 
         _maxConnections = config.Connections.Value();
+        _bufferSize = config.BufferSize.Value();
 
         // Copy all predefined links...
         if ((config.Links.IsSet() == true) && (config.Links.Length() != 0)) {
@@ -257,6 +263,8 @@ namespace Plugin {
         bool added = false;
         Core::NodeId nodeId;
 
+        _adminLock.Lock();
+
         // First do a cleanup of all "completely" closed channels.
         std::map<const uint32_t, Connector*>::iterator connection(_connectionMap.begin());
 
@@ -282,23 +290,54 @@ namespace Plugin {
             }
         }
 
+        _adminLock.Unlock();
+
         return (added);
     }
 
     /* virtual */ void WebProxy::Detach(PluginHost::Channel& channel)
     {
+        _adminLock.Lock();
+
         // See if we can forward this info..
         std::map<const uint32_t, Connector*>::iterator connection = _connectionMap.find(channel.Id());
 
         if (connection != _connectionMap.end()) {
             connection->second->Detach();
         }
+
+        _adminLock.Unlock();
     }
 
     /* virtual */ string WebProxy::Information() const
     {
-        // No additional info to report.
-        return (string());
+        Data info;
+
+        // Attach and Detach change the map, and delete what is in it, on the communication thread.
+        _adminLock.Lock();
+
+        std::map<const uint32_t, Connector*>::const_iterator index(_connectionMap.begin());
+
+        while (index != _connectionMap.end()) {
+            if (index->second->IsClosed() == false) {
+                Data::Connection& entry(info.Connections.Add());
+
+                entry.Id = index->first;
+                entry.Remote = index->second->RemoteId();
+                entry.Received = index->second->Received();
+                entry.Sent = index->second->Sent();
+                entry.Stalls = index->second->Stalls();
+                entry.Dropped = index->second->Dropped();
+            }
+            index++;
+        }
+
+        _adminLock.Unlock();
+
+        string result;
+        info.ToString(result);
+
+        return (result);
     }
 
     // IChannel methods
@@ -348,6 +387,9 @@ namespace Plugin {
         const string& options(channel.Query());
         bool datagram(false);
         bool text(false);
+        bool framed(false);
+        uint16_t latency(0);
+        uint16_t frameSize(0);
 
         if (options.empty() == false) {
             Core::TextSegmentIterator index(Core::TextFragment(options), true, '&');
@@ -364,6 +406,12 @@ namespace Plugin {
                         text = true;
                     } else if ((section.Current() == _T("device")) && (section.Next() == true)) {
                         device = section.Current();
+                    } else if ((section.Current() == _T("framed")) && (section.Next() == false)) {
+                        framed = true;
+                    } else if ((section.Current() == _T("latency")) && (section.Next() == true)) {
+                        latency = Core::NumberType<uint16_t>(section.Current()).Value();
+                    } else if ((section.Current() == _T("framesize")) && (section.Next() == true)) {
+                        frameSize = Core::NumberType<uint16_t>(section.Current()).Value();
                     }
                 }
             }
@@ -379,6 +427,9 @@ namespace Plugin {
                 host = Core::TextFragment(linkInfo.Host.Value());
                 device = Core::TextFragment(linkInfo.Device.Value());
                 datagram = ((linkInfo.Type.IsSet() == true) && (linkInfo.Type.Value() == Config::Link::UDP));
+                framed = ((linkInfo.Framing.IsSet() == true) && (linkInfo.Framing.Value() == Config::Link::LENGTH));
+                latency = linkInfo.Latency.Value();
+                frameSize = linkInfo.FrameSize.Value();
 
                 if (linkInfo.Configuration.IsSet() == true) {
                     const Config::Link::Settings& configInfo(linkInfo.Configuration);
@@ -395,16 +446,20 @@ namespace Plugin {
             Core::NodeId remote(host.Text().c_str());
 
             if (datagram == true) {
-                result = new ConnectorWrapper<DatagramChannel>(channel, 1024, remote);
+                result = new ConnectorWrapper<DatagramChannel>(channel, _bufferSize, 1024, remote);
             } else {
-                result = new ConnectorWrapper<StreamChannel>(channel, 1024, remote);
+                result = new ConnectorWrapper<StreamChannel>(channel, _bufferSize, 1024, remote);
             }
         } else if ((device.Length() > 0) && (host.Length() == 0)) {
-            result = new ConnectorWrapper<DeviceChannel>(channel, 1024, device.Text(), baudRate, parity, dataBits, stopBits, flowControl);
+            result = new ConnectorWrapper<DeviceChannel>(channel, _bufferSize, 1024, device.Text(), baudRate, parity, dataBits, stopBits, flowControl);
         }
 
-        if ((result != nullptr) && (text == true)) {
-            channel.Binary(false);
+        if (result != nullptr) {
+            result->Configure(framed, latency, frameSize);
+
+            if ((text == true) && (framed == false)) {
+                channel.Binary(false);
+            }
         }
 
         return (result);
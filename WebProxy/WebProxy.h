@@ -22,6 +22,8 @@
 
 #include "Module.h"
 
+#include <atomic>
+
 namespace WPEFramework {
 namespace Plugin {
 
@@ -36,20 +38,178 @@ namespace Plugin {
             Connector(const Connector&) = delete;
             Connector& operator=(const Connector&) = delete;
 
+            // Single producer, single consumer ring. The link and the channel each only move their own index,
+            // so data can be passed between them without taking a lock for every frame.
+            class Ring {
+            private:
+                Ring() = delete;
+                Ring(const Ring&) = delete;
+                Ring& operator=(const Ring&) = delete;
+
+            public:
+                Ring(const uint32_t size)
+                    : _mask(Capacity(size) - 1)
+                    , _buffer(new uint8_t[_mask + 1])
+                    , _head(0)
+                    , _tail(0)
+                    , _discard(0)
+                {
+                }
+                ~Ring()
+                {
+                    delete[] _buffer;
+                }
+
+            public:
+                // Consumer side.
+                inline uint32_t Used() const
+                {
+                    return (_tail.load(std::memory_order_acquire) - _head.load(std::memory_order_relaxed));
+                }
+                uint16_t Read(uint8_t data[], const uint16_t length)
+                {
+                    const uint16_t result = Peek(data, length);
+
+                    Skip(result);
+
+                    return (result);
+                }
+                uint16_t Peek(uint8_t data[], const uint16_t length) const
+                {
+                    const uint16_t result = static_cast<uint16_t>(std::min(Used(), static_cast<uint32_t>(length)));
+
+                    if (result != 0) {
+                        const uint32_t offset = _head.load(std::memory_order_relaxed) & _mask;
+                        const uint32_t first = std::min(static_cast<uint32_t>(result), (_mask + 1) - offset);
+
+                        ::memcpy(data, &(_buffer[offset]), first);
+                        ::memcpy(&(data[first]), _buffer, result - first);
+                    }
+
+                    return (result);
+                }
+                inline void Skip(const uint32_t length)
+                {
+                    ASSERT(length <= Used());
+
+                    _head.store(_head.load(std::memory_order_relaxed) + length, std::memory_order_release);
+                }
+                // Drops the given number of bytes, also those that are not written yet, as soon as they come in.
+                inline void Discard(const uint32_t length)
+                {
+                    _discard = length;
+                }
+                // Drops what came in of what is to be discarded, returns true once it is all gone.
+                bool Discarded()
+                {
+                    if (_discard != 0) {
+                        const uint32_t length = std::min(Used(), _discard);
+
+                        Skip(length);
+                        _discard -= length;
+                    }
+
+                    return (_discard == 0);
+                }
+                // Producer side.
+                inline uint32_t Free() const
+                {
+                    return ((_mask + 1) - (_tail.load(std::memory_order_relaxed) - _head.load(std::memory_order_acquire)));
+                }
+                uint16_t Write(const uint8_t data[], const uint16_t length)
+                {
+                    const uint16_t result = static_cast<uint16_t>(std::min(Free(), static_cast<uint32_t>(length)));
+
+                    if (result != 0) {
+                        Stage(0, data, result);
+                        Publish(result);
+                    }
+
+                    return (result);
+                }
+                // Copies data behind what is written, at the given distance, without making it visible to the
+                // consumer yet. The caller should have checked there is room for it.
+                void Stage(const uint32_t distance, const uint8_t data[], const uint16_t length)
+                {
+                    ASSERT((distance + length) <= Free());
+
+                    const uint32_t offset = (_tail.load(std::memory_order_relaxed) + distance) & _mask;
+                    const uint32_t first = std::min(static_cast<uint32_t>(length), (_mask + 1) - offset);
+
+                    ::memcpy(&(_buffer[offset]), data, first);
+                    ::memcpy(_buffer, &(data[first]), length - first);
+                }
+                // Makes all that was staged visible to the consumer at once.
+                inline void Publish(const uint32_t length)
+                {
+                    _tail.store(_tail.load(std::memory_order_relaxed) + length, std::memory_order_release);
+                }
+                inline uint32_t Capacity() const
+                {
+                    return (_mask + 1);
+                }
+
+            private:
+                static uint32_t Capacity(const uint32_t size)
+                {
+                    uint32_t result = 1024;
+
+                    while (result < size) {
+                        result <<= 1;
+                    }
+
+                    return (result);
+                }
+
+            private:
+                const uint32_t _mask;
+                uint8_t* _buffer;
+                std::atomic<uint32_t> _head;
+                std::atomic<uint32_t> _tail;
+                uint32_t _discard;
+            };
+
+            typedef Core::WorkerPool::JobType<Connector&> FlushJob;
+
         public:
-            Connector(PluginHost::Channel& channel, Core::IStream* link)
+            Connector(PluginHost::Channel& channel, Core::IStream* link, const uint32_t bufferSize)
                 : _link(link)
                 , _channel(&channel)
                 , _adminLock()
-                , _channelBuffer()
-                , _socketBuffer()
+                , _channelBuffer(bufferSize)
+                , _socketBuffer(bufferSize)
+                , _channelSignalled(false)
+                , _socketSignalled(false)
+                , _framed(false)
+                , _latency(0)
+                , _frameSize(0)
+                , _threshold(_channelBuffer.Capacity() / 2)
+                , _flush(*this)
+                , _scheduled(false)
+                , _received(0)
+                , _sent(0)
+                , _stalls(0)
+                , _dropped(0)
             {
             }
             virtual ~Connector()
             {
+                _flush.Revoke();
             }
 
         public:
+            // Framed: every datagram is preceded by its length, as a 16 bit big endian value, in both directions, so
+            //         datagrams can be batched into a websocket frame and still be told apart.
+            // Latency: time, in milliseconds, data received from the link may be held back to be combined with what
+            //          follows into a single websocket frame. 0 sends it out as soon as possible.
+            // FrameSize: largest websocket frame sent to the channel. 0 uses whatever the channel offers.
+            void Configure(const bool framed, const uint16_t latency, const uint16_t frameSize)
+            {
+                _framed = framed;
+                _latency = latency;
+                _frameSize = frameSize;
+                _threshold = ((frameSize != 0) && (frameSize < _threshold) ? frameSize : _threshold);
+            }
             inline uint32_t Id() const
             {
                 uint32_t result = 0;
@@ -71,62 +231,89 @@ namespace Plugin {
             {
                 return ((_channel == nullptr) && (_link->IsClosed()));
             }
+            // Bytes received from the link, bytes send to the link, the number of times data could not be accepted
+            // because the ring towards the other side was full and the number of datagrams that had to be dropped.
+            inline uint64_t Received() const
+            {
+                return (_received.load(std::memory_order_relaxed));
+            }
+            inline uint64_t Sent() const
+            {
+                return (_sent.load(std::memory_order_relaxed));
+            }
+            inline uint64_t Stalls() const
+            {
+                return (_stalls.load(std::memory_order_relaxed));
+            }
+            inline uint64_t Dropped() const
+            {
+                return (_dropped.load(std::memory_order_relaxed));
+            }
             // Methods to extract and insert data into the socket buffers
             uint16_t SendData(uint8_t* dataFrame, const uint16_t maxSendSize)
             {
-                _adminLock.Lock();
+                uint16_t result = Drain(_socketBuffer, _socketSignalled, dataFrame, maxSendSize);
 
-                uint16_t result = _socketBuffer.Read(dataFrame, maxSendSize);
-
-                _adminLock.Unlock();
+                _sent.fetch_add(result, std::memory_order_relaxed);
 
                 return (result);
             }
 
             uint16_t ReceiveData(uint8_t* dataFrame, const uint16_t receivedSize)
             {
-                _adminLock.Lock();
+                uint16_t result;
+                uint16_t added;
 
-                bool wasEmpty = _channelBuffer.IsEmpty();
+                if (_framed == false) {
+                    result = Fill(_channelBuffer, dataFrame, receivedSize);
+                    added = result;
+                } else {
+                    // A datagram is passed on as a whole or not at all.
+                    result = receivedSize;
+
+                    if (_channelBuffer.Free() < (static_cast<uint32_t>(receivedSize) + 2)) {
+                        _stalls.fetch_add(1, std::memory_order_relaxed);
+                        _dropped.fetch_add(1, std::memory_order_relaxed);
+                        added = 0;
+                    } else {
+                        const uint8_t header[2] = { static_cast<uint8_t>(receivedSize >> 8), static_cast<uint8_t>(receivedSize & 0xFF) };
+
+                        // The consumer should never see a header without the datagram it belongs to.
+                        _channelBuffer.Stage(0, header, sizeof(header));
+                        _channelBuffer.Stage(sizeof(header), dataFrame, receivedSize);
+                        _channelBuffer.Publish(sizeof(header) + receivedSize);
+                        added = receivedSize;
+                    }
+                }
 
-                uint16_t result = _channelBuffer.Write(dataFrame, receivedSize);
+                _received.fetch_add(added, std::memory_order_relaxed);
 
-                if (wasEmpty == true) {
-                    // This is new data, there was nothing pending, trigger a request for a frambuffer.
-                    _channel->RequestOutbound();
+                if (added != 0) {
+                    if ((_latency == 0) || (_channelBuffer.Used() >= _threshold)) {
+                        Signal();
+                    } else if (_scheduled.exchange(true) == false) {
+                        // Hold on to it for a while, more might be coming that can go out in the same frame.
+                        _flush.Schedule(Core::Time::Now().Add(_latency));
+                    }
                 }
 
-                _adminLock.Unlock();
-
                 return (result);
             }
 
             uint16_t ChannelSend(uint8_t* dataFrame, const uint16_t maxSendSize) const
             {
-                _adminLock.Lock();
-
-                uint16_t result = _channelBuffer.Read(dataFrame, maxSendSize);
-
-                _adminLock.Unlock();
-
-                return (result);
+                return (Drain(_channelBuffer, _channelSignalled, dataFrame, ((_frameSize != 0) && (_frameSize < maxSendSize) ? _frameSize : maxSendSize)));
             }
 
             uint16_t ChannelReceive(const uint8_t* dataFrame, const uint16_t receivedSize)
             {
-                _adminLock.Lock();
-
-                bool wasEmpty = _socketBuffer.IsEmpty();
+                uint16_t result = Fill(_socketBuffer, dataFrame, receivedSize);
 
-                uint16_t result = _socketBuffer.Write(dataFrame, receivedSize);
-
-                if (wasEmpty == true) {
+                if ((result != 0) && (_socketSignalled.exchange(true) == false)) {
                     // This is new data, there was nothing pending, trigger a request for a frambuffer.
                     _link->Trigger();
                 }
 
-                _adminLock.Unlock();
-
                 return (result);
             }
 
@@ -151,18 +338,124 @@ namespace Plugin {
 
             inline void Detach()
             {
+                _flush.Revoke();
+
                 _adminLock.Lock();
                 _channel = nullptr;
                 _link->Close(0);
                 _adminLock.Unlock();
             }
 
+            // Flush timer of the coalescing mode.
+            void Dispatch()
+            {
+                _scheduled = false;
+                Signal();
+            }
+
+        private:
+            void Signal()
+            {
+                if (_channelSignalled.exchange(true) == false) {
+                    // This is new data, there was nothing pending, trigger a request for a frambuffer.
+                    _adminLock.Lock();
+
+                    if (_channel != nullptr) {
+                        _channel->RequestOutbound();
+                    }
+
+                    _adminLock.Unlock();
+                }
+            }
+            uint16_t Fill(Ring& ring, const uint8_t* dataFrame, const uint16_t length)
+            {
+                uint16_t result = ring.Write(dataFrame, length);
+
+                if (result != length) {
+                    // The other side is not keeping up, what is left is pushed back to the sender.
+                    _stalls.fetch_add(1, std::memory_order_relaxed);
+                }
+
+                return (result);
+            }
+            uint16_t Drain(Ring& ring, std::atomic<bool>& signalled, uint8_t* dataFrame, const uint16_t length) const
+            {
+                uint16_t result = Take(ring, dataFrame, length);
+
+                if (result == 0) {
+                    signalled.store(false);
+
+                    // The producer might have added data after the read but before the flag was cleared, in
+                    // which case it did not signal, so we should pick it up ourselves.
+                    result = Take(ring, dataFrame, length);
+
+                    if (result != 0) {
+                        signalled.store(true);
+                    }
+                }
+
+                return (result);
+            }
+            uint16_t Take(Ring& ring, uint8_t* dataFrame, const uint16_t length) const
+            {
+                uint16_t result = 0;
+
+                if (_framed == false) {
+                    result = ring.Read(dataFrame, length);
+                } else {
+                    uint8_t header[2];
+                    // Only complete records are taken. Towards the channel the length prefixes go along, and as many
+                    // records as fit are batched into the frame. Towards the link, one datagram is send at a time.
+                    const uint32_t prefix = (&ring == &_channelBuffer ? sizeof(header) : 0);
+                    bool more = true;
+
+                    while ((more == true) && (ring.Discarded() == true) && (ring.Peek(header, sizeof(header)) == sizeof(header))) {
+                        const uint16_t size = (static_cast<uint16_t>(header[0]) << 8) | header[1];
+                        const uint32_t needed = size + prefix;
+
+                        if ((static_cast<uint32_t>(size) + sizeof(header)) > ring.Capacity()) {
+                            // The ring can never hold it completely, waiting for it would stall this direction for
+                            // good. Drop it as it comes in.
+                            ring.Discard(static_cast<uint32_t>(size) + sizeof(header));
+                            _dropped.fetch_add(1, std::memory_order_relaxed);
+                        } else if (ring.Used() < (static_cast<uint32_t>(size) + sizeof(header))) {
+                            // Not completely there yet.
+                            more = false;
+                        } else if ((result + needed) <= length) {
+                            ring.Skip(sizeof(header) - prefix);
+                            result += ring.Read(&(dataFrame[result]), static_cast<uint16_t>(needed));
+                            more = (prefix != 0);
+                        } else if (result == 0) {
+                            // It will never fit, get it out of the way.
+                            ring.Skip(static_cast<uint32_t>(size) + sizeof(header));
+                            _dropped.fetch_add(1, std::memory_order_relaxed);
+                        } else {
+                            more = false;
+                        }
+                    }
+                }
+
+                return (result);
+            }
+
         private:
             Core::IStream* _link;
             PluginHost::Channel* _channel;
             mutable Core::CriticalSection _adminLock;
-            Core::CyclicDataBuffer<Core::ScopedStorage<8192>> _channelBuffer;
-            Core::CyclicDataBuffer<Core::ScopedStorage<8192>> _socketBuffer;
+            mutable Ring _channelBuffer;
+            Ring _socketBuffer;
+            mutable std::atomic<bool> _channelSignalled;
+            std::atomic<bool> _socketSignalled;
+            bool _framed;
+            uint16_t _latency;
+            uint16_t _frameSize;
+            uint32_t _threshold;
+            FlushJob _flush;
+            std::atomic<bool> _scheduled;
+            std::atomic<uint64_t> _received;
+            std::atomic<uint64_t> _sent;
+            std::atomic<uint64_t> _stalls;
+            mutable std::atomic<uint64_t> _dropped;
         };
         class Config : public Core::JSON::Container {
         public:
@@ -176,6 +469,10 @@ namespace Plugin {
                     UDP,
                     SERIAL
                 };
+                enum framingType {
+                    RAW,
+                    LENGTH
+                };
 
                 class Settings : public Core::JSON::Container {
                 public:
@@ -243,6 +540,9 @@ namespace Plugin {
                     Add(_T("host"), &Host);
                     Add(_T("device"), &Device);
                     Add(_T("configuration"), &Configuration);
+                    Add(_T("framing"), &Framing);
+                    Add(_T("latency"), &Latency);
+                    Add(_T("framesize"), &FrameSize);
                 }
                 Link(const string& name, const enumType type, const bool text, const string host)
                     : Core::JSON::Container()
@@ -253,6 +553,9 @@ namespace Plugin {
                     Add(_T("host"), &Host);
                     Add(_T("device"), &Device);
                     Add(_T("configuration"), &Configuration);
+                    Add(_T("framing"), &Framing);
+                    Add(_T("latency"), &Latency);
+                    Add(_T("framesize"), &FrameSize);
 
                     Name = name;
                     Type = type;
@@ -271,6 +574,9 @@ namespace Plugin {
                     Add(_T("host"), &Host);
                     Add(_T("device"), &Device);
                     Add(_T("configuration"), &Configuration);
+                    Add(_T("framing"), &Framing);
+                    Add(_T("latency"), &Latency);
+                    Add(_T("framesize"), &FrameSize);
 
                     Name = name;
                     Type = type;
@@ -289,6 +595,9 @@ namespace Plugin {
                     , Host(copy.Host)
                     , Device(copy.Device)
                     , Configuration(copy.Configuration)
+                    , Framing(copy.Framing)
+                    , Latency(copy.Latency)
+                    , FrameSize(copy.FrameSize)
                 {
                     Add(_T("name"), &Name);
                     Add(_T("type"), &Type);
@@ -296,6 +605,9 @@ namespace Plugin {
                     Add(_T("host"), &Host);
                     Add(_T("device"), &Device);
                     Add(_T("configuration"), &Configuration);
+                    Add(_T("framing"), &Framing);
+                    Add(_T("latency"), &Latency);
+                    Add(_T("framesize"), &FrameSize);
                 }
                 ~Link()
                 {
@@ -308,6 +620,10 @@ namespace Plugin {
                 Core::JSON::String Host;
                 Core::JSON::String Device;
                 Settings Configuration;
+                // Datagram framing and coalescing, see Connector::Configure.
+                Core::JSON::EnumType<framingType> Framing;
+                Core::JSON::DecUInt16 Latency;
+                Core::JSON::DecUInt16 FrameSize;
             };
 
         private:
@@ -318,8 +634,10 @@ namespace Plugin {
             Config()
                 : Core::JSON::Container()
                 , Connections(10)
+                , BufferSize(8192)
             {
                 Add(_T("connections"), &Connections);
+                Add(_T("buffersize"), &BufferSize);
                 Add(_T("links"), &Links);
             }
             ~Config()
@@ -328,12 +646,80 @@ namespace Plugin {
 
         public:
             Core::JSON::DecUInt16 Connections;
+            // Size, in bytes, of the buffers between a channel and its link, in both directions.
+            Core::JSON::DecUInt32 BufferSize;
             Core::JSON::ArrayType<Link> Links;
         };
 
+        class Data : public Core::JSON::Container {
+        public:
+            class Connection : public Core::JSON::Container {
+            public:
+                Connection& operator=(const Connection&) = delete;
+
+                Connection()
+                    : Core::JSON::Container()
+                {
+                    Init();
+                }
+                Connection(const Connection& copy)
+                    : Core::JSON::Container()
+                    , Id(copy.Id)
+                    , Remote(copy.Remote)
+                    , Received(copy.Received)
+                    , Sent(copy.Sent)
+                    , Stalls(copy.Stalls)
+                    , Dropped(copy.Dropped)
+                {
+                    Init();
+                }
+                ~Connection()
+                {
+                }
+
+            private:
+                void Init()
+                {
+                    Add(_T("id"), &Id);
+                    Add(_T("remote"), &Remote);
+                    Add(_T("received"), &Received);
+                    Add(_T("sent"), &Sent);
+                    Add(_T("stalls"), &Stalls);
+                    Add(_T("dropped"), &Dropped);
+                }
+
+            public:
+                Core::JSON::DecUInt32 Id;
+                Core::JSON::String Remote;
+                Core::JSON::DecUInt64 Received;
+                Core::JSON::DecUInt64 Sent;
+                Core::JSON::DecUInt64 Stalls;
+                Core::JSON::DecUInt64 Dropped;
+            };
+
+        private:
+            Data(const Data&) = delete;
+            Data& operator=(const Data&) = delete;
+
+        public:
+            Data()
+                : Core::JSON::Container()
+            {
+                Add(_T("connections"), &Connections);
+            }
+            ~Data()
+            {
+            }
+
+        public:
+            Core::JSON::ArrayType<Connection> Connections;
+        };
+
     public:
         WebProxy()
-            : _connectionMap()
+            : _adminLock()
+            , _bufferSize(8192)
+            , _connectionMap()
         {
         }
         virtual ~WebProxy()
@@ -387,8 +773,10 @@ namespace Plugin {
         Connector* CreateConnector(PluginHost::Channel& channel) const;
 
     private:
+        mutable Core::CriticalSection _adminLock;
         string _prefix;
         uint32_t _maxConnections;
+        uint32_t _bufferSize;
         std::map<const uint32_t, Connector*> _connectionMap;
         std::map<const string, Config::Link> _linkInfo;
     };
@@ -0,0 +1,807 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Module.h"
+
+#include <atomic>
+#include <fcntl.h>
+#include <limits>
+#include <sys/stat.h>
+#include <unordered_map>
+
+#ifndef __WINDOWS__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace WPEFramework {
+namespace Plugin {
+
+    // The FileCache keeps the content of small static files (and their precompressed .gz siblings)
+    // in memory, so a GET on a hot asset does not have to reopen and reread the file from flash.
+    // Files that are too big to cache are kept open and read while they are served, straight from the
+    // page cache. They are not memory mapped, as a file that shrinks while it is mapped takes the
+    // process down. Entries are dropped as soon as inotify reports a change in their directory.
+    // Files loaded on the workerpool are read in one go up to a limit, bigger files are streamed: the
+    // workerpool reads the next chunk while the communication thread sends the current one.
+    class FileCache : public Core::IResource {
+    public:
+        class Content {
+        private:
+            // Number of bytes the workerpool reads ahead in one go, a streamed file has two of them in memory.
+            static constexpr uint32_t ChunkSize = 64 * 1024;
+            static constexpr uint32_t Busy = ~0u;
+
+            // Holds one chunk of a streamed file. State is 0 if it holds nothing, Busy while the workerpool is
+            // filling it and the chunk number + 1 once it can be copied from.
+            struct Slot {
+                std::atomic<uint32_t> State;
+                uint8_t* Buffer;
+            };
+
+            class ReadAhead : public Core::IDispatch {
+            private:
+                ReadAhead() = delete;
+                ReadAhead(const ReadAhead&) = delete;
+                ReadAhead& operator=(const ReadAhead&) = delete;
+
+            public:
+                ReadAhead(const Core::ProxyType<Content>& content, const uint32_t chunk)
+                    : _content(content)
+                    , _chunk(chunk)
+                {
+                }
+                ~ReadAhead() override
+                {
+                }
+
+            public:
+                void Dispatch() override
+                {
+                    _content->Fill(_chunk);
+                    _content->_parent->Done(*this);
+                }
+
+            private:
+                Core::ProxyType<Content> _content;
+                const uint32_t _chunk;
+            };
+
+            Content() = delete;
+            Content(const Content&) = delete;
+            Content& operator=(const Content&) = delete;
+
+        public:
+            Content(string&& data)
+                : _data(std::move(data))
+                , _descriptor(-1)
+                , _length(static_cast<uint32_t>(_data.length()))
+                , _parent(nullptr)
+                , _slots()
+            {
+            }
+            // If a parent is given, the file is streamed, reads are done ahead on the workerpool.
+            Content(const int descriptor, const uint32_t length, FileCache* parent)
+                : _data()
+                , _descriptor(descriptor)
+                , _length(length)
+                , _parent(parent)
+                , _slots()
+            {
+                for (Slot& slot : _slots) {
+                    slot.State.store(0, std::memory_order_relaxed);
+                    slot.Buffer = (_parent != nullptr ? new uint8_t[ChunkSize] : nullptr);
+                }
+            }
+            ~Content()
+            {
+#ifndef __WINDOWS__
+                if (_descriptor != -1) {
+                    ::close(_descriptor);
+                }
+#endif
+                for (Slot& slot : _slots) {
+                    delete[] slot.Buffer;
+                }
+            }
+
+        public:
+            inline uint32_t Length() const
+            {
+                return (_length);
+            }
+            // Returns the number of bytes copied, less than asked for if the file shrunk while it was served.
+            uint16_t Copy(uint8_t buffer[], const uint32_t offset, const uint16_t length) const
+            {
+                ASSERT((offset + length) <= _length);
+
+                uint16_t loaded = 0;
+
+                if (_descriptor == -1) {
+                    ::memcpy(buffer, &(_data[offset]), length);
+                    loaded = length;
+                } else {
+#ifndef __WINDOWS__
+                    while (loaded < length) {
+                        const uint32_t position = offset + loaded;
+                        const uint32_t chunk = position / ChunkSize;
+                        const Slot& slot(_slots[chunk % 2]);
+                        ssize_t size;
+
+                        if ((_parent != nullptr) && (slot.State.load(std::memory_order_acquire) == (chunk + 1))) {
+                            // Read ahead on the workerpool, the part of this chunk that is asked for.
+                            size = std::min(static_cast<uint32_t>(length - loaded), ((chunk + 1) * ChunkSize) - position);
+                            ::memcpy(&(buffer[loaded]), &(slot.Buffer[position - (chunk * ChunkSize)]), size);
+                        } else {
+                            size = ::pread(_descriptor, &(buffer[loaded]), length - loaded, position);
+                        }
+
+                        if (size > 0) {
+                            loaded += static_cast<uint16_t>(size);
+                        } else if ((size == 0) || (errno != EINTR)) {
+                            break;
+                        }
+                    }
+#endif
+                }
+
+                return (loaded);
+            }
+            // Has the workerpool read the chunks at and after the given offset, if they are not (being) read yet.
+            // Only the thread serializing the content calls this, so a chunk can not be overwritten while it is copied.
+            static void Stream(const Core::ProxyType<Content>& content, const uint32_t offset)
+            {
+                if (content->_parent != nullptr) {
+                    const uint32_t chunk = offset / ChunkSize;
+
+                    for (uint32_t next = chunk; (next <= (chunk + 1)) && ((next * ChunkSize) < content->_length); next++) {
+                        Slot& slot(content->_slots[next % 2]);
+                        const uint32_t state = slot.State.load(std::memory_order_acquire);
+
+                        if ((state != Busy) && (state != (next + 1))) {
+                            slot.State.store(Busy, std::memory_order_relaxed);
+                            content->_parent->Submit(Core::ProxyType<Core::IDispatch>(Core::ProxyType<ReadAhead>::Create(content, next)));
+                        }
+                    }
+                }
+            }
+
+        private:
+            void Fill(const uint32_t chunk)
+            {
+                Slot& slot(_slots[chunk % 2]);
+                const uint32_t offset = chunk * ChunkSize;
+                const uint32_t length = std::min(ChunkSize, _length - offset);
+                uint32_t loaded = 0;
+
+#ifndef __WINDOWS__
+                while (loaded < length) {
+                    const ssize_t size = ::pread(_descriptor, &(slot.Buffer[loaded]), length - loaded, offset + loaded);
+
+                    if (size > 0) {
+                        loaded += static_cast<uint32_t>(size);
+                    } else if ((size == 0) || (errno != EINTR)) {
+                        break;
+                    }
+                }
+#endif
+
+                // If the file shrunk, the chunk is left to be read on the communication thread, to find out.
+                slot.State.store((loaded == length ? chunk + 1 : 0), std::memory_order_release);
+            }
+
+        private:
+            const string _data;
+            const int _descriptor;
+            const uint32_t _length;
+            FileCache* _parent;
+            Slot _slots[2];
+        };
+
+        // Serializes a (shared) Content buffer as a web body, without taking a private copy. If the file shrunk
+        // while it is served, the length announced can not be met anymore, Truncated() is called to abort.
+        class Body : public Web::IBody {
+        private:
+            Body(const Body&) = delete;
+            Body& operator=(const Body&) = delete;
+
+        public:
+            Body()
+                : _content()
+                , _offset(0)
+            {
+            }
+            Body(const Core::ProxyType<Content>& content)
+                : _content(content)
+                , _offset(0)
+            {
+            }
+            ~Body() override
+            {
+            }
+
+        private:
+            uint32_t Serialize() const override
+            {
+                _offset = 0;
+
+                if (_content.IsValid() == false) {
+                    return (0);
+                }
+
+                Content::Stream(_content, 0);
+
+                return (_content->Length());
+            }
+            uint32_t Deserialize() override
+            {
+                // A cached body is send only.
+                ASSERT(false);
+                return (0);
+            }
+            void End() const override
+            {
+            }
+            uint16_t Serialize(uint8_t stream[], const uint16_t maxLength) const override
+            {
+                uint16_t result = 0;
+
+                if ((_content.IsValid() == true) && (_offset < _content->Length())) {
+                    const uint16_t length = static_cast<uint16_t>(std::min(static_cast<uint32_t>(maxLength), _content->Length() - _offset));
+
+                    result = _content->Copy(stream, _offset, length);
+
+                    if (result == length) {
+                        _offset += result;
+
+                        if (_offset < _content->Length()) {
+                            Content::Stream(_content, _offset);
+                        }
+                    } else {
+                        TRACE_L1(_T("FileCache: file shrunk while being served, %d bytes missing"), _content->Length() - _offset - result);
+                        _offset = _content->Length();
+                        Truncated();
+                    }
+                }
+
+                return (result);
+            }
+            uint16_t Deserialize(const uint8_t[], const uint16_t) override
+            {
+                ASSERT(false);
+                return (0);
+            }
+
+        protected:
+            virtual void Truncated() const
+            {
+            }
+
+        private:
+            Core::ProxyType<Content> _content;
+            mutable uint32_t _offset;
+        };
+
+        class Config : public Core::JSON::Container {
+        private:
+            Config& operator=(const Config&) = delete;
+
+        public:
+            Config()
+                : Core::JSON::Container()
+                , Size(0)
+                , EntrySize(64)
+                , LoadSize(256)
+                , Precompressed(true)
+            {
+                Add(_T("size"), &Size);
+                Add(_T("entrysize"), &EntrySize);
+                Add(_T("loadsize"), &LoadSize);
+                Add(_T("precompressed"), &Precompressed);
+            }
+            Config(const Config& copy)
+                : Core::JSON::Container()
+                , Size(copy.Size)
+                , EntrySize(copy.EntrySize)
+                , LoadSize(copy.LoadSize)
+                , Precompressed(copy.Precompressed)
+            {
+                Add(_T("size"), &Size);
+                Add(_T("entrysize"), &EntrySize);
+                Add(_T("loadsize"), &LoadSize);
+                Add(_T("precompressed"), &Precompressed);
+            }
+            ~Config()
+            {
+            }
+
+        public:
+            // All sizes are in KB. A Size of 0 disables the in memory cache, and with it serving the files that
+            // are too big to cache from a descriptor that is kept open. Files loaded on the workerpool are read
+            // in memory up to LoadSize, bigger files are streamed.
+            Core::JSON::DecUInt32 Size;
+            Core::JSON::DecUInt32 EntrySize;
+            Core::JSON::DecUInt32 LoadSize;
+            Core::JSON::Boolean Precompressed;
+        };
+
+    private:
+        struct Entry {
+            string Path;
+            Core::ProxyType<Content> Plain;
+            Core::ProxyType<Content> Compressed;
+        };
+
+        typedef std::list<Entry> Entries;
+        typedef std::unordered_map<string, Entries::iterator> Index;
+        typedef std::unordered_map<int, string> Watches;
+        typedef std::unordered_map<string, uint32_t> Generations;
+
+        // Beyond this many invalidated paths, their generations are folded into a new epoch.
+        static constexpr uint32_t MaxGenerations = 1024;
+
+        FileCache(const FileCache&) = delete;
+        FileCache& operator=(const FileCache&) = delete;
+
+    public:
+        FileCache()
+            : _adminLock()
+            , _notifyFd(-1)
+            , _maxSize(0)
+            , _maxEntrySize(0)
+            , _maxLoadSize(0)
+            , _precompressed(false)
+            , _size(0)
+            , _entries()
+            , _index()
+            , _watches()
+            , _generations()
+            , _epoch(0)
+            , _hits(0)
+            , _misses(0)
+            , _streamLock()
+            , _streaming()
+        {
+        }
+        ~FileCache()
+        {
+            Clear();
+        }
+
+    public:
+        inline uint64_t Hits() const
+        {
+            return (_hits.load(std::memory_order_relaxed));
+        }
+        inline uint64_t Misses() const
+        {
+            return (_misses.load(std::memory_order_relaxed));
+        }
+        void Configure(const Config& config)
+        {
+            Clear();
+
+            _maxSize = config.Size.Value() * 1024;
+            _maxEntrySize = std::min(config.EntrySize.Value() * 1024, _maxSize);
+            _maxLoadSize = config.LoadSize.Value() * 1024;
+            _precompressed = config.Precompressed.Value();
+
+#ifndef __WINDOWS__
+            if (_maxSize != 0) {
+                _notifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+                if (_notifyFd != -1) {
+                    Core::ResourceMonitor::Instance().Register(*this);
+                } else {
+                    // Without invalidation we can not guarantee the cache is coherent, so do not cache.
+                    TRACE_L1(_T("FileCache could not initialize inotify, caching disabled. Error: %d"), errno);
+                    _maxSize = 0;
+                    _maxEntrySize = 0;
+                }
+            }
+#else
+            // There is no inotify to keep the cache coherent.
+            _maxSize = 0;
+            _maxEntrySize = 0;
+#endif
+        }
+        void Clear()
+        {
+            std::list<Core::ProxyType<Core::IDispatch>> streaming;
+
+            // Make sure no file is being read ahead for us anymore.
+            _streamLock.Lock();
+            streaming.swap(_streaming);
+            _streamLock.Unlock();
+
+            for (Core::ProxyType<Core::IDispatch>& job : streaming) {
+                Core::IWorkerPool::Instance().Revoke(job, Core::infinite);
+            }
+
+#ifndef __WINDOWS__
+            if (_notifyFd != -1) {
+                Core::ResourceMonitor::Instance().Unregister(*this);
+                ::close(_notifyFd);
+                _notifyFd = -1;
+            }
+#endif
+
+            _adminLock.Lock();
+            _entries.clear();
+            _index.clear();
+            _watches.clear();
+            _size = 0;
+            Invalidate();
+            _adminLock.Unlock();
+        }
+        // Changes whenever the file at the given path is invalidated. Capture it before the file is loaded, so
+        // content read before a concurrent change is not cached after that change was handled.
+        uint64_t Generation(const string& path) const
+        {
+            _adminLock.Lock();
+
+            Generations::const_iterator index(_generations.find(path));
+            uint64_t result = (static_cast<uint64_t>(_epoch) << 32) | (index != _generations.end() ? index->second : 0);
+
+            _adminLock.Unlock();
+
+            return (result);
+        }
+
+        // Returns the content to serve for the given file. If compressed is true, the precompressed variant
+        // is preferred, on return it reflects whether that variant was actually selected. An invalid proxy
+        // is returned if the file should be served the conventional way.
+        Core::ProxyType<Content> Find(const string& path, bool& compressed)
+        {
+            Core::ProxyType<Content> result(Cached(path, compressed));
+
+            if (result.IsValid() == false) {
+                result = Load(path, compressed, false, Generation(path));
+            }
+
+            return (result);
+        }
+        // Only returns content if it is available in memory, so it is safe to call on the communication thread.
+        // On a miss, compressed is left untouched.
+        Core::ProxyType<Content> Cached(const string& path, bool& compressed)
+        {
+            Core::ProxyType<Content> result;
+
+            _adminLock.Lock();
+
+            Index::iterator index(_index.find(path));
+
+            if (index != _index.end()) {
+                // Move it to the front, it is the most recently used.
+                _entries.splice(_entries.begin(), _entries, index->second);
+                result = Select(*(index->second), compressed);
+                _hits.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            _adminLock.Unlock();
+
+            return (result);
+        }
+        // Loads the content from the filesystem. If complete is set, the content is also made available if it is
+        // not cached, so serving it does not block on file access anymore: read in memory up to the load size, or
+        // else streamed by the workerpool. The content is only cached if the file was not invalidated since the
+        // generation was captured.
+        Core::ProxyType<Content> Load(const string& path, bool& compressed, const bool complete, const uint64_t generation)
+        {
+            Core::ProxyType<Content> result;
+            struct stat info;
+
+            _misses.fetch_add(1, std::memory_order_relaxed);
+
+            // Bodies can not be longer than 4GB, bigger files are left to be served the conventional way.
+            if ((::stat(path.c_str(), &info) == 0) && (S_ISREG(info.st_mode)) && (static_cast<uint64_t>(info.st_size) <= std::numeric_limits<uint32_t>::max())) {
+                const uint32_t length = static_cast<uint32_t>(info.st_size);
+
+                if ((length != 0) && (length <= _maxEntrySize) && (Watch(Core::File::PathName(path)) == true)) {
+                    Entry entry;
+
+                    entry.Path = path;
+                    entry.Plain = Read(path, length);
+
+                    if ((_precompressed == true) && (entry.Plain.IsValid() == true)) {
+                        const string variant(path + _T(".gz"));
+
+                        if ((::stat(variant.c_str(), &info) == 0) && (S_ISREG(info.st_mode)) && (static_cast<uint32_t>(info.st_size) < length)) {
+                            entry.Compressed = Read(variant, static_cast<uint32_t>(info.st_size));
+                        }
+                    }
+
+                    if (entry.Plain.IsValid() == true) {
+                        result = Select(entry, compressed);
+                        Insert(entry, generation);
+                    }
+                } else if (complete == true) {
+                    result = (length <= _maxLoadSize ? Read(path, length) : Open(path, length, true));
+                } else if (_maxSize != 0) {
+                    // Not cached, it is read while it is served, from a descriptor that is kept open.
+                    result = Open(path, length, false);
+                }
+            }
+
+            if (result.IsValid() == false) {
+                compressed = false;
+            }
+
+            return (result);
+        }
+
+    private:
+        Core::IResource::handle Descriptor() const override
+        {
+            return (_notifyFd);
+        }
+        uint16_t Events() override
+        {
+            return (POLLIN);
+        }
+        void Handle(const uint16_t events) override
+        {
+#ifndef __WINDOWS__
+            if ((events & POLLIN) != 0) {
+                uint8_t eventBuffer[16 * (sizeof(struct inotify_event) + NAME_MAX + 1)];
+                int length;
+
+                do {
+                    length = ::read(_notifyFd, eventBuffer, sizeof(eventBuffer));
+
+                    if (length > 0) {
+                        int offset = 0;
+
+                        _adminLock.Lock();
+
+                        while (offset < length) {
+                            const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(&eventBuffer[offset]);
+
+                            if ((event->mask & IN_Q_OVERFLOW) != 0) {
+                                // We lost track of the changes, start all over.
+                                Flush();
+                                Invalidate();
+                            } else {
+                                Watches::iterator loop(_watches.find(event->wd));
+
+                                if (loop != _watches.end()) {
+                                    if ((event->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF)) != 0) {
+                                        Flush(loop->second);
+                                        Invalidate();
+                                        _watches.erase(loop);
+                                    } else if (event->len > 0) {
+                                        string name(loop->second + event->name);
+
+                                        // A change in the compressed variant invalidates the entry it belongs to.
+                                        if ((name.length() > 3) && (name.compare(name.length() - 3, 3, _T(".gz")) == 0)) {
+                                            name.resize(name.length() - 3);
+                                        }
+
+                                        Remove(name);
+                                        Invalidate(name);
+                                    }
+                                }
+                            }
+
+                            offset += sizeof(struct inotify_event) + event->len;
+                        }
+
+                        _adminLock.Unlock();
+                    }
+                } while (length > 0);
+            }
+#endif
+        }
+
+    private:
+        Core::ProxyType<Content> Select(const Entry& entry, bool& compressed) const
+        {
+            if ((compressed == true) && (entry.Compressed.IsValid() == true)) {
+                return (entry.Compressed);
+            }
+            compressed = false;
+            return (entry.Plain);
+        }
+        Core::ProxyType<Content> Read(const string& path, const uint32_t length) const
+        {
+            Core::ProxyType<Content> result;
+#ifndef __WINDOWS__
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+            if (fd != -1) {
+                string data(length, '\0');
+                uint32_t loaded = 0;
+                ssize_t size;
+
+                while ((loaded < length) && ((size = ::read(fd, &(data[loaded]), length - loaded)) > 0)) {
+                    loaded += static_cast<uint32_t>(size);
+                }
+
+                ::close(fd);
+
+                if (loaded == length) {
+                    result = Core::ProxyType<Content>::Create(std::move(data));
+                }
+            }
+#endif
+
+            return (result);
+        }
+        Core::ProxyType<Content> Open(const string& path, const uint32_t length, const bool stream)
+        {
+            Core::ProxyType<Content> result;
+#ifndef __WINDOWS__
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+            if (fd != -1) {
+                ::posix_fadvise(fd, 0, length, POSIX_FADV_SEQUENTIAL);
+
+                result = Core::ProxyType<Content>::Create(fd, length, (stream == true ? this : nullptr));
+            }
+#endif
+
+            return (result);
+        }
+        void Submit(const Core::ProxyType<Core::IDispatch>& job)
+        {
+            _streamLock.Lock();
+            _streaming.push_back(job);
+            _streamLock.Unlock();
+
+            Core::IWorkerPool::Instance().Submit(job);
+        }
+        void Done(const Core::IDispatch& job)
+        {
+            _streamLock.Lock();
+
+            std::list<Core::ProxyType<Core::IDispatch>>::iterator index(_streaming.begin());
+
+            while ((index != _streaming.end()) && (&job != &(*(*index)))) {
+                index++;
+            }
+
+            if (index != _streaming.end()) {
+                _streaming.erase(index);
+            }
+
+            _streamLock.Unlock();
+        }
+        void Insert(const Entry& entry, const uint64_t generation)
+        {
+            const uint32_t size = Size(entry);
+
+            _adminLock.Lock();
+
+            if (Generation(entry.Path) != generation) {
+                // It changed while it was being loaded, what we read might already be stale.
+                _adminLock.Unlock();
+                return;
+            }
+
+            // Someone else might have loaded it in the mean time.
+            Remove(entry.Path);
+
+            while ((_entries.empty() == false) && ((_size + size) > _maxSize)) {
+                Remove(_entries.back().Path);
+            }
+
+            _entries.push_front(entry);
+            _index.emplace(entry.Path, _entries.begin());
+            _size += size;
+
+            _adminLock.Unlock();
+        }
+        // Make sure we get notified if something changes in the directory, before its content is loaded.
+        bool Watch(const string& directory)
+        {
+            Core::SafeSyncType<Core::CriticalSection> scopedLock(_adminLock);
+            Watches::const_iterator index(_watches.begin());
+
+            while ((index != _watches.end()) && (index->second != directory)) {
+                index++;
+            }
+
+            if (index == _watches.end()) {
+#ifdef __WINDOWS__
+                return (false);
+#else
+                int wd = inotify_add_watch(_notifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CREATE | IN_DELETE_SELF | IN_MOVE_SELF);
+
+                if (wd < 0) {
+                    return (false);
+                }
+
+                _watches[wd] = directory;
+#endif
+            }
+
+            return (true);
+        }
+        void Remove(const string& path)
+        {
+            Index::iterator index(_index.find(path));
+
+            if (index != _index.end()) {
+                _size -= Size(*(index->second));
+                _entries.erase(index->second);
+                _index.erase(index);
+            }
+        }
+        void Flush(const string& directory)
+        {
+            Entries::iterator index(_entries.begin());
+
+            while (index != _entries.end()) {
+                if (index->Path.compare(0, directory.length(), directory) == 0) {
+                    _size -= Size(*index);
+                    _index.erase(index->Path);
+                    index = _entries.erase(index);
+                } else {
+                    index++;
+                }
+            }
+        }
+        void Flush()
+        {
+            _entries.clear();
+            _index.clear();
+            _size = 0;
+        }
+        // Lock should be taken by the caller.
+        void Invalidate(const string& path)
+        {
+            if (_generations.size() >= MaxGenerations) {
+                Invalidate();
+            }
+            _generations[path]++;
+        }
+        // Invalidates all paths at once. Lock should be taken by the caller.
+        void Invalidate()
+        {
+            _generations.clear();
+            _epoch++;
+        }
+        static uint32_t Size(const Entry& entry)
+        {
+            return (entry.Plain->Length() + (entry.Compressed.IsValid() == true ? entry.Compressed->Length() : 0));
+        }
+
+    private:
+        mutable Core::CriticalSection _adminLock;
+        int _notifyFd;
+        uint32_t _maxSize;
+        uint32_t _maxEntrySize;
+        uint32_t _maxLoadSize;
+        bool _precompressed;
+        uint32_t _size;
+        Entries _entries;
+        Index _index;
+        Watches _watches;
+        Generations _generations;
+        uint32_t _epoch;
+        std::atomic<uint64_t> _hits;
+        std::atomic<uint64_t> _misses;
+        Core::CriticalSection _streamLock;
+        std::list<Core::ProxyType<Core::IDispatch>> _streaming;
+    };
+
+} // namespace Plugin
+} // namespace WPEFramework
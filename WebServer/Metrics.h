@@ -0,0 +1,430 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Module.h"
+
+#include <atomic>
+#include <map>
+#include <tuple>
+
+namespace WPEFramework {
+namespace Plugin {
+
+    // Lock free latency histogram. Bucket N counts the samples in [2^N, 2^(N+1)) microseconds, so
+    // recording a sample is a handful of relaxed atomic increments, whatever thread it is done on.
+    class LatencyHistogram {
+    public:
+        static constexpr uint8_t Buckets = 32;
+
+        LatencyHistogram(const LatencyHistogram&) = delete;
+        LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+        LatencyHistogram()
+            : _count(0)
+            , _sum(0)
+        {
+            for (uint8_t index = 0; index < Buckets; index++) {
+                _buckets[index] = 0;
+            }
+        }
+        ~LatencyHistogram()
+        {
+        }
+
+    public:
+        void Record(const uint64_t microseconds)
+        {
+            uint8_t bucket = 0;
+            uint64_t value = microseconds >> 1;
+
+            while ((value != 0) && (bucket < (Buckets - 1))) {
+                value >>= 1;
+                bucket++;
+            }
+
+            _buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+            _sum.fetch_add(microseconds, std::memory_order_relaxed);
+            _count.fetch_add(1, std::memory_order_relaxed);
+        }
+        inline uint64_t Count() const
+        {
+            return (_count.load(std::memory_order_relaxed));
+        }
+        inline uint64_t Sum() const
+        {
+            return (_sum.load(std::memory_order_relaxed));
+        }
+        inline uint64_t Bucket(const uint8_t index) const
+        {
+            ASSERT(index < Buckets);
+            return (_buckets[index].load(std::memory_order_relaxed));
+        }
+        // Upper bound, in microseconds, of a bucket.
+        static inline uint64_t Bound(const uint8_t index)
+        {
+            return (static_cast<uint64_t>(2) << index);
+        }
+        // Returns the upper bound of the bucket holding the given percentile, in microseconds.
+        uint64_t Percentile(const uint8_t percentile) const
+        {
+            uint64_t counts[Buckets];
+            uint64_t total = 0;
+
+            // Take a copy first, so the walk below works on a consistent set of buckets.
+            for (uint8_t index = 0; index < Buckets; index++) {
+                counts[index] = Bucket(index);
+                total += counts[index];
+            }
+
+            uint64_t result = 0;
+
+            if (total != 0) {
+                const uint64_t threshold = ((total * percentile) + 99) / 100;
+                uint64_t seen = 0;
+                uint8_t index = 0;
+
+                while ((index < (Buckets - 1)) && ((seen + counts[index]) < threshold)) {
+                    seen += counts[index];
+                    index++;
+                }
+
+                result = Bound(index);
+            }
+
+            return (result);
+        }
+
+    private:
+        std::atomic<uint64_t> _count;
+        std::atomic<uint64_t> _sum;
+        std::atomic<uint32_t> _buckets[Buckets];
+    };
+
+    class RouteMetrics {
+    public:
+        RouteMetrics(const RouteMetrics&) = delete;
+        RouteMetrics& operator=(const RouteMetrics&) = delete;
+
+        RouteMetrics()
+            : _latency()
+            , _bytesIn(0)
+            , _bytesOut(0)
+            , _errors(0)
+        {
+        }
+        ~RouteMetrics()
+        {
+        }
+
+    public:
+        inline void Served(const uint64_t microseconds, const uint32_t bytesIn, const uint32_t bytesOut)
+        {
+            _latency.Record(microseconds);
+            _bytesIn.fetch_add(bytesIn, std::memory_order_relaxed);
+            _bytesOut.fetch_add(bytesOut, std::memory_order_relaxed);
+        }
+        inline void Failed()
+        {
+            _errors.fetch_add(1, std::memory_order_relaxed);
+        }
+        inline const LatencyHistogram& Latency() const
+        {
+            return (_latency);
+        }
+        inline uint64_t BytesIn() const
+        {
+            return (_bytesIn.load(std::memory_order_relaxed));
+        }
+        inline uint64_t BytesOut() const
+        {
+            return (_bytesOut.load(std::memory_order_relaxed));
+        }
+        inline uint64_t Errors() const
+        {
+            return (_errors.load(std::memory_order_relaxed));
+        }
+
+    private:
+        LatencyHistogram _latency;
+        std::atomic<uint64_t> _bytesIn;
+        std::atomic<uint64_t> _bytesOut;
+        std::atomic<uint64_t> _errors;
+    };
+
+    // Collects a snapshot of the metrics of all routes and renders them as JSON or in the Prometheus text format.
+    class MetricsReport {
+    public:
+        class Data : public Core::JSON::Container {
+        public:
+            class Route : public Core::JSON::Container {
+            public:
+                Route& operator=(const Route&) = delete;
+
+                Route()
+                    : Core::JSON::Container()
+                {
+                    Init();
+                }
+                Route(const Route& copy)
+                    : Core::JSON::Container()
+                    , Path(copy.Path)
+                    , Type(copy.Type)
+                    , Requests(copy.Requests)
+                    , Errors(copy.Errors)
+                    , BytesIn(copy.BytesIn)
+                    , BytesOut(copy.BytesOut)
+                    , Average(copy.Average)
+                    , P50(copy.P50)
+                    , P90(copy.P90)
+                    , P99(copy.P99)
+                {
+                    Init();
+                }
+                ~Route() override
+                {
+                }
+
+            private:
+                void Init()
+                {
+                    Add(_T("path"), &Path);
+                    Add(_T("type"), &Type);
+                    Add(_T("requests"), &Requests);
+                    Add(_T("errors"), &Errors);
+                    Add(_T("bytesin"), &BytesIn);
+                    Add(_T("bytesout"), &BytesOut);
+                    Add(_T("average"), &Average);
+                    Add(_T("p50"), &P50);
+                    Add(_T("p90"), &P90);
+                    Add(_T("p99"), &P99);
+                }
+
+            public:
+                Core::JSON::String Path;
+                Core::JSON::String Type;
+                Core::JSON::DecUInt64 Requests;
+                Core::JSON::DecUInt64 Errors;
+                Core::JSON::DecUInt64 BytesIn;
+                Core::JSON::DecUInt64 BytesOut;
+                // Latencies in microseconds.
+                Core::JSON::DecUInt64 Average;
+                Core::JSON::DecUInt64 P50;
+                Core::JSON::DecUInt64 P90;
+                Core::JSON::DecUInt64 P99;
+            };
+
+        public:
+            Data(const Data&) = delete;
+            Data& operator=(const Data&) = delete;
+
+            Data()
+                : Core::JSON::Container()
+            {
+                Add(_T("connections"), &Connections);
+                Add(_T("cachehits"), &CacheHits);
+                Add(_T("cachemisses"), &CacheMisses);
+                Add(_T("routes"), &Routes);
+            }
+            ~Data() override
+            {
+            }
+
+        public:
+            Core::JSON::DecUInt32 Connections;
+            Core::JSON::DecUInt64 CacheHits;
+            Core::JSON::DecUInt64 CacheMisses;
+            Core::JSON::ArrayType<Route> Routes;
+        };
+
+    public:
+        MetricsReport(const MetricsReport&) = delete;
+        MetricsReport& operator=(const MetricsReport&) = delete;
+
+        MetricsReport(const uint32_t connections, const uint64_t cacheHits, const uint64_t cacheMisses)
+            : _data()
+            , _text()
+            , _latencies()
+            , _errors()
+            , _received()
+            , _sent()
+        {
+            _data.Connections = connections;
+            _data.CacheHits = cacheHits;
+            _data.CacheMisses = cacheMisses;
+
+            _text = _T("# TYPE webserver_connections_active gauge\nwebserver_connections_active ") + Core::NumberType<uint32_t>(connections).Text() + _T("\n");
+            _text += _T("# TYPE webserver_cache_hits_total counter\nwebserver_cache_hits_total ") + Core::NumberType<uint64_t>(cacheHits).Text() + _T("\n");
+            _text += _T("# TYPE webserver_cache_misses_total counter\nwebserver_cache_misses_total ") + Core::NumberType<uint64_t>(cacheMisses).Text() + _T("\n");
+        }
+        ~MetricsReport()
+        {
+        }
+
+    public:
+        void Add(const string& path, const TCHAR type[], const RouteMetrics& metrics)
+        {
+            const LatencyHistogram& latency(metrics.Latency());
+            const string labels(_T("route=\"") + Escape(path) + _T("\",type=\"") + Escape(type) + _T("\""));
+            Data::Route& route(_data.Routes.Add());
+            uint64_t cumulative = 0;
+
+            route.Path = path;
+            route.Type = type;
+            route.Requests = latency.Count();
+            route.Errors = metrics.Errors();
+            route.BytesIn = metrics.BytesIn();
+            route.BytesOut = metrics.BytesOut();
+            route.Average = (latency.Count() != 0 ? latency.Sum() / latency.Count() : 0);
+            route.P50 = latency.Percentile(50);
+            route.P90 = latency.Percentile(90);
+            route.P99 = latency.Percentile(99);
+
+            for (uint8_t index = 0; index < LatencyHistogram::Buckets; index++) {
+                cumulative += latency.Bucket(index);
+                _latencies += _T("webserver_request_duration_seconds_bucket{") + labels + _T(",le=\"") + Seconds(LatencyHistogram::Bound(index)) + _T("\"} ") + Core::NumberType<uint64_t>(cumulative).Text() + _T("\n");
+            }
+            _latencies += _T("webserver_request_duration_seconds_bucket{") + labels + _T(",le=\"+Inf\"} ") + Core::NumberType<uint64_t>(cumulative).Text() + _T("\n");
+            _latencies += _T("webserver_request_duration_seconds_sum{") + labels + _T("} ") + Seconds(latency.Sum()) + _T("\n");
+            _latencies += _T("webserver_request_duration_seconds_count{") + labels + _T("} ") + Core::NumberType<uint64_t>(latency.Count()).Text() + _T("\n");
+            _errors += _T("webserver_request_errors_total{") + labels + _T("} ") + Core::NumberType<uint64_t>(metrics.Errors()).Text() + _T("\n");
+            _received += _T("webserver_received_bytes_total{") + labels + _T("} ") + Core::NumberType<uint64_t>(metrics.BytesIn()).Text() + _T("\n");
+            _sent += _T("webserver_sent_bytes_total{") + labels + _T("} ") + Core::NumberType<uint64_t>(metrics.BytesOut()).Text() + _T("\n");
+        }
+        // The samples of a metric family have to be grouped together, following its TYPE line.
+        string Text() const
+        {
+            string result(_text);
+
+            result += _T("# TYPE webserver_request_duration_seconds histogram\n") + _latencies;
+            result += _T("# TYPE webserver_request_errors_total counter\n") + _errors;
+            result += _T("# TYPE webserver_received_bytes_total counter\n") + _received;
+            result += _T("# TYPE webserver_sent_bytes_total counter\n") + _sent;
+
+            return (result);
+        }
+        string JSON() const
+        {
+            string result;
+            _data.ToString(result);
+            return (result);
+        }
+
+    private:
+        static string Seconds(const uint64_t microseconds)
+        {
+            TCHAR buffer[32];
+            ::snprintf(buffer, sizeof(buffer), _T("%llu.%06llu"), static_cast<unsigned long long>(microseconds / 1000000), static_cast<unsigned long long>(microseconds % 1000000));
+            return (string(buffer));
+        }
+        // Backslash, double quote and newline have to be escaped in label values.
+        static string Escape(const string& value)
+        {
+            string result;
+
+            result.reserve(value.length());
+
+            for (const TCHAR character : value) {
+                if (character == '\\') {
+                    result += _T("\\\\");
+                } else if (character == '"') {
+                    result += _T("\\\"");
+                } else if (character == '\n') {
+                    result += _T("\\n");
+                } else {
+                    result += character;
+                }
+            }
+
+            return (result);
+        }
+
+    private:
+        Data _data;
+        string _text;
+        string _latencies;
+        string _errors;
+        string _received;
+        string _sent;
+    };
+
+    // The metrics of a bounded number of routes, by path. Paths seen once the table is full are accounted for on
+    // one overflow route, so requests for random paths can not grow it without limit. Routes are never removed,
+    // so a reference to one stays valid as long as the table exists.
+    class RouteTable {
+    private:
+        typedef std::map<string, RouteMetrics> Routes;
+
+    public:
+        RouteTable(const RouteTable&) = delete;
+        RouteTable& operator=(const RouteTable&) = delete;
+
+        RouteTable(const uint16_t maxRoutes, const string& overflow)
+            : _adminLock()
+            , _maxRoutes(maxRoutes)
+            , _routes()
+            , _overflowPath(overflow)
+            , _overflow()
+        {
+        }
+        ~RouteTable()
+        {
+        }
+
+    public:
+        RouteMetrics& Route(const string& path)
+        {
+            Core::SafeSyncType<Core::CriticalSection> scopedLock(_adminLock);
+
+            Routes::iterator index(_routes.find(path));
+
+            if (index == _routes.end()) {
+                if (_routes.size() >= _maxRoutes) {
+                    return (_overflow);
+                }
+
+                index = _routes.emplace(std::piecewise_construct, std::forward_as_tuple(path), std::forward_as_tuple()).first;
+            }
+
+            return (index->second);
+        }
+        void Report(MetricsReport& report, const TCHAR type[]) const
+        {
+            Core::SafeSyncType<Core::CriticalSection> scopedLock(_adminLock);
+
+            for (const std::pair<const string, RouteMetrics>& route : _routes) {
+                report.Add(route.first, type, route.second);
+            }
+
+            if ((_overflow.Latency().Count() != 0) || (_overflow.Errors() != 0)) {
+                report.Add(_overflowPath, type, _overflow);
+            }
+        }
+
+    private:
+        mutable Core::CriticalSection _adminLock;
+        const uint16_t _maxRoutes;
+        Routes _routes;
+        const string _overflowPath;
+        RouteMetrics _overflow;
+    };
+
+} // namespace Plugin
+} // namespace WPEFramework
@@ -0,0 +1,282 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Module.h"
+
+namespace WPEFramework {
+namespace Plugin {
+
+    // Path segment trie, mapping URL path prefixes to an element. A lookup walks the segments of the
+    // path once and returns the element registered for the longest matching prefix, so its cost depends
+    // on the depth of the path, not on the number of prefixes registered. Empty segments are ignored,
+    // so "/Service/DeviceInfo" and "/Service//DeviceInfo/" are the same prefix.
+    template <typename ELEMENT>
+    class PrefixTreeType {
+    private:
+        class Node {
+        private:
+            Node(const Node&) = delete;
+            Node& operator=(const Node&) = delete;
+
+            typedef std::vector<std::pair<string, Node*>> Children;
+
+        public:
+            Node()
+                : _element(nullptr)
+                , _children()
+            {
+            }
+            ~Node()
+            {
+                Clear();
+            }
+
+        public:
+            inline ELEMENT* Element() const
+            {
+                return (_element);
+            }
+            inline void Element(ELEMENT* element)
+            {
+                _element = element;
+            }
+            inline bool IsEmpty() const
+            {
+                return ((_element == nullptr) && (_children.empty() == true));
+            }
+            void Clear()
+            {
+                for (std::pair<string, Node*>& child : _children) {
+                    delete child.second;
+                }
+                _children.clear();
+                _element = nullptr;
+            }
+            void Collect(std::list<ELEMENT*>& elements) const
+            {
+                if (_element != nullptr) {
+                    elements.push_back(_element);
+                }
+                for (const std::pair<string, Node*>& child : _children) {
+                    child.second->Collect(elements);
+                }
+            }
+            // Children are kept sorted, so a segment can be looked up without constructing a string.
+            Node* Find(const string& path, const uint32_t offset, const uint32_t length) const
+            {
+                typename Children::const_iterator index(LowerBound(path, offset, length));
+
+                return (((index != _children.end()) && (index->first.compare(0, string::npos, path, offset, length) == 0)) ? index->second : nullptr);
+            }
+            Node* Create(const string& path, const uint32_t offset, const uint32_t length)
+            {
+                typename Children::iterator index(LowerBound(path, offset, length));
+
+                if ((index == _children.end()) || (index->first.compare(0, string::npos, path, offset, length) != 0)) {
+                    index = _children.insert(index, std::pair<string, Node*>(path.substr(offset, length), new Node()));
+                }
+
+                return (index->second);
+            }
+            void Remove(const Node* child)
+            {
+                typename Children::iterator index(_children.begin());
+
+                while ((index != _children.end()) && (index->second != child)) {
+                    index++;
+                }
+
+                ASSERT(index != _children.end());
+
+                if (index != _children.end()) {
+                    delete index->second;
+                    _children.erase(index);
+                }
+            }
+
+        private:
+            typename Children::const_iterator LowerBound(const string& path, const uint32_t offset, const uint32_t length) const
+            {
+                return (const_cast<Node*>(this)->LowerBound(path, offset, length));
+            }
+            typename Children::iterator LowerBound(const string& path, const uint32_t offset, const uint32_t length)
+            {
+                typename Children::iterator first(_children.begin());
+                uint32_t count = static_cast<uint32_t>(_children.size());
+
+                while (count > 0) {
+                    uint32_t step = count / 2;
+                    typename Children::iterator middle(first + step);
+
+                    if (middle->first.compare(0, string::npos, path, offset, length) < 0) {
+                        first = middle + 1;
+                        count -= step + 1;
+                    } else {
+                        count = step;
+                    }
+                }
+
+                return (first);
+            }
+
+        private:
+            ELEMENT* _element;
+            Children _children;
+        };
+
+    public:
+        PrefixTreeType(const PrefixTreeType<ELEMENT>&) = delete;
+        PrefixTreeType<ELEMENT>& operator=(const PrefixTreeType<ELEMENT>&) = delete;
+
+        PrefixTreeType()
+            : _root()
+            , _count(0)
+        {
+        }
+        ~PrefixTreeType()
+        {
+        }
+
+    public:
+        inline uint32_t Count() const
+        {
+            return (_count);
+        }
+        // Returns the element that was registered for this prefix before, if any.
+        ELEMENT* Add(const string& prefix, ELEMENT* element)
+        {
+            ASSERT(element != nullptr);
+
+            Node* node = &_root;
+            uint32_t offset = 0;
+            uint32_t length;
+
+            while ((length = Segment(prefix, offset)) != 0) {
+                node = node->Create(prefix, offset, length);
+                offset += length;
+            }
+
+            ELEMENT* result = node->Element();
+            node->Element(element);
+
+            if (result == nullptr) {
+                _count++;
+            }
+
+            return (result);
+        }
+        // Returns the element that was registered for exactly this prefix, if any.
+        ELEMENT* Remove(const string& prefix)
+        {
+            std::vector<Node*> trail;
+            Node* node = &_root;
+            uint32_t offset = 0;
+            uint32_t length;
+
+            while ((node != nullptr) && ((length = Segment(prefix, offset)) != 0)) {
+                trail.push_back(node);
+                node = node->Find(prefix, offset, length);
+                offset += length;
+            }
+
+            ELEMENT* result = (node != nullptr ? node->Element() : nullptr);
+
+            if (result != nullptr) {
+                node->Element(nullptr);
+                _count--;
+
+                // Prune the branches that do not lead to an element anymore.
+                while ((trail.empty() == false) && (node->IsEmpty() == true)) {
+                    Node* parent = trail.back();
+                    trail.pop_back();
+                    parent->Remove(node);
+                    node = parent;
+                }
+            }
+
+            return (result);
+        }
+        // Returns the element of the longest prefix of the path and the length of the path that it matched.
+        ELEMENT* Find(const string& path, uint32_t& matched) const
+        {
+            const Node* node = &_root;
+            ELEMENT* result = _root.Element();
+            uint32_t offset = 0;
+            uint32_t length;
+
+            matched = 0;
+
+            while ((node != nullptr) && ((length = Segment(path, offset)) != 0)) {
+                node = node->Find(path, offset, length);
+                offset += length;
+
+                if ((node != nullptr) && (node->Element() != nullptr)) {
+                    result = node->Element();
+                    matched = offset;
+                }
+            }
+
+            return (result);
+        }
+        void Elements(std::list<ELEMENT*>& elements) const
+        {
+            _root.Collect(elements);
+        }
+        // Hands out all elements and empties the tree.
+        void Clear(std::list<ELEMENT*>& elements)
+        {
+            _root.Collect(elements);
+            _root.Clear();
+            _count = 0;
+        }
+
+    private:
+        // Skips the leading slashes, so on return offset is the start of the next segment, and returns the
+        // length of that segment. If there is no next segment, 0 is returned and offset is left untouched.
+        static uint32_t Segment(const string& path, uint32_t& offset)
+        {
+            const uint32_t start = offset;
+
+            while ((offset < path.length()) && (path[offset] == '/')) {
+                offset++;
+            }
+
+            uint32_t end = offset;
+
+            while ((end < path.length()) && (path[end] != '/')) {
+                end++;
+            }
+
+            if (end == offset) {
+                offset = start;
+                return (0);
+            }
+
+            return (end - offset);
+        }
+
+    private:
+        Node _root;
+        uint32_t _count;
+    };
+
+} // namespace Plugin
+} // namespace WPEFramework
@@ -18,6 +18,9 @@
  */
  
 #include "Module.h"
+#include "FileCache.h"
+#include "Metrics.h"
+#include "PrefixTree.h"
 #include <interfaces/IMemory.h>
 #include <interfaces/IWebServer.h>
 
@@ -101,20 +104,32 @@ namespace Plugin {
                     , Path()
                     , Subst()
                     , Server()
+                    , Connections(1)
+                    , Pipeline(1)
+                    , Timeout(0)
                 {
                     Add(_T("path"), &Path);
                     Add(_T("subst"), &Subst);
                     Add(_T("server"), &Server);
+                    Add(_T("connections"), &Connections);
+                    Add(_T("pipeline"), &Pipeline);
+                    Add(_T("timeout"), &Timeout);
                 }
                 Proxy(const Proxy& copy)
                     : Core::JSON::Container()
                     , Path(copy.Path)
                     , Subst(copy.Subst)
                     , Server(copy.Server)
+                    , Connections(copy.Connections)
+                    , Pipeline(copy.Pipeline)
+                    , Timeout(copy.Timeout)
                 {
                     Add(_T("path"), &Path);
                     Add(_T("subst"), &Subst);
                     Add(_T("server"), &Server);
+                    Add(_T("connections"), &Connections);
+                    Add(_T("pipeline"), &Pipeline);
+                    Add(_T("timeout"), &Timeout);
                 }
                 virtual ~Proxy()
                 {
@@ -124,6 +139,10 @@ namespace Plugin {
                 Core::JSON::String Path;
                 Core::JSON::String Subst;
                 Core::JSON::String Server;
+                // Size of the connection pool, number of requests pipelined per connection and timeout in ms (0 is none).
+                Core::JSON::DecUInt8 Connections;
+                Core::JSON::DecUInt8 Pipeline;
+                Core::JSON::DecUInt32 Timeout;
             };
 
         public:
@@ -134,6 +153,8 @@ namespace Plugin {
                 , Interface()
                 , Path(_T("www"))
                 , IdleTime(180)
+                , Offload(false)
+                , Metrics()
             {
                 Add(_T("port"), &Port);
                 Add(_T("binding"), &Binding);
@@ -141,6 +162,9 @@ namespace Plugin {
                 Add(_T("path"), &Path);
                 Add(_T("idletime"), &IdleTime);
                 Add(_T("proxies"), &Proxies);
+                Add(_T("cache"), &Cache);
+                Add(_T("offload"), &Offload);
+                Add(_T("metrics"), &Metrics);
             }
             ~Config()
             {
@@ -153,6 +177,11 @@ namespace Plugin {
             Core::JSON::String Path;
             Core::JSON::DecUInt16 IdleTime;
             Core::JSON::ArrayType<Proxy> Proxies;
+            FileCache::Config Cache;
+            // Load the files that are not cached on the workerpool, instead of on the communication thread.
+            Core::JSON::Boolean Offload;
+            // Path on which the metrics are served, in the Prometheus text format or, with ?format=json, as JSON.
+            Core::JSON::String Metrics;
         };
 
         class RequestFactory {
@@ -198,47 +227,137 @@ namespace Plugin {
         };
 
         // IMPORTANT NOTE:
-        // There is no need to lock/unlock usage on this server as all action->response senarious take place on
-        // the communication thread from the SoketPortMonitor. There is only 1 such thread per process.
-        // Given this, make sure that all actions done by the ProxyMap are deterministic and short <100ms as it
-        // upholds all other network traffic.
+        // All action->response senarious take place on the communication thread from the SoketPortMonitor. There is
+        // only 1 such thread per process. Given this, make sure that all actions done by the ProxyMap are deterministic
+        // and short <100ms as it upholds all other network traffic. The only other thread entering the ProxyMap is the
+        // job that expires requests that are not answered in time, that is why the administration is locked.
         class ProxyMap {
         private:
+            struct OutstandingMessage {
+                Core::ProxyType<Web::Request> Request;
+                uint32_t Id;
+                uint64_t Started;
+                uint64_t Deadline;
+                uint32_t Length;
+                bool Submitted;
+            };
+
+            typedef std::list<OutstandingMessage> Messages;
+
+            class Upstream;
+
             class OutgoingChannel : public Web::WebLinkType<Core::SocketStream, Web::Response, Web::Request, ResponseFactory> {
             private:
                 OutgoingChannel() = delete;
                 OutgoingChannel(const OutgoingChannel&) = delete;
                 OutgoingChannel& operator=(const OutgoingChannel&) = delete;
 
-                struct OutstandingMessage {
-                    Core::ProxyType<Web::Request> Request;
-                    uint32_t Id;
-                };
+            public:
+                OutgoingChannel(Upstream& upstream, const Core::NodeId& remoteId, const uint8_t pipeline)
+                    : Web::WebLinkType<Core::SocketStream, Web::Response, Web::Request, ResponseFactory>(pipeline + 1, false, remoteId.AnyInterface(), remoteId, 1024, 1024)
+                    , _upstream(upstream)
+                    , _outstandingMessages()
+                    , _connected(false)
+                {
+                }
+                ~OutgoingChannel() override
+                {
+                    Close(Core::infinite);
+                }
+
+            public:
+                inline uint32_t Outstanding() const
+                {
+                    return (static_cast<uint32_t>(_outstandingMessages.size()));
+                }
+                inline bool Connected() const
+                {
+                    return (_connected);
+                }
+                inline Messages& Outstandings()
+                {
+                    return (_outstandingMessages);
+                }
+                void ProxyRequest(const OutstandingMessage& message)
+                {
+                    _outstandingMessages.push_back(message);
+
+                    if (IsOpen() == true) {
+                        Forward();
+                    } else if (IsClosed() == true) {
+                        Open(0);
+                    }
+                }
+                // Pipeline all messages that have not yet been handed over to the link.
+                void Forward()
+                {
+                    Messages::iterator index(_outstandingMessages.begin());
+
+                    while (index != _outstandingMessages.end()) {
+                        if (index->Submitted == false) {
+                            index->Submitted = true;
+                            Submit(index->Request);
+                        }
+                        index++;
+                    }
+                }
+
+            public:
+                void LinkBody(Core::ProxyType<Web::Response>& response) override
+                {
+                    response->Body(_textBodies.Element());
+                }
+                void Send(const Core::ProxyType<Web::Request>& request) override;
+                // Whenever there is a state change on the link, it is reported here.
+                void StateChange() override;
+                void Received(Core::ProxyType<Web::Response>& response) override;
+
+            private:
+                Upstream& _upstream;
+                Messages _outstandingMessages;
+                bool _connected;
+            };
+
+            // An Upstream is a pool of keep-alive connections towards one proxied server. Requests are spread over
+            // the connection with the least outstanding requests, each connection pipelining up to "pipeline" of them.
+            class Upstream {
+            private:
+                Upstream() = delete;
+                Upstream(const Upstream&) = delete;
+                Upstream& operator=(const Upstream&) = delete;
 
             public:
-                OutgoingChannel(const string& path, const string& replacement, ProxyMap& proxyMap, const Core::NodeId& remoteId)
-                    : Web::WebLinkType<Core::SocketStream, Web::Response, Web::Request, ResponseFactory>(2, false, remoteId.AnyInterface(), remoteId, 1024, 1024)
+                Upstream(ProxyMap& parent, const string& path, const string& replacement, const Core::NodeId& remoteId, const uint8_t connections, const uint8_t pipeline, const uint32_t timeout)
+                    : _parent(parent)
                     , _path(path)
                     , _replacement(replacement)
-                    , _outstandingMessages()
-                    , _proxyMap(proxyMap)
+                    , _remoteId(remoteId)
+                    , _connections(connections == 0 ? 1 : connections)
+                    , _pipeline(pipeline == 0 ? 1 : pipeline)
+                    , _timeout(static_cast<uint64_t>(timeout) * Core::Time::TicksPerMillisecond)
+                    , _channels()
+                    , _pending()
+                    , _metrics()
                 {
                 }
-
-                void ProxyRequest(Core::ProxyType<Web::Request>& request, uint32_t id)
+                ~Upstream()
                 {
+                    std::list<OutgoingChannel*> channels;
 
-                    OutstandingMessage message = { request, id };
+                    // Detach the connections first, so their closure is not seen as a reason to reconnect.
+                    _parent._adminLock.Lock();
+                    channels.swap(_channels);
+                    _pending.clear();
+                    _parent._adminLock.Unlock();
 
-                    _outstandingMessages.push_back(message);
+                    // An expiry run might still be closing one of them.
+                    _parent._closeLock.Lock();
 
-                    if (_outstandingMessages.size() == 1) {
-                        if (IsOpen() == false) {
-                            Open(0);
-                        } else {
-                            Submit(request);
-                        }
+                    for (OutgoingChannel* channel : channels) {
+                        delete channel;
                     }
+
+                    _parent._closeLock.Unlock();
                 }
 
             public:
@@ -246,43 +365,207 @@ namespace Plugin {
                 {
                     return (_path);
                 }
-                virtual void LinkBody(Core::ProxyType<Web::Response>& response)
+                inline bool HasTimeout() const
                 {
-                    response->Body(_textBodies.Element());
+                    return (_timeout != 0);
+                }
+                inline uint64_t Timeout() const
+                {
+                    return (_timeout);
                 }
-                virtual void Send(const Core::ProxyType<Web::Request>& request)
+                inline const RouteMetrics& Metrics() const
                 {
-                    std::list<OutstandingMessage>::iterator index(_outstandingMessages.begin());
+                    return (_metrics);
+                }
+                void ProxyRequest(Core::ProxyType<Web::Request>& request, const uint32_t id)
+                {
+                    const uint64_t now(Core::Time::Now().Ticks());
+                    OutstandingMessage message = { request, id, now, (_timeout == 0 ? 0 : now + _timeout), (request->ContentLength.IsSet() == true ? request->ContentLength.Value() : 0), false };
+
+                    if ((_pending.empty() == false) || (Dispatch(message) == false)) {
+                        _pending.push_back(message);
+                    }
+
+                    if (message.Deadline != 0) {
+                        _parent.Schedule(now);
+                    }
+                }
+                void Sent(OutgoingChannel& channel, const Core::ProxyType<Web::Request>& request)
+                {
+                    Messages& messages(channel.Outstandings());
+                    Messages::iterator index(messages.begin());
 
-                    while ((index != _outstandingMessages.end()) && (index->Request.IsValid() == false)) {
+                    while ((index != messages.end()) && (index->Request != request)) {
                         index++;
                     }
 
-                    ASSERT(index != _outstandingMessages.end());
-                    ASSERT(index->Request == request);
+                    // Once send, we do not need the request anymore, mark it as send.
+                    if (index != messages.end()) {
+                        index->Request.Release();
+                    }
+                }
+                // Returns the id of the channel that is waiting for this response, 0 if nobody is waiting anymore.
+                uint32_t Received(OutgoingChannel& channel, const Web::Response& response)
+                {
+                    uint32_t result = 0;
+                    Messages& messages(channel.Outstandings());
+
+                    if (messages.empty() == false) {
+                        // Responses arrive in the order the requests were send.
+                        ASSERT(messages.front().Request.IsValid() == false);
+
+                        _metrics.Served(Core::Time::Now().Ticks() - messages.front().Started, messages.front().Length, (response.ContentLength.IsSet() == true ? response.ContentLength.Value() : 0));
+
+                        result = messages.front().Id;
+                        messages.pop_front();
+
+                        // This connection has room again, see if there is anything waiting.
+                        Drain();
+                    }
 
-                    index->Request.Release();
+                    return (result);
                 }
-                // Whenever there is a state change on the link, it is reported here.
-                virtual void StateChange()
+                void StateChange(OutgoingChannel& channel, std::list<uint32_t>& failed)
                 {
-                    if (IsOpen() == true) {
+                    if (std::find(_channels.begin(), _channels.end(), &channel) == _channels.end()) {
+                        // This connection is being destructed, nothing to do anymore.
+                        channel.Outstandings().clear();
+                    } else if (channel.IsOpen() == true) {
+                        channel.Forward();
+                    } else {
+                        Messages& messages(channel.Outstandings());
+                        Messages::reverse_iterator index(messages.rbegin());
+
+                        while (index != messages.rend()) {
+                            if ((index->Request.IsValid() == true) && (channel.Connected() == true)) {
+                                // The server closed a keep-alive connection, retry what it has not seen on another one.
+                                index->Submitted = false;
+                                _pending.push_front(*index);
+                            } else {
+                                _metrics.Failed();
+                                failed.push_back(index->Id);
+                            }
+                            index++;
+                        }
+                        messages.clear();
 
-                        if (!_outstandingMessages.empty()) {
-                            Submit(_outstandingMessages.front().Request);
+                        Drain();
+                    }
+                }
+                // Fail all requests that are not answered in time. A connection with a request that expired is closed, as
+                // the response for it would otherwise be matched with the next request on that connection.
+                void Expire(const uint64_t now, std::list<uint32_t>& failed, std::list<OutgoingChannel*>& closing)
+                {
+                    Messages::iterator loop(_pending.begin());
+
+                    while (loop != _pending.end()) {
+                        if ((loop->Deadline != 0) && (loop->Deadline <= now)) {
+                            _metrics.Failed();
+                            failed.push_back(loop->Id);
+                            loop = _pending.erase(loop);
+                        } else {
+                            loop++;
                         }
                     }
+
+                    for (OutgoingChannel* channel : _channels) {
+                        Messages& messages(channel->Outstandings());
+                        Messages::iterator index(messages.begin());
+
+                        while ((index != messages.end()) && ((index->Deadline == 0) || (index->Deadline > now))) {
+                            index++;
+                        }
+
+                        if (index != messages.end()) {
+                            Messages::reverse_iterator entry(messages.rbegin());
+
+                            while (entry != messages.rend()) {
+                                if ((entry->Submitted == false) && ((entry->Deadline == 0) || (entry->Deadline > now))) {
+                                    _pending.push_front(*entry);
+                                } else {
+                                    _metrics.Failed();
+                                    failed.push_back(entry->Id);
+                                }
+                                entry++;
+                            }
+                            messages.clear();
+                            closing.push_back(channel);
+                        }
+                    }
+
+                    Drain();
+                }
+                uint64_t NextDeadline() const
+                {
+                    uint64_t result = NextDeadline(_pending, 0);
+
+                    for (const OutgoingChannel* channel : _channels) {
+                        result = NextDeadline(const_cast<OutgoingChannel*>(channel)->Outstandings(), result);
+                    }
+
+                    return (result);
+                }
+
+            private:
+                static uint64_t NextDeadline(const Messages& messages, const uint64_t current)
+                {
+                    uint64_t result = current;
+
+                    for (const OutstandingMessage& message : messages) {
+                        if ((message.Deadline != 0) && ((result == 0) || (message.Deadline < result))) {
+                            result = message.Deadline;
+                        }
+                    }
+
+                    return (result);
+                }
+                void Drain()
+                {
+                    while ((_pending.empty() == false) && (Dispatch(_pending.front()) == true)) {
+                        _pending.pop_front();
+                    }
+                }
+                bool Dispatch(const OutstandingMessage& message)
+                {
+                    OutgoingChannel* selected = nullptr;
+
+                    for (OutgoingChannel* channel : _channels) {
+                        if ((channel->Outstanding() < _pipeline) && ((selected == nullptr) || (channel->Outstanding() < selected->Outstanding()))) {
+                            selected = channel;
+                        }
+                    }
+
+                    // Only grow the pool if all connections are busy.
+                    if (((selected == nullptr) || (selected->Outstanding() != 0)) && (_channels.size() < _connections)) {
+                        selected = new OutgoingChannel(*this, _remoteId, _pipeline);
+                        _channels.push_back(selected);
+                    }
+
+                    if (selected != nullptr) {
+                        selected->ProxyRequest(message);
+                    }
+
+                    return (selected != nullptr);
                 }
-                virtual void Received(Core::ProxyType<Web::Response>& response);
 
             private:
+                friend class OutgoingChannel;
+
+                ProxyMap& _parent;
                 const string _path;
                 const string _replacement;
-
-                std::list<OutstandingMessage> _outstandingMessages;
-                ProxyMap& _proxyMap;
+                const Core::NodeId _remoteId;
+                const uint8_t _connections;
+                const uint8_t _pipeline;
+                const uint64_t _timeout;
+                std::list<OutgoingChannel*> _channels;
+                Messages _pending;
+                RouteMetrics _metrics;
             };
 
+            typedef Core::WorkerPool::JobType<ProxyMap&> Job;
+            typedef PrefixTreeType<Upstream> Routes;
+
         private:
             ProxyMap() = delete;
             ProxyMap(const ProxyMap&) = delete;
@@ -290,17 +573,21 @@ namespace Plugin {
 
         public:
             ProxyMap(ChannelMap& server)
-                : _server(server)
-                , _proxies()
+                : _adminLock()
+                , _closeLock()
+                , _server(server)
+                , _routes()
+                , _timed()
+                , _job(*this)
+                , _scheduled(0)
             {
             }
             ~ProxyMap()
             {
+                _job.Revoke();
+
                 // Clean up channels in map.
-                while (_proxies.size() > 0) {
-                    delete _proxies.front();
-                    _proxies.pop_front();
-                }
+                Destroy();
             }
 
         public:
@@ -311,62 +598,56 @@ namespace Plugin {
 
                 while (index.Next() == true) {
 
-                    const string& path(index.Current().Path.Value());
-                    const string& subst(index.Current().Subst.Value());
-                    const Core::NodeId address(index.Current().Server.Value().c_str());
+                    const Config::Proxy& proxy(index.Current());
+                    const Core::NodeId address(proxy.Server.Value().c_str());
 
                     if (address.IsValid() == true) {
 
-                        _proxies.push_back(new OutgoingChannel(path, subst, *this, address));
+                        Install(new Upstream(*this, proxy.Path.Value(), proxy.Subst.Value(), address, proxy.Connections.Value(), proxy.Pipeline.Value(), proxy.Timeout.Value()));
                     }
                 }
             }
 
             void Destroy()
             {
+                std::list<Upstream*> proxies;
 
-                std::list<OutgoingChannel*>::iterator index(_proxies.begin());
+                // The connections should not be closed while holding the lock, their StateChange needs it.
+                _adminLock.Lock();
+                _routes.Clear(proxies);
+                _timed.clear();
+                _adminLock.Unlock();
 
-                while (index != _proxies.end()) {
+                std::list<Upstream*>::iterator index(proxies.begin());
+
+                while (index != proxies.end()) {
 
                     delete (*index);
 
                     index++;
                 }
-                _proxies.clear();
             }
 
             bool Relay(Core::ProxyType<Web::Request>& request, uint32_t channelId)
             {
 
-                bool found = false;
-                const string& originalPath = request->Path;
-                std::list<OutgoingChannel*>::iterator index(_proxies.begin());
-                string proxyPath;
-
-                while ((found == false) && (index != _proxies.end())) {
+                uint32_t matched;
 
-                    proxyPath = (*index)->Path();
+                _adminLock.Lock();
 
-                    uint32_t checkSize(static_cast<uint32_t>(proxyPath.length()));
-
-                    // If path starts with mapped string, we should relay.
-                    if (((originalPath.length() == checkSize) || ((originalPath.length() > checkSize) && (originalPath[checkSize] == '/'))) && (originalPath.compare(0, checkSize, proxyPath) == 0)) {
-                        found = true;
-                    } else {
-                        index++;
-                    }
-                }
+                // If path starts with mapped string, we should relay. The longest mapped prefix wins.
+                Upstream* upstream = _routes.Find(request->Path, matched);
 
                 // If we didn't find relay instructions for this path, return false.
-                if (found == true) {
+                if (upstream != nullptr) {
 
-                    request->Path = (proxyPath + request->Path.substr(proxyPath.length()));
-
-                    (*index)->ProxyRequest(request, channelId);
+                    // The request is forwarded with its path as is, what was matched is only relevant for the lookup.
+                    upstream->ProxyRequest(request, channelId);
                 }
 
-                return (found);
+                _adminLock.Unlock();
+
+                return (upstream != nullptr);
             }
 
             inline void AddProxy(const string& path, const string& subst, const string& address)
@@ -375,32 +656,156 @@ namespace Plugin {
 
                 if (node.IsValid() == true) {
 
-                    _proxies.push_back(new OutgoingChannel(path, subst, *this, node));
+                    const Config::Proxy defaults;
+
+                    Install(new Upstream(*this, path, subst, node, defaults.Connections.Value(), defaults.Pipeline.Value(), defaults.Timeout.Value()));
                 }
             }
             inline void RemoveProxy(const string& path)
             {
-                std::list<OutgoingChannel*>::iterator index(_proxies.begin());
+                _adminLock.Lock();
 
-                while ((index != _proxies.end()) && ((*index)->Path() != path)) {
+                Upstream* upstream = _routes.Remove(path);
 
-                    index++;
-                }
+                Untime(upstream);
 
-                if (index != _proxies.end()) {
+                _adminLock.Unlock();
 
-                    delete (*index);
-                    _proxies.erase(index);
+                if (upstream != nullptr) {
+                    delete upstream;
                 }
             }
             inline void Submit(uint32_t channelId, Core::ProxyType<Web::Response>& response)
             {
                 _server.Submit(channelId, response);
             }
+            void Report(MetricsReport& report) const
+            {
+                std::list<Upstream*> upstreams;
+
+                _adminLock.Lock();
+
+                _routes.Elements(upstreams);
+
+                for (const Upstream* upstream : upstreams) {
+                    report.Add(upstream->Path(), _T("proxy"), upstream->Metrics());
+                }
+
+                _adminLock.Unlock();
+            }
+
+            void Dispatch()
+            {
+                const uint64_t now(Core::Time::Now().Ticks());
+                std::list<uint32_t> failed;
+                std::list<OutgoingChannel*> closing;
+                uint64_t next = 0;
+
+                _adminLock.Lock();
+
+                _scheduled = 0;
+
+                for (Upstream* upstream : _timed) {
+                    upstream->Expire(now, failed, closing);
+
+                    uint64_t deadline = upstream->NextDeadline();
+
+                    if ((deadline != 0) && ((next == 0) || (deadline < next))) {
+                        next = deadline;
+                    }
+                }
+
+                if (next != 0) {
+                    // Re-armed from within the job itself, never revoked here.
+                    _scheduled = std::min(next, now + Shortest());
+                    _job.Schedule(Core::Time(_scheduled));
+                }
+
+                // The connections are closed outside the admin lock, their StateChange needs it. Taking the close
+                // lock before releasing the admin lock keeps an Upstream from deleting them in the mean time.
+                _closeLock.Lock();
+                _adminLock.Unlock();
+
+                // Closing does not wait, the StateChange follows on the communication thread.
+                for (OutgoingChannel* channel : closing) {
+                    channel->Close(0);
+                }
+
+                _closeLock.Unlock();
+
+                Fail(failed, Web::STATUS_GATEWAY_TIMEOUT);
+            }
+
+        private:
+            // A proxy registered on an existing path replaces the one that was there.
+            void Install(Upstream* upstream)
+            {
+                _adminLock.Lock();
+
+                Upstream* replaced = _routes.Add(upstream->Path(), upstream);
+
+                Untime(replaced);
+
+                if (upstream->HasTimeout() == true) {
+                    _timed.push_back(upstream);
+                }
+
+                _adminLock.Unlock();
+
+                if (replaced != nullptr) {
+                    delete replaced;
+                }
+            }
+            // Only the upstreams with a timeout are visited by the expiry job. Lock should be taken by the caller.
+            void Untime(Upstream* upstream)
+            {
+                if ((upstream != nullptr) && (upstream->HasTimeout() == true)) {
+                    _timed.remove(upstream);
+                }
+            }
+            // The job is armed no later than the shortest timeout from now, so no deadline of a request that
+            // follows can be earlier and an armed job never has to be revoked (which could wait for the very
+            // Dispatch that is blocked on our lock). Lock should be taken by the caller.
+            void Schedule(const uint64_t now)
+            {
+                if (_scheduled == 0) {
+                    _scheduled = now + Shortest();
+                    _job.Schedule(Core::Time(_scheduled));
+                }
+            }
+            // Lock should be taken by the caller.
+            uint64_t Shortest() const
+            {
+                uint64_t result = 0;
+
+                for (const Upstream* upstream : _timed) {
+                    if ((result == 0) || (upstream->Timeout() < result)) {
+                        result = upstream->Timeout();
+                    }
+                }
+
+                return (result);
+            }
+            void Fail(const std::list<uint32_t>& ids, const Web::WebStatus status)
+            {
+                for (const uint32_t id : ids) {
+                    Core::ProxyType<Web::Response> response(PluginHost::IFactories::Instance().Response());
+
+                    response->ErrorCode = status;
+                    response->Message = (status == Web::STATUS_GATEWAY_TIMEOUT ? _T("Proxied server did not respond in time") : _T("Proxied server is not reachable"));
+
+                    _server.Submit(id, response);
+                }
+            }
 
         private:
+            mutable Core::CriticalSection _adminLock;
+            Core::CriticalSection _closeLock;
             ChannelMap& _server;
-            std::list<OutgoingChannel*> _proxies;
+            Routes _routes;
+            std::list<Upstream*> _timed;
+            Job _job;
+            uint64_t _scheduled;
         };
 
         class IncomingChannel : public Web::WebLinkType<Core::SocketStream, Web::Request, Web::Response, RequestFactory> {
@@ -414,10 +819,34 @@ namespace Plugin {
                 : Web::WebLinkType<Core::SocketStream, Web::Request, Web::Response, RequestFactory>(2, false, connector, remoteId, 1024, 1024)
                 , _id(0)
                 , _parent(static_cast<ChannelMap&>(*parent))
+                , _counted(false)
+                , _requests(0)
+                , _trackLock()
+                , _tracked()
             {
             }
             virtual ~IncomingChannel()
             {
+                if (_counted == true) {
+                    _parent.Disconnected();
+                }
+            }
+
+        public:
+            // Remembers when the request came in and the route it is accounted for on, until its response is sent.
+            // The response is referenced while it is tracked, so it can not be mistaken for a later one.
+            void Track(const uint32_t request, RouteMetrics& route, const Core::ProxyType<Web::Response>& response, const uint64_t started, const uint32_t length)
+            {
+                _trackLock.Lock();
+
+                Tracked& entry(_tracked[request]);
+
+                entry.Route = &route;
+                entry.Response = response;
+                entry.Started = started;
+                entry.Length = length;
+
+                _trackLock.Unlock();
             }
 
         private:
@@ -434,12 +863,18 @@ namespace Plugin {
                     request->Body(_textBodies.Element());
                 }
             }
-            virtual void Send(const Core::ProxyType<Web::Response>& response)
-            {
-                TRACE(WebFlow, (response));
-            }
+            virtual void Send(const Core::ProxyType<Web::Response>& response);
             virtual void StateChange()
             {
+                if (IsOpen() != _counted) {
+                    _counted = !_counted;
+
+                    if (_counted == true) {
+                        _parent.Connected();
+                    } else {
+                        _parent.Disconnected();
+                    }
+                }
             }
             virtual void Received(Core::ProxyType<Web::Request>& request);
 
@@ -452,8 +887,19 @@ namespace Plugin {
             }
 
         private:
+            struct Tracked {
+                RouteMetrics* Route;
+                Core::ProxyType<Web::Response> Response;
+                uint64_t Started;
+                uint32_t Length;
+            };
+
             uint32_t _id;
             ChannelMap& _parent;
+            bool _counted;
+            uint32_t _requests;
+            Core::CriticalSection _trackLock;
+            std::map<uint32_t, Tracked> _tracked;
         };
 
         class ChannelMap : public Core::SocketServerType<IncomingChannel> {
@@ -463,6 +909,9 @@ namespace Plugin {
 
             typedef Core::SocketServerType<IncomingChannel> BaseClass;
 
+            // Static files with metrics of their own, the files beyond are accounted for together.
+            static constexpr uint16_t MaxStaticRoutes = 128;
+
             class TimeHandler {
             public:
                 TimeHandler()
@@ -499,6 +948,80 @@ namespace Plugin {
                 ChannelMap* _parent;
             };
 
+            // Drops the connection if the file shrunk while it was served, so the client can not take what it got
+            // for the complete file.
+            class StaticBody : public FileCache::Body {
+            private:
+                StaticBody() = delete;
+                StaticBody(const StaticBody&) = delete;
+                StaticBody& operator=(const StaticBody&) = delete;
+
+            public:
+                StaticBody(const Core::ProxyType<FileCache::Content>& content, IncomingChannel& channel)
+                    : FileCache::Body(content)
+                    , _channel(channel)
+                {
+                }
+                ~StaticBody() override
+                {
+                }
+
+            private:
+                void Truncated() const override
+                {
+                    _channel.Close(0);
+                }
+
+            private:
+                IncomingChannel& _channel;
+            };
+
+            // The communication thread is the only thread serving all sockets in this process. To keep it from
+            // blocking on file access, the content of files that are not cached can be loaded on the workerpool.
+            // Once loaded, the response is submitted to the channel that requested it.
+            class LoadJob : public Core::IDispatch {
+            private:
+                LoadJob() = delete;
+                LoadJob(const LoadJob&) = delete;
+                LoadJob& operator=(const LoadJob&) = delete;
+
+            public:
+                LoadJob(ChannelMap& parent, const uint32_t id, const uint32_t request, const string& path, const Web::MIMETypes type, const bool compressed, const uint64_t started, const uint64_t generation)
+                    : _parent(parent)
+                    , _id(id)
+                    , _request(request)
+                    , _path(path)
+                    , _type(type)
+                    , _compressed(compressed)
+                    , _started(started)
+                    , _generation(generation)
+                {
+                }
+                ~LoadJob() override
+                {
+                }
+
+            public:
+                void Dispatch() override
+                {
+                    bool compressed = _compressed;
+                    Core::ProxyType<FileCache::Content> content(_parent._fileCache.Load(_path, compressed, true, _generation));
+
+                    _parent.Deliver(_id, _request, _path, _type, content, compressed, _started);
+                    _parent.Loaded(*this);
+                }
+
+            private:
+                ChannelMap& _parent;
+                const uint32_t _id;
+                const uint32_t _request;
+                const string _path;
+                const Web::MIMETypes _type;
+                const bool _compressed;
+                const uint64_t _started;
+                const uint64_t _generation;
+            };
+
         public:
 #ifdef __WINDOWS__
 #pragma warning(disable : 4355)
@@ -510,6 +1033,13 @@ namespace Plugin {
                 , _connectionCheckTimer(0)
                 , _cleanupTimer(Core::Thread::DefaultStackSize(), _T("ConnectionChecker"))
                 , _proxyMap(*this)
+                , _fileCache()
+                , _offload(false)
+                , _loadLock()
+                , _loading()
+                , _metricsPath()
+                , _connections(0)
+                , _static(MaxStaticRoutes, _T("/*"))
             {
             }
 #ifdef __WINDOWS__
@@ -517,6 +1047,17 @@ namespace Plugin {
 #endif
             ~ChannelMap()
             {
+                std::list<Core::ProxyType<Core::IDispatch>> loading;
+
+                // Make sure no file is being loaded for us anymore.
+                _loadLock.Lock();
+                loading.swap(_loading);
+                _loadLock.Unlock();
+
+                for (Core::ProxyType<Core::IDispatch>& job : loading) {
+                    Core::IWorkerPool::Instance().Revoke(job, Core::infinite);
+                }
+
                 // Start by closing the server thread..
                 Core::SocketServerType<IncomingChannel>::Close(1000);
 
@@ -549,6 +1090,10 @@ namespace Plugin {
 
                 _proxyMap.Create(index);
 
+                _fileCache.Configure(configuration.Cache);
+                _offload = configuration.Offload.Value();
+                _metricsPath = configuration.Metrics.Value();
+
                 if (configuration.Interface.Value().empty() == false) {
                     Core::NodeId selectedNode = Plugin::Config::IPV4UnicastNode(configuration.Interface.Value());
 
@@ -609,10 +1154,61 @@ namespace Plugin {
             {
                 return (_proxyMap.Relay(request, id));
             }
+            // Submits the response for this file to the channel, right away if it can be served from memory.
+            void Serve(const uint32_t id, const uint32_t request, const string& path, const Web::MIMETypes type, bool compressed)
+            {
+                const uint64_t started(Core::Time::Now().Ticks());
+                Core::ProxyType<FileCache::Content> content(_offload == true ? _fileCache.Cached(path, compressed) : _fileCache.Find(path, compressed));
+
+                if ((content.IsValid() == true) || (_offload == false)) {
+                    Deliver(id, request, path, type, content, compressed, started);
+                } else {
+                    Core::ProxyType<Core::IDispatch> job(Core::ProxyType<LoadJob>::Create(*this, id, request, path, type, compressed, started, _fileCache.Generation(path)));
+
+                    _loadLock.Lock();
+                    _loading.push_back(job);
+                    _loadLock.Unlock();
+
+                    Core::IWorkerPool::Instance().Submit(job);
+                }
+            }
             inline string Accessor() const
             {
                 return (_accessor);
             }
+            inline bool IsMetrics(const string& path) const
+            {
+                return ((_metricsPath.empty() == false) && (path == _metricsPath));
+            }
+            inline void Connected()
+            {
+                _connections.fetch_add(1, std::memory_order_relaxed);
+            }
+            inline void Disconnected()
+            {
+                _connections.fetch_sub(1, std::memory_order_relaxed);
+            }
+            Core::ProxyType<Web::Response> Metrics(const bool json) const
+            {
+                MetricsReport report(_connections.load(std::memory_order_relaxed), _fileCache.Hits(), _fileCache.Misses());
+                Core::ProxyType<Web::Response> response(PluginHost::IFactories::Instance().Response());
+                Core::ProxyType<Web::TextBody> body(_textBodies.Element());
+
+                _static.Report(report, _T("static"));
+                _proxyMap.Report(report);
+
+                if (json == true) {
+                    *body = report.JSON();
+                    response->ContentType = Web::MIME_JSON;
+                } else {
+                    *body = report.Text();
+                    response->ContentType = Web::MIME_TEXT;
+                }
+
+                response->Body<Web::TextBody>(body);
+
+                return (response);
+            }
             void Close(IncomingChannel& data)
             {
             }
@@ -626,6 +1222,75 @@ namespace Plugin {
             }
 
         private:
+            Core::ProxyType<Web::Response> Response(IncomingChannel& channel, RouteMetrics& route, const string& path, const Web::MIMETypes type, const Core::ProxyType<FileCache::Content>& content, const bool compressed, uint32_t& length)
+            {
+                Core::ProxyType<Web::Response> response(PluginHost::IFactories::Instance().Response());
+
+                length = 0;
+
+                response->ContentType = type;
+
+                if (content.IsValid() == true) {
+                    Core::ProxyType<StaticBody> cachedBody(Core::ProxyType<StaticBody>::Create(content, channel));
+
+                    response->Body<StaticBody>(cachedBody);
+                    length = content->Length();
+
+                    if (compressed == true) {
+                        response->ContentEncoding = Web::ENCODING_GZIP;
+                    }
+                } else {
+                    Core::ProxyType<Web::FileBody> fileBody(PluginHost::IFactories::Instance().FileBody());
+
+                    *fileBody = path;
+                    response->Body<Web::FileBody>(fileBody);
+
+                    if (fileBody->Exists() == false) {
+                        route.Failed();
+                    } else {
+                        length = static_cast<uint32_t>(fileBody->Size());
+                    }
+                }
+
+                return (response);
+            }
+            // The latency of a static file is accounted for on the route of its path, once its response is completely sent.
+            void Deliver(const uint32_t id, const uint32_t request, const string& path, const Web::MIMETypes type, const Core::ProxyType<FileCache::Content>& content, const bool compressed, const uint64_t started)
+            {
+                Core::ProxyType<IncomingChannel> channel(BaseClass::Client(id));
+
+                if (channel.IsValid() == true) {
+                    uint32_t length;
+                    RouteMetrics& route(_static.Route(Route(path)));
+                    Core::ProxyType<Web::Response> response(Response(*channel, route, path, type, content, compressed, length));
+
+                    channel->Track(request, route, response, started, length);
+                    channel->Submit(response);
+                }
+            }
+            // Static files are reported by their path relative to the root that is served.
+            string Route(const string& path) const
+            {
+                ASSERT((_prefixPath.empty() == false) && (path.compare(0, _prefixPath.length(), _prefixPath) == 0));
+
+                return (path.substr(_prefixPath.length() - 1));
+            }
+            void Loaded(const LoadJob& job)
+            {
+                _loadLock.Lock();
+
+                std::list<Core::ProxyType<Core::IDispatch>>::iterator index(_loading.begin());
+
+                while ((index != _loading.end()) && (static_cast<const Core::IDispatch*>(&job) != &(*(*index)))) {
+                    index++;
+                }
+
+                if (index != _loading.end()) {
+                    _loading.erase(index);
+                }
+
+                _loadLock.Unlock();
+            }
             uint64_t Timed(const uint64_t scheduledTime)
             {
                 Core::Time NextTick(Core::Time::Now());
@@ -658,6 +1323,13 @@ namespace Plugin {
             uint32_t _connectionCheckTimer;
             Core::TimerType<TimeHandler> _cleanupTimer;
             ProxyMap _proxyMap;
+            FileCache _fileCache;
+            bool _offload;
+            Core::CriticalSection _loadLock;
+            std::list<Core::ProxyType<Core::IDispatch>> _loading;
+            string _metricsPath;
+            std::atomic<uint32_t> _connections;
+            RouteTable _static;
         };
 
     private:
@@ -756,11 +1428,14 @@ namespace Plugin {
 
         TRACE(WebFlow, (Core::proxy_cast<Web::Request>(request)));
 
-        // Check if the channel server will relay this message.
-        if (_parent.Relay(request, Id()) == false) {
+        if (_parent.IsMetrics(request->Path) == true) {
+
+            Core::ProxyType<Web::Response> response(_parent.Metrics((request->Query.IsSet() == true) && (request->Query.Value() == _T("format=json"))));
 
-            Core::ProxyType<Web::Response> response(PluginHost::IFactories::Instance().Response());
-            Core::ProxyType<Web::FileBody> fileBody(PluginHost::IFactories::Instance().FileBody());
+            Submit(response);
+        }
+        // Check if the channel server will relay this message.
+        else if (_parent.Relay(request, Id()) == false) {
 
             // If so, don't deal with it ourselves.
             Web::MIMETypes result;
@@ -768,38 +1443,69 @@ namespace Plugin {
 
             if (Web::MIMETypeForFile(request->Path, fileToService, result) == false) {
 
-                string fullPath = fileToService + _T("index.html");
-
                 // No filename gives, be default, we go for the index.html page..
-                *fileBody = fileToService + _T("index.html");
-                response->ContentType = Web::MIME_HTML;
-                response->Body<Web::FileBody>(fileBody);
-            } else {
-                *fileBody = fileToService;
-                response->ContentType = result;
-                response->Body<Web::FileBody>(fileBody);
+                fileToService += _T("index.html");
+                result = Web::MIME_HTML;
             }
-            Submit(response);
+
+            _parent.Serve(Id(), ++_requests, fileToService, result, ((request->AcceptEncoding.IsSet() == true) && (request->AcceptEncoding.Value() == Web::ENCODING_GZIP)));
         }
     }
 
-    /* virtual */ void WebServerImplementation::ProxyMap::OutgoingChannel::Received(Core::ProxyType<Web::Response>& response)
+    /* virtual */ void WebServerImplementation::IncomingChannel::Send(const Core::ProxyType<Web::Response>& response)
     {
-        // Is response to our front of the list
-        ASSERT(_outstandingMessages.empty() == false);
-        ASSERT(_outstandingMessages.front().Request.IsValid() == false);
+        TRACE(WebFlow, (response));
 
-        if (_outstandingMessages.empty() == false) {
-            _proxyMap.Submit(_outstandingMessages.front().Id, response);
-            _outstandingMessages.pop_front();
+        _trackLock.Lock();
 
-            // See if ther is a next one to send.
-            if (_outstandingMessages.size() > 0) {
+        std::map<uint32_t, Tracked>::iterator index(_tracked.begin());
 
-                ASSERT(_outstandingMessages.front().Request.IsValid() == true);
+        while ((index != _tracked.end()) && (index->second.Response != response)) {
+            index++;
+        }
 
-                Submit(_outstandingMessages.front().Request);
-            }
+        if (index != _tracked.end()) {
+            index->second.Route->Served(Core::Time::Now().Ticks() - index->second.Started, 0, index->second.Length);
+            _tracked.erase(index);
+        }
+
+        _trackLock.Unlock();
+    }
+
+    /* virtual */ void WebServerImplementation::ProxyMap::OutgoingChannel::Send(const Core::ProxyType<Web::Request>& request)
+    {
+        _upstream._parent._adminLock.Lock();
+        _upstream.Sent(*this, request);
+        _upstream._parent._adminLock.Unlock();
+    }
+
+    /* virtual */ void WebServerImplementation::ProxyMap::OutgoingChannel::StateChange()
+    {
+        std::list<uint32_t> failed;
+
+        _upstream._parent._adminLock.Lock();
+
+        _upstream.StateChange(*this, failed);
+
+        // Remember if this connection got established, if it did not, the server is not reachable.
+        _connected = IsOpen();
+
+        _upstream._parent._adminLock.Unlock();
+
+        _upstream._parent.Fail(failed, Web::STATUS_BAD_GATEWAY);
+    }
+
+    /* virtual */ void WebServerImplementation::ProxyMap::OutgoingChannel::Received(Core::ProxyType<Web::Response>& response)
+    {
+        _upstream._parent._adminLock.Lock();
+
+        uint32_t id = _upstream.Received(*this, *response);
+
+        _upstream._parent._adminLock.Unlock();
+
+        // If the request expired in the mean time, the client already got its answer.
+        if (id != 0) {
+            _upstream._parent.Submit(id, response);
         }
     }
 
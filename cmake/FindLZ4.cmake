@@ -0,0 +1,45 @@
+# If not stated otherwise in this file or this component's LICENSE file the
+# following copyright and licenses apply:
+#
+# Copyright 2020 RDK Management
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# - Try to find liblz4
+# Once done this will define
+#  LZ4_FOUND - System has liblz4
+#  LZ4_INCLUDE_DIRS - The liblz4 include directories
+#  LZ4_LIBRARIES - The libraries needed to use liblz4
+#  LZ4::LZ4 - Imported target for liblz4
+
+find_package(PkgConfig)
+pkg_check_modules(LZ4 liblz4)
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(LZ4 DEFAULT_MSG LZ4_LIBRARIES)
+
+mark_as_advanced(LZ4_INCLUDE_DIRS LZ4_LIBRARIES)
+
+find_library(LZ4_LIBRARY NAMES ${LZ4_LIBRARIES}
+        HINTS ${LZ4_LIBDIR} ${LZ4_LIBRARY_DIRS}
+        )
+
+if(LZ4_LIBRARY AND NOT TARGET LZ4::LZ4)
+    add_library(LZ4::LZ4 UNKNOWN IMPORTED)
+    set_target_properties(LZ4::LZ4 PROPERTIES
+            IMPORTED_LOCATION "${LZ4_LIBRARY}"
+            INTERFACE_LINK_LIBRARIES "${LZ4_LIBRARIES}"
+            INTERFACE_COMPILE_OPTIONS "${LZ4_CFLAGS_OTHER}"
+            INTERFACE_INCLUDE_DIRECTORIES "${LZ4_INCLUDE_DIRS}"
+            )
+endif()
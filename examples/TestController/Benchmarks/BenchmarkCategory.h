@@ -0,0 +1,93 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "../Module.h"
+
+#include "../Core/TestAdministrator.h"
+#include "../Core/TestCategoryBase.h"
+#include "../Core/TestMetadata.h"
+#include <interfaces/ITestController.h>
+
+#include <chrono>
+
+namespace WPEFramework {
+namespace TestCore {
+
+    // Microbenchmarks of the data structures of the plugins in this repository. The structures are compiled in
+    // from the sources of the plugins, so they are measured as they are shipped, without a running plugin.
+    class BenchmarkCategory : TestCore::TestCategoryBase {
+    protected:
+        BenchmarkCategory()
+            : TestCategoryBase()
+        {
+            TestCore::TestAdministrator::Instance().Announce(this);
+        }
+
+    public:
+        BenchmarkCategory(const BenchmarkCategory&) = delete;
+        BenchmarkCategory& operator=(const BenchmarkCategory&) = delete;
+        virtual ~BenchmarkCategory() = default;
+
+        static Exchange::ITestController::ICategory& Instance()
+        {
+            static Exchange::ITestController::ICategory* _singleton(Core::Service<BenchmarkCategory>::Create<Exchange::ITestController::ICategory>());
+            return (*_singleton);
+        }
+
+        // ITestCategory methods
+        string Name() const override
+        {
+            return _name;
+        };
+
+        void Setup() override{
+        };
+
+        void TearDown() override{
+        };
+
+        BEGIN_INTERFACE_MAP(BenchmarkCategory)
+        INTERFACE_ENTRY(Exchange::ITestController::ICategory)
+        END_INTERFACE_MAP
+
+    private:
+        const string _name = _T("Benchmarks");
+    };
+
+    namespace Benchmark {
+
+        inline uint64_t Now()
+        {
+            return (static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count()));
+        }
+
+        // Adds a measurement, or a check, to the outcome of a benchmark.
+        inline void Step(TestResult& result, const string& description, const bool success)
+        {
+            TestResult::TestStep& step(result.Steps.Add());
+
+            step.Description = description;
+            step.Status = (success == true ? _T("Success") : _T("Failed"));
+        }
+
+    } // namespace Benchmark
+} // namespace TestCore
+} // namespace WPEFramework
@@ -0,0 +1,278 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../Module.h"
+
+#include "../../../TimeSync/ClockFilter.h"
+#include "../Core/TestBase.h"
+#include "../Core/Trace.h"
+#include "BenchmarkCategory.h"
+#include <interfaces/ITestController.h>
+
+#include <random>
+
+namespace WPEFramework {
+
+// The clock filter, the selection and the frequency loop of the TimeSync plugin on made up servers and a made up
+// clock: the filter has to take the offset of the sample with the shortest round trip, the selection has to leave
+// out the servers that are off, the frequency loop has to take over the drift of the local clock, and the filter
+// and the selection, on every synchronization, should not take long.
+class ClockFilterBenchmark : public TestBase {
+private:
+    typedef Plugin::ClockFilter ClockFilter;
+
+    static constexpr uint32_t Rounds = 10000;
+    // A second in ticks.
+    static constexpr uint64_t Second = 1000 * 1000;
+    // Polls of the frequency loop, 64 seconds apart (poll 6) as the discipline starts out.
+    static constexpr uint32_t Polls = 64;
+    static constexpr double PollInterval = 64;
+
+public:
+    ClockFilterBenchmark(const ClockFilterBenchmark&) = delete;
+    ClockFilterBenchmark& operator=(const ClockFilterBenchmark&) = delete;
+
+    ClockFilterBenchmark()
+        : TestBase(TestBase::DescriptionBuilder("TimeSync clock filter and intersection of the NTP servers"))
+    {
+        TestCore::BenchmarkCategory::Instance().Register(this);
+    }
+
+    virtual ~ClockFilterBenchmark()
+    {
+        TestCore::BenchmarkCategory::Instance().Unregister(this);
+    }
+
+public:
+    // ICommand methods
+    string Execute(const string& params) final
+    {
+        TestCore::TestResult jsonResult;
+        string result;
+
+        TRACE(TestCore::TestStart, (_T("Start execute of test: %s"), _name.c_str()));
+
+        const bool filter = Filter();
+        const bool falsetickers = Falsetickers();
+        const bool disagree = Disagree();
+        const bool future = Future();
+        const bool drift = Drift(100e-6) && Drift(-250e-6);
+        const bool limit = Limit();
+
+        TestCore::Benchmark::Step(jsonResult, _T("Filter takes the offset of the sample with the shortest round trip"), filter);
+        TestCore::Benchmark::Step(jsonResult, _T("Selection leaves out the servers that do not agree with the majority"), falsetickers);
+        TestCore::Benchmark::Step(jsonResult, _T("Selection takes the most accurate server if there is no majority"), disagree);
+        TestCore::Benchmark::Step(jsonResult, _T("Filter takes samples from after a clock set back as fresh ones"), future);
+        TestCore::Benchmark::Step(jsonResult, _T("Frequency loop takes over the drift of the local clock and keeps the offset down"), drift);
+        TestCore::Benchmark::Step(jsonResult, _T("Frequency loop stops at what the kernel can correct"), limit);
+
+        // The work of a synchronization with four servers with full filters.
+        std::vector<ClockFilter::Source> sources(4);
+        const uint64_t now = 1000 * Second;
+
+        for (uint8_t index = 0; index < sources.size(); index++) {
+            Fill(sources[index], now, 0.002 * index, 0.020 + (0.005 * index));
+        }
+
+        double offset = 0;
+        double jitter = 0;
+        uint32_t selected = 0;
+
+        const uint64_t start = TestCore::Benchmark::Now();
+
+        for (uint32_t round = 0; round < Rounds; round++) {
+            std::vector<ClockFilter::Source*> candidates;
+
+            for (ClockFilter::Source& source : sources) {
+                ClockFilter::Filter(source, now + round);
+                candidates.push_back(&source);
+            }
+
+            selected += (ClockFilter::Select(candidates, offset, jitter) != nullptr ? 1 : 0);
+        }
+
+        const uint64_t duration = (TestCore::Benchmark::Now() - start) / Rounds;
+
+        TestCore::Benchmark::Step(jsonResult, _T("4 servers: filter and selection ") + Core::NumberType<uint64_t>(duration).Text() + _T(" ns per synchronization"), (selected == Rounds));
+
+        jsonResult.Name = _name;
+        jsonResult.OverallStatus = ((filter == true) && (falsetickers == true) && (disagree == true) && (future == true) && (drift == true) && (limit == true) && (selected == Rounds) ? _T("Success") : _T("Failed"));
+
+        TRACE(TestCore::TestStart, (_T("End test: %s"), _name.c_str()));
+        jsonResult.ToString(result);
+        return result;
+    }
+
+    string Name() const final
+    {
+        return _name;
+    }
+
+private:
+    // A server with a full filter, taken a second apart. The round trips are spread around the given one, and
+    // so is the offset, the longer the round trip the more it is off, as it goes on the network.
+    static void Fill(ClockFilter::Source& source, const uint64_t now, const double offset, const double delay)
+    {
+        const double spread[] = { 0.004, 0.0, 0.012, 0.002, 0.007, 0.015, 0.001, 0.009 };
+
+        source = ClockFilter::Source();
+        source.RootDelay = 0.010;
+        source.RootDispersion = 0.005;
+
+        for (uint8_t index = 0; index < ClockFilter::Length; index++) {
+            ClockFilter::Sample sample;
+
+            sample.Offset = offset + ((index % 2) == 0 ? spread[index] : -spread[index]) / 2;
+            sample.Delay = delay + spread[index];
+            sample.Dispersion = ClockFilter::Precision;
+            sample.Epoch = now - ((ClockFilter::Length - index) * Second);
+
+            ClockFilter::Add(source, sample);
+        }
+    }
+    static bool Filter()
+    {
+        const uint64_t now = 1000 * Second;
+        ClockFilter::Source source;
+
+        Fill(source, now, 0.050, 0.030);
+        ClockFilter::Filter(source, now);
+
+        // The round trip of 0.030 is the one with no spread, its offset is spot on.
+        bool result = (source.Count == ClockFilter::Length) && (source.Offset == 0.050) && (source.Delay == 0.030);
+
+        // The jitter is the spread of the other offsets around it, the distance covers at least half the round trip
+        // to the primary reference.
+        result = (source.Jitter > 0.001) && (source.Jitter < 0.008) && (result == true);
+        result = (source.Distance > ((source.RootDelay + source.Delay) / 2)) && (source.Distance < 0.1) && (result == true);
+
+        return (result);
+    }
+    static bool Falsetickers()
+    {
+        const uint64_t now = 1000 * Second;
+        const double offsets[] = { 0.100, 5.0, 0.104, -3.0, 0.097 };
+        std::vector<ClockFilter::Source> sources(sizeof(offsets) / sizeof(offsets[0]));
+        std::vector<ClockFilter::Source*> candidates;
+
+        for (uint8_t index = 0; index < sources.size(); index++) {
+            Fill(sources[index], now, offsets[index], 0.020);
+            ClockFilter::Filter(sources[index], now);
+            candidates.push_back(&sources[index]);
+        }
+
+        double offset = 0;
+        double jitter = 0;
+        const ClockFilter::Source* best = ClockFilter::Select(candidates, offset, jitter);
+
+        return ((best != nullptr) && (sources[0].Selected == true) && (sources[1].Selected == false) && (sources[2].Selected == true) && (sources[3].Selected == false) && (sources[4].Selected == true) && (std::fabs(offset - 0.100) < 0.005) && (jitter == best->Jitter));
+    }
+    static bool Disagree()
+    {
+        const uint64_t now = 1000 * Second;
+        std::vector<ClockFilter::Source> sources(2);
+        std::vector<ClockFilter::Source*> candidates;
+
+        Fill(sources[0], now, 1.0, 0.050);
+        Fill(sources[1], now, -1.0, 0.020);
+
+        for (ClockFilter::Source& source : sources) {
+            ClockFilter::Filter(source, now);
+            candidates.push_back(&source);
+        }
+
+        double offset = 0;
+        double jitter = 0;
+        const ClockFilter::Source* best = ClockFilter::Select(candidates, offset, jitter);
+
+        return ((best == &sources[1]) && (sources[0].Selected == false) && (offset == sources[1].Offset));
+    }
+    static bool Future()
+    {
+        const uint64_t now = 1000 * Second;
+        ClockFilter::Source source;
+        ClockFilter::Source reference;
+
+        Fill(source, now, 0.050, 0.030);
+        reference = source;
+
+        // The clock went back a minute after the samples were taken.
+        ClockFilter::Filter(source, now - (60 * Second));
+        // As if they were all taken just now.
+        for (uint8_t index = 0; index < reference.Count; index++) {
+            reference.Samples[index].Epoch = now;
+        }
+        ClockFilter::Filter(reference, now);
+
+        return ((source.Offset == reference.Offset) && (source.Dispersion == reference.Dispersion) && (source.Distance == reference.Distance) && (source.Distance < 0.1));
+    }
+    // A local clock that drifts (positive is fast), disciplined as Track() does: every poll the offset is slewed
+    // out, at most 500us a second as the kernel does, and the frequency loop takes part of what is left over. The
+    // offsets are measured with some noise, as they are on the network.
+    static bool Drift(const double drift)
+    {
+        std::mt19937 random(static_cast<uint32_t>(drift * 1e9));
+        std::uniform_real_distribution<double> noise(-50e-6, 50e-6);
+        double frequency = 0;
+        double error = 0; // local clock minus true time
+        double pending = 0; // what the kernel still has to slew
+        double worst = 0;
+
+        for (uint32_t poll = 0; poll < Polls; poll++) {
+            // The kernel slews what it was asked to, the clock drifts as far as the frequency correction leaves it.
+            const double slewed = std::max(-500e-6 * PollInterval, std::min(pending, 500e-6 * PollInterval));
+
+            error += slewed + ((drift + frequency) * PollInterval);
+            pending -= slewed;
+
+            const double offset = noise(random) - error;
+
+            if (poll != 0) {
+                frequency = ClockFilter::Discipline(frequency, offset, pending, PollInterval);
+            }
+
+            // The new offset replaces what was still to be slewed.
+            pending = offset;
+
+            if (poll >= (Polls / 2)) {
+                worst = std::max(worst, std::fabs(error));
+            }
+        }
+
+        // Within a PPM of the drift, and the clock within a millisecond once the loop has settled.
+        return ((std::fabs(drift + frequency) < 1e-6) && (worst < 0.001));
+    }
+    static bool Limit()
+    {
+        double frequency = 0;
+
+        for (uint32_t poll = 0; poll < Polls; poll++) {
+            // A clock that is 1000 PPM fast, the offsets keep coming back no matter the correction.
+            frequency = ClockFilter::Discipline(frequency, -1000e-6 * PollInterval, 0, PollInterval);
+        }
+
+        return ((frequency == -ClockFilter::MaximumFrequency) && (ClockFilter::Discipline(frequency, 0.010, 0, 0) == frequency));
+    }
+
+private:
+    const string _name = _T("ClockFilter");
+};
+
+static Exchange::ITestController::ITest* _singleton(Core::Service<ClockFilterBenchmark>::Create<Exchange::ITestController::ITest>());
+} // namespace WPEFramework
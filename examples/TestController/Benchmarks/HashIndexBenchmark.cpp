@@ -0,0 +1,253 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../Module.h"
+
+#include "../../../Dictionary/HashIndex.h"
+#include "../../../Dictionary/ReadWriteLock.h"
+#include "../Core/TestBase.h"
+#include "../Core/Trace.h"
+#include "BenchmarkCategory.h"
+#include <interfaces/ITestController.h>
+
+#include <thread>
+
+namespace WPEFramework {
+
+// Key lookups in a namespace of the Dictionary: the hash index against the scan over the list of entries it
+// replaced, with a growing number of keys, and the lookups of a growing number of reader threads sharing the
+// namespace with a writer, under the read/write lock of the Dictionary.
+class HashIndexBenchmark : public TestBase {
+private:
+    static constexpr uint32_t Lookups = 100000;
+    static constexpr uint32_t Keys = 10000;
+
+    class Entry {
+    public:
+        Entry(const string& key)
+            : _key(key)
+            , _value()
+        {
+        }
+
+    public:
+        inline const string& Key() const
+        {
+            return (_key);
+        }
+        inline const string& Value() const
+        {
+            return (_value);
+        }
+        inline void Value(const string& value)
+        {
+            _value = value;
+        }
+
+    private:
+        string _key;
+        string _value;
+    };
+
+    struct Space {
+        std::list<Entry> Entries;
+        Plugin::HashIndexType<Entry> Index;
+        Plugin::ReadWriteLock Lock;
+    };
+
+public:
+    HashIndexBenchmark(const HashIndexBenchmark&) = delete;
+    HashIndexBenchmark& operator=(const HashIndexBenchmark&) = delete;
+
+    HashIndexBenchmark()
+        : TestBase(TestBase::DescriptionBuilder("Dictionary key lookups, hash index against a list scan and with concurrent readers"))
+    {
+        TestCore::BenchmarkCategory::Instance().Register(this);
+    }
+
+    virtual ~HashIndexBenchmark()
+    {
+        TestCore::BenchmarkCategory::Instance().Unregister(this);
+    }
+
+public:
+    // ICommand methods
+    string Execute(const string& params) final
+    {
+        const uint32_t counts[] = { 10, 100, 1000, Keys };
+        TestCore::TestResult jsonResult;
+        string result;
+        uint64_t smallest = 0;
+        uint64_t largest = 0;
+        uint64_t scan = 0;
+        bool found = true;
+
+        TRACE(TestCore::TestStart, (_T("Start execute of test: %s"), _name.c_str()));
+
+        for (const uint32_t count : counts) {
+            std::vector<string> keys;
+            Space space;
+
+            Fill(space, keys, count);
+
+            uint64_t start = TestCore::Benchmark::Now();
+
+            for (uint32_t index = 0; index < Lookups; index++) {
+                found = (space.Index.Find(keys[(index * 2654435761u) % count]) != nullptr) && (found == true);
+            }
+
+            const uint64_t get = (TestCore::Benchmark::Now() - start) / Lookups;
+
+            start = TestCore::Benchmark::Now();
+
+            for (uint32_t index = 0; index < Lookups; index++) {
+                space.Index.Find(keys[(index * 2654435761u) % count])->Value(keys[index % count]);
+            }
+
+            const uint64_t set = (TestCore::Benchmark::Now() - start) / Lookups;
+
+            start = TestCore::Benchmark::Now();
+
+            // The lookup as it was done before, a walk over the entries of the namespace.
+            for (uint32_t index = 0; index < Lookups; index++) {
+                const string& key(keys[(index * 2654435761u) % count]);
+                std::list<Entry>::const_iterator loop(space.Entries.begin());
+
+                while ((loop != space.Entries.end()) && (loop->Key() != key)) {
+                    loop++;
+                }
+
+                found = (loop != space.Entries.end()) && (found == true);
+            }
+
+            scan = (TestCore::Benchmark::Now() - start) / Lookups;
+
+            if (count == counts[0]) {
+                smallest = get;
+            }
+            largest = get;
+
+            TestCore::Benchmark::Step(jsonResult, Core::NumberType<uint32_t>(count).Text() + _T(" keys: get ") + Core::NumberType<uint64_t>(get).Text() + _T(" ns, set ") + Core::NumberType<uint64_t>(set).Text() + _T(" ns, list scan ") + Core::NumberType<uint64_t>(scan).Text() + _T(" ns per lookup"), found);
+        }
+
+        const bool flat = (largest <= ((smallest * 4) + 100));
+        const bool faster = (largest < scan);
+
+        TestCore::Benchmark::Step(jsonResult, _T("Hash index lookup does not grow with the number of keys"), flat);
+        TestCore::Benchmark::Step(jsonResult, _T("Hash index lookup beats the list scan with the most keys"), faster);
+
+        const bool concurrent = Readers(jsonResult);
+
+        jsonResult.Name = _name;
+        jsonResult.OverallStatus = ((found == true) && (flat == true) && (faster == true) && (concurrent == true) ? _T("Success") : _T("Failed"));
+
+        TRACE(TestCore::TestStart, (_T("End test: %s"), _name.c_str()));
+        jsonResult.ToString(result);
+        return result;
+    }
+
+    string Name() const final
+    {
+        return _name;
+    }
+
+private:
+    // The keys are made up front, so only the lookups are measured.
+    static void Fill(Space& space, std::vector<string>& keys, const uint32_t count)
+    {
+        for (uint32_t index = 0; index < count; index++) {
+            keys.push_back(_T("key") + Core::NumberType<uint32_t>(index).Text());
+            space.Entries.push_back(Entry(keys.back()));
+            space.Index.Insert(&(space.Entries.back()));
+        }
+    }
+    // Readers only wait for the writer, so the lookups done per second should grow with the number of readers, as
+    // long as there are cores to run them on.
+    bool Readers(TestCore::TestResult& jsonResult) const
+    {
+        const uint32_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+        std::vector<string> keys;
+        Space space;
+        uint64_t single = 0;
+        uint64_t most = 0;
+
+        Fill(space, keys, Keys);
+
+        for (uint32_t readers = 1; readers <= std::min(cores, 4u); readers <<= 1) {
+            std::atomic<bool> running(true);
+            std::atomic<uint64_t> lookups(0);
+            std::list<std::thread> threads;
+            uint32_t sets = 0;
+
+            const uint64_t start = TestCore::Benchmark::Now();
+
+            for (uint32_t reader = 0; reader < readers; reader++) {
+                threads.emplace_back([&space, &keys, &running, &lookups, reader]() {
+                    uint32_t index = reader;
+
+                    while (running.load(std::memory_order_relaxed) == true) {
+                        space.Lock.ReadLock();
+                        space.Index.Find(keys[(index * 2654435761u) % Keys]);
+                        space.Lock.ReadUnlock();
+                        index++;
+                    }
+
+                    lookups.fetch_add(index - reader, std::memory_order_relaxed);
+                });
+            }
+
+            // The writer changes a key now and then, as the applications polling the Dictionary do.
+            while ((TestCore::Benchmark::Now() - start) < 200000000) {
+                space.Lock.WriteLock();
+                space.Index.Find(keys[sets % Keys])->Value(keys[(sets * 7) % Keys]);
+                space.Lock.WriteUnlock();
+                sets++;
+
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+
+            running = false;
+
+            for (std::thread& thread : threads) {
+                thread.join();
+            }
+
+            const uint64_t rate = (lookups.load() * 1000) / ((TestCore::Benchmark::Now() - start) / 1000000);
+
+            if (readers == 1) {
+                single = rate;
+            }
+            most = rate;
+
+            TestCore::Benchmark::Step(jsonResult, Core::NumberType<uint32_t>(readers).Text() + _T(" readers: ") + Core::NumberType<uint64_t>(rate).Text() + _T(" lookups per second, with ") + Core::NumberType<uint32_t>(sets).Text() + _T(" sets"), true);
+        }
+
+        const bool result = (most >= ((single * 8) / 10));
+
+        TestCore::Benchmark::Step(jsonResult, _T("Concurrent readers do not slow down the lookups"), result);
+
+        return (result);
+    }
+
+private:
+    const string _name = _T("HashIndex");
+};
+
+static Exchange::ITestController::ITest* _singleton(Core::Service<HashIndexBenchmark>::Create<Exchange::ITestController::ITest>());
+} // namespace WPEFramework
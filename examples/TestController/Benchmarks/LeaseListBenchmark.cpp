@@ -0,0 +1,301 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../Module.h"
+
+#include "../../../DHCPServer/DHCPServerImplementation.h"
+#include "../Core/TestBase.h"
+#include "../Core/Trace.h"
+#include "BenchmarkCategory.h"
+#include <interfaces/ITestController.h>
+
+namespace WPEFramework {
+
+// A DISCOVER storm on the lease table of the DHCPServer, as after a power cut when all clients come up at once:
+// every client discovers, all of them retransmit, and once the pool is used up new clients take over the leases
+// that expired. The indexed lease table against the list, searched from the front, it replaced.
+class LeaseListBenchmark : public TestBase {
+private:
+    typedef Plugin::DHCPServerImplementation::Identifier Identifier;
+    typedef Plugin::DHCPServerImplementation::Lease Lease;
+    typedef Plugin::DHCPServerImplementation::LeaseList LeaseList;
+
+    // 10.0.0.2, the pool runs from here.
+    static constexpr uint32_t MinAddress = 0x0A000002;
+    // Clients that come in once the pool is used up, the list scan takes a pass over the pool for each.
+    static constexpr uint32_t Latecomers = 64;
+    // The time an offered address is locked out for, as the server does.
+    static constexpr uint64_t OfferTime = 60 * 1000 * 1000;
+
+    // Results of a storm, in nanoseconds per DISCOVER, and the addresses that were offered.
+    struct Storm {
+        uint64_t New;
+        uint64_t Repeat;
+        uint64_t Expired;
+        std::vector<uint32_t> Offers;
+    };
+
+    // The lease table as it was before, a list searched from the front for every lookup and the pool probed
+    // an address at a time.
+    class Scan {
+    public:
+        Scan(const Scan&) = delete;
+        Scan& operator=(const Scan&) = delete;
+
+        Scan(const uint32_t minAddress, const uint32_t maxAddress)
+            : _leases()
+            , _minAddress(minAddress)
+            , _maxAddress(maxAddress)
+            , _nextFreeIp(minAddress)
+        {
+        }
+
+    public:
+        std::list<Lease>& Leases()
+        {
+            return (_leases);
+        }
+        uint32_t Discover(const Identifier& id, const uint64_t now)
+        {
+            Lease* result = Find(id);
+
+            if (result == nullptr) {
+                for (uint32_t ip = _nextFreeIp; ip <= _maxAddress; ip++) {
+                    if (Find(ip) == nullptr) {
+                        _leases.push_back(Lease(id, ip));
+                        result = &(_leases.back());
+                        _nextFreeIp = (ip + 1);
+                        break;
+                    }
+                }
+
+                for (uint32_t ip = _minAddress; (result == nullptr) && (ip <= _maxAddress); ip++) {
+                    Lease* lease = Find(ip);
+
+                    if ((lease != nullptr) && (lease->Expiration() < now)) {
+                        result = lease;
+                        result->Update(id);
+                    }
+                }
+            }
+
+            if ((result != nullptr) && (result->Expiration() < now)) {
+                result->Expiration(now + OfferTime);
+            }
+
+            return (result != nullptr ? result->Raw() : 0);
+        }
+
+    private:
+        Lease* Find(const uint32_t address)
+        {
+            std::list<Lease>::iterator index(_leases.begin());
+            while ((index != _leases.end()) && (index->Raw() != address)) {
+                index++;
+            }
+
+            return (index != _leases.end() ? &(*index) : nullptr);
+        }
+        Lease* Find(const Identifier& id)
+        {
+            std::list<Lease>::iterator index(_leases.begin());
+            while ((index != _leases.end()) && (index->Id() != id)) {
+                index++;
+            }
+
+            return (index != _leases.end() ? &(*index) : nullptr);
+        }
+
+    private:
+        std::list<Lease> _leases;
+        uint32_t _minAddress;
+        uint32_t _maxAddress;
+        uint32_t _nextFreeIp;
+    };
+
+    // The lease table of the server, driven as Discover() in the DHCPServerImplementation does.
+    class Index {
+    public:
+        Index(const Index&) = delete;
+        Index& operator=(const Index&) = delete;
+
+        Index(const uint32_t minAddress, const uint32_t maxAddress)
+            : _leases()
+            , _nextFreeIp(minAddress)
+        {
+            _leases.Pool(minAddress, maxAddress);
+        }
+
+    public:
+        LeaseList& Leases()
+        {
+            return (_leases);
+        }
+        uint32_t Discover(const Identifier& id, const uint64_t now)
+        {
+            Lease* result = _leases.Find(id);
+
+            if (result == nullptr) {
+                uint32_t ip;
+
+                if (_leases.NextFree(_nextFreeIp, ip) == true) {
+                    result = _leases.Create(id, ip);
+                    _nextFreeIp = (ip + 1);
+                } else {
+                    result = _leases.Expired(now);
+
+                    if (result != nullptr) {
+                        _leases.Update(*result, id);
+                    }
+                }
+            }
+
+            if ((result != nullptr) && (result->Expiration() < now)) {
+                _leases.Expiration(*result, now + OfferTime);
+            }
+
+            return (result != nullptr ? result->Raw() : 0);
+        }
+
+    private:
+        LeaseList _leases;
+        uint32_t _nextFreeIp;
+    };
+
+public:
+    LeaseListBenchmark(const LeaseListBenchmark&) = delete;
+    LeaseListBenchmark& operator=(const LeaseListBenchmark&) = delete;
+
+    LeaseListBenchmark()
+        : TestBase(TestBase::DescriptionBuilder("DHCPServer DISCOVER storm, indexed lease table against a list scan"))
+    {
+        TestCore::BenchmarkCategory::Instance().Register(this);
+    }
+
+    virtual ~LeaseListBenchmark()
+    {
+        TestCore::BenchmarkCategory::Instance().Unregister(this);
+    }
+
+public:
+    // ICommand methods
+    string Execute(const string& params) final
+    {
+        const uint32_t counts[] = { 254, 1022, 4094 };
+        TestCore::TestResult jsonResult;
+        string result;
+        uint64_t smallest = 0;
+        uint64_t largest = 0;
+        uint64_t scan = 0;
+        bool same = true;
+
+        TRACE(TestCore::TestStart, (_T("Start execute of test: %s"), _name.c_str()));
+
+        for (const uint32_t count : counts) {
+            std::vector<Identifier> clients;
+
+            // Client identifiers as a client sends them: hardware type 1 (ethernet) and the MAC address.
+            for (uint32_t index = 0; index < (count + Latecomers); index++) {
+                const uint8_t id[] = { 1, 0x02, 0x00, static_cast<uint8_t>(index >> 24), static_cast<uint8_t>(index >> 16), static_cast<uint8_t>(index >> 8), static_cast<uint8_t>(index) };
+                clients.emplace_back(id, static_cast<uint8_t>(sizeof(id)));
+            }
+
+            Index index(MinAddress, MinAddress + count - 1);
+            Scan list(MinAddress, MinAddress + count - 1);
+            Storm indexed;
+            Storm scanned;
+
+            Run(index, clients, count, indexed);
+            Run(list, clients, count, scanned);
+
+            // Which of the expired leases a latecomer gets differs, the list scan takes the lowest address, as
+            // long as every latecomer gets one.
+            same = std::equal(indexed.Offers.begin(), indexed.Offers.begin() + (2 * count), scanned.Offers.begin()) && (same == true);
+            same = (std::count(indexed.Offers.begin(), indexed.Offers.end(), 0u) == 0) && (std::count(scanned.Offers.begin(), scanned.Offers.end(), 0u) == 0) && (same == true);
+
+            if (count == counts[0]) {
+                smallest = indexed.New + indexed.Repeat;
+            }
+            largest = indexed.New + indexed.Repeat;
+            scan = scanned.New + scanned.Repeat;
+
+            TestCore::Benchmark::Step(jsonResult, Core::NumberType<uint32_t>(count).Text() + _T(" clients, indexed: new ") + Core::NumberType<uint64_t>(indexed.New).Text() + _T(" ns, repeat ") + Core::NumberType<uint64_t>(indexed.Repeat).Text() + _T(" ns, expired ") + Core::NumberType<uint64_t>(indexed.Expired).Text() + _T(" ns per discover"), true);
+            TestCore::Benchmark::Step(jsonResult, Core::NumberType<uint32_t>(count).Text() + _T(" clients, list scan: new ") + Core::NumberType<uint64_t>(scanned.New).Text() + _T(" ns, repeat ") + Core::NumberType<uint64_t>(scanned.Repeat).Text() + _T(" ns, expired ") + Core::NumberType<uint64_t>(scanned.Expired).Text() + _T(" ns per discover"), true);
+        }
+
+        const bool flat = (largest <= ((smallest * 4) + 200));
+        const bool faster = (largest < scan);
+
+        TestCore::Benchmark::Step(jsonResult, _T("Indexed lease table offers the addresses the list scan offered, and one to every latecomer"), same);
+        TestCore::Benchmark::Step(jsonResult, _T("Indexed discover does not grow with the number of clients"), flat);
+        TestCore::Benchmark::Step(jsonResult, _T("Indexed discover beats the list scan with the most clients"), faster);
+
+        jsonResult.Name = _name;
+        jsonResult.OverallStatus = ((same == true) && (flat == true) && (faster == true) ? _T("Success") : _T("Failed"));
+
+        TRACE(TestCore::TestStart, (_T("End test: %s"), _name.c_str()));
+        jsonResult.ToString(result);
+        return result;
+    }
+
+    string Name() const final
+    {
+        return _name;
+    }
+
+private:
+    // All clients of the pool discover, and do so again, then the leases expire and the latecomers come in.
+    template <typename TABLE>
+    static void Run(TABLE& table, const std::vector<Identifier>& clients, const uint32_t count, Storm& storm)
+    {
+        const uint64_t now = Core::Time::Now().Ticks();
+
+        uint64_t start = TestCore::Benchmark::Now();
+
+        for (uint32_t index = 0; index < count; index++) {
+            storm.Offers.push_back(table.Discover(clients[index], now));
+        }
+
+        storm.New = (TestCore::Benchmark::Now() - start) / count;
+        start = TestCore::Benchmark::Now();
+
+        for (uint32_t index = 0; index < count; index++) {
+            storm.Offers.push_back(table.Discover(clients[index], now));
+        }
+
+        storm.Repeat = (TestCore::Benchmark::Now() - start) / count;
+
+        // None of the clients came back with a REQUEST, so their offers run out.
+        const uint64_t later = now + OfferTime + 1;
+
+        start = TestCore::Benchmark::Now();
+
+        for (uint32_t index = count; index < (count + Latecomers); index++) {
+            storm.Offers.push_back(table.Discover(clients[index], later));
+        }
+
+        storm.Expired = (TestCore::Benchmark::Now() - start) / Latecomers;
+    }
+
+private:
+    const string _name = _T("LeaseList");
+};
+
+static Exchange::ITestController::ITest* _singleton(Core::Service<LeaseListBenchmark>::Create<Exchange::ITestController::ITest>());
+} // namespace WPEFramework
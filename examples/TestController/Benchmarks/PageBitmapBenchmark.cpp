@@ -0,0 +1,158 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../Module.h"
+
+#include "../../../ResourceMonitor/PageBitmap.h"
+#include "../Core/TestBase.h"
+#include "../Core/Trace.h"
+#include "BenchmarkCategory.h"
+#include <interfaces/ITestController.h>
+
+#include <random>
+
+namespace WPEFramework {
+
+// The VSS and USS count of the ResourceMonitor over the physical page bitmaps: the wide-word count of both in
+// one pass against the per word loop, one pass per metric, it replaced.
+class PageBitmapBenchmark : public TestBase {
+private:
+    // Half a million words, the bitmap of a device with 64GB of 4KB pages, or of a sparse physical memory map.
+    static constexpr uint32_t Words = 512 * 1024;
+    static constexpr uint32_t Passes = 20;
+
+public:
+    PageBitmapBenchmark(const PageBitmapBenchmark&) = delete;
+    PageBitmapBenchmark& operator=(const PageBitmapBenchmark&) = delete;
+
+    PageBitmapBenchmark()
+        : TestBase(TestBase::DescriptionBuilder("ResourceMonitor page bitmap popcount, wide words against the per word loop"))
+    {
+        TestCore::BenchmarkCategory::Instance().Register(this);
+    }
+
+    virtual ~PageBitmapBenchmark()
+    {
+        TestCore::BenchmarkCategory::Instance().Unregister(this);
+    }
+
+public:
+    // ICommand methods
+    string Execute(const string& params) final
+    {
+        TestCore::TestResult jsonResult;
+        string result;
+        std::vector<uint32_t> map(Words);
+        std::vector<uint32_t> mask(Words);
+        std::mt19937 random(Words);
+        uint32_t total = 0;
+        uint32_t exclusive = 0;
+        uint32_t vss = 0;
+        uint32_t uss = 0;
+
+        TRACE(TestCore::TestStart, (_T("Start execute of test: %s"), _name.c_str()));
+
+        // Pages mapped by the tree, and the part of them shared with other trees.
+        for (uint32_t index = 0; index < Words; index++) {
+            map[index] = static_cast<uint32_t>(random());
+            mask[index] = static_cast<uint32_t>(random()) & static_cast<uint32_t>(random());
+        }
+
+        uint64_t start = TestCore::Benchmark::Now();
+
+        for (uint32_t pass = 0; pass < Passes; pass++) {
+            vss = CountSetBits(map.data(), nullptr);
+            uss = CountSetBits(map.data(), mask.data());
+        }
+
+        const uint64_t loop = (TestCore::Benchmark::Now() - start) / Passes;
+
+        start = TestCore::Benchmark::Now();
+
+        for (uint32_t pass = 0; pass < Passes; pass++) {
+            Plugin::PageBitmap::Count(map.data(), mask.data(), 0, Words, total, exclusive);
+        }
+
+        const uint64_t wide = (TestCore::Benchmark::Now() - start) / Passes;
+
+        const bool same = (total == vss) && (exclusive == uss);
+        const bool faster = (wide < loop);
+        const bool bounded = Bounded(map, mask);
+
+        TestCore::Benchmark::Step(jsonResult, Core::NumberType<uint32_t>(Words).Text() + _T(" words: per word loop ") + Core::NumberType<uint64_t>(loop / 1000).Text() + _T(" us, wide words ") + Core::NumberType<uint64_t>(wide / 1000).Text() + _T(" us for VSS and USS"), true);
+        TestCore::Benchmark::Step(jsonResult, _T("Wide-word count gives the VSS and USS of the per word loop"), same);
+        TestCore::Benchmark::Step(jsonResult, _T("Wide-word count beats the per word loop"), faster);
+        TestCore::Benchmark::Step(jsonResult, _T("Counts over a range of words, at any alignment, match the per word loop"), bounded);
+
+        jsonResult.Name = _name;
+        jsonResult.OverallStatus = ((same == true) && (faster == true) && (bounded == true) ? _T("Success") : _T("Failed"));
+
+        TRACE(TestCore::TestStart, (_T("End test: %s"), _name.c_str()));
+        jsonResult.ToString(result);
+        return result;
+    }
+
+    string Name() const final
+    {
+        return _name;
+    }
+
+private:
+    // The count as it was done before, a 32 bit popcount per word and a pass per metric.
+    static uint32_t CountSetBits(const uint32_t pageBuffer[], const uint32_t* inverseMask, const uint32_t begin = 0, const uint32_t end = Words)
+    {
+        uint32_t count = 0;
+
+        if (inverseMask == nullptr) {
+            for (uint32_t index = begin; index < end; index++) {
+                count += __builtin_popcount(pageBuffer[index]);
+            }
+        } else {
+            for (uint32_t index = begin; index < end; index++) {
+                count += __builtin_popcount(pageBuffer[index] & (~inverseMask[index]));
+            }
+        }
+
+        return count;
+    }
+    // The trees only count the words their processes touch, so the ranges start and end anywhere, also in
+    // the middle of a wide word.
+    static bool Bounded(const std::vector<uint32_t>& map, const std::vector<uint32_t>& mask)
+    {
+        const std::pair<uint32_t, uint32_t> ranges[] = { { 0, 0 }, { 0, 1 }, { 3, 4 }, { 1, 7 }, { 5, 38 }, { 13, 1000 }, { Words - 9, Words } };
+        bool result = true;
+
+        for (const std::pair<uint32_t, uint32_t>& range : ranges) {
+            uint32_t total = 0;
+            uint32_t exclusive = 0;
+
+            Plugin::PageBitmap::Count(map.data(), mask.data(), range.first, range.second, total, exclusive);
+
+            result = (total == CountSetBits(map.data(), nullptr, range.first, range.second)) && (exclusive == CountSetBits(map.data(), mask.data(), range.first, range.second)) && (result == true);
+        }
+
+        return (result);
+    }
+
+private:
+    const string _name = _T("PageBitmap");
+};
+
+static Exchange::ITestController::ITest* _singleton(Core::Service<PageBitmapBenchmark>::Create<Exchange::ITestController::ITest>());
+} // namespace WPEFramework
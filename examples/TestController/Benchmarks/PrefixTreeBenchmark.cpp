@@ -0,0 +1,154 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../Module.h"
+
+#include "../../../WebServer/PrefixTree.h"
+#include "../Core/TestBase.h"
+#include "../Core/Trace.h"
+#include "BenchmarkCategory.h"
+#include <interfaces/ITestController.h>
+
+namespace WPEFramework {
+
+// Routing of proxied requests in the WebServer: the longest prefix lookup in the path segment trie against the
+// scan over the list of proxies it replaced, with a growing number of proxies. The trie should cost about the
+// same whatever the number of proxies, the list scan grows with it.
+class PrefixTreeBenchmark : public TestBase {
+private:
+    static constexpr uint32_t Lookups = 100000;
+
+    struct Proxy {
+        string Path;
+    };
+
+public:
+    PrefixTreeBenchmark(const PrefixTreeBenchmark&) = delete;
+    PrefixTreeBenchmark& operator=(const PrefixTreeBenchmark&) = delete;
+
+    PrefixTreeBenchmark()
+        : TestBase(TestBase::DescriptionBuilder("WebServer proxy routing, path segment trie against a list scan"))
+    {
+        TestCore::BenchmarkCategory::Instance().Register(this);
+    }
+
+    virtual ~PrefixTreeBenchmark()
+    {
+        TestCore::BenchmarkCategory::Instance().Unregister(this);
+    }
+
+public:
+    // ICommand methods
+    string Execute(const string& params) final
+    {
+        const uint32_t counts[] = { 10, 100, 1000, 10000 };
+        TestCore::TestResult jsonResult;
+        string result;
+        uint64_t smallest = 0;
+        uint64_t largest = 0;
+        uint64_t scan = 0;
+
+        TRACE(TestCore::TestStart, (_T("Start execute of test: %s"), _name.c_str()));
+
+        for (const uint32_t count : counts) {
+            std::vector<Proxy> proxies(count);
+            std::vector<string> paths;
+            Plugin::PrefixTreeType<Proxy> tree;
+            std::list<Proxy*> list;
+            uint32_t hits = 0;
+
+            for (uint32_t index = 0; index < count; index++) {
+                proxies[index].Path = _T("/Service/Proxy") + Core::NumberType<uint32_t>(index).Text() + _T("/api");
+                tree.Add(proxies[index].Path, &(proxies[index]));
+                list.push_back(&(proxies[index]));
+            }
+
+            // Requests for proxies all over the list, and one in eight for a path that is not proxied at all.
+            for (uint32_t index = 0; index < 64; index++) {
+                if ((index % 8) == 7) {
+                    paths.push_back(_T("/Service/Unknown/index.html"));
+                } else {
+                    paths.push_back(proxies[(index * 2654435761u) % count].Path + _T("/v1/status"));
+                }
+            }
+
+            uint64_t start = TestCore::Benchmark::Now();
+
+            for (uint32_t index = 0; index < Lookups; index++) {
+                uint32_t matched;
+
+                if (tree.Find(paths[index % paths.size()], matched) != nullptr) {
+                    hits++;
+                }
+            }
+
+            const uint64_t trie = (TestCore::Benchmark::Now() - start) / Lookups;
+
+            start = TestCore::Benchmark::Now();
+
+            // The lookup as it was done before, the first proxy with a path that is a prefix of the request.
+            for (uint32_t index = 0; index < Lookups; index++) {
+                const string& path(paths[index % paths.size()]);
+                std::list<Proxy*>::const_iterator loop(list.begin());
+
+                while ((loop != list.end()) && ((path.compare(0, (*loop)->Path.length(), (*loop)->Path) != 0) || ((path.length() > (*loop)->Path.length()) && (path[(*loop)->Path.length()] != '/')))) {
+                    loop++;
+                }
+
+                if (loop != list.end()) {
+                    hits--;
+                }
+            }
+
+            scan = (TestCore::Benchmark::Now() - start) / Lookups;
+
+            if (count == counts[0]) {
+                smallest = trie;
+            }
+            largest = trie;
+
+            TestCore::Benchmark::Step(jsonResult, Core::NumberType<uint32_t>(count).Text() + _T(" proxies: trie ") + Core::NumberType<uint64_t>(trie).Text() + _T(" ns, list ") + Core::NumberType<uint64_t>(scan).Text() + _T(" ns per lookup"), (hits == 0));
+        }
+
+        // A couple of extra string compares per level are fine, growing with the number of proxies is not.
+        const bool flat = (largest <= ((smallest * 4) + 100));
+        const bool faster = (largest < scan);
+
+        TestCore::Benchmark::Step(jsonResult, _T("Trie lookup does not grow with the number of proxies"), flat);
+        TestCore::Benchmark::Step(jsonResult, _T("Trie lookup beats the list scan with the most proxies"), faster);
+
+        jsonResult.Name = _name;
+        jsonResult.OverallStatus = ((flat == true) && (faster == true) ? _T("Success") : _T("Failed"));
+
+        TRACE(TestCore::TestStart, (_T("End test: %s"), _name.c_str()));
+        jsonResult.ToString(result);
+        return result;
+    }
+
+    string Name() const final
+    {
+        return _name;
+    }
+
+private:
+    const string _name = _T("PrefixTree");
+};
+
+static Exchange::ITestController::ITest* _singleton(Core::Service<PrefixTreeBenchmark>::Create<Exchange::ITestController::ITest>());
+} // namespace WPEFramework